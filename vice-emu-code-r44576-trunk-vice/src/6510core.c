@@ -2205,7 +2205,9 @@ static const uint8_t rewind_fetch_tab[] = {
 /* Here, the CPU is emulated. */
 
 {
+#ifndef cpu_is_jammed
     static int cpu_is_jammed = 0;
+#endif
     unsigned int tmpa; /* needed for some of the opcode macros */
 #if !defined(DRIVE_CPU)
     CLOCK profiling_clock_start;
@@ -28,6 +28,7 @@
 #ifndef VICE_ALARM_H
 #define VICE_ALARM_H
 
+#include "hostprofile.h"
 #include "types.h"
 
 #define ALARM_CONTEXT_MAX_PENDING_ALARMS 0x100
@@ -140,7 +141,9 @@ inline static void alarm_context_dispatch(alarm_context_t *context,
     idx = context->next_pending_alarm_idx;
     alarm = context->pending_alarms[idx].alarm;
 
+    HOSTPROFILE_ENTER(HOSTPROFILE_ALARM);
     (alarm->callback)(offset, alarm->data);
+    HOSTPROFILE_LEAVE(HOSTPROFILE_ALARM);
 }
 
 inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
@@ -34,6 +34,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "rewind.h"
 #include "uiactions.h"
 #include "uiapi.h"
 #include "uisnapshot.h"
@@ -78,6 +79,15 @@ static void snapshot_quicksave_action(ui_action_map_t *self)
 {
     ui_snapshot_quicksave_snapshot();
 }
+
+/** \brief  Rewind to an earlier state action
+ *
+ * \param[in]   self    action map
+ */
+static void snapshot_rewind_action(ui_action_map_t *self)
+{
+    rewind_trigger(rewind_get_interval());
+}
 /* }}} */
 
 /* {{{ History actions */
@@ -160,6 +170,9 @@ static const ui_action_map_t snapshot_actions[] = {
     {   .action  = ACTION_SNAPSHOT_QUICKSAVE,
         .handler = snapshot_quicksave_action
     },
+    {   .action  = ACTION_SNAPSHOT_REWIND,
+        .handler = snapshot_rewind_action
+    },
 
     /* History actions */
     {   .action   = ACTION_HISTORY_RECORD_START,
@@ -493,6 +493,9 @@ static ui_menu_item_t snapshot_menu[] = {
     { "Quicksave snapshot", UI_MENU_TYPE_ITEM_ACTION,
       ACTION_SNAPSHOT_QUICKSAVE,
       NULL, false },
+    { "Rewind to an earlier state", UI_MENU_TYPE_ITEM_ACTION,
+      ACTION_SNAPSHOT_REWIND,
+      NULL, false },
 
     UI_MENU_SEPARATOR,
 
@@ -51,6 +51,7 @@ static const vice_gtk3_combo_entry_int_t idle_methods[] = {
     { "None",           DRIVE_IDLE_NO_IDLE },
     { "Skip cycles",    DRIVE_IDLE_SKIP_CYCLES },
     { "Trap idle",      DRIVE_IDLE_TRAP_IDLE },
+    { "Detect idle loops", DRIVE_IDLE_LOOP_DETECT },
     { NULL,             -1 }
 };
 
@@ -1035,6 +1035,11 @@ DRIVE_EXBOARD_MENU(11)
             .callback = set_idle_callback,                                      \
             .data     = (ui_callback_data_t)(DRIVE_IDLE_TRAP_IDLE + (x << 8))   \
         },                                                                      \
+        {   .string   = "Detect idle loops",                                    \
+            .type     = MENU_ENTRY_OTHER_TOGGLE,                                \
+            .callback = set_idle_callback,                                      \
+            .data     = (ui_callback_data_t)(DRIVE_IDLE_LOOP_DETECT + (x << 8)) \
+        },                                                                      \
         SDL_MENU_LIST_END                                                       \
     };
 
@@ -283,6 +283,11 @@ ui_menu_entry_t snapshot_menu[] = {
         .type      = MENU_ENTRY_OTHER,
         .activated = MENU_EXIT_UI_STRING
     },
+    {   .action    = ACTION_SNAPSHOT_REWIND,
+        .string    = "Rewind to an earlier state",
+        .type      = MENU_ENTRY_OTHER,
+        .activated = MENU_EXIT_UI_STRING
+    },
     SDL_MENU_ITEM_SEPARATOR,
 
     {   .action    = ACTION_HISTORY_RECORD_START,
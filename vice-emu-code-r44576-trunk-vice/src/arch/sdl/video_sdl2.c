@@ -299,6 +299,10 @@ static void recreate_canvas_textures(video_canvas_t *canvas)
         log_error(sdlvideo_log, "SDL_CreateTexture() failed on recreation: %s\n", SDL_GetError());
         return;
     }
+
+    /* both textures are empty, fill them with the whole screen */
+    canvas->full_uploads = 2;
+    canvas->videoconfig->partial_render_valid = 0;
 }
 
 
@@ -727,7 +731,8 @@ static int sdl_canvas_is_visible(struct video_canvas_s *canvas)
 /* called from raster/raster.c:realize_canvas */
 video_canvas_t *video_canvas_create(video_canvas_t *canvas, unsigned int *width, unsigned int *height, int mapped)
 {
-    /* nothing to do here, the real work is done in sdl_ui_init_finalize */
+    /* nothing else to do here, the real work is done in sdl_ui_init_finalize */
+    canvas->videoconfig->partial_render = 1;
     return canvas;
 }
 
@@ -740,6 +745,8 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
     uint8_t *backup;
     SDL_RendererFlip flip = 0;
     double angle = 0;
+    int overlay;
+    int damage_first, damage_last;
 
     /* If the canvas isn't initialized, skip this */
     if ((canvas == NULL) || (canvas->screen == NULL)) {
@@ -750,6 +757,16 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
         return;
     }
 
+    /* The overlays and the menu are drawn into the draw buffer after the
+       changed lines were found, so everything is rendered while they are
+       shown and in the frame after.  */
+    overlay = (sdl_vsid_state & SDL_VSID_ACTIVE) || (sdl_vkbd_state & SDL_VKBD_ACTIVE)
+              || (uistatusbar_state & (UISTATUSBAR_ACTIVE|UISTATUSBAR_ACTIVE_VDC))
+              || sdl_menu_state || machine_class == VICE_MACHINE_VSID;
+    if (overlay) {
+        canvas->videoconfig->partial_render_valid = 0;
+    }
+
     if (sdl_vsid_state & SDL_VSID_ACTIVE) {
         sdl_vsid_draw();
     }
@@ -794,6 +811,9 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
     } else {
         video_canvas_render(canvas, (uint8_t *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch);
     }
+    if (overlay) {
+        canvas->videoconfig->partial_render_valid = 0;
+    }
 
     if (recreate_textures) {
         recreate_all_textures();
@@ -803,8 +823,34 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
          *       SDL_UpdateTexture below updates the entire canvas */
     }
 
-    /* Upload the new frame to the GPU texture. TODO: use SDL_LockTexture for this as the docs day it's faster. */
-    SDL_UpdateTexture(canvas->texture, NULL, canvas->screen->pixels, canvas->screen->pitch);
+    /* Upload the new frame to the GPU texture. TODO: use SDL_LockTexture for this as the docs day it's faster.
+       The texture still holds the frame before the previous one, so only
+       the rows that changed in either of the last two frames are uploaded. */
+    damage_first = canvas->draw_buffer->damage_first;
+    damage_last = canvas->draw_buffer->damage_last;
+    if (canvas->full_uploads > 0) {
+        canvas->full_uploads--;
+        SDL_UpdateTexture(canvas->texture, NULL, canvas->screen->pixels, canvas->screen->pitch);
+    } else {
+        int first = MIN(damage_first, canvas->previous_damage_first);
+        int last = MAX(damage_last, canvas->previous_damage_last);
+
+        first = MAX(first, 0);
+        last = MIN(last, canvas->screen->h - 1);
+        if (first <= last) {
+            SDL_Rect rect;
+
+            rect.x = 0;
+            rect.y = first;
+            rect.w = canvas->screen->w;
+            rect.h = last - first + 1;
+            SDL_UpdateTexture(canvas->texture, &rect,
+                              (uint8_t *)canvas->screen->pixels + (size_t)first * canvas->screen->pitch,
+                              canvas->screen->pitch);
+        }
+    }
+    canvas->previous_damage_first = damage_first;
+    canvas->previous_damage_last = damage_last;
 
     /* Render. */
     SDL_RenderClear(canvas->container->renderer);
@@ -1007,6 +1053,7 @@ void video_canvas_resize(struct video_canvas_s *canvas, char resize_canvas)
             SDL_FreeSurface(canvas->screen);
         }
         canvas->screen = new_screen;
+        canvas->videoconfig->partial_render_valid = 0;
 
         recreate_canvas_textures(canvas);
 
@@ -105,6 +105,13 @@ struct video_canvas_s {
     /** \brief Last frame's texture, used for interlaced modes. */
     SDL_Texture* previous_frame_texture;
 
+    /** \brief Rows of the screen that changed in the previous frame, that
+     *         frame went to the texture that is uploaded next */
+    int previous_damage_first, previous_damage_last;
+
+    /** \brief Number of frames that still need a full texture upload */
+    int full_uploads;
+
     /** \brief The SDL2 objects that this canvas can output to. */
     video_container_t* container;
 #endif
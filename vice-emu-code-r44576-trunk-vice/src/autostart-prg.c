@@ -352,6 +352,92 @@ int autostart_prg_with_disk_image(int unit, int drive, const char *file_name,
     return result;
 }
 
+/* Read `program_name' (PETSCII, "*" for the first file) from the disk image
+   attached to unit:drive through the virtual drive and keep it for
+   autostart_prg_perform_injection(), so that it does not have to be loaded
+   by the KERNAL.  */
+int autostart_prg_with_disk_injection(int unit, int drive,
+                                      const char *program_name,
+                                      log_t log)
+{
+    const int secondary = 0;
+    autostart_prg_t *prg;
+    vdrive_t *vdrive;
+    uint8_t name[20];
+    uint8_t *buffer;
+    unsigned int name_len, len;
+    uint8_t data;
+    int status;
+
+    DBG(("autostart_prg_with_disk_injection (unit: %d drive: %d program_name: %s)",
+         unit, drive, program_name));
+
+    vdrive = file_system_get_vdrive((unsigned int)unit);
+    if (vdrive == NULL || vdrive->image == NULL) {
+        return -1;
+    }
+
+    name_len = 0;
+    if (drive == 1) {
+        name[name_len++] = '1';
+        name[name_len++] = ':';
+    }
+    while (*program_name && name_len < sizeof(name)) {
+        name[name_len++] = (uint8_t)*program_name++;
+    }
+
+    if (vdrive_iec_open(vdrive, name, name_len, secondary, NULL) != SERIAL_OK) {
+        log_error(log, "Cannot open program on unit #%d:%d.", unit, drive);
+        return -1;
+    }
+
+    /* load address plus the largest program that fits into memory */
+    buffer = lib_malloc(0x10002);
+    len = 0;
+    do {
+        status = vdrive_iec_read(vdrive, &data, secondary);
+        if (status & SERIAL_ERROR) {
+            break;
+        }
+        if (len == 0x10002) {
+            status = SERIAL_ERROR;
+            break;
+        }
+        buffer[len++] = data;
+    } while (status == SERIAL_OK);
+
+    vdrive_iec_close(vdrive, secondary);
+
+    if ((status & SERIAL_ERROR) || len < 3) {
+        log_error(log, "Cannot read program from unit #%d:%d.", unit, drive);
+        lib_free(buffer);
+        return -1;
+    }
+
+    prg = lib_malloc(sizeof(autostart_prg_t));
+    prg->start_addr = (uint16_t)(buffer[0] | (buffer[1] << 8));
+    prg->size = len - 2;
+
+    if (prg->start_addr + prg->size - 1 > 0xffff) {
+        log_error(log, "Invalid size of program: %" PRIu32, prg->size);
+        lib_free(prg);
+        lib_free(buffer);
+        return -1;
+    }
+
+    prg->data = lib_malloc(prg->size);
+    memcpy(prg->data, buffer + 2, prg->size);
+    lib_free(buffer);
+
+    /* clean up old injection */
+    if (inject_prg != NULL) {
+        free_prg(inject_prg);
+    }
+    inject_prg = prg;
+
+    return 0;
+}
+
 int autostart_prg_perform_injection(log_t log)
 {
     unsigned int i;
@@ -51,6 +51,7 @@ int autostart_prg_with_virtual_fs(int unit, int drive, const char *file_name, fi
 int autostart_prg_with_ram_injection(const char *file_name, fileio_info_t *fh, log_t log);
 int autostart_prg_with_disk_image(int unit, int drive, const char *file_name, fileio_info_t *fh, log_t log,
                                   const char *image_name);
+int autostart_prg_with_disk_injection(int unit, int drive, const char *program_name, log_t log);
 
 int autostart_prg_perform_injection(log_t log);
 
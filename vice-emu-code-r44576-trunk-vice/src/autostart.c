@@ -200,6 +200,8 @@ static int AutostartDelayRandom = 0;
 
 static int AutostartPrgMode = AUTOSTART_PRG_MODE_VFS;
 
+static int AutostartDiskInject = 0;
+
 static char *AutostartPrgDiskImage = NULL;
 
 static const char * const AutostartRunCommandsAvailable[] = {
@@ -320,6 +322,14 @@ static int set_autostart_prg_mode(int val, void *param)
     return 0;
 }
 
+/*! \internal \brief set if programs on disk images should be injected */
+static int set_autostart_disk_inject(int val, void *param)
+{
+    AutostartDiskInject = val ? 1 : 0;
+
+    return 0;
+}
+
 /*! \internal \brief set disk image name of autostart prg mode */
 
 static int set_autostart_prg_disk_image(const char *val, void *param)
@@ -354,6 +364,8 @@ static resource_int_t resources_int[] = {
       &AutostartWarp, set_autostart_warp, NULL },
     { "AutostartPrgMode", AUTOSTART_PRG_MODE_DEFAULT, RES_EVENT_NO, (resource_value_t)0,
       &AutostartPrgMode, set_autostart_prg_mode, NULL },
+    { "AutostartDiskInject", 0, RES_EVENT_NO, (resource_value_t)0,
+      &AutostartDiskInject, set_autostart_disk_inject, NULL },
     { "AutostartDelay", 0, RES_EVENT_NO, (resource_value_t)0,
       &AutostartDelay, set_autostart_delay, NULL },
     { "AutostartDelayRandom", 1, RES_EVENT_NO, (resource_value_t)0,
@@ -446,6 +458,12 @@ static const cmdline_option_t cmdline_options[] =
     { "-autostartprgdiskimage", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "AutostartPrgDiskImage", NULL,
       "<Name>", "Set disk image for autostart of PRG files" },
+    { "-autostart-disk-inject", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "AutostartDiskInject", (resource_value_t)1,
+      NULL, "On autostart from disk, inject the program into RAM instead of loading it" },
+    { "+autostart-disk-inject", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "AutostartDiskInject", (resource_value_t)0,
+      NULL, "On autostart from disk, load the program with the KERNAL" },
     { "-autostart-delay", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "AutostartDelay", NULL,
       "<seconds>", "Set initial autostart delay (0: use default)" },
@@ -1653,6 +1671,21 @@ static void setup_for_disk_ready(int unit, int drive)
         ));
 }
 
+/* The program is read from the image before the reset, so the drive is not
+   needed until the program runs.  */
+static void setup_for_disk_injection(int unit, int drive)
+{
+    if (handle_drive_true_emulation_overridden
+        && get_true_drive_emulation_state(unit)) {
+        /* restored by autostart_done() */
+        set_true_drive_emulation_mode(0, unit);
+    }
+    DBG(("setup_for_disk_injection: unit: %d drive: %d TDE: %s",
+        unit, drive, get_true_drive_emulation_state(unit) ? "on" : "off"));
+    autostart_disk_unit = unit;
+    autostart_disk_drive = drive;
+}
+
 /* Autostart disk image `file_name'.  */
 int autostart_disk(int unit, int drive, const char *file_name, const char *program_name,
                    unsigned int program_number, unsigned int runmode)
@@ -1732,6 +1765,19 @@ int autostart_disk(int unit, int drive, const char *file_name, const char *progr
                 }
             }
 #endif
+            if (AutostartDiskInject
+                && autostart_prg_with_disk_injection(unit, drive, name,
+                                                     autostart_log) >= 0) {
+                log_message(autostart_log,
+                            "Injecting program from unit #%d:%d.", unit, drive);
+                autostart_type = AUTOSTART_PRG_INJECT;
+                setup_for_disk_injection(unit, drive);
+                reboot_for_autostart(name, AUTOSTART_INJECT, runmode);
+                lib_free(name);
+
+                return 0;
+            }
+
             autostart_type = AUTOSTART_DISK_IMAGE;
             setup_for_disk(unit, drive);
             reboot_for_autostart(name, AUTOSTART_HASDISK, runmode);
@@ -97,6 +97,7 @@
 #include "vdrive-iec.h"
 #include "vdrive-rel.h"
 #include "vdrive.h"
+#include "zarchive.h"
 #include "zipcode.h"
 #include "p64.h"
 #include "fileio/p00.h"
@@ -214,6 +215,8 @@ static int info_cmd(int nargs, char **args);
 static int list_cmd(int nargs, char **args);
 static int name_cmd(int nargs, char **args);
 static int p00save_cmd(int nargs, char **args);
+static int pack_cmd(int nargs, char **args);
+static int packlist_cmd(int nargs, char **args);
 static int pwd_cmd(int nargs, char **args);
 static int quit_cmd(int nargs, char **args);
 static int raw_cmd(int nargs, char **args); /* @ */
@@ -477,6 +480,17 @@ const command_t command_list[] = {
       "The <enable> argument should be either 0 or 1.",
       0, 2,
       p00save_cmd },
+    { "pack",
+      "pack <archive> <image1> [... <imageN>]",
+      "Create the indexed archive <archive> out of the specified disk and "
+      "tape\nimages.  Its members can be attached as `<archive>/<image>'.",
+      2, MAXARG,
+      pack_cmd },
+    { "packlist",
+      "packlist <archive>",
+      "List the images stored in the indexed archive <archive>.",
+      1, 1,
+      packlist_cmd },
     { "pwd",
       "pwd",
       "Show current host directory path",
@@ -6319,6 +6333,106 @@ static int p00save_cmd(int nargs, char **args)
 }
 
 
+/** \brief  Create an indexed archive out of a set of images
+ *
+ * Syntax: pack \<archive> \<image1> [... \<imageN>]
+ *
+ * The images are stored under their file names, without the directory.
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  0 on success, < 0 on failure
+ */
+static int pack_cmd(int nargs, char **args)
+{
+    zarchive_writer_t *w;
+    char *path;
+    int i;
+
+    archdep_expand_path(&path, args[1]);
+
+    if (util_file_exists(path)) {
+        fprintf(stderr, "`%s' already exists\n", path);
+        lib_free(path);
+        return FD_NOTWRT;
+    }
+
+    w = zarchive_create(path, ZARCHIVE_BLOCK_SIZE);
+    if (w == NULL) {
+        fprintf(stderr, "cannot create `%s'\n", path);
+        lib_free(path);
+        return FD_NOTWRT;
+    }
+
+    for (i = 2; i < nargs; i++) {
+        char *image, *member;
+
+        archdep_expand_path(&image, args[i]);
+        util_fname_split(image, NULL, &member);
+
+        if (zarchive_add_file(w, member, image) < 0) {
+            fprintf(stderr, "cannot add `%s' to `%s'\n", image, path);
+            lib_free(member);
+            lib_free(image);
+            zarchive_abort(w);
+            lib_free(path);
+            return FD_NOTRD;
+        }
+
+        lib_free(member);
+        lib_free(image);
+    }
+
+    if (zarchive_finish(w) < 0) {
+        fprintf(stderr, "cannot write `%s'\n", path);
+        lib_free(path);
+        return FD_WRTERR;
+    }
+
+    printf("packed %d image%s into `%s'\n",
+           nargs - 2, nargs == 3 ? "" : "s", path);
+    lib_free(path);
+    return FD_OK;
+}
+
+
+/** \brief  List the images stored in an indexed archive
+ *
+ * Syntax: packlist \<archive>
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  0 on success, < 0 on failure
+ */
+static int packlist_cmd(int nargs, char **args)
+{
+    zarchive_t *arc;
+    char *path;
+    unsigned int i;
+
+    archdep_expand_path(&path, args[1]);
+
+    arc = zarchive_open(path);
+    if (arc == NULL) {
+        fprintf(stderr, "cannot open archive `%s'\n", path);
+        lib_free(path);
+        return FD_NOTRD;
+    }
+
+    for (i = 0; i < zarchive_num_members(arc); i++) {
+        printf("%10lu  %s\n",
+               (unsigned long)zarchive_member_size(arc, i),
+               zarchive_member_name(arc, i));
+    }
+
+    zarchive_close(arc);
+    lib_free(path);
+    return FD_OK;
+}
+
+
 /** \brief  Change current host directory path
  *
  * Syntax: cd \<hostdir>
@@ -29,6 +29,7 @@
 #include <stdio.h>
 
 #include "cpmcart.h"
+#include "hostprofile.h"
 #include "monitor.h"
 #include "vicii-cycle.h"
 
@@ -48,7 +49,9 @@ int maincpu_ba_low_flags = 0;
     interrupt_delay();                             \
     maincpu_clk++;                                 \
     maincpu_ba_low_flags &= ~MAINCPU_BA_LOW_VICII; \
-    maincpu_ba_low_flags |= vicii_cycle()
+    HOSTPROFILE_ENTER(HOSTPROFILE_VICII);          \
+    maincpu_ba_low_flags |= vicii_cycle();         \
+    HOSTPROFILE_LEAVE(HOSTPROFILE_VICII)
 
 
 /* Skip cycle implementation */
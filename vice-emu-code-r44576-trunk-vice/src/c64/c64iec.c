@@ -36,6 +36,7 @@
 #include "cartridge.h"
 #include "drive.h"
 #include "iecbus.h"
+#include "iecbustrace.h"
 #include "iecdrive.h"
 #include "maincpu.h"
 #include "types.h"
@@ -135,6 +136,7 @@ void iec_update_ports(void)
     iecbus.drv_port = (((iecbus.cpu_port >> 4) & 0x4) | (iecbus.cpu_port >> 7) | ((iecbus.cpu_bus << 3) & 0x80));
 
     IEC_DEBUG_PORTS();
+    IECBUSTRACE_UPDATE(&iecbus);
 }
 
 void iec_update_ports_embedded(void)
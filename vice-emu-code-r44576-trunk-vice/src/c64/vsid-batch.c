@@ -0,0 +1,407 @@
+/*
+ * vsid-batch.c - Render lists of PSID tunes to sound files.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+ * -psidbatch <list> renders PSID tunes to sound files, one file per tune,
+ * in warp mode.  Every line of the list is
+ *
+ *   <file> [<tune> [<length>]]
+ *
+ * Without a tune all tunes of the file are rendered.  The length is given
+ * in seconds or as [M]M:SS[.f], without it the length from the HVSC song
+ * length database is used, or -psidbatchlength if the tune isn't in there.
+ * The files are written to -psidbatchdir as <name>-<tune>.<format>, with
+ * <format> being the recording device (-psidbatchformat, wav by default).
+ *
+ * With -instances the lines of the list are split over the instances, so
+ * the tunes are rendered in parallel.  VSID exits when all tunes are done,
+ * with 1 if any of them couldn't be rendered.
+ */
+
+#include "vice.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "archdep_tick.h"
+#include "cmdline.h"
+#include "hvsc.h"
+#include "instances.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "psid.h"
+#include "resources.h"
+#include "util.h"
+#include "vsid-batch.h"
+
+typedef struct batch_entry_s {
+    char *name;
+    int tune;           /* 0: all tunes */
+    long length;        /* in ms, 0: from the song length database */
+} batch_entry_t;
+
+static batch_entry_t *entries = NULL;
+static int num_entries = 0;
+
+static char *batch_dir = NULL;
+static char *batch_format = NULL;
+static int batch_default_length = 180;
+
+/* current entry and tune */
+static int entry_index = -1;
+static int tune = 0;
+static int last_tune = 0;
+static long *song_lengths = NULL;
+static int num_song_lengths = 0;
+
+static int playing = 0;
+static unsigned int frames = 0;
+static long length = 0;
+static tick_t tune_start;
+
+static int started = 0;
+static int rendered = 0;
+static int failed = 0;
+static tick_t batch_start;
+
+static log_t batch_log = LOG_DEFAULT;
+
+void vsid_batch_shutdown(void)
+{
+    int i;
+
+    for (i = 0; i < num_entries; i++) {
+        lib_free(entries[i].name);
+    }
+    lib_free(entries);
+    entries = NULL;
+    num_entries = 0;
+    lib_free(song_lengths);
+    song_lengths = NULL;
+    lib_free(batch_dir);
+    batch_dir = NULL;
+    lib_free(batch_format);
+    batch_format = NULL;
+}
+
+/* Parse seconds or [M]M:SS[.f] into ms, -1 if `s' is neither.  */
+static long batch_parse_length(const char *s)
+{
+    char *end;
+    double secs;
+    long mins = 0;
+
+    if (!isdigit((unsigned char)*s)) {
+        return -1;
+    }
+    if (strchr(s, ':') != NULL) {
+        mins = strtol(s, &end, 10);
+        if (*end != ':') {
+            return -1;
+        }
+        s = end + 1;
+    }
+    secs = strtod(s, &end);
+    if (*end != 0 || secs < 0.0) {
+        return -1;
+    }
+    return mins * 60000 + (long)(secs * 1000.0 + 0.5);
+}
+
+/* Does `s' look like a tune number?  */
+static int batch_is_number(const char *s)
+{
+    if (*s == 0) {
+        return 0;
+    }
+    while (isdigit((unsigned char)*s)) {
+        s++;
+    }
+    return *s == 0;
+}
+
+/* Move on to the next tune to render, loading the next file of this
+   instance if needed.  Returns 0 when there are no tunes left.  */
+static int batch_next_tune(void)
+{
+    while (tune >= last_tune) {
+        batch_entry_t *entry;
+        int songs, default_tune;
+
+        lib_free(song_lengths);
+        song_lengths = NULL;
+        num_song_lengths = 0;
+
+        /* with instances, every instance takes every n-th line */
+        do {
+            entry_index++;
+        } while (entry_index < num_entries && instances_get_count() > 0
+                 && entry_index % instances_get_count() != instances_get_index());
+        if (entry_index >= num_entries) {
+            return 0;
+        }
+        entry = &entries[entry_index];
+
+        if (psid_load_file(entry->name) < 0) {
+            log_error(batch_log, "Cannot load `%s'.", entry->name);
+            failed++;
+            tune = last_tune = 0;
+            continue;
+        }
+        songs = psid_tunes(&default_tune);
+        if (entry->tune > songs) {
+            log_error(batch_log, "`%s' has no tune %d.", entry->name, entry->tune);
+            failed++;
+            tune = last_tune = 0;
+            continue;
+        }
+        if (entry->tune > 0) {
+            tune = entry->tune - 1;
+            last_tune = entry->tune;
+        } else {
+            tune = 0;
+            last_tune = songs;
+        }
+        if (entry->length == 0) {
+            num_song_lengths = hvsc_sldb_get_lengths(entry->name, &song_lengths);
+        }
+    }
+    tune++;
+    return 1;
+}
+
+static void batch_start_tune(void)
+{
+    batch_entry_t *entry = &entries[entry_index];
+    char *base, *name, *path;
+    char num[16];
+
+    if (entry->length > 0) {
+        length = entry->length;
+    } else if (tune <= num_song_lengths) {
+        length = song_lengths[tune - 1];
+    } else {
+        log_warning(batch_log, "No song length for `%s' tune %d, using %d seconds.",
+                    entry->name, tune, batch_default_length);
+        length = batch_default_length * 1000L;
+    }
+
+    util_fname_split(entry->name, NULL, &base);
+    if (strrchr(base, '.') != NULL) {
+        *strrchr(base, '.') = 0;
+    }
+    sprintf(num, "-%d.", tune);
+    name = util_concat(base, num, batch_format, NULL);
+    path = util_join_paths(batch_dir, name, NULL);
+
+    /* both changes close the file of the previous tune and open the new
+       one at the next sound flush */
+    resources_set_string("SoundRecordDeviceArg", path);
+    resources_set_string("SoundRecordDeviceName", batch_format);
+
+    log_message(batch_log, "Rendering `%s' tune %d (%.1f s) to `%s'.",
+                entry->name, tune, length / 1000.0, path);
+    lib_free(path);
+    lib_free(name);
+    lib_free(base);
+
+    machine_play_psid(tune);
+    machine_trigger_reset(MACHINE_RESET_MODE_SOFT);
+
+    frames = 0;
+    playing = 1;
+    tune_start = tick_now();
+}
+
+void vsid_batch_vsync(double rfsh_per_sec)
+{
+    if (num_entries == 0) {
+        return;
+    }
+
+    if (!started) {
+        started = 1;
+        batch_start = tick_now();
+        resources_set_string("SoundDeviceName", "dummy");
+        resources_set_int("Sound", 1);
+        resources_set_int("WarpMode", 1);
+    }
+
+    if (playing) {
+        frames++;
+        if (frames * 1000.0 / rfsh_per_sec < length) {
+            return;
+        }
+        playing = 0;
+        rendered++;
+        log_message(batch_log, "Rendered %.1f s in %.2f s.",
+                    length / 1000.0, (double)tick_now_delta(tune_start) / tick_per_second());
+    }
+
+    if (batch_next_tune()) {
+        batch_start_tune();
+        return;
+    }
+
+    resources_set_string("SoundRecordDeviceName", "");
+    log_message(batch_log, "%d tunes rendered in %.2f s, %d failed.",
+                rendered, (double)tick_now_delta(batch_start) / tick_per_second(), failed);
+    num_entries = 0;
+    archdep_vice_exit(failed ? 1 : 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int batch_load_list(const char *name, void *param)
+{
+    FILE *f;
+    char buf[1024];
+    int num_alloc = 0;
+    int line = 0;
+
+    f = fopen(name, MODE_READ_TEXT);
+    if (f == NULL) {
+        log_error(batch_log, "Cannot open PSID batch list `%s'.", name);
+        return -1;
+    }
+
+    while (util_get_line(buf, (int)sizeof(buf), f) >= 0) {
+        batch_entry_t *entry;
+        char *words[2];
+        int num_words = 0;
+        char *p;
+
+        line++;
+        if (buf[0] == 0 || buf[0] == '#') {
+            continue;
+        }
+
+        /* up to two numbers at the end of the line are the tune and the
+           length, the rest is the file name */
+        while (num_words < 2) {
+            p = buf + strlen(buf);
+            while (p > buf && !isspace((unsigned char)p[-1])) {
+                p--;
+            }
+            if (p == buf || (!batch_is_number(p) && batch_parse_length(p) < 0)) {
+                break;
+            }
+            p--;
+            words[num_words++] = p + 1;
+            while (p > buf && isspace((unsigned char)p[-1])) {
+                p--;
+            }
+            *p = 0;
+        }
+
+        if (num_entries == num_alloc) {
+            num_alloc = num_alloc ? num_alloc * 2 : 256;
+            entries = lib_realloc(entries, sizeof(batch_entry_t) * (size_t)num_alloc);
+        }
+        entry = &entries[num_entries];
+        entry->tune = 0;
+        entry->length = 0;
+
+        /* words are in reverse order, a single one is the tune unless it
+           can only be a length */
+        if (num_words == 2) {
+            if (!batch_is_number(words[1])) {
+                log_error(batch_log, "%s:%d: expected a tune number.", name, line);
+                fclose(f);
+                return -1;
+            }
+            entry->tune = atoi(words[1]);
+            entry->length = batch_parse_length(words[0]);
+        } else if (num_words == 1) {
+            if (batch_is_number(words[0])) {
+                entry->tune = atoi(words[0]);
+            } else {
+                entry->length = batch_parse_length(words[0]);
+            }
+        }
+        entry->name = lib_strdup(buf);
+        num_entries++;
+    }
+    fclose(f);
+
+    if (num_entries == 0) {
+        log_error(batch_log, "PSID batch list `%s' is empty.", name);
+        return -1;
+    }
+    if (batch_dir == NULL) {
+        batch_dir = lib_strdup(".");
+    }
+    if (batch_format == NULL) {
+        batch_format = lib_strdup("wav");
+    }
+    return 0;
+}
+
+static int batch_set_dir(const char *value, void *param)
+{
+    return util_string_set(&batch_dir, value);
+}
+
+static int batch_set_format(const char *value, void *param)
+{
+    return util_string_set(&batch_format, value);
+}
+
+static int batch_set_length(const char *value, void *param)
+{
+    int secs = atoi(value);
+
+    if (secs < 1) {
+        return -1;
+    }
+    batch_default_length = secs;
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-psidbatch", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      batch_load_list, NULL, NULL, NULL,
+      "<Name>", "Render the tunes listed in <Name> to sound files in warp mode and exit" },
+    { "-psidbatchdir", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      batch_set_dir, NULL, NULL, NULL,
+      "<Path>", "Directory for the sound files of -psidbatch" },
+    { "-psidbatchformat", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      batch_set_format, NULL, NULL, NULL,
+      "<Name>", "Sound recording driver used by -psidbatch (wav, flac, ...)" },
+    { "-psidbatchlength", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      batch_set_length, NULL, NULL, NULL,
+      "<Seconds>", "Length of tunes that are not in the song length database (default 180)" },
+    CMDLINE_LIST_END
+};
+
+int vsid_batch_cmdline_options_init(void)
+{
+    batch_log = log_open("PSIDBatch");
+
+    return cmdline_register_options(cmdline_options);
+}
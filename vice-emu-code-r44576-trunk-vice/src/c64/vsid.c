@@ -65,6 +65,7 @@
 #include "vicii.h"
 #include "vicii-mem.h"
 #include "video.h"
+#include "vsid-batch.h"
 #include "vsid-cmdline-options.h"
 #include "vsidui.h"
 #include "vsid-debugcart.h"
@@ -155,6 +156,10 @@ int machine_cmdline_options_init(void)
         init_cmdline_options_fail("debug cart");
         return -1;
     }
+    if (vsid_batch_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("psid batch");
+        return -1;
+    }
     return 0;
 }
 
@@ -283,6 +288,7 @@ void machine_specific_shutdown(void)
 
     sid_cmdline_options_shutdown();
 
+    vsid_batch_shutdown();
     psid_shutdown();
 }
 
@@ -326,6 +332,8 @@ static void machine_vsync_hook(void)
         time = playtime;
         vsid_ui_display_time(playtime);
     }
+
+    vsid_batch_vsync(machine_timing.rfsh_per_sec);
 }
 
 void machine_set_restore_key(int v)
@@ -34,6 +34,7 @@
 #include "c64iec.h"
 #include "drive.h"
 #include "iecbus.h"
+#include "iecbustrace.h"
 #include "iecdrive.h"
 #include "maincpu.h"
 #include "types.h"
@@ -58,6 +59,8 @@ void iec_update_ports(void)
     iecbus.drv_port = (((iecbus.cpu_port >> 4) & 0x4)
                        | (iecbus.cpu_port >> 7)
                        | ((iecbus.cpu_bus << 3) & 0x80));
+
+    IECBUSTRACE_UPDATE(&iecbus);
 }
 
 void iec_update_ports_embedded(void)
@@ -1268,6 +1268,7 @@ inline static void bit_write(int port)
         current_image[port]->cycle_counter_total = current_image[port]->cycle_counter;
     }
     current_image[port]->has_changed = 1;
+    tap_discard_contents(current_image[port]);
     datasette_update_ui_counter(port);
 }
 
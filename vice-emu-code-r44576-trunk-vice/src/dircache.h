@@ -0,0 +1,50 @@
+/*
+ * dircache.h - Cache of the host directories used for CBM files.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_DIRCACHE_H
+#define VICE_DIRCACHE_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+/* Length of the CBM name stored in a P00 header.  */
+#define DIRCACHE_P00_NAME_LEN   17
+
+typedef struct dircache_s dircache_t;
+
+dircache_t *dircache_open(const char *path);
+void dircache_close(dircache_t *dc);
+void dircache_invalidate(void);
+void dircache_shutdown(void);
+
+unsigned int dircache_num_entries(const dircache_t *dc);
+const char *dircache_name(const dircache_t *dc, unsigned int index);
+const char *dircache_petscii_name(dircache_t *dc, unsigned int index);
+int dircache_stat(dircache_t *dc, unsigned int index, size_t *len,
+                  unsigned int *isdir, unsigned int *perms);
+int dircache_p00_name(dircache_t *dc, unsigned int index, uint8_t *cbmname);
+unsigned int dircache_prefix_count(dircache_t *dc, unsigned int index,
+                                   unsigned int len, int petscii);
+
+#endif
@@ -55,6 +55,12 @@ static const cmdline_option_t cmdline_options[] =
     { "-drivesoundvolume", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "DriveSoundEmulationVolume", NULL,
       "<Volume>", "Set volume for disk drive sound emulation (0-4000)" },
+    { "-drivethreads", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DriveThreads", (void *)1,
+      NULL, "Run the emulated drive CPUs on separate host threads" },
+    { "+drivethreads", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DriveThreads", (void *)0,
+      NULL, "Run all emulated drive CPUs on the emulation thread" },
     CMDLINE_LIST_END
 };
 
@@ -68,7 +74,7 @@ static cmdline_option_t cmd_drive[] =
       "<method>", "Set drive 40 track extension policy (0: never, 1: ask, 2: on access)" },
     { NULL, SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, NULL, NULL,
-      "<method>", "Set drive idling method (0: no traps, 1: skip cycles, 2: trap idle)" },
+      "<method>", "Set drive idling method (0: no traps, 1: skip cycles, 2: trap idle, 3: detect idle loops)" },
     { NULL, SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, NULL, NULL,
       "<RPM>", "Set drive rpm (30000 = 300rpm)" },
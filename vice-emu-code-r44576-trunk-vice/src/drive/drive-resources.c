@@ -61,6 +61,9 @@ int drive_sound_emulation;
 /* volume of the drive sound */
 int drive_sound_emulation_volume;
 
+/* Run the drive CPUs on their own threads?  */
+int drive_threads;
+
 static int set_drive_true_emulation(int val, void *param)
 {
     unsigned int dnr;
@@ -123,6 +126,13 @@ static int set_drive_sound_emulation_volume(int val, void *param)
     return 0;
 }
 
+static int set_drive_threads(int val, void *param)
+{
+    drive_threads = val ? 1 : 0;
+
+    return 0;
+}
+
 static int set_drive_extend_image_policy(int val, void *param)
 {
     switch (val) {
@@ -293,6 +303,7 @@ static int set_drive_idling_method(int val, void *param)
     switch (val) {
         case DRIVE_IDLE_SKIP_CYCLES:
         case DRIVE_IDLE_TRAP_IDLE:
+        case DRIVE_IDLE_LOOP_DETECT:
         case DRIVE_IDLE_NO_IDLE:
             break;
         default:
@@ -383,6 +394,8 @@ static const resource_int_t resources_int[] = {
       &drive_sound_emulation, set_drive_sound_emulation, NULL },
     { "DriveSoundEmulationVolume", 1000, RES_EVENT_NO, (resource_value_t)1000,
       &drive_sound_emulation_volume, set_drive_sound_emulation_volume, NULL },
+    { "DriveThreads", 0, RES_EVENT_NO, (resource_value_t)0,
+      &drive_threads, set_drive_threads, NULL },
     RESOURCE_INT_LIST_END
 };
 
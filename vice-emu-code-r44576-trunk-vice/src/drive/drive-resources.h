@@ -29,6 +29,7 @@
 
 extern int drive_sound_emulation;
 extern int drive_sound_emulation_volume;
+extern int drive_threads;
 
 int drive_resources_init(void);
 void drive_resources_shutdown(void);
@@ -30,6 +30,7 @@
 #include "drive.h"
 #include "drive-resources.h"
 #include "drive-sound.h"
+#include "drivethread.h"
 #include "sound.h"
 
 static const signed char hum[] = {
@@ -1610,6 +1611,8 @@ static sound_chip_t drive_sound = {
 
 void drive_sound_update(int i, int unit)
 {
+    drivethread_sync(diskunit_context[unit]);
+
     if (!drive_sound_emulation) {
         drive_sound.chip_enabled = 0;
         return;
@@ -1629,6 +1632,8 @@ void drive_sound_update(int i, int unit)
 
 void drive_sound_head(int track, int dir, int unit)
 {
+    drivethread_sync(diskunit_context[unit]);
+
     if (!drive_sound_emulation) {
         drive_sound.chip_enabled = 0;
         return;
@@ -51,14 +51,17 @@
 #include "diskconstants.h"
 #include "diskimage.h"
 #include "drive-check.h"
+#include "drive-resources.h"
 #include "drive.h"
 #include "drivecpu.h"
 #include "drivecpu65c02.h"
 #include "driveimage.h"
 #include "drivesync.h"
+#include "drivethread.h"
 #include "driverom.h"
 #include "drivetypes.h"
 #include "gcr.h"
+#include "hostprofile.h"
 #include "iecbus.h"
 #include "iecdrive.h"
 #include "lib.h"
@@ -301,6 +304,8 @@ void drive_shutdown(void)
         return;
     }
 
+    drivethread_shutdown();
+
     for (unr = 0; unr < NUM_DISK_UNITS; unr++) {
         diskunit_context_t *unit = diskunit_context[unr];
 
@@ -986,25 +991,37 @@ int drive_num_leds(unsigned int dnr)
 
 void drive_cpu_execute_one(diskunit_context_t *drv, CLOCK clk_value)
 {
+    HOSTPROFILE_ENTER(HOSTPROFILE_DRIVE_CPU);
     if (drv->type == DRIVE_TYPE_2000 || drv->type == DRIVE_TYPE_4000 ||
         drv->type == DRIVE_TYPE_CMDHD) {
         drivecpu65c02_execute(drv, clk_value);
     } else {
         drivecpu_execute(drv, clk_value);
     }
+    HOSTPROFILE_LEAVE(HOSTPROFILE_DRIVE_CPU);
 }
 
 void drive_cpu_execute_all(CLOCK clk_value)
 {
-    unsigned int dnr;
+    unsigned int dnr, units = 0;
 
     for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
         diskunit_context_t *unit = diskunit_context[dnr];
 
         if (unit->enable) {
-            drive_cpu_execute_one(unit, clk_value);
+            units |= 1u << dnr;
+            if (!drive_threads) {
+                drive_cpu_execute_one(unit, clk_value);
+            }
         }
     }
+
+    if (units && drive_threads) {
+        drivethread_execute(units, clk_value);
+    }
+#ifdef DRIVETHREAD_VERIFY
+    drivethread_verify(units, clk_value);
+#endif
 }
 
 void drive_cpu_set_overflow(diskunit_context_t *drv)
@@ -1020,16 +1037,30 @@ void drive_cpu_set_overflow(diskunit_context_t *drv)
 /* This is called at every vsync. */
 void drive_vsync_hook(void)
 {
-    unsigned int dnr;
+    unsigned int dnr, units = 0;
 
     drive_update_ui_status();
 
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        diskunit_context_t *unit = diskunit_context[dnr];
+
+        if (unit->enable && unit->idling_method != DRIVE_IDLE_SKIP_CYCLES) {
+            units |= 1u << dnr;
+        }
+    }
+
+    /* rotating a disk only affects its own unit, so the units can be run
+       before any disk is rotated */
+    if (units && drive_threads) {
+        drivethread_execute(units, maincpu_clk);
+    }
+
     for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
         diskunit_context_t *unit = diskunit_context[dnr];
         drive_t *drive = unit->drives[0];
 
         if (unit->enable) {
-            if (unit->idling_method != DRIVE_IDLE_SKIP_CYCLES) {
+            if (unit->idling_method != DRIVE_IDLE_SKIP_CYCLES && !drive_threads) {
                 drive_cpu_execute_one(diskunit_context[dnr], maincpu_clk);
             }
             if (unit->idling_method == DRIVE_IDLE_NO_IDLE) {
@@ -1043,6 +1074,9 @@ void drive_vsync_hook(void)
             /* printf("drive_vsync_hook drv %d @clk:%d\n", dnr, maincpu_clk); */
         }
     }
+#ifdef DRIVETHREAD_VERIFY
+    drivethread_verify(units, maincpu_clk);
+#endif
 }
 
 /* ------------------------------------------------------------------------- */
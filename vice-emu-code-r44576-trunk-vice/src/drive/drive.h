@@ -78,6 +78,7 @@
 #define DRIVE_IDLE_NO_IDLE     0
 #define DRIVE_IDLE_SKIP_CYCLES 1
 #define DRIVE_IDLE_TRAP_IDLE   2
+#define DRIVE_IDLE_LOOP_DETECT 3    /* trap idle, plus generic idle loops */
 
 /* Drive type ID's and names. When adding things here, please also update
  * the `drive_type_info_list` array in src/drive/drive.c to keep UI's current
@@ -40,7 +40,9 @@
 #include "drivecpu.h"
 #include "drive-check.h"
 #include "drivemem.h"
+#include "drivethread.h"
 #include "drivetypes.h"
+#include "iec.h"
 #include "interrupt.h"
 #include "lib.h"
 #include "log.h"
@@ -196,6 +198,8 @@ void drivecpu_reset(diskunit_context_t *drv)
 
     *(drv->clk_ptr) = 0;
     drivecpu_reset_clk(drv);
+    drv->cpu->idle.verify = 0;
+    drv->cpu->jam_deferred = 0;
 
     preserve_monitor = drv->cpu->int_status->global_pending_int & IK_MONITOR;
 
@@ -271,7 +275,8 @@ inline static uint32_t drive_trap_handler(diskunit_context_t *drv)
 {
     if (MOS6510_REGS_GET_PC(&(drv->cpu->cpu_regs)) == (uint16_t)drv->trap) {
         MOS6510_REGS_SET_PC(&(drv->cpu->cpu_regs), drv->trapcont);
-        if (drv->idling_method == DRIVE_IDLE_TRAP_IDLE) {
+        if (drv->idling_method == DRIVE_IDLE_TRAP_IDLE
+            || drv->idling_method == DRIVE_IDLE_LOOP_DETECT) {
             CLOCK next_clk;
 
             next_clk = alarm_context_next_pending_clk(drv->cpu->alarm_context);
@@ -348,6 +353,504 @@ inline static int interrupt_check_irq_delay(interrupt_cpu_status_t *cs,
     return 0;
 }
 
+/* -------------------------------------------------------------------------- */
+/* Generic idle loop detection (DRIVE_IDLE_LOOP_DETECT).
+
+   Fast loaders and other custom drive code wait for the computer in short
+   loops of their own, like
+
+       loop    LDA $1800
+               AND #$05
+               BEQ loop
+
+   While the drive catches up the computer does not run, so the value read
+   from the bus cannot change.  If a loop does not write anything and only
+   reads memory and I/O registers that stay the same until the next alarm
+   of the drive, every pass through it is the same as the one before.  Once
+   two passes in a row started with the same registers, the clock is
+   advanced by as many whole passes as fit before the next alarm (or the end
+   of the time slice).  This gives exactly the same result as emulating
+   them.
+
+   The loop is followed instruction by instruction, so an interrupt or a
+   branch out of the loop ends the tracking.  BVC/BVS and the other
+   instructions that look at the byte ready line are never part of an idle
+   loop.
+
+   With DRIVECPU_IDLE_VERIFY defined nothing is skipped.  The passes are
+   emulated instead, and when the clock reaches the point the skip would
+   have jumped to, clock and registers are compared with what the skip
+   would have left.  Differences are logged as errors.  */
+
+/* #define DRIVECPU_IDLE_VERIFY */
+
+#define IDLE_OP_NONE     0x00   /* not allowed in an idle loop */
+#define IDLE_OP_IMP      0x01   /* implied, no operand */
+#define IDLE_OP_IMM      0x02
+#define IDLE_OP_ZP       0x03
+#define IDLE_OP_ZPX      0x04
+#define IDLE_OP_ZPY      0x05
+#define IDLE_OP_ABS      0x06
+#define IDLE_OP_ABX      0x07
+#define IDLE_OP_ABY      0x08
+#define IDLE_OP_REL      0x09
+#define IDLE_OP_JMP      0x0a
+#define IDLE_OP_MODE     0x0f
+
+#define IDLE_OP_WRITES_X 0x10
+#define IDLE_OP_WRITES_Y 0x20
+#define IDLE_OP_BIT      0x40
+
+static int drivecpu_idle_decode(uint8_t opcode)
+{
+    switch (opcode) {
+        case 0x18:          /* CLC */
+        case 0x38:          /* SEC */
+        case 0x8a:          /* TXA */
+        case 0x98:          /* TYA */
+        case 0xea:          /* NOP */
+            return IDLE_OP_IMP;
+        case 0xaa:          /* TAX */
+        case 0xba:          /* TSX */
+            return IDLE_OP_IMP | IDLE_OP_WRITES_X;
+        case 0xa8:          /* TAY */
+            return IDLE_OP_IMP | IDLE_OP_WRITES_Y;
+
+        case 0x09:          /* ORA #$nn */
+        case 0x29:          /* AND #$nn */
+        case 0x49:          /* EOR #$nn */
+        case 0xa9:          /* LDA #$nn */
+        case 0xc0:          /* CPY #$nn */
+        case 0xc9:          /* CMP #$nn */
+        case 0xe0:          /* CPX #$nn */
+            return IDLE_OP_IMM;
+        case 0xa0:          /* LDY #$nn */
+            return IDLE_OP_IMM | IDLE_OP_WRITES_Y;
+        case 0xa2:          /* LDX #$nn */
+            return IDLE_OP_IMM | IDLE_OP_WRITES_X;
+
+        case 0x05:          /* ORA $nn */
+        case 0x25:          /* AND $nn */
+        case 0x45:          /* EOR $nn */
+        case 0xa5:          /* LDA $nn */
+        case 0xc4:          /* CPY $nn */
+        case 0xc5:          /* CMP $nn */
+        case 0xe4:          /* CPX $nn */
+            return IDLE_OP_ZP;
+        case 0x24:          /* BIT $nn */
+            return IDLE_OP_ZP | IDLE_OP_BIT;
+        case 0xa4:          /* LDY $nn */
+            return IDLE_OP_ZP | IDLE_OP_WRITES_Y;
+        case 0xa6:          /* LDX $nn */
+            return IDLE_OP_ZP | IDLE_OP_WRITES_X;
+
+        case 0x15:          /* ORA $nn,X */
+        case 0x35:          /* AND $nn,X */
+        case 0x55:          /* EOR $nn,X */
+        case 0xb5:          /* LDA $nn,X */
+        case 0xd5:          /* CMP $nn,X */
+            return IDLE_OP_ZPX;
+        case 0xb4:          /* LDY $nn,X */
+            return IDLE_OP_ZPX | IDLE_OP_WRITES_Y;
+        case 0xb6:          /* LDX $nn,Y */
+            return IDLE_OP_ZPY | IDLE_OP_WRITES_X;
+
+        case 0x0d:          /* ORA $nnnn */
+        case 0x2d:          /* AND $nnnn */
+        case 0x4d:          /* EOR $nnnn */
+        case 0xad:          /* LDA $nnnn */
+        case 0xcc:          /* CPY $nnnn */
+        case 0xcd:          /* CMP $nnnn */
+        case 0xec:          /* CPX $nnnn */
+            return IDLE_OP_ABS;
+        case 0x2c:          /* BIT $nnnn */
+            return IDLE_OP_ABS | IDLE_OP_BIT;
+        case 0xac:          /* LDY $nnnn */
+            return IDLE_OP_ABS | IDLE_OP_WRITES_Y;
+        case 0xae:          /* LDX $nnnn */
+            return IDLE_OP_ABS | IDLE_OP_WRITES_X;
+
+        case 0x1d:          /* ORA $nnnn,X */
+        case 0x3d:          /* AND $nnnn,X */
+        case 0x5d:          /* EOR $nnnn,X */
+        case 0xbd:          /* LDA $nnnn,X */
+        case 0xdd:          /* CMP $nnnn,X */
+            return IDLE_OP_ABX;
+        case 0xbc:          /* LDY $nnnn,X */
+            return IDLE_OP_ABX | IDLE_OP_WRITES_Y;
+        case 0x19:          /* ORA $nnnn,Y */
+        case 0x39:          /* AND $nnnn,Y */
+        case 0x59:          /* EOR $nnnn,Y */
+        case 0xb9:          /* LDA $nnnn,Y */
+        case 0xd9:          /* CMP $nnnn,Y */
+            return IDLE_OP_ABY;
+        case 0xbe:          /* LDX $nnnn,Y */
+            return IDLE_OP_ABY | IDLE_OP_WRITES_X;
+
+        case 0x10:          /* BPL $nnnn */
+        case 0x30:          /* BMI $nnnn */
+        case 0x90:          /* BCC $nnnn */
+        case 0xb0:          /* BCS $nnnn */
+        case 0xd0:          /* BNE $nnnn */
+        case 0xf0:          /* BEQ $nnnn */
+            return IDLE_OP_REL;
+
+        case 0x4c:          /* JMP $nnnn */
+            return IDLE_OP_JMP;
+    }
+
+    return IDLE_OP_NONE;
+}
+
+static unsigned int drivecpu_idle_op_size(int op)
+{
+    switch (op & IDLE_OP_MODE) {
+        case IDLE_OP_IMP:
+            return 1;
+        case IDLE_OP_ABS:
+        case IDLE_OP_ABX:
+        case IDLE_OP_ABY:
+        case IDLE_OP_JMP:
+            return 3;
+    }
+    return 2;
+}
+
+/* Fetch the three bytes at `addr', which must be plain memory (the CPU
+   always fetches that many).  */
+static int drivecpu_idle_fetch(diskunit_context_t *drv, unsigned int addr,
+                               uint8_t *code)
+{
+    unsigned int i;
+
+    for (i = 0; i < 3; i++) {
+        unsigned int a = (addr + i) & 0xffff;
+        uint8_t *base = drv->cpud->read_base_tab_ptr[a >> 8];
+
+        if (base == NULL) {
+            return 0;
+        }
+        code[i] = base[a];
+    }
+    return 1;
+}
+
+/* Check the instructions from `head' to the jump back at `tail' and
+   remember where they are.  */
+static int drivecpu_idle_scan(diskunit_context_t *drv, unsigned int head,
+                              unsigned int tail)
+{
+    drivecpu_idle_t *idle = &drv->cpu->idle;
+    unsigned int addr = head;
+    unsigned int n = 0;
+    int ops = 0;
+
+    while (n < DRIVECPU_IDLE_MAX_INSNS && addr <= tail) {
+        uint8_t code[3];
+        unsigned int dest;
+        int op;
+
+        if (!drivecpu_idle_fetch(drv, addr, code)) {
+            return 0;
+        }
+        op = drivecpu_idle_decode(code[0]);
+        idle->insn_pc[n++] = addr;
+        ops |= op;
+
+        switch (op & IDLE_OP_MODE) {
+            case IDLE_OP_NONE:
+                return 0;
+            case IDLE_OP_REL:
+                dest = (addr + 2 + (signed char)code[1]) & 0xffff;
+                if (addr == tail) {
+                    if (dest != head) {
+                        return 0;
+                    }
+                    goto done;
+                }
+                /* only branches out of the loop, so there is a single way
+                   through it */
+                if (dest >= head && dest <= tail) {
+                    return 0;
+                }
+                break;
+            case IDLE_OP_JMP:
+                if (addr != tail || (code[1] | (code[2] << 8)) != head) {
+                    return 0;
+                }
+                goto done;
+        }
+
+        if (addr == tail) {
+            return 0;
+        }
+        addr += drivecpu_idle_op_size(op);
+    }
+    return 0;
+
+done:
+    /* the index registers must stay the same for the whole pass, so the
+       indexed addresses can be checked in advance */
+    for (addr = 0; addr < n; addr++) {
+        uint8_t code[3];
+        int op;
+
+        if (!drivecpu_idle_fetch(drv, idle->insn_pc[addr], code)) {
+            return 0;
+        }
+        op = drivecpu_idle_decode(code[0]) & IDLE_OP_MODE;
+        if (((ops & IDLE_OP_WRITES_X) && (op == IDLE_OP_ZPX || op == IDLE_OP_ABX))
+            || ((ops & IDLE_OP_WRITES_Y) && (op == IDLE_OP_ZPY || op == IDLE_OP_ABY))) {
+            return 0;
+        }
+    }
+
+    idle->num_insns = n;
+    return 1;
+}
+
+static int drivecpu_idle_read_ok(diskunit_context_t *drv, unsigned int addr)
+{
+    if (drv->cpud->read_base_tab_ptr[addr >> 8] != NULL) {
+        return 1;
+    }
+    return iec_drive_idle_read(drv, (uint16_t)addr);
+}
+
+/* Check the memory accesses of the loop, with the registers it has now.  */
+static int drivecpu_idle_reads_ok(diskunit_context_t *drv)
+{
+    drivecpu_context_t *cpu = drv->cpu;
+    drivecpu_idle_t *idle = &cpu->idle;
+    unsigned int i, bits = 0;
+
+    for (i = 0; i < idle->num_insns; i++) {
+        uint8_t code[3];
+        unsigned int addr, index;
+        int op;
+
+        /* the loop itself may have been banked out */
+        if (!drivecpu_idle_fetch(drv, idle->insn_pc[i], code)) {
+            return 0;
+        }
+        op = drivecpu_idle_decode(code[0]);
+        addr = code[1] | (code[2] << 8);
+
+        switch (op & IDLE_OP_MODE) {
+            case IDLE_OP_ZP:
+                if (!drivecpu_idle_read_ok(drv, code[1])) {
+                    return 0;
+                }
+                break;
+            case IDLE_OP_ZPX:
+            case IDLE_OP_ZPY:
+                index = ((op & IDLE_OP_MODE) == IDLE_OP_ZPX) ? cpu->cpu_regs.x : cpu->cpu_regs.y;
+                if (!drivecpu_idle_read_ok(drv, code[1])
+                    || !drivecpu_idle_read_ok(drv, (code[1] + index) & 0xff)) {
+                    return 0;
+                }
+                break;
+            case IDLE_OP_ABS:
+                if (!drivecpu_idle_read_ok(drv, addr)) {
+                    return 0;
+                }
+                break;
+            case IDLE_OP_ABX:
+            case IDLE_OP_ABY:
+                index = ((op & IDLE_OP_MODE) == IDLE_OP_ABX) ? cpu->cpu_regs.x : cpu->cpu_regs.y;
+                /* a page crossing adds a dummy read from elsewhere */
+                if (((addr + index) ^ addr) & 0xff00) {
+                    return 0;
+                }
+                if (!drivecpu_idle_read_ok(drv, addr + index)) {
+                    return 0;
+                }
+                break;
+        }
+        if (op & IDLE_OP_BIT) {
+            bits++;
+        }
+    }
+
+    /* BIT with bit 6 clear rotates the disk, which is not the same as
+       rotating it once later.  With a single BIT in the loop the V flag
+       tells what it reads.  */
+    if (bits > 0
+        && (drv->drives[0]->byte_ready_active & BRA_MOTOR_ON)
+        && (bits > 1 || !(cpu->cpu_regs.p & P_OVERFLOW))) {
+        return 0;
+    }
+
+    return 1;
+}
+
+static int drivecpu_idle_same_regs(const mos6510_regs_t *a,
+                                   const mos6510_regs_t *b)
+{
+    return a->a == b->a && a->x == b->x && a->y == b->y && a->sp == b->sp
+           && a->p == b->p && a->n == b->n && a->z == b->z;
+}
+
+#ifdef DRIVECPU_IDLE_VERIFY
+/* Compare the emulated passes with the skip they replaced, once the clock
+   got to where the skip would have ended.  */
+static void drivecpu_idle_verify(diskunit_context_t *drv)
+{
+    drivecpu_context_t *cpu = drv->cpu;
+    drivecpu_idle_t *idle = &cpu->idle;
+    const mos6510_regs_t *regs = &cpu->cpu_regs;
+
+    if (*(drv->clk_ptr) < idle->verify_clk) {
+        return;
+    }
+    idle->verify = 0;
+
+    if (*(drv->clk_ptr) != idle->verify_clk
+        || regs->pc != idle->verify_regs.pc
+        || !drivecpu_idle_same_regs(&idle->verify_regs, regs)) {
+        log_error(drv->log,
+                  "Idle loop at $%04x: skip to clock %"PRIu64" differs from "
+                  "emulating it: clock %"PRIu64", PC $%04x, A $%02x, X $%02x, "
+                  "Y $%02x, SP $%02x.",
+                  idle->verify_regs.pc, idle->verify_clk, *(drv->clk_ptr),
+                  regs->pc, regs->a, regs->x, regs->y, regs->sp);
+        return;
+    }
+
+    if ((++idle->verify_count & 0xfff) == 0) {
+        log_message(drv->log, "Idle loop skips verified: %u.",
+                    idle->verify_count);
+    }
+}
+#endif
+
+static int drivecpu_idle_can_skip(diskunit_context_t *drv)
+{
+    drivecpu_context_t *cpu = drv->cpu;
+    unsigned int pending = cpu->int_status->global_pending_int;
+
+    /* an IRQ may be pending, as long as it stays masked */
+    if (pending != IK_NONE
+        && !(pending == IK_IRQ && (cpu->cpu_regs.p & P_INTERRUPT))) {
+        return 0;
+    }
+
+    if (monitor_mask[cpu->monspace]) {
+        return 0;
+    }
+#ifdef DEBUG
+    if (debug.drivecpu_traceflg[drv->mynumber]) {
+        return 0;
+    }
+#endif
+
+    return 1;
+}
+
+/* Called before every instruction.  Returns non-zero if the clock has been
+   advanced up to the end of the time slice.  */
+static int drivecpu_idle_check(diskunit_context_t *drv)
+{
+    drivecpu_context_t *cpu = drv->cpu;
+    drivecpu_idle_t *idle = &cpu->idle;
+    unsigned int pc = cpu->cpu_regs.pc;
+    CLOCK next_clk, limit, period;
+
+#ifdef DRIVECPU_IDLE_VERIFY
+    if (idle->verify) {
+        drivecpu_idle_verify(drv);
+    }
+#endif
+
+    if (!idle->tracking) {
+        unsigned int last_pc = idle->last_pc;
+
+        idle->last_pc = pc;
+
+        /* a short jump back might close an idle loop */
+        if (pc >= last_pc || last_pc - pc >= DRIVECPU_IDLE_MAX_BYTES
+            || (pc == idle->reject_head && last_pc == idle->reject_tail)) {
+            return 0;
+        }
+        if (!drivecpu_idle_scan(drv, pc, last_pc)) {
+            idle->reject_head = pc;
+            idle->reject_tail = last_pc;
+            return 0;
+        }
+        idle->tracking = 1;
+        idle->pos = 0;
+        idle->passes = 0;
+    }
+
+    if (pc != idle->insn_pc[idle->pos]) {
+        /* left the loop, or an interrupt came in */
+        idle->tracking = 0;
+        idle->last_pc = pc;
+        return 0;
+    }
+
+    if (idle->pos != 0) {
+        idle->pos = (idle->pos + 1 < idle->num_insns) ? idle->pos + 1 : 0;
+        return 0;
+    }
+    idle->pos = (idle->num_insns > 1) ? 1 : 0;
+
+    /* At the loop head.  The first pass reads everything once, after it
+       the reads have no more side effects.  An alarm starts it over.  */
+    next_clk = alarm_context_next_pending_clk(cpu->alarm_context);
+
+    if (idle->passes == 0 || next_clk != idle->alarm_clk) {
+        idle->passes = 1;
+        idle->alarm_clk = next_clk;
+        return 0;
+    }
+
+    if (idle->passes == 1
+        || !drivecpu_idle_same_regs(&idle->pass_regs, &cpu->cpu_regs)) {
+        idle->passes = 2;
+        idle->pass_clk = *(drv->clk_ptr);
+        idle->pass_regs = cpu->cpu_regs;
+        return 0;
+    }
+
+    if (!drivecpu_idle_reads_ok(drv)) {
+        idle->tracking = 0;
+        idle->last_pc = pc;
+        idle->reject_head = pc;
+        idle->reject_tail = idle->insn_pc[idle->num_insns - 1];
+        return 0;
+    }
+
+    if (!drivecpu_idle_can_skip(drv)) {
+        idle->pass_clk = *(drv->clk_ptr);
+        return 0;
+    }
+
+    /* The last pass left everything as it was: skip the passes that end
+       before the next alarm.  */
+    period = *(drv->clk_ptr) - idle->pass_clk;
+    limit = (next_clk < cpu->stop_clk) ? next_clk : cpu->stop_clk;
+
+#ifdef DRIVECPU_IDLE_VERIFY
+    if (!idle->verify && period > 0 && limit > *(drv->clk_ptr)
+        && limit - *(drv->clk_ptr) >= period) {
+        idle->verify = 1;
+        idle->verify_clk = *(drv->clk_ptr)
+                           + ((limit - *(drv->clk_ptr)) / period) * period;
+        idle->verify_regs = cpu->cpu_regs;
+    }
+    idle->pass_clk = *(drv->clk_ptr);
+    return 0;
+#endif
+
+    if (period > 0 && limit > *(drv->clk_ptr)) {
+        *(drv->clk_ptr) += ((limit - *(drv->clk_ptr)) / period) * period;
+    }
+    idle->pass_clk = *(drv->clk_ptr);
+
+    return *(drv->clk_ptr) >= cpu->stop_clk;
+}
+
 /* -------------------------------------------------------------------------- */
 /* Execute up to the current main CPU clock value.  This automatically
    calculates the corresponding number of clock ticks in the drive.  */
@@ -371,6 +874,9 @@ void drivecpu_execute(diskunit_context_t *drv, CLOCK clk_value)
 
     drivecpu_wake_up(drv);
 
+    /* the computer may have changed the bus since the last time */
+    cpu->idle.tracking = 0;
+
     /* Calculate number of main CPU clocks to emulate */
     if (clk_value > cpu->last_clk) {
         cycles = clk_value - cpu->last_clk;
@@ -388,7 +894,12 @@ void drivecpu_execute(diskunit_context_t *drv, CLOCK clk_value)
     }
 
     /* Run drive CPU emulation until the stop_clk clock has been reached. */
-    while (*drv->clk_ptr < cpu->stop_clk) {
+    while (*drv->clk_ptr < cpu->stop_clk && !cpu->jam_deferred) {
+        if (drv->idling_method == DRIVE_IDLE_LOOP_DETECT
+            && drivecpu_idle_check(drv)) {
+            continue;
+        }
+
 /* Include the 6502/6510 CPU emulation core.  */
 
 #define CLK (*(drv->clk_ptr))
@@ -404,6 +915,8 @@ void drivecpu_execute(diskunit_context_t *drv, CLOCK clk_value)
 
 #define JAM() drivecpu_jam(drv)
 
+#define cpu_is_jammed (cpu->is_jammed)
+
 #define ROM_TRAP_ALLOWED() 1
 
 #define ROM_TRAP_HANDLER() drive_trap_handler(drv)
@@ -512,6 +1025,12 @@ static void drivecpu_jam(diskunit_context_t *drv)
             break;
     }
 
+    /* the dialog, the monitor and the reset all belong to the emulation
+       thread */
+    if (drivethread_defer_jam(drv)) {
+        return;
+    }
+
     tmp = drive_jam(drv->mynumber, "%s (%u) CPU: JAM at $%04X  ", dname, drv->mynumber + 8, (unsigned int)reg_pc);
     switch (tmp) {
         case JAM_RESET:
@@ -248,7 +248,8 @@ inline static uint32_t drive_trap_handler(diskunit_context_t *drv)
 {
     if (R65C02_REGS_GET_PC(&(drv->cpu->cpu_R65C02_regs)) == (uint16_t)drv->trap) {
         R65C02_REGS_SET_PC(&(drv->cpu->cpu_R65C02_regs), drv->trapcont);
-        if (drv->idling_method == DRIVE_IDLE_TRAP_IDLE) {
+        if (drv->idling_method == DRIVE_IDLE_TRAP_IDLE
+            || drv->idling_method == DRIVE_IDLE_LOOP_DETECT) {
             CLOCK next_clk;
 
             next_clk = alarm_context_next_pending_clk(drv->cpu->alarm_context);
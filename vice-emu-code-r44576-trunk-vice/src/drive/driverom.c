@@ -166,7 +166,8 @@ void driverom_initialize_traps(diskunit_context_t *unit)
     DBG(("driverom_initialize_traps type: %u trap idle: %s\n", unit->type,
            unit->idling_method == DRIVE_IDLE_TRAP_IDLE ? "enabled" : "disabled"));
 
-    if (unit->idling_method != DRIVE_IDLE_TRAP_IDLE) {
+    if (unit->idling_method != DRIVE_IDLE_TRAP_IDLE
+        && unit->idling_method != DRIVE_IDLE_LOOP_DETECT) {
         return;
     }
 
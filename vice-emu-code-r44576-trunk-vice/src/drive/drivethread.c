@@ -0,0 +1,369 @@
+/*
+ * drivethread.c - Run the drive CPUs on their own host threads.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+ * When the emulation catches up all drives at once (drive_cpu_execute_all()),
+ * the units are normally run one after the other in ascending order.  Unit 9
+ * therefore already sees everything unit 8 did up to the target clock, while
+ * unit 8 saw unit 9 as it was at the start.
+ *
+ * To get exactly the same result with threads, every unit runs on its own
+ * thread (the lowest one on the emulation thread itself) and may run freely
+ * as long as it only touches its own state.  Before it touches anything that
+ * other units can see (the IEC bus lines, the fast serial line, the drive
+ * sound) it calls drivethread_sync(), which waits until all lower units are
+ * done with the slice.  A higher unit cannot have touched the shared state
+ * yet, as it would have been waiting for this one.
+ *
+ * The emulation thread is blocked for the whole slice, so nothing outside
+ * the drives can change underneath them.  A unit only waits the first time
+ * it touches shared state in a slice; after that the lower units are done
+ * and it runs freely again.
+ *
+ * A JAM on a drive thread cannot be handled there, as the dialog, the
+ * monitor and the reset all belong to the emulation thread.  The unit stops
+ * at the JAM instead, and once the slice is over the emulation thread runs
+ * it again up to the target clock, jamming it there.  Units with hardware that is not
+ * covered by drivethread_sync() (parallel cables, IEEE-488, TCBM, the CMD
+ * drives) and units that are being debugged are always run serially.
+ */
+
+#include "vice.h"
+
+#include <string.h>
+
+#include "debug.h"
+#include "drive.h"
+#include "drivecpu.h"
+#include "drivetypes.h"
+#include "drivethread.h"
+#include "hostprofile.h"
+#include "log.h"
+#include "monitor.h"
+
+#ifdef USE_VICE_THREAD
+#include <pthread.h>
+#endif
+
+static void drivethread_execute_serial(unsigned int units, CLOCK clk_value)
+{
+    unsigned int dnr;
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        if (units & (1u << dnr)) {
+            drive_cpu_execute_one(diskunit_context[dnr], clk_value);
+        }
+    }
+}
+
+#ifdef USE_VICE_THREAD
+
+typedef struct drivethread_s {
+    pthread_t thread;
+    int running;
+    /* last slice the thread has looked at */
+    unsigned int slice;
+} drivethread_t;
+
+static drivethread_t threads[NUM_DISK_UNITS];
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+/* The current slice, only changed by the emulation thread with the lock
+   held.  */
+static unsigned int slice_count = 0;
+static unsigned int slice_units = 0;
+static unsigned int slice_done = 0;
+static CLOCK slice_clk = 0;
+static int slice_active = 0;
+static int quit = 0;
+
+/* Set once all lower units are done with the slice.  Reset for the units
+   of a slice by the emulation thread with the lock held before the slice
+   starts, otherwise only accessed by the thread running the unit.  */
+static int unit_synced[NUM_DISK_UNITS];
+
+static void *drivethread_main(void *arg)
+{
+    drivethread_t *t = (drivethread_t *)arg;
+    unsigned int dnr = (unsigned int)(t - threads);
+
+    pthread_mutex_lock(&lock);
+    while (!quit) {
+        if (t->slice != slice_count) {
+            t->slice = slice_count;
+            if (slice_units & (1u << dnr)) {
+                CLOCK clk_value = slice_clk;
+
+                pthread_mutex_unlock(&lock);
+                drive_cpu_execute_one(diskunit_context[dnr], clk_value);
+                pthread_mutex_lock(&lock);
+
+                slice_done |= 1u << dnr;
+                pthread_cond_broadcast(&done_cond);
+                continue;
+            }
+        }
+        pthread_cond_wait(&start_cond, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+
+    return NULL;
+}
+
+static int drivethread_start(unsigned int dnr)
+{
+    drivethread_t *t = &threads[dnr];
+
+    if (t->running) {
+        return 0;
+    }
+
+    t->slice = slice_count;
+    if (pthread_create(&t->thread, NULL, drivethread_main, t) != 0) {
+        log_error(LOG_DEFAULT, "Could not create a thread for unit %u, running the drives serially.",
+                  dnr + 8);
+        return -1;
+    }
+    t->running = 1;
+
+    return 0;
+}
+
+/* Can `drv' run in parallel to other units?  */
+static int drivethread_unit_allowed(diskunit_context_t *drv)
+{
+    switch (drv->type) {
+        case DRIVE_TYPE_1540:
+        case DRIVE_TYPE_1541:
+        case DRIVE_TYPE_1541II:
+        case DRIVE_TYPE_1570:
+        case DRIVE_TYPE_1571:
+        case DRIVE_TYPE_1571CR:
+        case DRIVE_TYPE_1581:
+            break;
+        default:
+            return 0;
+    }
+
+    if (drv->parallel_cable != DRIVE_PC_NONE) {
+        return 0;
+    }
+
+    /* a jammed CPU would hit the JAM again on every slice, each time
+       handing it back to the emulation thread */
+    if (drv->cpu->is_jammed) {
+        return 0;
+    }
+
+    /* breakpoints, watchpoints and tracing stop the emulation from inside
+       the CPU core */
+    if (monitor_mask[drv->cpu->monspace]) {
+        return 0;
+    }
+#ifdef DEBUG
+    if (debug.drivecpu_traceflg[drv->mynumber]) {
+        return 0;
+    }
+#endif
+
+    return 1;
+}
+
+void drivethread_execute(unsigned int units, CLOCK clk_value)
+{
+    unsigned int dnr, first = NUM_DISK_UNITS, count = 0;
+
+    if (hostprofile_get_enabled()) {
+        /* the counters are not thread safe */
+        drivethread_execute_serial(units, clk_value);
+        return;
+    }
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        if (units & (1u << dnr)) {
+            if (!drivethread_unit_allowed(diskunit_context[dnr])) {
+                drivethread_execute_serial(units, clk_value);
+                return;
+            }
+            if (first == NUM_DISK_UNITS) {
+                first = dnr;
+            } else if (drivethread_start(dnr) < 0) {
+                drivethread_execute_serial(units, clk_value);
+                return;
+            }
+            count++;
+        }
+    }
+
+    if (count < 2) {
+        drivethread_execute_serial(units, clk_value);
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    slice_units = units;
+    slice_done = 0;
+    slice_clk = clk_value;
+    slice_count++;
+    slice_active = 1;
+    memset(unit_synced, 0, sizeof unit_synced);
+    unit_synced[first] = 1;
+    pthread_cond_broadcast(&start_cond);
+    pthread_mutex_unlock(&lock);
+
+    /* the lowest unit never has to wait, run it right here */
+    drive_cpu_execute_one(diskunit_context[first], clk_value);
+
+    pthread_mutex_lock(&lock);
+    slice_done |= 1u << first;
+    pthread_cond_broadcast(&done_cond);
+    while (slice_done != units) {
+        pthread_cond_wait(&done_cond, &lock);
+    }
+    slice_active = 0;
+    pthread_mutex_unlock(&lock);
+
+    /* finish the units that jammed on their thread, in the same order as
+       when running them serially */
+    for (dnr = first + 1; dnr < NUM_DISK_UNITS; dnr++) {
+        diskunit_context_t *drv = diskunit_context[dnr];
+
+        if ((units & (1u << dnr)) && drv->cpu->jam_deferred) {
+            drv->cpu->jam_deferred = 0;
+            drive_cpu_execute_one(drv, clk_value);
+        }
+    }
+}
+
+void drivethread_sync(diskunit_context_t *drv)
+{
+    unsigned int dnr = drv->mynumber;
+    unsigned int lower;
+
+    if (unit_synced[dnr]) {
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    if (slice_active) {
+        lower = slice_units & ((1u << dnr) - 1);
+        while ((slice_done & lower) != lower) {
+            pthread_cond_wait(&done_cond, &lock);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    unit_synced[dnr] = 1;
+}
+
+int drivethread_defer_jam(diskunit_context_t *drv)
+{
+    drivethread_t *t = &threads[drv->mynumber];
+
+    if (!t->running || !pthread_equal(pthread_self(), t->thread)) {
+        return 0;
+    }
+
+    drv->cpu->jam_deferred = 1;
+    return 1;
+}
+
+void drivethread_shutdown(void)
+{
+    unsigned int dnr;
+
+    pthread_mutex_lock(&lock);
+    quit = 1;
+    pthread_cond_broadcast(&start_cond);
+    pthread_mutex_unlock(&lock);
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        if (threads[dnr].running) {
+            pthread_join(threads[dnr].thread, NULL);
+            threads[dnr].running = 0;
+        }
+    }
+}
+
+#else
+
+void drivethread_execute(unsigned int units, CLOCK clk_value)
+{
+    drivethread_execute_serial(units, clk_value);
+}
+
+void drivethread_sync(diskunit_context_t *drv)
+{
+}
+
+int drivethread_defer_jam(diskunit_context_t *drv)
+{
+    return 0;
+}
+
+void drivethread_shutdown(void)
+{
+}
+
+#endif /* USE_VICE_THREAD */
+
+#ifdef DRIVETHREAD_VERIFY
+void drivethread_verify(unsigned int units, CLOCK clk_value)
+{
+    static uint32_t hash = 2166136261u;
+    static unsigned int count = 0;
+    unsigned int dnr;
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        if (units & (1u << dnr)) {
+            diskunit_context_t *drv = diskunit_context[dnr];
+            const mos6510_regs_t *regs = &drv->cpu->cpu_regs;
+            uint32_t values[9];
+            unsigned int i;
+
+            values[0] = dnr;
+            values[1] = (uint32_t)diskunit_clk[dnr];
+            values[2] = (uint32_t)(diskunit_clk[dnr] >> 32);
+            values[3] = regs->pc;
+            values[4] = regs->a | (regs->x << 8) | (regs->y << 16);
+            values[5] = regs->sp;
+            values[6] = regs->p;
+            values[7] = regs->n;
+            values[8] = regs->z;
+
+            /* FNV-1a */
+            for (i = 0; i < 9; i++) {
+                hash = (hash ^ values[i]) * 16777619u;
+            }
+        }
+    }
+
+    if ((++count & 0x3ff) == 0) {
+        log_message(LOG_DEFAULT, "Drive state %u at clock %"PRIu64": %08x.",
+                    count, clk_value, hash);
+    }
+}
+#endif
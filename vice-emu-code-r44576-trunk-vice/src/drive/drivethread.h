@@ -0,0 +1,58 @@
+/*
+ * drivethread.h - Run the drive CPUs on their own host threads.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_DRIVETHREAD_H
+#define VICE_DRIVETHREAD_H
+
+#include "types.h"
+
+struct diskunit_context_s;
+
+/* Bring the units set in the `units' bit mask (bit 0 = unit 8) up to
+   `clk_value'.  The result is always the same as running them one after
+   the other in ascending order, which is done anyway whenever the units
+   cannot be run in parallel.  */
+void drivethread_execute(unsigned int units, CLOCK clk_value);
+
+/* Must be called by the drive side before it touches state that is
+   shared with other units (IEC bus, fast serial, drive sound).  */
+void drivethread_sync(struct diskunit_context_s *drv);
+
+/* Called when the CPU of `drv' jams.  Returns non-zero if this happens on
+   a drive thread: the unit then stops, and is run again on the emulation
+   thread once the slice is over, where the JAM is handled (dialog,
+   monitor, reset).  */
+int drivethread_defer_jam(struct diskunit_context_s *drv);
+
+/* Define to log a hash of the clocks and registers of the units after they
+   have been caught up, the same way with and without DriveThreads.  Two
+   runs with the same input must log the same lines.  */
+/* #define DRIVETHREAD_VERIFY */
+
+#ifdef DRIVETHREAD_VERIFY
+void drivethread_verify(unsigned int units, CLOCK clk_value);
+#endif
+
+void drivethread_shutdown(void);
+
+#endif
@@ -52,6 +52,49 @@ typedef drive_store_func_t *drive_store_func_ptr_t;
 typedef uint8_t drive_peek_func_t (struct diskunit_context_s *, uint16_t);
 typedef drive_peek_func_t *drive_peek_func_ptr_t;
 
+/*
+ *  State of the generic idle loop detection (DRIVE_IDLE_LOOP_DETECT).
+ */
+
+/* Longest loop handled, in instructions and in bytes.  */
+#define DRIVECPU_IDLE_MAX_INSNS 8
+#define DRIVECPU_IDLE_MAX_BYTES 32
+
+typedef struct drivecpu_idle_s {
+    /* Non-zero while following the instructions of a loop.  */
+    int tracking;
+
+    /* Address of the previous instruction, while looking for a loop.  */
+    unsigned int last_pc;
+
+    /* Last loop found not to be an idle loop.  */
+    unsigned int reject_head;
+    unsigned int reject_tail;
+
+    /* Addresses of the instructions of the loop, the head first, and the
+       index of the one expected next.  */
+    unsigned int insn_pc[DRIVECPU_IDLE_MAX_INSNS];
+    unsigned int num_insns;
+    unsigned int pos;
+
+    /* Number of passes through the loop head without an alarm.  */
+    unsigned int passes;
+
+    /* Next pending alarm when the passes started.  */
+    CLOCK alarm_clk;
+
+    /* Clock and registers at the start of the last pass.  */
+    CLOCK pass_clk;
+    mos6510_regs_t pass_regs;
+
+    /* Pending comparison with a skip, and the number of skips found to be
+       right (DRIVECPU_IDLE_VERIFY in drivecpu.c).  */
+    int verify;
+    CLOCK verify_clk;
+    mos6510_regs_t verify_regs;
+    unsigned int verify_count;
+} drivecpu_idle_t;
+
 /*
  *  The private CPU data.
  */
@@ -97,6 +140,16 @@ typedef struct drivecpu_context_s {
     mos6510_regs_t cpu_regs;
     R65C02_regs_t cpu_R65C02_regs;
 
+    drivecpu_idle_t idle;
+
+    /* The CPU is stopped at a JAM opcode; kept per CPU as the units may
+       run on threads of their own.  */
+    int is_jammed;
+
+    /* The JAM was hit on a drive thread and is left to the emulation
+       thread, see drivethread_defer_jam().  */
+    int jam_deferred;
+
     uint8_t *pageone;        /* init to NULL */
 
     int monspace;         /* init to e_disk[89]_space */
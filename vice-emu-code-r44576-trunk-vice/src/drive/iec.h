@@ -40,6 +40,7 @@ void iec_drive_init(struct diskunit_context_s *drv);
 void iec_drive_shutdown(struct diskunit_context_s *drv);
 void iec_drive_reset(struct diskunit_context_s *drv);
 void iec_drive_mem_init(struct diskunit_context_s *drv, unsigned int type);
+int iec_drive_idle_read(struct diskunit_context_s *drv, uint16_t addr);
 void iec_drive_setup_context(struct diskunit_context_s *drv);
 void iec_drive_idling_method(unsigned int dnr);
 void iec_drive_rom_load(void);
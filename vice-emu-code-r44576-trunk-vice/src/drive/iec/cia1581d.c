@@ -33,6 +33,7 @@
 #include "ciad.h"
 #include "debug.h"
 #include "drive.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "iecbus.h"
 #include "iecdrive.h"
@@ -66,6 +67,26 @@ uint8_t cia1581_peek(diskunit_context_t *ctxptr, uint16_t addr)
     return ciacore_peek(ctxptr->cia1581, addr);
 }
 
+/* Return non-zero if reading `addr' over and over again gives the same
+   value until the next alarm of the drive.  Used by the idle loop
+   detection.  */
+int cia1581_idle_read(diskunit_context_t *ctxptr, uint16_t addr)
+{
+    cia_context_t *cia_context = ctxptr->cia1581;
+
+    switch (addr & 0xf) {
+        case CIA_PRB:
+            /* the timer outputs on PB6/PB7 follow the timers */
+            return ((cia_context->c_cia[CIA_CRA]
+                     | cia_context->c_cia[CIA_CRB]) & CIA_CR_PBON) == 0;
+        case CIA_DDRA:
+        case CIA_DDRB:
+            return 1;
+    }
+
+    return 0;
+}
+
 int cia1581_dump(diskunit_context_t *ctxptr, uint16_t addr)
 {
     ciacore_dump(ctxptr->cia1581);
@@ -151,6 +172,8 @@ static void store_ciapb(cia_context_t *cia_context, CLOCK rclk, uint8_t byte)
     cia1581p = (drivecia1581_context_t *)(cia_context->prv);
 
     if (byte != cia_context->old_pb) {
+        drivethread_sync((diskunit_context_t *)(cia_context->context));
+
         if (cia1581p->iecbus != NULL) {
             uint8_t *drive_bus, *drive_data;
             unsigned int unit;
@@ -207,6 +230,8 @@ static uint8_t read_ciapb(cia_context_t *cia_context)
 
     cia1581p = (drivecia1581_context_t *)(cia_context->prv);
 
+    drivethread_sync((diskunit_context_t *)(cia_context->context));
+
     if (cia1581p->iecbus != NULL) {
         uint8_t *drive_port;
 
@@ -236,6 +261,7 @@ static void store_sdr(cia_context_t *cia_context, uint8_t byte)
 
     cia1581p = (drivecia1581_context_t *)(cia_context->prv);
 
+    drivethread_sync((diskunit_context_t *)(cia_context->context));
     iec_fast_drive_write(byte, cia1581p->number);
 }
 
@@ -51,6 +51,7 @@ void cia1581_init(struct diskunit_context_s *ctxptr);
 void cia1581_store(struct diskunit_context_s *ctxptr, uint16_t addr, uint8_t value);
 uint8_t cia1581_read(struct diskunit_context_s *ctxptr, uint16_t addr);
 uint8_t cia1581_peek(struct diskunit_context_s *ctxptr, uint16_t addr);
+int cia1581_idle_read(struct diskunit_context_s *ctxptr, uint16_t addr);
 int cia1581_dump(struct diskunit_context_s *ctxptr, uint16_t addr);
 
 void cia1571_set_timing(struct cia_context_s *cia_context, int tickspersec, int powerfreq);
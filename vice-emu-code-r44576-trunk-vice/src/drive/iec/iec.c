@@ -131,6 +131,11 @@ void iec_drive_mem_init(struct diskunit_context_s *drv, unsigned int type)
     memiec_init(drv, type);
 }
 
+int iec_drive_idle_read(struct diskunit_context_s *drv, uint16_t addr)
+{
+    return memiec_idle_read(drv, addr);
+}
+
 void iec_drive_setup_context(struct diskunit_context_s *drv)
 {
     via1d1541_setup_context(drv);
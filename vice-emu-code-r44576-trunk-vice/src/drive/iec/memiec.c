@@ -87,6 +87,22 @@ static void drive_store_zero(diskunit_context_t *drv, uint16_t address, uint8_t
 
 /* ------------------------------------------------------------------------- */
 
+/* Return non-zero if reading the I/O register at `address' is safe for the
+   idle loop detection, see via1d1541_idle_read().  */
+int memiec_idle_read(struct diskunit_context_s *drv, uint16_t address)
+{
+    drive_read_func_t *read_func = drv->cpud->read_tab[0][address >> 8];
+
+    if (read_func == via1d1541_read) {
+        return via1d1541_idle_read(drv, address);
+    }
+    if (read_func == cia1581_read) {
+        return cia1581_idle_read(drv, address);
+    }
+
+    return 0;
+}
+
 void memiec_init(struct diskunit_context_s *drv, unsigned int type)
 {
     drivecpud_context_t *cpud = drv->cpud;
@@ -27,9 +27,12 @@
 #ifndef VICE_MEMIEC_H
 #define VICE_MEMIEC_H
 
+#include "types.h"
+
 struct diskunit_context_s;
 struct mem_ioreg_list_s;
 
 void memiec_init(struct diskunit_context_s *drv, unsigned int type);
+int memiec_idle_read(struct diskunit_context_s *drv, uint16_t address);
 
 #endif
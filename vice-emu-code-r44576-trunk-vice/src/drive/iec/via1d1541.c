@@ -34,6 +34,7 @@
 #include "debug.h"
 #include "drive.h"
 #include "drivesync.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "glue1571.h"
 #include "iecbus.h"
@@ -75,6 +76,42 @@ uint8_t via1d1541_peek(diskunit_context_t *ctxptr, uint16_t addr)
     return viacore_peek(ctxptr->via1d1541, addr);
 }
 
+/* Return non-zero if reading `addr' over and over again gives the same
+   value, with no side effects beyond those of the first read, until the
+   next alarm of the drive.  Used by the idle loop detection.  */
+int via1d1541_idle_read(diskunit_context_t *ctxptr, uint16_t addr)
+{
+    via_context_t *via_context = ctxptr->via1d1541;
+
+    switch (addr & 0xf) {
+        case VIA_PRA:
+        case VIA_PRA_NHS:
+            /* the 1570/1571 read the byte ready line here, the parallel
+               cables have handshake lines */
+            if ((ctxptr->type != DRIVE_TYPE_1540
+                 && ctxptr->type != DRIVE_TYPE_1541
+                 && ctxptr->type != DRIVE_TYPE_1541II)
+                || ctxptr->parallel_cable != DRIVE_PC_NONE) {
+                return 0;
+            }
+            /* CA2 handshake output */
+            return (via_context->via[VIA_PCR] & 0x0c) != 0x08;
+        case VIA_PRB:
+        case VIA_DDRB:
+        case VIA_DDRA:
+        case VIA_T1LL:
+        case VIA_T1LH:
+        case VIA_ACR:
+        case VIA_PCR:
+        case VIA_IFR:
+        case VIA_IER:
+            return 1;
+    }
+
+    /* the timers count and reading the shift register starts shifting */
+    return 0;
+}
+
 int via1d1541_dump(diskunit_context_t *ctxptr, uint16_t addr)
 {
     viacore_dump(((diskunit_context_t*)ctxptr)->via1d1541);
@@ -148,6 +185,8 @@ static void store_pra(via_context_t *via_context, uint8_t byte, uint8_t oldpa_va
     /* dc = (diskunit_context_t *)(via_context->context); */
     dc = via1p->diskunit;
 
+    drivethread_sync(dc);
+
     if (dc->type == DRIVE_TYPE_1570
         || dc->type == DRIVE_TYPE_1571
         || dc->type == DRIVE_TYPE_1571CR) {
@@ -217,6 +256,8 @@ static void store_prb(via_context_t *via_context, uint8_t byte, uint8_t p_oldpb,
     via1p = (drivevia1_context_t *)(via_context->prv);
 
     if (byte != p_oldpb) {
+        drivethread_sync(via1p->diskunit);
+
         DEBUG_IEC_DRV_WRITE(byte);
 
         if (iecbus != NULL) {
@@ -332,6 +373,8 @@ static uint8_t read_prb(via_context_t *via_context)
     /* 0 for drive0, 0x20 for drive 1 */
     orval = (via1p->number << 5);
 
+    drivethread_sync(via1p->diskunit);
+
     if (iecbus != NULL) {
         byte = (((via_context->via[VIA_PRB] & 0x1a)
                  | iecbus->drv_port) ^ 0x85) | orval;
@@ -39,6 +39,7 @@ void via1d1541_init(struct diskunit_context_s *ctxptr);
 void via1d1541_store(struct diskunit_context_s *ctxptr, uint16_t addr, uint8_t byte);
 uint8_t via1d1541_read(struct diskunit_context_s *ctxptr, uint16_t addr);
 uint8_t via1d1541_peek(struct diskunit_context_s *ctxptr, uint16_t addr);
+int via1d1541_idle_read(struct diskunit_context_s *ctxptr, uint16_t addr);
 int via1d1541_dump(diskunit_context_t *ctxptr, uint16_t addr);
 
 #endif
@@ -32,6 +32,7 @@
 
 #include "drive.h"
 #include "drivetypes.h"
+#include "hostprofile.h"
 #include "lib.h"
 #include "rotation.h"
 #include "types.h"
@@ -79,6 +80,12 @@ struct rotation_s {
     uint32_t seed;
 
     uint32_t xorShift32;
+
+    /* cached reference clocks per revolution; they only change when the
+       rpm or the wobble do */
+    int ref_per_rev_rpm;
+    int ref_per_rev_wobble;
+    int ref_per_rev;
 };
 typedef struct rotation_s rotation_t;
 
@@ -106,6 +113,7 @@ void rotation_init(int freq, unsigned int dnr)
     rotation[dnr].so_delay = 0;
     rotation[dnr].cycle_index = 0;
     rotation[dnr].ref_advance = 0;
+    rotation[dnr].ref_per_rev_rpm = -1;
 }
 
 void rotation_reset(drive_t *drive)
@@ -340,11 +348,12 @@ static void rotation_1541_gcr(drive_t *dptr, CLOCK ref_cycles)
 {
     rotation_t *rptr;
     int clk_ref_per_rev, cyc_act_frv;
-    CLOCK todo;
+    CLOCK todo, skip_cycles;
     int32_t delta;
     uint32_t count_new_bitcell, cyc_sum_frv /*, sum_new_bitcell*/;
     unsigned int dnr = dptr->diskunit->mynumber;
     uint64_t tmp = 30000UL;
+    int skip;
 
     rptr = &rotation[dnr];
 
@@ -362,9 +371,14 @@ static void rotation_1541_gcr(drive_t *dptr, CLOCK ref_cycles)
      *    change a lot over time, so the random offset is rather small.
      */
 
-    tmp *= clk_ref_per_rev;
-    tmp /= dptr->rpm;
-    clk_ref_per_rev = (int)tmp + dptr->wobble_factor;
+    if ((rptr->ref_per_rev_rpm != dptr->rpm) || (rptr->ref_per_rev_wobble != dptr->wobble_factor)) {
+        tmp *= clk_ref_per_rev;
+        tmp /= dptr->rpm;
+        rptr->ref_per_rev = (int)tmp + dptr->wobble_factor;
+        rptr->ref_per_rev_rpm = dptr->rpm;
+        rptr->ref_per_rev_wobble = dptr->wobble_factor;
+    }
+    clk_ref_per_rev = rptr->ref_per_rev;
 
     /* cell cycles for the actual flux reversal period, it is 1 now, but could be different with variable density */
     cyc_act_frv = 1;
@@ -381,23 +395,57 @@ static void rotation_1541_gcr(drive_t *dptr, CLOCK ref_cycles)
         while (ref_cycles > 0) {
             /* calculate how much cycles can we do in one single pass */
             todo = 1;
+            skip = 0;
+            skip_cycles = 0;
             delta = count_new_bitcell - rptr->accum;
             if ((delta > 0) && ((cyc_sum_frv << 1) <= (uint32_t)delta)) {
+                CLOCK reversal, first_carry, shift_carry, period;
+
                 todo = delta / cyc_sum_frv;
                 if (ref_cycles < (int)todo) {
                     todo = ref_cycles;
                 }
-                if ((rptr->ue7_counter < 16) && ((16 - rptr->ue7_counter) < (int)todo)) {
-                    todo = 16 - rptr->ue7_counter;
+                if ((rptr->so_delay > 0) && (rptr->so_delay < (int)todo)) {
+                    todo = rptr->so_delay;
                 }
-                if ((rptr->filter_counter < 40) && ((40 - rptr->filter_counter) < (int)todo)) {
-                    todo = 40 - rptr->filter_counter;
+
+                /* next possible (random) flux reversal, if within this pass */
+                reversal = todo + 1;
+                if ((rptr->filter_counter < 40) && ((40 - rptr->filter_counter) < (int)reversal)) {
+                    reversal = 40 - rptr->filter_counter;
                 }
-                if ((rptr->fr_randcount > 0) && (rptr->fr_randcount < todo)) {
-                    todo = rptr->fr_randcount;
+                if ((rptr->fr_randcount > 0) && (rptr->fr_randcount < reversal)) {
+                    reversal = rptr->fr_randcount;
                 }
-                if ((rptr->so_delay > 0) && (rptr->so_delay < (int)todo)) {
-                    todo = rptr->so_delay;
+
+                if ((rptr->ue7_counter < 16) && ((16 - rptr->ue7_counter) < (int)todo)) {
+                    first_carry = 16 - rptr->ue7_counter;
+                    if ((reversal <= first_carry)
+                        || ((rptr->filter_counter >= 40) && (rptr->filter_last_state != rptr->filter_state))) {
+                        todo = reversal < first_carry ? reversal : first_carry;
+                    } else {
+                        /* UE7 carries that do not clock the shifter only
+                         * advance UF4, so run up to the carry that does,
+                         * or up to the last carry before a flux reversal.
+                         * The steps taken stay the same as with one carry
+                         * per pass wherever a reversal reloads UE7, so the
+                         * result is identical.
+                         */
+                        period = 16 - rptr->ue7_dcba;
+                        shift_carry = first_carry + ((1 - rptr->uf4_counter) & 3) * period;
+                        if (shift_carry < todo) {
+                            todo = shift_carry;
+                        }
+                        if (reversal <= todo) {
+                            todo = first_carry + ((reversal - first_carry - 1) / period) * period;
+                        }
+                        if (todo > first_carry) {
+                            skip = (int)((todo - first_carry - 1) / period) + 1;
+                            skip_cycles = first_carry + (skip - 1) * period;
+                        }
+                    }
+                } else if (reversal < todo) {
+                    todo = reversal;
                 }
             }
 
@@ -432,7 +480,13 @@ static void rotation_1541_gcr(drive_t *dptr, CLOCK ref_cycles)
             }
 
             /* divide the reference clock with UE7 */
-            rptr->ue7_counter += todo;
+            if (skip) {
+                /* carries passed during this step, none of them clocks the shifter */
+                rptr->uf4_counter = (rptr->uf4_counter + skip) & 0xf;
+                rptr->ue7_counter = rptr->ue7_dcba + (int)(todo - skip_cycles);
+            } else {
+                rptr->ue7_counter += todo;
+            }
             if (rptr->ue7_counter == 16) {
                 /* carry asserted; reload the counter */
                 rptr->ue7_counter = rptr->ue7_dcba;
@@ -1110,6 +1164,8 @@ void rotation_rotate_disk(drive_t *dptr)
         return;
     }
 
+    HOSTPROFILE_ENTER(HOSTPROFILE_ROTATION);
+
     rotation_do_wobble(dptr);
 
     if (dptr->complicated_image_loaded) {
@@ -1122,6 +1178,8 @@ void rotation_rotate_disk(drive_t *dptr)
     } else {
         rotation_1541_simple(dptr);
     }
+
+    HOSTPROFILE_LEAVE(HOSTPROFILE_ROTATION);
 }
 
 /******************************************************************************/
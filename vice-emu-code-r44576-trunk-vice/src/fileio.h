@@ -57,6 +57,7 @@
 #define FILEIO_FILE_PERMISSION 3
 #define FILEIO_FILE_SCRATCHED  4
 
+struct dircache_s;
 struct rawfile_info_s;
 
 struct fileio_info_s {
@@ -71,6 +72,8 @@ typedef struct fileio_info_s fileio_info_t;
 fileio_info_t *fileio_open(const char *file_name, const char *path,
                            unsigned int format, unsigned int command,
                            unsigned int type, int *reclenp);
+fileio_info_t *fileio_stat_entry(struct dircache_s *dc, unsigned int index,
+                                 unsigned int format, unsigned int type);
 void fileio_close(fileio_info_t *info);
 unsigned int fileio_read(fileio_info_t *info, uint8_t *buf, unsigned int len);
 unsigned int fileio_write(fileio_info_t *info, uint8_t *buf, unsigned int len);
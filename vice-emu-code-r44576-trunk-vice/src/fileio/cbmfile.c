@@ -32,6 +32,7 @@
 #include "archdep.h"
 #include "cbmdos.h"
 #include "charset.h"
+#include "dircache.h"
 #include "fileio.h"
 #include "lib.h"
 #include "rawfile.h"
@@ -42,33 +43,24 @@
 
 static char *cbmfile_find_file(const char *fsname, const char *path)
 {
-    archdep_dir_t *host_dir;
+    dircache_t *dc;
     uint8_t *name1, *name2;
     const char *name;
     char *retname = NULL;
-    const char *open_path;
+    unsigned int i;
 
-    open_path = path;
-    if (path == NULL) {
-        open_path = "";
-    }
-
-    host_dir = archdep_opendir(open_path, ARCHDEP_OPENDIR_ALL_FILES);
+    dc = dircache_open(path);
 
-    if (host_dir == NULL) {
+    if (dc == NULL) {
         return NULL;
     }
 
     name1 = cbmdos_dir_slot_create(fsname, (unsigned int)strlen(fsname));
 
-    while (1) {
+    for (i = 0; i < dircache_num_entries(dc); i++) {
         unsigned int equal;
 
-        name = archdep_readdir(host_dir);
-
-        if (name == NULL) {
-            break;
-        }
+        name = dircache_name(dc, i);
 
         name2 = cbmdos_dir_slot_create(name, (unsigned int)strlen(name));
         equal = cbmdos_parse_wildcard_compare(name1, name2);
@@ -82,7 +74,7 @@ static char *cbmfile_find_file(const char *fsname, const char *path)
     }
 
     lib_free(name1);
-    archdep_closedir(host_dir);
+    dircache_close(dc);
 
     return retname;
 }
@@ -0,0 +1,438 @@
+/*
+ * dircache.c - Cache of the host directories used for CBM files.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+ * Finding a CBM file on the host means going through the whole directory:
+ * the name of a P00 file is in its header, and the short names of files
+ * with long names depend on the other files.  This keeps the entries of
+ * the directories in use, with what was found out about them so far.
+ *
+ * A directory is read again when its modification time changed, or when
+ * the cache was built in the same second as the last change (a later
+ * change in that second would not show).  Files changed by VICE itself
+ * call dircache_invalidate().  Files that other programs change in place,
+ * without creating, removing or renaming anything, keep their old size
+ * and P00 name until the directory changes.
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "archdep.h"
+#include "charset.h"
+#include "dircache.h"
+#include "lib.h"
+#include "p00.h"
+#include "types.h"
+#include "util.h"
+
+/* Number of directories kept while nobody uses them.  */
+#define DIRCACHE_KEEP_MAX   8
+
+/* Entry flags, what was found out about the entry so far.  */
+#define ENTRY_STAT          (1U << 0)
+#define ENTRY_STAT_OK       (1U << 1)
+#define ENTRY_P00           (1U << 2)
+
+typedef struct dircache_entry_s {
+    const char *name;           /* points into the archdep_dir_t */
+    char *petscii_name;
+    unsigned int flags;
+    size_t len;
+    unsigned int isdir;
+    unsigned int perms;
+    int p00_type;
+    uint8_t p00_name[DIRCACHE_P00_NAME_LEN + 1];
+} dircache_entry_t;
+
+struct dircache_s {
+    char *path;
+    archdep_dir_t *dir;
+    dircache_entry_t *entries;
+    unsigned int num_entries;
+
+    /* modification time of the directory, valid if `have_mtime' is set */
+    time_t mtime;
+    int have_mtime;
+    int racy;
+    unsigned int generation;
+
+    /* users of this cache, and caches replaced while in use */
+    int refs;
+    int stale;
+
+    /* see dircache_prefix_count(), one set of counts for each charset */
+    unsigned int *prefix_counts[2];
+    unsigned int prefix_len[2];
+
+    struct dircache_s *next;
+};
+
+static dircache_t *dircache_list = NULL;
+static unsigned int dircache_generation = 0;
+
+static void dircache_free(dircache_t *dc)
+{
+    unsigned int i;
+
+    for (i = 0; i < dc->num_entries; i++) {
+        lib_free(dc->entries[i].petscii_name);
+    }
+    lib_free(dc->entries);
+    lib_free(dc->prefix_counts[0]);
+    lib_free(dc->prefix_counts[1]);
+    archdep_closedir(dc->dir);
+    lib_free(dc->path);
+    lib_free(dc);
+}
+
+static void dircache_unlink(dircache_t *dc)
+{
+    dircache_t **p;
+
+    for (p = &dircache_list; *p != NULL; p = &(*p)->next) {
+        if (*p == dc) {
+            *p = dc->next;
+            break;
+        }
+    }
+    dc->next = NULL;
+}
+
+/* Drop the caches that changed, and the oldest unused ones when there are
+   too many.  */
+static void dircache_trim(void)
+{
+    dircache_t *dc, *next;
+    unsigned int kept = 0;
+
+    for (dc = dircache_list; dc != NULL; dc = next) {
+        next = dc->next;
+
+        if (dc->generation != dircache_generation) {
+            dc->stale = 1;
+        }
+        if (dc->stale || (dc->refs == 0 && kept >= DIRCACHE_KEEP_MAX)) {
+            dircache_unlink(dc);
+            if (dc->refs == 0) {
+                dircache_free(dc);
+            } else {
+                dc->stale = 1;
+            }
+        } else if (dc->refs == 0) {
+            kept++;
+        }
+    }
+}
+
+static int dircache_get_mtime(const char *path, time_t *mtime)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        return 0;
+    }
+    *mtime = st.st_mtime;
+    return 1;
+}
+
+static dircache_t *dircache_build(const char *path)
+{
+    archdep_dir_t *dir;
+    dircache_t *dc;
+    unsigned int i;
+    time_t mtime = 0;
+    int have_mtime;
+
+    /* read the time first, a change while reading makes it differ */
+    have_mtime = dircache_get_mtime(path, &mtime);
+
+    dir = archdep_opendir(path, ARCHDEP_OPENDIR_ALL_FILES);
+    if (dir == NULL) {
+        return NULL;
+    }
+
+    dc = lib_calloc(1, sizeof(dircache_t));
+    dc->path = lib_strdup(path);
+    dc->dir = dir;
+    dc->num_entries = (unsigned int)archdep_readdir_num_entries(dir);
+    dc->entries = lib_calloc(dc->num_entries ? dc->num_entries : 1,
+                             sizeof(dircache_entry_t));
+    for (i = 0; i < dc->num_entries; i++) {
+        dc->entries[i].name = archdep_readdir_get_entry(dir, (int)i);
+    }
+    dc->mtime = mtime;
+    dc->have_mtime = have_mtime;
+    dc->racy = !have_mtime || time(NULL) <= mtime;
+    dc->generation = dircache_generation;
+
+    return dc;
+}
+
+/* Return the entries of the host directory `path', read again if it
+   changed.  NULL is the current directory.  Returns NULL if the directory
+   cannot be read.  */
+dircache_t *dircache_open(const char *path)
+{
+    dircache_t *dc;
+    time_t mtime;
+
+    if (path == NULL) {
+        path = "";
+    }
+
+    dircache_trim();
+
+    for (dc = dircache_list; dc != NULL; dc = dc->next) {
+        if (strcmp(dc->path, path) == 0) {
+            break;
+        }
+    }
+
+    if (dc != NULL
+        && (dc->racy
+            || !dircache_get_mtime(path, &mtime)
+            || mtime != dc->mtime)) {
+        dircache_unlink(dc);
+        if (dc->refs == 0) {
+            dircache_free(dc);
+        } else {
+            dc->stale = 1;
+        }
+        dc = NULL;
+    }
+
+    if (dc == NULL) {
+        dc = dircache_build(path);
+        if (dc == NULL) {
+            return NULL;
+        }
+    } else {
+        dircache_unlink(dc);
+    }
+
+    /* most recently used first */
+    dc->next = dircache_list;
+    dircache_list = dc;
+    dc->refs++;
+
+    return dc;
+}
+
+void dircache_close(dircache_t *dc)
+{
+    if (dc == NULL) {
+        return;
+    }
+
+    dc->refs--;
+    if (dc->refs == 0 && dc->stale) {
+        dircache_free(dc);
+    }
+}
+
+/* Called after files were written, created, renamed or removed.  Caches in
+   use stay as they are until closed.  */
+void dircache_invalidate(void)
+{
+    dircache_generation++;
+}
+
+void dircache_shutdown(void)
+{
+    dircache_t *dc, *next;
+
+    for (dc = dircache_list; dc != NULL; dc = next) {
+        next = dc->next;
+        dc->next = NULL;
+        if (dc->refs == 0) {
+            dircache_free(dc);
+        } else {
+            dc->stale = 1;
+        }
+    }
+    dircache_list = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+unsigned int dircache_num_entries(const dircache_t *dc)
+{
+    return dc->num_entries;
+}
+
+const char *dircache_name(const dircache_t *dc, unsigned int index)
+{
+    return dc->entries[index].name;
+}
+
+const char *dircache_petscii_name(dircache_t *dc, unsigned int index)
+{
+    dircache_entry_t *entry = &dc->entries[index];
+
+    if (entry->petscii_name == NULL) {
+        entry->petscii_name = lib_strdup(entry->name);
+        charset_petconvstring((uint8_t *)entry->petscii_name, CONVERT_TO_PETSCII);
+    }
+    return entry->petscii_name;
+}
+
+/* Like archdep_stat(), `perms' gets the ARCHDEP_ACCESS_R_OK and
+   ARCHDEP_ACCESS_W_OK bits archdep_access() allows.  */
+int dircache_stat(dircache_t *dc, unsigned int index, size_t *len,
+                  unsigned int *isdir, unsigned int *perms)
+{
+    dircache_entry_t *entry = &dc->entries[index];
+
+    if (!(entry->flags & ENTRY_STAT)) {
+        char *complete;
+
+        if (*dc->path == '\0') {
+            complete = lib_strdup(entry->name);
+        } else {
+            complete = util_concat(dc->path, ARCHDEP_DIR_SEP_STR, entry->name, NULL);
+        }
+
+        entry->flags |= ENTRY_STAT;
+        if (archdep_stat(complete, &entry->len, &entry->isdir) == 0) {
+            entry->flags |= ENTRY_STAT_OK;
+            entry->perms = 0;
+            if (archdep_access(complete, ARCHDEP_ACCESS_R_OK) == 0) {
+                entry->perms |= ARCHDEP_ACCESS_R_OK;
+            }
+            if (archdep_access(complete, ARCHDEP_ACCESS_W_OK) == 0) {
+                entry->perms |= ARCHDEP_ACCESS_W_OK;
+            }
+        }
+        lib_free(complete);
+    }
+
+    if (!(entry->flags & ENTRY_STAT_OK)) {
+        return -1;
+    }
+    *len = entry->len;
+    *isdir = entry->isdir;
+    *perms = entry->perms;
+    return 0;
+}
+
+/* Get the CBM name in the header of a P00 file, not padded.  `cbmname'
+   must have room for DIRCACHE_P00_NAME_LEN + 1 bytes.  Returns the file
+   type, or -1 if the entry isn't a P00 file.  */
+int dircache_p00_name(dircache_t *dc, unsigned int index, uint8_t *cbmname)
+{
+    dircache_entry_t *entry = &dc->entries[index];
+
+    if (!(entry->flags & ENTRY_P00)) {
+        entry->flags |= ENTRY_P00;
+        entry->p00_type = p00_read_name(entry->name,
+                                        *dc->path == '\0' ? NULL : dc->path,
+                                        entry->p00_name);
+        entry->p00_name[DIRCACHE_P00_NAME_LEN] = 0;
+    }
+
+    if (entry->p00_type < 0) {
+        return -1;
+    }
+    memcpy(cbmname, entry->p00_name, DIRCACHE_P00_NAME_LEN + 1);
+    return entry->p00_type;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const dircache_t *prefix_dc;
+static unsigned int prefix_len;
+static int prefix_petscii;
+
+static const char *prefix_name(unsigned int index)
+{
+    const dircache_entry_t *entry = &prefix_dc->entries[index];
+
+    return prefix_petscii ? entry->petscii_name : entry->name;
+}
+
+static int prefix_compare(const void *a, const void *b)
+{
+    unsigned int ia = *(const unsigned int *)a;
+    unsigned int ib = *(const unsigned int *)b;
+    int rc;
+
+    rc = strncmp(prefix_name(ia), prefix_name(ib), prefix_len);
+    if (rc != 0) {
+        return rc;
+    }
+    return ia < ib ? -1 : (ia > ib);
+}
+
+/* Return the number of entries from the first one up to `index' whose
+   names start with the same `len' characters as the name of `index', as
+   the short names of long file names are made.  The names are compared in
+   PETSCII if `petscii' is set.  */
+unsigned int dircache_prefix_count(dircache_t *dc, unsigned int index,
+                                   unsigned int len, int petscii)
+{
+    int cs = petscii ? 1 : 0;
+
+    if (dc->prefix_counts[cs] == NULL || dc->prefix_len[cs] != len) {
+        unsigned int *order, *counts;
+        unsigned int i, count = 0;
+
+        if (petscii) {
+            for (i = 0; i < dc->num_entries; i++) {
+                dircache_petscii_name(dc, i);
+            }
+        }
+
+        order = lib_malloc((dc->num_entries + 1) * sizeof(unsigned int));
+        counts = lib_malloc((dc->num_entries + 1) * sizeof(unsigned int));
+        for (i = 0; i < dc->num_entries; i++) {
+            order[i] = i;
+        }
+
+        /* sorting puts each group of names in directory order */
+        prefix_dc = dc;
+        prefix_len = len;
+        prefix_petscii = cs;
+        qsort(order, dc->num_entries, sizeof(unsigned int), prefix_compare);
+
+        for (i = 0; i < dc->num_entries; i++) {
+            if (i == 0 || strncmp(prefix_name(order[i - 1]), prefix_name(order[i]), len) != 0) {
+                count = 0;
+            }
+            counts[order[i]] = ++count;
+        }
+        lib_free(order);
+
+        lib_free(dc->prefix_counts[cs]);
+        dc->prefix_counts[cs] = counts;
+        dc->prefix_len[cs] = len;
+    }
+
+    return dc->prefix_counts[cs][index];
+}
@@ -27,8 +27,11 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
 
+#include "archdep.h"
 #include "cbmfile.h"
+#include "dircache.h"
 #include "fileio.h"
 #include "lib.h"
 #include "p00.h"
@@ -82,6 +85,53 @@ fileio_info_t *fileio_open(const char *file_name, const char *path,
     lib_free(new_file);
     lib_free(new_path);
 
+    switch (command & FILEIO_COMMAND_MASK) {
+        case FILEIO_COMMAND_READ:
+        case FILEIO_COMMAND_STAT:
+            break;
+        default:
+            dircache_invalidate();
+            break;
+    }
+
+    return info;
+}
+
+/* Same as fileio_open() with FILEIO_COMMAND_STAT | FILEIO_COMMAND_FSNAME,
+   for entry `index' of a directory cache.  The file is not opened, only
+   the name and type of the result can be used.  */
+fileio_info_t *fileio_stat_entry(struct dircache_s *dc, unsigned int index,
+                                 unsigned int format, unsigned int type)
+{
+    fileio_info_t *info;
+    uint8_t p00_name[DIRCACHE_P00_NAME_LEN + 1];
+    int p00_type = -1;
+    size_t len;
+    unsigned int isdir, perms;
+
+    if (format & FILEIO_FORMAT_P00) {
+        p00_type = dircache_p00_name(dc, index, p00_name);
+    }
+
+    if (p00_type >= 0) {
+        info = lib_malloc(sizeof(fileio_info_t));
+        info->name = (uint8_t *)lib_strdup((char *)p00_name);
+        info->type = (unsigned int)p00_type;
+        info->format = FILEIO_FORMAT_P00;
+    } else if ((format & FILEIO_FORMAT_RAW)
+               && dircache_stat(dc, index, &len, &isdir, &perms) == 0
+               && (isdir || (perms & ARCHDEP_ACCESS_R_OK))) {
+        info = lib_malloc(sizeof(fileio_info_t));
+        info->name = (uint8_t *)lib_strdup(dircache_petscii_name(dc, index));
+        info->type = type;
+        info->format = FILEIO_FORMAT_RAW;
+    } else {
+        return NULL;
+    }
+
+    info->length = (unsigned int)strlen((char *)(info->name));
+    info->rawfile = NULL;
+
     return info;
 }
 
@@ -115,6 +165,8 @@ unsigned int fileio_read(fileio_info_t *info, uint8_t *buf, unsigned int len)
 
 unsigned int fileio_write(fileio_info_t *info, uint8_t *buf, unsigned int len)
 {
+    dircache_invalidate();
+
     switch (info->format) {
         case FILEIO_FORMAT_RAW:
             return cbmfile_write(info, buf, len);
@@ -178,6 +230,8 @@ unsigned int fileio_rename(const char *src_name, const char *dest_name,
 {
     unsigned int rc = FILEIO_FILE_NOT_FOUND;
 
+    dircache_invalidate();
+
     if (format & FILEIO_FORMAT_P00) {
         rc = p00_rename(src_name, dest_name, path);
     }
@@ -202,6 +256,8 @@ unsigned int fileio_scratch(const char *file_name, const char *path,
 {
     unsigned int rc = FILEIO_FILE_NOT_FOUND;
 
+    dircache_invalidate();
+
     if (format & FILEIO_FORMAT_P00) {
         rc = p00_scratch(file_name, path);
     }
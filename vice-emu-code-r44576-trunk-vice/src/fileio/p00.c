@@ -38,6 +38,7 @@
 
 #include "archdep.h"
 #include "cbmdos.h"
+#include "dircache.h"
 #include "fileio.h"
 #include "lib.h"
 #include "log.h"
@@ -158,62 +159,58 @@ static void p00_pad_a0(uint8_t *slot)
     }
 }
 
-static char *p00_file_find(const char *file_name, const char *path)
+/* Read the CBM name from the header of the P00 file `name' in `path'.
+   Returns the file type, or -1 if it isn't a P00 file.  */
+int p00_read_name(const char *name, const char *path, uint8_t *cbmname)
 {
-    archdep_dir_t *host_dir;
     struct rawfile_info_s *rawfile;
-    uint8_t p00_header_file_name[P00_HDR_CBMNAME_LEN];
-    const char *name;
-    char *alloc_name = NULL;
-    int rc;
+    int type, rc;
 
-    host_dir = archdep_opendir(path, ARCHDEP_OPENDIR_ALL_FILES);
-    if (host_dir == NULL) {
-        return NULL;
+    type = p00_check_name(name);
+    if (type < 0) {
+        return -1;
     }
 
-    while (1) {
-        name = archdep_readdir(host_dir);
-
-        if (name == NULL) {
-            break;
-        }
+    rawfile = rawfile_open(name, path, FILEIO_COMMAND_READ);
+    if (rawfile == NULL) {
+        return -1;
+    }
 
-        if (p00_check_name(name) < 0) {
-            continue;
-        }
+    rc = p00_read_header(rawfile, cbmname, NULL);
+    rawfile_destroy(rawfile);
 
-        rawfile = rawfile_open(name, path, FILEIO_COMMAND_READ);
-        if (rawfile == NULL) {
-            continue;
-        }
+    return rc < 0 ? -1 : type;
+}
 
-        rc = p00_read_header(rawfile, (uint8_t *)p00_header_file_name, NULL);
+static char *p00_file_find(const char *file_name, const char *path)
+{
+    dircache_t *dc;
+    uint8_t p00_header_file_name[DIRCACHE_P00_NAME_LEN + 1];
+    uint8_t *cname;
+    char *alloc_name = NULL;
+    unsigned int i;
 
-        if (rc >= 0) {
-            uint8_t *cname;
-            unsigned int equal;
+    dc = dircache_open(path);
+    if (dc == NULL) {
+        return NULL;
+    }
 
-            p00_pad_a0(p00_header_file_name);
-            cname = cbmdos_dir_slot_create(file_name, (unsigned int)strlen(file_name));
-            equal = cbmdos_parse_wildcard_compare(cname, p00_header_file_name);
-            lib_free(cname);
+    cname = cbmdos_dir_slot_create(file_name, (unsigned int)strlen(file_name));
 
-            if (equal > 0) {
-                alloc_name = lib_strdup(name);
-            } else {
-                rc = -1;
-            }
+    for (i = 0; i < dircache_num_entries(dc); i++) {
+        if (dircache_p00_name(dc, i, p00_header_file_name) < 0) {
+            continue;
         }
 
-        rawfile_destroy(rawfile);
-
-        if (rc >= 0) {
+        p00_pad_a0(p00_header_file_name);
+        if (cbmdos_parse_wildcard_compare(cname, p00_header_file_name) > 0) {
+            alloc_name = lib_strdup(dircache_name(dc, i));
             break;
         }
     }
 
-    archdep_closedir(host_dir);
+    lib_free(cname);
+    dircache_close(dc);
 
     return alloc_name;
 }
@@ -55,5 +55,6 @@ unsigned int p00_seek(struct fileio_info_s *info, off_t offset, int whence);
 unsigned int p00_tell(struct fileio_info_s *info);
 
 char *p00_filename_create(const char *filename, unsigned int type);
+int p00_read_name(const char *name, const char *path, uint8_t *cbmname);
 
 #endif
@@ -37,6 +37,7 @@
 #include <stdio.h>
 
 #include "cbmdos.h"
+#include "dircache.h"
 #include "fileio.h"
 #include "fsdevice-close.h"
 #include "fsdevice-read.h"
@@ -80,7 +81,7 @@ int fsdevice_close(vdrive_t *vdrive, unsigned int secondary)
                 return FLOPPY_ERROR;
             }
 
-            archdep_closedir(bufinfo->host_dir);
+            dircache_close(bufinfo->host_dir);
             bufinfo->host_dir = NULL;
             break;
     }
@@ -32,6 +32,7 @@
 
 #include "archdep.h"
 #include "charset.h"
+#include "dircache.h"
 #include "fsdevicetypes.h"
 #include "lib.h"
 #include "log.h"
@@ -94,16 +95,32 @@
 
 #define MAXDIRPOSMARK (10+26+26)
 
-static int _limit_longname(archdep_dir_t *archdep_dir, vdrive_t *vdrive, char *longname, int mode)
+static const char *dirposmark[2] = {
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ",
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"};
+
+/* make the short name of entry `index' in `longname', which has its name */
+static int _limit_entry(dircache_t *dc, unsigned int index, char *longname, int mode)
+{
+    unsigned int dirpos;
+
+    dirpos = dircache_prefix_count(dc, index, 14, mode);
+    /* handle max count */
+    if (dirpos >= MAXDIRPOSMARK) {
+        log_error(LOG_DEFAULT, "could not make a unique short name for '%s'", longname);
+        return -1;
+    }
+    longname[14] = dirposmark[mode][dirpos];
+    longname[15] = LONGNAMEMARKER;
+    longname[16] = 0;
+    return 0;
+}
+
+static int _limit_longname(dircache_t *dc, vdrive_t *vdrive, char *longname, int mode)
 {
     const char *direntry;
-    char newname[ARCHDEP_PATH_MAX];
     int longnames;
-    int dirpos = 0;
-    int tmppos;
-    char *dirposmark[2] = {
-        "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ",
-        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"};
+    unsigned int i;
 
     DBG(("limit_longname enter '%s' mode: %d\n", longname, mode));
     if (resources_get_int("FSDeviceLongNames", &longnames) < 0) {
@@ -112,38 +129,20 @@ static int _limit_longname(archdep_dir_t *archdep_dir, vdrive_t *vdrive, char *l
 
     if (!longnames) {
         if (strlen(longname) > 16) {
-            tmppos = archdep_telldir(archdep_dir);
-            archdep_rewinddir(archdep_dir);
-
-            while(1) {
-                direntry = archdep_readdir(archdep_dir);
-                if (direntry == NULL) {
-                    break;
-                }
-                strcpy(newname, direntry);
+            for (i = 0; i < dircache_num_entries(dc); i++) {
                 if (mode) {
-                    charset_petconvstring((uint8_t *)newname, CONVERT_TO_PETSCII);   /* ASCII name to PETSCII */
+                    direntry = dircache_petscii_name(dc, i);   /* ASCII name to PETSCII */
+                } else {
+                    direntry = dircache_name(dc, i);
                 }
-                if (!strncmp(newname, longname, 14)) {
-                    dirpos++;
-                    /* handle max count */
-                    if (dirpos == MAXDIRPOSMARK) {
-                        log_error(LOG_DEFAULT, "could not make a unique short name for '%s'", longname);
-                        archdep_seekdir(archdep_dir, tmppos);
+                if (!strcmp(direntry, longname)) {
+                    DBG(("limit_longname found full '%s'\n", longname));
+                    if (_limit_entry(dc, i, longname, mode) < 0) {
                         return -1;
                     }
-                    DBG(("limit_longname found partial '%s'\n", longname));
-                }
-                DBG(("limit_longname>%d '%s'->'%s' (%s)\n", dirpos, direntry, newname, longname));
-                if (!strcmp(newname, longname)) {
-                    DBG(("limit_longname found full '%s'\n", longname));
-                    longname[14] = dirposmark[mode][dirpos];
-                    longname[15] = LONGNAMEMARKER;
-                    longname[16] = 0;
                     break;
                 }
             }
-            archdep_seekdir(archdep_dir, tmppos);
         }
     }
     DBG(("limit_longname return '%s'\n", longname));
@@ -153,17 +152,17 @@ static int _limit_longname(archdep_dir_t *archdep_dir, vdrive_t *vdrive, char *l
 
 static int limit_longname(vdrive_t *vdrive, char *longname, int mode)
 {
-    archdep_dir_t *archdep_dir;
+    dircache_t *dc;
     char *prefix;
     int ret = -1;
 
     prefix = fsdevice_get_path(vdrive->unit);
     DBG(("limit_longname path '%s'\n", prefix));
 
-    archdep_dir = archdep_opendir(prefix, ARCHDEP_OPENDIR_ALL_FILES);
-    if (archdep_dir != NULL) {
-        ret = _limit_longname(archdep_dir, vdrive, longname, mode);
-        archdep_closedir(archdep_dir);
+    dc = dircache_open(prefix);
+    if (dc != NULL) {
+        ret = _limit_longname(dc, vdrive, longname, mode);
+        dircache_close(dc);
     }
     return ret;
 }
@@ -177,11 +176,12 @@ static int limit_longname(vdrive_t *vdrive, char *longname, int mode)
 
 static char *expand_shortname(vdrive_t *vdrive, char *shortname, int mode)
 {
-    archdep_dir_t *host_dir;
+    dircache_t *dc;
     const char *direntry;
     char *prefix;
     char *longname;
     int longnames;
+    unsigned int i;
 
     if (resources_get_int("FSDeviceLongNames", &longnames) < 0) {
         longnames = 0;
@@ -196,19 +196,19 @@ static char *expand_shortname(vdrive_t *vdrive, char *shortname, int mode)
         prefix = fsdevice_get_path(vdrive->unit);
         DBG(("expand_shortname path '%s'\n", prefix));
 
-        host_dir = archdep_opendir(prefix, ARCHDEP_OPENDIR_ALL_FILES);
-        if (host_dir == NULL) {
+        dc = dircache_open(prefix);
+        if (dc == NULL) {
+            lib_free(longname);
             return NULL;
         }
 
-        while(1) {
-            direntry = archdep_readdir(host_dir);
-            if (direntry == NULL) {
-                break;
-            }
+        for (i = 0; i < dircache_num_entries(dc); i++) {
+            direntry = dircache_name(dc, i);
             /* create the short name for this entry and see if it matches */
             strcpy(longname, direntry);
-            _limit_longname(host_dir, vdrive, longname, 0);
+            if (strlen(longname) > 16) {
+                _limit_entry(dc, i, longname, 0);
+            }
             if (mode) {
                 charset_petconvstring((uint8_t *)longname, CONVERT_TO_PETSCII);   /* ASCII name to PETSCII */
             }
@@ -218,11 +218,11 @@ static char *expand_shortname(vdrive_t *vdrive, char *shortname, int mode)
                 if (mode) {
                     charset_petconvstring((uint8_t *)longname, CONVERT_TO_PETSCII);   /* ASCII name to PETSCII */
                 }
-                archdep_closedir(host_dir);
+                dircache_close(dc);
                 return longname;
             }
         }
-        archdep_closedir(host_dir);
+        dircache_close(dc);
     }
     /* copy original string to the new name */
     strcpy(longname, shortname);
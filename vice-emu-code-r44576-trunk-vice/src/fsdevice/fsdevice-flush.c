@@ -45,6 +45,7 @@
 #include "archdep.h"
 #include "cbmdos.h"
 #include "charset.h"
+#include "dircache.h"
 #include "fileio.h"
 #include "fsdevice-flush.h"
 #include "fsdevice-filename.h"
@@ -132,6 +133,7 @@ static int fsdevice_flush_mkdir(vdrive_t *vdrive, char *arg)
     path = util_concat(prefix, ARCHDEP_DIR_SEP_STR, arg, NULL);
 
     er = CBMDOS_IPE_OK;
+    dircache_invalidate();
     if (archdep_mkdir(path, ARCHDEP_MKDIR_RWXUG)) {
         er = CBMDOS_IPE_INVAL;
         if (errno == EEXIST) {
@@ -196,6 +198,7 @@ static int fsdevice_flush_rmdir(vdrive_t *vdrive, char *arg)
     /* FIXME: rmdir() can set a lot of different errors codes, so this probably
      *        is a little naive
      */
+    dircache_invalidate();
     if (archdep_rmdir(path) != 0) {
         er = CBMDOS_IPE_NOT_EMPTY;
         if (errno == EPERM) {
@@ -44,6 +44,7 @@
 #include "archdep.h"
 #include "cbmdos.h"
 #include "charset.h"
+#include "dircache.h"
 #include "fileio.h"
 #include "fsdevice-filename.h"
 #include "fsdevice-read.h"
@@ -105,7 +106,7 @@ static int fsdevice_open_directory(vdrive_t *vdrive, unsigned int secondary,
                                    bufinfo_t *bufinfo,
                                    cbmdos_cmd_parse_t *cmd_parse, char *rname)
 {
-    archdep_dir_t *host_dir;
+    dircache_t *host_dir;
     char *mask;
     uint8_t *p;
     int i;
@@ -138,14 +139,14 @@ static int fsdevice_open_directory(vdrive_t *vdrive, unsigned int secondary,
     }
 
     /* trying to open */
-    host_dir = archdep_opendir((char *)(cmd_parse->parsecmd), ARCHDEP_OPENDIR_ALL_FILES);
+    host_dir = dircache_open((char *)(cmd_parse->parsecmd));
     if (host_dir == NULL) {
         for (p = (uint8_t *)(cmd_parse->parsecmd); *p; p++) {
             if (isupper((unsigned char)*p)) {
                 *p = tolower((unsigned char)*p);
             }
         }
-        host_dir = archdep_opendir((char *)(cmd_parse->parsecmd), ARCHDEP_OPENDIR_ALL_FILES);
+        host_dir = dircache_open((char *)(cmd_parse->parsecmd));
         if (host_dir == NULL) {
             fsdevice_error(vdrive, CBMDOS_IPE_NOT_FOUND);
             return FLOPPY_ERROR;
@@ -205,6 +206,7 @@ static int fsdevice_open_directory(vdrive_t *vdrive, unsigned int secondary,
     bufinfo[secondary].bufp = bufinfo[secondary].name;
     bufinfo[secondary].mode = Directory;
     bufinfo[secondary].host_dir = host_dir;
+    bufinfo[secondary].host_dir_pos = 0;
     bufinfo[secondary].eof = 0;
 
     return FLOPPY_COMMAND_OK;
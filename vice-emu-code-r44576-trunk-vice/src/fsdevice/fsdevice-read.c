@@ -40,6 +40,7 @@
 
 #include "archdep.h"
 #include "cbmdos.h"
+#include "dircache.h"
 #include "fileio.h"
 #include "fsdevice-filename.h"
 #include "fsdevice-resources.h"
@@ -382,12 +383,11 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
 {
     int i, l, f, statrc;
     unsigned long blocks;
-    const char *direntry;
+    unsigned int index = 0;
     size_t filelen;
-    unsigned int isdir;
+    unsigned int isdir, perms;
     fileio_info_t *finfo = NULL;
     unsigned int format = 0;
-    char buf[ARCHDEP_PATH_MAX];
 
     bufinfo->bufp = bufinfo->name;
 
@@ -410,15 +410,13 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
         uint8_t *p;
         finfo = NULL;
 
-        direntry = archdep_readdir(bufinfo->host_dir);
-
-        if (direntry == NULL) {
+        if (bufinfo->host_dir_pos >= dircache_num_entries(bufinfo->host_dir)) {
             break;
         }
+        index = bufinfo->host_dir_pos++;
 
-        finfo = fileio_open(direntry, bufinfo->dir, format,
-                            FILEIO_COMMAND_STAT | FILEIO_COMMAND_FSNAME,
-                            FILEIO_TYPE_PRG, NULL);
+        finfo = fileio_stat_entry(bufinfo->host_dir, index, format,
+                                  FILEIO_TYPE_PRG);
 
         if (finfo == NULL) {
             continue;
@@ -460,19 +458,15 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
         }
     } while (f);
 
-    if (direntry != NULL) {
+    if (finfo != NULL) {
         uint8_t *p = bufinfo->name;
 
-        strcpy(buf, bufinfo->dir);
-        strcat(buf, ARCHDEP_DIR_SEP_STR);
-        strcat(buf, direntry);
-
         /* Line link, Length and spaces */
 
         *p++ = 1;
         *p++ = 1;
 
-        statrc = archdep_stat(buf, &filelen, &isdir);
+        statrc = dircache_stat(bufinfo->host_dir, index, &filelen, &isdir, &perms);
         if (statrc == 0) {
             blocks = (filelen + 253) / 254;
         } else {
@@ -551,7 +545,7 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
             }
         }
 
-        if (archdep_access(buf, ARCHDEP_ACCESS_W_OK)) {
+        if (statrc != 0 || !(perms & ARCHDEP_ACCESS_W_OK)) {
             *p++ = '<'; /* read-only file */
         }
 
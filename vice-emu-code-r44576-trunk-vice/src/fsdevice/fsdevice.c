@@ -44,6 +44,7 @@
 #include "archdep.h"
 #include "attach.h"
 #include "cbmdos.h"
+#include "dircache.h"
 #include "fileio.h"
 #include "fsdevice-close.h"
 #include "fsdevice-flush.h"
@@ -247,4 +248,6 @@ void fsdevice_shutdown(void)
         lib_free(fsdevice_dev[i].errorl);
         lib_free(fsdevice_dev[i].cmdbuf);
     }
+
+    dircache_shutdown();
 }
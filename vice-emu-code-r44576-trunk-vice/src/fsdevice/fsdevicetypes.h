@@ -28,7 +28,6 @@
 #define VICE_FSDEVICETYPES_H
 
 #include "types.h"
-#include "archdep_dir.h"
 
 #define FSDEVICE_BUFFER_MAX 16
 #define FSDEVICE_DEVICE_MAX 4
@@ -40,12 +39,14 @@ enum fsmode {
     Write, Read, Append, Directory, Relative
 };
 
+struct dircache_s;
 struct fileio_info_s;
 struct tape_image_s;
 
 struct bufinfo_s {
     struct fileio_info_s *fileio_info;
-    archdep_dir_t *host_dir;
+    struct dircache_s *host_dir;
+    unsigned int host_dir_pos;
     struct tape_image_s *tape;
     enum fsmode mode;
     char *dir;
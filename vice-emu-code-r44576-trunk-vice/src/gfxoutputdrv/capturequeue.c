@@ -0,0 +1,402 @@
+/*
+ * capturequeue.c - Queue between the movie drivers and their encoder thread.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+ * The movie drivers used to encode and write every frame and every block
+ * of audio on the emulation thread, so a slow encoder or a full pipe made
+ * the emulation run slower than realtime.  Now the driver copies the data
+ * into a slot of a fixed ring and an encoder thread does the rest.
+ *
+ * There is exactly one producer (the emulation thread, which runs both
+ * screenshot_record() and the soundmovie encode) and one consumer (the
+ * encoder thread).  The producer only advances `head', the consumer only
+ * advances `tail', so the ring itself needs no lock.  The mutex and the
+ * conditions are only used to sleep when the ring is empty or full.
+ *
+ * Items are encoded in the order they were queued, so the drivers see the
+ * same sequence of video and audio as before.  Without thread support, or
+ * with CaptureQueueSize set to 0, items are encoded right away.
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archdep_tick.h"
+#include "capturequeue.h"
+#include "cmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "resources.h"
+
+#ifdef USE_VICE_THREAD
+#include <pthread.h>
+
+#define QUEUE_LOAD(x)       __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define QUEUE_STORE(x, v)   __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#else
+#define QUEUE_LOAD(x)       (x)
+#define QUEUE_STORE(x, v)   ((x) = (v))
+#endif
+
+#define CAPTURE_QUEUE_SIZE_MAX  256
+
+typedef struct capture_queue_slot_s {
+    int type;
+    unsigned int repeat;
+    size_t size;
+    size_t alloc;
+    uint8_t *data;
+} capture_queue_slot_t;
+
+struct capture_queue_s {
+    char *name;
+    capture_queue_encode_t encode;
+
+    capture_queue_slot_t *slots;
+    unsigned int num_slots;
+
+    /* Number of items queued and encoded; the slot of an item is its
+       number modulo num_slots.  */
+    unsigned int head;
+    unsigned int tail;
+
+    /* slot handed out by capture_queue_reserve(), or NULL */
+    capture_queue_slot_t *reserved;
+
+    /* video frames dropped since the last one that was queued */
+    unsigned int dropped;
+
+    /* set by the encoder when an item could not be encoded */
+    int error;
+
+    int policy;
+    int warned;     /* the slow encoder was reported, see CAPTURE_QUEUE_POLICY_WARN */
+
+    /* statistics */
+    unsigned long video_items;
+    unsigned long audio_items;
+    unsigned long dropped_total;
+    unsigned long depth_sum;
+    unsigned int depth_max;
+    unsigned long waits;
+    tick_t wait_ticks;
+
+#ifdef USE_VICE_THREAD
+    int threaded;
+    int quit;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t drained;
+#endif
+};
+
+static int queue_size = 16;
+static int queue_policy = CAPTURE_QUEUE_POLICY_BLOCK;
+
+static void encode_slot(capture_queue_t *queue, capture_queue_slot_t *slot)
+{
+    if (QUEUE_LOAD(queue->error)) {
+        return;
+    }
+    if (queue->encode(slot->type, slot->data, slot->size, slot->repeat) < 0) {
+        log_error(LOG_DEFAULT, "%s: error encoding %s.", queue->name,
+                  slot->type == CAPTURE_QUEUE_VIDEO ? "video frame" : "audio");
+        QUEUE_STORE(queue->error, 1);
+    }
+}
+
+#ifdef USE_VICE_THREAD
+
+static void *capture_queue_thread(void *arg)
+{
+    capture_queue_t *queue = (capture_queue_t *)arg;
+    unsigned int tail = queue->tail;
+
+    pthread_mutex_lock(&queue->lock);
+    while (1) {
+        while (QUEUE_LOAD(queue->head) == tail && !queue->quit) {
+            pthread_cond_wait(&queue->filled, &queue->lock);
+        }
+        if (QUEUE_LOAD(queue->head) == tail) {
+            break;
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        encode_slot(queue, &queue->slots[tail % queue->num_slots]);
+        tail++;
+        QUEUE_STORE(queue->tail, tail);
+
+        pthread_mutex_lock(&queue->lock);
+        pthread_cond_signal(&queue->drained);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return NULL;
+}
+
+/* Wait until the encoder made room for another item.  */
+static void wait_for_slot(capture_queue_t *queue)
+{
+    tick_t start = tick_now();
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->head - QUEUE_LOAD(queue->tail) == queue->num_slots) {
+        pthread_cond_wait(&queue->drained, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    queue->waits++;
+    queue->wait_ticks += tick_now_delta(start);
+}
+
+#endif
+
+capture_queue_t *capture_queue_open(const char *name, capture_queue_encode_t encode)
+{
+    capture_queue_t *queue = lib_calloc(1, sizeof(capture_queue_t));
+
+    queue->name = lib_strdup(name);
+    queue->encode = encode;
+    queue->policy = queue_policy;
+    queue->num_slots = 1;
+
+#ifdef USE_VICE_THREAD
+    if (queue_size > 0) {
+        queue->num_slots = (unsigned int)queue_size;
+        pthread_mutex_init(&queue->lock, NULL);
+        pthread_cond_init(&queue->filled, NULL);
+        pthread_cond_init(&queue->drained, NULL);
+        if (pthread_create(&queue->thread, NULL, capture_queue_thread, queue) == 0) {
+            queue->threaded = 1;
+        } else {
+            log_error(LOG_DEFAULT, "%s: could not create the encoder thread, encoding on the emulation thread.",
+                      queue->name);
+            pthread_cond_destroy(&queue->drained);
+            pthread_cond_destroy(&queue->filled);
+            pthread_mutex_destroy(&queue->lock);
+            queue->num_slots = 1;
+        }
+    }
+#endif
+
+    queue->slots = lib_calloc(queue->num_slots, sizeof(capture_queue_slot_t));
+
+    return queue;
+}
+
+/* Get a buffer of `size' bytes for the next item.  Returns 0 and the buffer
+   in `data', 1 if the video frame was dropped and -1 if the encoder failed
+   earlier.  */
+int capture_queue_reserve(capture_queue_t *queue, int type, size_t size, uint8_t **data)
+{
+    capture_queue_slot_t *slot;
+
+    *data = NULL;
+
+    if (queue == NULL || QUEUE_LOAD(queue->error)) {
+        return -1;
+    }
+
+#ifdef USE_VICE_THREAD
+    if (queue->threaded && queue->head - QUEUE_LOAD(queue->tail) == queue->num_slots) {
+        if (type == CAPTURE_QUEUE_VIDEO && queue->policy == CAPTURE_QUEUE_POLICY_DROP) {
+            queue->dropped++;
+            queue->dropped_total++;
+            return 1;
+        }
+        if (queue->policy == CAPTURE_QUEUE_POLICY_WARN && !queue->warned) {
+            log_warning(LOG_DEFAULT, "%s: the encoder cannot keep up, the emulation is slowed down.",
+                        queue->name);
+            queue->warned = 1;
+        }
+        wait_for_slot(queue);
+    }
+#endif
+
+    slot = &queue->slots[queue->head % queue->num_slots];
+    if (slot->alloc < size) {
+        lib_free(slot->data);
+        slot->data = lib_malloc(size);
+        slot->alloc = size;
+    }
+    slot->type = type;
+    slot->size = size;
+    slot->repeat = 0;
+    if (type == CAPTURE_QUEUE_VIDEO) {
+        slot->repeat = queue->dropped;
+        queue->dropped = 0;
+    }
+    queue->reserved = slot;
+
+    *data = slot->data;
+    return 0;
+}
+
+/* Queue the item filled in after capture_queue_reserve().  */
+int capture_queue_commit(capture_queue_t *queue)
+{
+    capture_queue_slot_t *slot;
+    unsigned int depth;
+
+    if (queue == NULL || queue->reserved == NULL) {
+        return -1;
+    }
+    slot = queue->reserved;
+    queue->reserved = NULL;
+
+    if (slot->type == CAPTURE_QUEUE_VIDEO) {
+        queue->video_items++;
+    } else {
+        queue->audio_items++;
+    }
+
+#ifdef USE_VICE_THREAD
+    if (queue->threaded) {
+        QUEUE_STORE(queue->head, queue->head + 1);
+        depth = queue->head - QUEUE_LOAD(queue->tail);
+        queue->depth_sum += depth;
+        if (depth > queue->depth_max) {
+            queue->depth_max = depth;
+        }
+
+        pthread_mutex_lock(&queue->lock);
+        pthread_cond_signal(&queue->filled);
+        pthread_mutex_unlock(&queue->lock);
+
+        return QUEUE_LOAD(queue->error) ? -1 : 0;
+    }
+#endif
+
+    depth = 1;
+    queue->depth_sum += depth;
+    queue->depth_max = depth;
+    encode_slot(queue, slot);
+    queue->head++;
+    queue->tail++;
+
+    return queue->error ? -1 : 0;
+}
+
+/* Encode what is left in the queue, stop the encoder thread and free the
+   queue.  Returns -1 if anything could not be encoded.  */
+int capture_queue_close(capture_queue_t *queue)
+{
+    unsigned long items;
+    unsigned int i;
+    int error;
+
+    if (queue == NULL) {
+        return 0;
+    }
+
+#ifdef USE_VICE_THREAD
+    if (queue->threaded) {
+        pthread_mutex_lock(&queue->lock);
+        queue->quit = 1;
+        pthread_cond_signal(&queue->filled);
+        pthread_mutex_unlock(&queue->lock);
+        pthread_join(queue->thread, NULL);
+
+        pthread_cond_destroy(&queue->drained);
+        pthread_cond_destroy(&queue->filled);
+        pthread_mutex_destroy(&queue->lock);
+    }
+#endif
+
+    items = queue->video_items + queue->audio_items;
+    log_message(LOG_DEFAULT,
+                "%s: %lu frames and %lu audio blocks encoded, %lu frames dropped, queue depth %.1f average and %u maximum of %u, waited %lu times for %.1f ms.",
+                queue->name, queue->video_items, queue->audio_items, queue->dropped_total,
+                items > 0 ? (double)queue->depth_sum / (double)items : 0.0,
+                queue->depth_max, queue->num_slots, queue->waits,
+                (double)queue->wait_ticks * 1000.0 / (double)tick_per_second());
+
+    error = queue->error;
+
+    for (i = 0; i < queue->num_slots; i++) {
+        lib_free(queue->slots[i].data);
+    }
+    lib_free(queue->slots);
+    lib_free(queue->name);
+    lib_free(queue);
+
+    return error ? -1 : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_queue_size(int val, void *param)
+{
+    if (val < 0 || val > CAPTURE_QUEUE_SIZE_MAX) {
+        return -1;
+    }
+    queue_size = val;
+    return 0;
+}
+
+static int set_queue_policy(int val, void *param)
+{
+    switch (val) {
+        case CAPTURE_QUEUE_POLICY_BLOCK:
+        case CAPTURE_QUEUE_POLICY_DROP:
+        case CAPTURE_QUEUE_POLICY_WARN:
+            break;
+        default:
+            return -1;
+    }
+    queue_policy = val;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "CaptureQueueSize", 16, RES_EVENT_NO, NULL,
+      &queue_size, set_queue_size, NULL },
+    { "CaptureQueuePolicy", CAPTURE_QUEUE_POLICY_BLOCK, RES_EVENT_NO, NULL,
+      &queue_policy, set_queue_policy, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int capture_queue_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-capturequeuesize", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "CaptureQueueSize", NULL,
+      "<value>", "Set the number of frames and audio blocks queued for the movie encoder thread (0: encode on the emulation thread, max 256)" },
+    { "-capturequeuepolicy", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "CaptureQueuePolicy", NULL,
+      "<policy>", "What to do with a frame when the movie encoder queue is full (0: wait, 1: drop, 2: wait and warn)" },
+    CMDLINE_LIST_END
+};
+
+int capture_queue_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
@@ -0,0 +1,56 @@
+/*
+ * capturequeue.h - Queue between the movie drivers and their encoder thread.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_CAPTUREQUEUE_H
+#define VICE_CAPTUREQUEUE_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+/* item types */
+#define CAPTURE_QUEUE_VIDEO     0
+#define CAPTURE_QUEUE_AUDIO     1
+
+/* values for CaptureQueuePolicy, what to do with a video frame when the
+   queue is full (audio always waits) */
+#define CAPTURE_QUEUE_POLICY_BLOCK  0   /* wait for the encoder */
+#define CAPTURE_QUEUE_POLICY_DROP   1   /* drop the frame */
+#define CAPTURE_QUEUE_POLICY_WARN   2   /* wait, and log that the encoder is too slow */
+
+typedef struct capture_queue_s capture_queue_t;
+
+/* Encode one item.  `repeat' is the number of video frames that were
+   dropped right before this one; the driver should output the frame that
+   many more times to keep the timing.  Returns < 0 on error.  */
+typedef int (*capture_queue_encode_t)(int type, uint8_t *data, size_t size, unsigned int repeat);
+
+capture_queue_t *capture_queue_open(const char *name, capture_queue_encode_t encode);
+int capture_queue_reserve(capture_queue_t *queue, int type, size_t size, uint8_t **data);
+int capture_queue_commit(capture_queue_t *queue);
+int capture_queue_close(capture_queue_t *queue);
+
+int capture_queue_resources_init(void);
+int capture_queue_cmdline_options_init(void);
+
+#endif
@@ -67,6 +67,7 @@
 #include <unistd.h>
 
 #include "archdep.h"
+#include "capturequeue.h"
 #include "cmdline.h"
 #include "coproc.h"
 #include "ffmpegdrv.h"
@@ -287,6 +288,10 @@ static vice_network_socket_t *ffmpeg_audio_listen_socket = NULL;
 #endif
 static char *outfilename = NULL;
 
+/* frames and audio go through this to the thread writing to the sockets,
+   opened once the sockets are connected */
+static capture_queue_t *ffmpeg_queue = NULL;
+
 /******************************************************************************/
 
 static int ffmpegexedrv_init_file(void);
@@ -483,15 +488,47 @@ static void log_resource_values(const char *func)
     DBG(("%s FFMPEGVideoHalveFramerate:%d", func, video_halve_framerate));
 }
 
+static int send_video_frame(uint8_t *data)
+{
+    size_t len = INPUT_VIDEO_BPP * video_height * video_width;
+    return (int)len - vice_network_send(ffmpeg_video_socket, data, len, 0 /* flags */);
+}
+
 static int write_video_frame(VIDEOFrame *pic)
 {
     size_t len = INPUT_VIDEO_BPP * video_height * video_width;
+    uint8_t *data;
+    int ret;
+
     if ((video_has_codec > 0) && (video_codec != AV_CODEC_ID_NONE)) {
-        if (ffmpeg_video_socket == 0) {
+        if (ffmpeg_video_socket == 0 || ffmpeg_queue == NULL) {
             log_error(LOG_DEFAULT, "FFMPEG: write_video_frame ffmpeg_video_socket is 0 (framecount:%"PRIu64")\n", framecounter);
             return 0;
         }
-        return (int)len - vice_network_send(ffmpeg_video_socket, pic->data, len, 0 /* flags */);
+        ret = capture_queue_reserve(ffmpeg_queue, CAPTURE_QUEUE_VIDEO, len, &data);
+        if (ret != 0) {
+            /* either dropped (the next frame is sent twice) or an error */
+            return ret < 0 ? -1 : 0;
+        }
+        memcpy(data, pic->data, len);
+        return capture_queue_commit(ffmpeg_queue);
+    }
+    return 0;
+}
+
+/* capture_queue_encode_t, called on the thread writing to the sockets */
+static int ffmpegexedrv_encode(int type, uint8_t *data, size_t size, unsigned int repeat)
+{
+    unsigned int i;
+
+    if (type == CAPTURE_QUEUE_AUDIO) {
+        return vice_network_send(ffmpeg_audio_socket, data, size, 0 /* flags */) == (int)size ? 0 : -1;
+    }
+
+    for (i = 0; i <= repeat; i++) {
+        if (send_video_frame(data) != 0) {
+            return -1;
+        }
     }
     return 0;
 }
@@ -505,7 +542,7 @@ static void write_initial_video_frames(void)
     DBG(("video len:%d (%d)", len, len * DUMMY_FRAMES_VIDEO));
     memset(video_st_frame->data, 0, len);
     for (frm = 0; frm < DUMMY_FRAMES_VIDEO; frm++) {
-        write_video_frame(video_st_frame);
+        send_video_frame(video_st_frame->data);
     }
 }
 
@@ -924,7 +961,9 @@ static int ffmpegexe_soundmovie_init(int speed, int channels, soundmovie_buffer_
     }
 #endif
 
-    start_ffmpeg_executable();
+    if (start_ffmpeg_executable() == 0) {
+        ffmpeg_queue = capture_queue_open("FFMPEGEXE", ffmpegexedrv_encode);
+    }
 
     return 0;
 }
@@ -934,7 +973,8 @@ static int ffmpegexe_soundmovie_init(int speed, int channels, soundmovie_buffer_
 /* triggered by soundffmpegaudio->write */
 static int ffmpegexe_soundmovie_encode(soundmovie_buffer_t *audio_in)
 {
-    int res;
+    uint8_t *data;
+    size_t len;
 #ifdef DEBUG_FFMPEG_FRAMES
     double frametime = (double)framecounter / fps;
     double audiotime = (double)audio_input_counter / (double)audio_input_sample_rate;
@@ -946,28 +986,25 @@ static int ffmpegexe_soundmovie_encode(soundmovie_buffer_t *audio_in)
     }
 #endif
 
-    if (ffmpeg_audio_socket == 0) {
+    if (ffmpeg_audio_socket == 0 || ffmpeg_queue == NULL) {
         log_error(LOG_DEFAULT, "FFMPEG: ffmpegexe_soundmovie_encode ffmpeg_audio_socket is 0 (framecount:%"PRIu64")", audio_input_counter);
         return 0;
     }
 
     if ((audio_has_codec > 0) && (audio_codec != AV_CODEC_ID_NONE)) {
+        if (audio_input_channels != 1 && audio_input_channels != 2) {
+            return -1;
+        }
         /* FIXME: we might have an endianess problem here, we might have to swap lo/hi on BE machines */
-        if (audio_input_channels == 1) {
-            res = vice_network_send(ffmpeg_audio_socket, &audio_in->buffer[0], audio_in->used * 2, 0 /* flags */);
-            if (res != audio_in->used * 2) {
-                return -1;
-            }
-            audio_input_counter += audio_in->used;
-        } else if (audio_input_channels == 2) {
-            res = vice_network_send(ffmpeg_audio_socket, &audio_in->buffer[0], audio_in->used * 2, 0 /* flags */);
-            if (res != audio_in->used * 2) {
-                return -1;
-            }
-            audio_input_counter += audio_in->used / 2;
-        } else {
+        len = (size_t)audio_in->used * 2;
+        if (capture_queue_reserve(ffmpeg_queue, CAPTURE_QUEUE_AUDIO, len, &data) < 0) {
+            return -1;
+        }
+        memcpy(data, audio_in->buffer, len);
+        if (capture_queue_commit(ffmpeg_queue) < 0) {
             return -1;
         }
+        audio_input_counter += audio_in->used / audio_input_channels;
     }
 
     audio_in->used = 0;
@@ -1193,6 +1230,10 @@ static int ffmpegexedrv_close(screenshot_t *screenshot)
 
     soundmovie_stop();
 
+    /* wait until everything was written to the sockets */
+    capture_queue_close(ffmpeg_queue);
+    ffmpeg_queue = NULL;
+
     ffmpegexedrv_close_video();
     ffmpegexedrv_close_audio();
 
@@ -33,6 +33,7 @@
 
 #include "archdep.h"
 #include "bmpdrv.h"
+#include "capturequeue.h"
 #include "gfxoutput.h"
 #include "gifdrv.h"
 #include "lib.h"
@@ -54,6 +55,10 @@
 
 #include "zmbvdrv.h"
 
+#ifdef HAVE_SHM_OPEN
+#include "shmdrv.h"
+#endif
+
 struct gfxoutputdrv_list_s {
     struct gfxoutputdrv_s *drv;
     struct gfxoutputdrv_list_s *next;
@@ -118,6 +123,9 @@ int gfxoutput_early_init(int help)
 #endif
     gfxoutput_init_ffmpegexe(help);
     gfxoutput_init_zmbv(help);
+#ifdef HAVE_SHM_OPEN
+    gfxoutput_init_shm(help);
+#endif
 
     /* C64 formats */
     gfxoutput_init_godot(help);
@@ -217,7 +225,7 @@ int gfxoutput_resources_init(void)
         current = current->next;
     }
 
-    return 0;
+    return capture_queue_resources_init();
 }
 
 int gfxoutput_cmdline_options_init(void)
@@ -235,5 +243,5 @@ int gfxoutput_cmdline_options_init(void)
         current = current->next;
     }
 
-    return 0;
+    return capture_queue_cmdline_options_init();
 }
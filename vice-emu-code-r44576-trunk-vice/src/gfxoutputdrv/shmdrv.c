@@ -0,0 +1,470 @@
+/** \file   shmdrv.c
+ * \brief   Movie driver publishing frames and audio in POSIX shared memory
+ *
+ * Every recorded frame and every block of audio is written into a ring of
+ * slots in a shared memory object, together with a sequence number, so
+ * local programs (recorders, test comparators, streaming bridges) can map
+ * the object and read the data without going through a pipe or socket.
+ * The layout is described in shmdrv.h, src/tools/shmread is a small reader.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* #define DEBUG_SHMDRV */
+
+#include "vice.h"
+
+#ifdef HAVE_SHM_OPEN
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "archdep_defs.h"
+#include "cmdline.h"
+#include "gfxoutput.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "palette.h"
+#include "resources.h"
+#include "screenshot.h"
+#include "shmdrv.h"
+#include "soundmovie.h"
+#include "util.h"
+
+#ifdef DEBUG_SHMDRV
+#define LOG(x)  log_debug   x
+#else
+#define LOG(x)
+#endif
+
+/* slots are aligned to this many bytes */
+#define SHM_SLOT_ALIGN  64
+
+#define SHM_ALIGN(x)    (((x) + (SHM_SLOT_ALIGN - 1)) & ~((size_t)SHM_SLOT_ALIGN - 1))
+
+/******************************************************************************/
+
+/* the shared memory object */
+static char *shm_name = NULL;
+static int shm_fd = -1;
+static uint8_t *shm_base = NULL;
+static size_t shm_size = 0;
+static shm_export_header_t *shm_header = NULL;
+
+/* sequence numbers of the last frame and audio block written */
+static uint64_t frame_seq = 0;
+static uint64_t block_seq = 0;
+
+/* audio */
+static soundmovie_buffer_t shmdrv_audio_in;
+
+/* resources */
+static int shm_frames = 8;
+static int shm_rgb = 0;
+
+static int set_shm_frames(int val, void *param)
+{
+    if (val < 2 || val > 256) {
+        return -1;
+    }
+    shm_frames = val;
+    return 0;
+}
+
+static int set_shm_rgb(int val, void *param)
+{
+    shm_rgb = val ? 1 : 0;
+    return 0;
+}
+
+/*---------- Resources ------------------------------------------------*/
+
+static const resource_int_t resources_int[] = {
+    { "SHMExportFrames", 8, RES_EVENT_NO, NULL,
+      &shm_frames, set_shm_frames, NULL },
+    { "SHMExportRGB", 0, RES_EVENT_NO, NULL,
+      &shm_rgb, set_shm_rgb, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+static int shmdrv_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+/*---------- Commandline options --------------------------------------*/
+
+static int cmdline_shm_export(const char *arg, void *param)
+{
+    return screenshot_start_recording("SHM", arg);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-shmexport", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_shm_export, NULL, NULL, NULL,
+      "<Name>", "Publish frames and audio in the POSIX shared memory object <Name>" },
+    { "-shmexportframes", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SHMExportFrames", NULL,
+      "<value>", "Set the number of frames kept in the shared memory ring (2-256)" },
+    { "-shmexportrgb", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SHMExportRGB", (resource_value_t)1,
+      NULL, "Publish frames as 24 bit RGB" },
+    { "+shmexportrgb", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SHMExportRGB", (resource_value_t)0,
+      NULL, "Publish frames as palette indices" },
+    CMDLINE_LIST_END
+};
+
+static int shmdrv_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/*---------------------------------------------------------------------*/
+
+static shm_export_frame_t *frame_slot(uint64_t seq)
+{
+    return (shm_export_frame_t *)(shm_base + shm_header->frames_offset
+                                  + ((seq - 1) % shm_header->num_frames) * shm_header->frame_slot_size);
+}
+
+static shm_export_block_t *block_slot(uint64_t seq)
+{
+    return (shm_export_block_t *)(shm_base + shm_header->blocks_offset
+                                  + ((seq - 1) % shm_header->num_blocks) * shm_header->block_slot_size);
+}
+
+static void shmdrv_unmap(void)
+{
+    if (shm_header != NULL) {
+        shm_header->active = 0;
+    }
+    if (shm_base != NULL) {
+        munmap(shm_base, shm_size);
+    }
+    if (shm_fd >= 0) {
+        close(shm_fd);
+    }
+    if (shm_name != NULL) {
+        /* readers that still have it mapped keep their mapping */
+        shm_unlink(shm_name);
+        lib_free(shm_name);
+    }
+
+    shm_name = NULL;
+    shm_fd = -1;
+    shm_base = NULL;
+    shm_size = 0;
+    shm_header = NULL;
+}
+
+/*-----------------------*/
+/* audio stream          */
+/*-----------------------*/
+
+/* Soundmovie API soundmovie_funcs_t.init */
+static int shm_soundmovie_init(int speed, int channels, soundmovie_buffer_t **audio_in)
+{
+    int samples;
+
+    LOG(("shm_soundmovie_init(speed:%d channels:%d)", speed, channels));
+
+    if (shm_header == NULL || channels < 1) {
+        return -1;
+    }
+
+    /* one block per frame */
+    samples = (int)(((int64_t)speed * shm_header->cycles_per_frame) / shm_header->cycles_per_second) * channels;
+    if (samples > SHM_EXPORT_BLOCK_SAMPLES) {
+        samples = SHM_EXPORT_BLOCK_SAMPLES - (SHM_EXPORT_BLOCK_SAMPLES % channels);
+    }
+    if (samples < channels) {
+        samples = channels;
+    }
+
+    lib_free(shmdrv_audio_in.buffer);
+    shmdrv_audio_in.buffer = lib_malloc(samples * sizeof(int16_t));
+    shmdrv_audio_in.size = samples;
+    shmdrv_audio_in.used = 0;
+    *audio_in = &shmdrv_audio_in;
+
+    shm_header->audio_rate = (uint32_t)speed;
+    shm_header->audio_channels = (uint32_t)channels;
+
+    return 0;
+}
+
+/* Soundmovie API soundmovie_funcs_t.encode */
+static int shm_soundmovie_encode(soundmovie_buffer_t *audio_in)
+{
+    shm_export_block_t *slot;
+
+    if (shm_header == NULL) {
+        return -1;
+    }
+
+    block_seq++;
+    slot = block_slot(block_seq);
+
+    slot->seq = 0;
+    SHM_EXPORT_BARRIER();
+
+    slot->samples = (uint32_t)audio_in->used;
+    memcpy((uint8_t *)slot + sizeof(shm_export_block_t), audio_in->buffer,
+           audio_in->used * sizeof(int16_t));
+
+    SHM_EXPORT_BARRIER();
+    slot->seq = block_seq;
+    SHM_EXPORT_BARRIER();
+    shm_header->block_seq = block_seq;
+
+    audio_in->used = 0;
+    return 0;
+}
+
+/* Soundmovie API soundmovie_funcs_t.close */
+static void shm_soundmovie_close(void)
+{
+    LOG(("shm_soundmovie_close()"));
+    /* just stop the whole recording */
+    screenshot_stop_recording();
+}
+
+static soundmovie_funcs_t shmdrv_soundmovie_funcs = {
+    shm_soundmovie_init,
+    shm_soundmovie_encode,
+    shm_soundmovie_close
+};
+
+/*-----------------------*/
+/* driver API            */
+/*-----------------------*/
+
+/* Driver API gfxoutputdrv_t.save */
+/* called once to start recording video+audio */
+static int shmdrv_save(screenshot_t *screenshot, const char *filename)
+{
+    size_t bpp = shm_rgb ? 3 : 1;
+    size_t frame_slot_size, block_slot_size, header_size;
+    size_t num_blocks;
+
+    LOG(("shmdrv_save(name:'%s')", filename));
+
+    if (shm_base != NULL) {
+        shmdrv_unmap();
+    }
+
+    /* POSIX wants the name to start with a slash */
+    if (filename[0] == '/') {
+        shm_name = lib_strdup(filename);
+    } else {
+        shm_name = util_concat("/", filename, NULL);
+    }
+
+    header_size = SHM_ALIGN(sizeof(shm_export_header_t));
+    frame_slot_size = SHM_ALIGN(sizeof(shm_export_frame_t)
+                                + (size_t)screenshot->max_width * screenshot->max_height * bpp);
+    block_slot_size = SHM_ALIGN(sizeof(shm_export_block_t) + SHM_EXPORT_BLOCK_SAMPLES * sizeof(int16_t));
+    /* keep about as much audio as video */
+    num_blocks = (size_t)shm_frames * 2;
+
+    shm_size = header_size + frame_slot_size * shm_frames + block_slot_size * num_blocks;
+
+    shm_fd = shm_open(shm_name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (shm_fd < 0) {
+        log_error(LOG_DEFAULT, "shmdrv: shm_open(%s) failed: %s", shm_name, strerror(errno));
+        shmdrv_unmap();
+        return -1;
+    }
+
+    if (ftruncate(shm_fd, (off_t)shm_size) < 0) {
+        log_error(LOG_DEFAULT, "shmdrv: Cannot resize %s to %"PRI_SIZE_T" bytes: %s",
+                  shm_name, shm_size, strerror(errno));
+        shmdrv_unmap();
+        return -1;
+    }
+
+    shm_base = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (shm_base == MAP_FAILED) {
+        log_error(LOG_DEFAULT, "shmdrv: Cannot map %s: %s", shm_name, strerror(errno));
+        shm_base = NULL;
+        shmdrv_unmap();
+        return -1;
+    }
+
+    /* ftruncate() already filled the object with zeroes */
+    shm_header = (shm_export_header_t *)shm_base;
+    memcpy(shm_header->magic, SHM_EXPORT_MAGIC, sizeof(SHM_EXPORT_MAGIC));
+    shm_header->version = SHM_EXPORT_VERSION;
+    shm_header->header_size = (uint32_t)sizeof(shm_export_header_t);
+
+    shm_header->video_format = shm_rgb ? SHM_EXPORT_RGB24 : SHM_EXPORT_INDEXED8;
+    shm_header->cycles_per_second = (uint32_t)machine_get_cycles_per_second();
+    shm_header->cycles_per_frame = (uint32_t)machine_get_cycles_per_frame();
+    shm_header->max_width = screenshot->max_width;
+    shm_header->max_height = screenshot->max_height;
+    shm_header->num_frames = (uint32_t)shm_frames;
+    shm_header->frame_slot_size = (uint32_t)frame_slot_size;
+    shm_header->frames_offset = header_size;
+
+    shm_header->num_blocks = (uint32_t)num_blocks;
+    shm_header->block_slot_size = (uint32_t)block_slot_size;
+    shm_header->blocks_offset = header_size + frame_slot_size * shm_frames;
+
+    SHM_EXPORT_BARRIER();
+    shm_header->active = 1;
+
+    frame_seq = 0;
+    block_seq = 0;
+
+    log_message(LOG_DEFAULT, "shmdrv: Publishing %ux%u frames in %s (%"PRI_SIZE_T" bytes).",
+                screenshot->max_width, screenshot->max_height, shm_name, shm_size);
+
+    soundmovie_start(&shmdrv_soundmovie_funcs);
+
+    return 0;
+}
+
+/* Driver API gfxoutputdrv_t.record */
+/* triggered by screenshot_record, called for every frame */
+static int shmdrv_record(screenshot_t *screenshot)
+{
+    shm_export_frame_t *slot;
+    uint8_t *data;
+    unsigned int width, height, y;
+    unsigned int i;
+
+    if (shm_header == NULL) {
+        return -1;
+    }
+
+    width = screenshot->width;
+    height = screenshot->height;
+    if (width > shm_header->max_width || height > shm_header->max_height) {
+        /* the layout of the object cannot change while it is in use */
+        log_error(LOG_DEFAULT, "shmdrv: Frame size %ux%u exceeds %ux%u.",
+                  width, height, shm_header->max_width, shm_header->max_height);
+        return -1;
+    }
+
+    frame_seq++;
+    slot = frame_slot(frame_seq);
+    data = (uint8_t *)slot + sizeof(shm_export_frame_t);
+
+    slot->seq = 0;
+    SHM_EXPORT_BARRIER();
+
+    slot->width = width;
+    slot->height = height;
+
+    if (shm_header->video_format == SHM_EXPORT_RGB24) {
+        slot->line_size = width * 3;
+        for (y = 0; y < height; y++) {
+            (screenshot->convert_line)(screenshot, data + y * slot->line_size, y, SCREENSHOT_MODE_RGB24);
+        }
+    } else {
+        slot->line_size = width;
+        for (i = 0; i < screenshot->palette->num_entries && i < 256; i++) {
+            slot->palette[i * 3 + 0] = screenshot->palette->entries[i].red;
+            slot->palette[i * 3 + 1] = screenshot->palette->entries[i].green;
+            slot->palette[i * 3 + 2] = screenshot->palette->entries[i].blue;
+        }
+        for (y = 0; y < height; y++) {
+            (screenshot->convert_line)(screenshot, data + y * slot->line_size, y, SCREENSHOT_MODE_PALETTE);
+        }
+    }
+
+    SHM_EXPORT_BARRIER();
+    slot->seq = frame_seq;
+    SHM_EXPORT_BARRIER();
+    shm_header->frame_seq = frame_seq;
+
+    return 0;
+}
+
+/* Driver API gfxoutputdrv_t.close */
+static int shmdrv_close(screenshot_t *screenshot)
+{
+    soundmovie_stop();
+
+    if (shm_name != NULL) {
+        log_message(LOG_DEFAULT, "shmdrv: Stopped publishing in %s after %"PRIu64" frames.",
+                    shm_name, frame_seq);
+    }
+    shmdrv_unmap();
+
+    lib_free(shmdrv_audio_in.buffer);
+    shmdrv_audio_in.buffer = NULL;
+    shmdrv_audio_in.size = 0;
+    shmdrv_audio_in.used = 0;
+
+    return 0;
+}
+
+/* Driver API gfxoutputdrv_t.write */
+static int shmdrv_write(screenshot_t *screenshot)
+{
+    return 0;
+}
+
+/* Driver API gfxoutputdrv_t.shutdown */
+static void shmdrv_shutdown(void)
+{
+    shmdrv_unmap();
+    lib_free(shmdrv_audio_in.buffer);
+    shmdrv_audio_in.buffer = NULL;
+}
+
+static gfxoutputdrv_t shm_drv = {
+    "SHM",
+    "Shared memory (POSIX)",
+    NULL,
+    NULL,
+    NULL, /* open */
+    shmdrv_close,
+    shmdrv_write,
+    shmdrv_save,
+    NULL,
+    shmdrv_record,
+    shmdrv_shutdown,
+    shmdrv_resources_init,
+    shmdrv_cmdline_options_init
+#ifdef FEATURE_CPUMEMHISTORY
+    , NULL
+#endif
+};
+
+/* public, init this output driver */
+void gfxoutput_init_shm(int help)
+{
+    gfxoutput_register(&shm_drv);
+}
+
+#endif /* HAVE_SHM_OPEN */
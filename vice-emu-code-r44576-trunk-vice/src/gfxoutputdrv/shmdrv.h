@@ -0,0 +1,110 @@
+/*
+ * shmdrv.h - Export of frames and audio through POSIX shared memory.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_SHMDRV_H
+#define VICE_SHMDRV_H
+
+#include "types.h"
+
+/*
+ * Layout of the shared memory object.  This header is also used by the
+ * reader in src/tools/shmread, keep both in sync.
+ *
+ * The object starts with a shm_export_header_t, followed by `num_frames'
+ * video slots of `frame_slot_size' bytes each and `num_blocks' audio slots
+ * of `block_slot_size' bytes each.  All values are in host byte order.
+ *
+ * Frame n (counting from 1) is stored in slot (n - 1) % num_frames, audio
+ * block n in slot (n - 1) % num_blocks.  The writer sets the `seq' field of
+ * a slot to 0 before it overwrites the slot and to n once the slot is
+ * complete, and then stores n in `frame_seq' or `block_seq' of the header.
+ * A reader takes the sequence number from the header, reads the slot and
+ * checks that the `seq' of the slot still has the same value afterwards.
+ * If it does not, the writer has lapped the reader and the data is torn.
+ */
+
+#define SHM_EXPORT_MAGIC        "VICESHM"
+#define SHM_EXPORT_VERSION      1
+
+/* values for video_format */
+#define SHM_EXPORT_INDEXED8     0   /* one byte per pixel, palette in the slot */
+#define SHM_EXPORT_RGB24        1   /* three bytes (r, g, b) per pixel */
+
+/* Maximum number of samples (for all channels) in an audio block.  */
+#define SHM_EXPORT_BLOCK_SAMPLES    4096
+
+typedef struct shm_export_header_s {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+
+    /* non-zero while VICE is writing to the object */
+    volatile uint32_t active;
+
+    /* video */
+    uint32_t video_format;
+    uint32_t cycles_per_second;     /* frame rate is cycles_per_second / cycles_per_frame */
+    uint32_t cycles_per_frame;
+    uint32_t max_width;             /* maximum size of a frame in pixels */
+    uint32_t max_height;
+    uint32_t num_frames;
+    uint32_t frame_slot_size;
+    uint64_t frames_offset;
+    volatile uint64_t frame_seq;    /* newest complete frame, 0 = none yet */
+
+    /* audio, the format fields are 0 until the sound system started */
+    volatile uint32_t audio_rate;
+    volatile uint32_t audio_channels;   /* samples are interleaved int16_t */
+    uint32_t num_blocks;
+    uint32_t block_slot_size;
+    uint64_t blocks_offset;
+    volatile uint64_t block_seq;    /* newest complete block, 0 = none yet */
+} shm_export_header_t;
+
+typedef struct shm_export_frame_s {
+    volatile uint64_t seq;
+    uint32_t width;
+    uint32_t height;
+    uint32_t line_size;             /* bytes per line of pixel data */
+    uint32_t reserved;
+    uint8_t palette[256 * 3];       /* r, g, b, only for SHM_EXPORT_INDEXED8 */
+    /* pixel data follows */
+} shm_export_frame_t;
+
+typedef struct shm_export_block_s {
+    volatile uint64_t seq;
+    uint32_t samples;               /* number of int16_t that follow */
+    uint32_t reserved;
+    /* sample data follows */
+} shm_export_block_t;
+
+/* Memory barrier between the slot data and the sequence numbers.  */
+#if defined(__GNUC__) || defined(__clang__)
+#define SHM_EXPORT_BARRIER()    __sync_synchronize()
+#else
+#define SHM_EXPORT_BARRIER()
+#endif
+
+void gfxoutput_init_shm(int help);
+
+#endif
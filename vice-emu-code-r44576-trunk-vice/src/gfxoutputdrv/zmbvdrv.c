@@ -34,6 +34,7 @@
 #include <string.h>
 
 #include "archdep.h"
+#include "capturequeue.h"
 #include "cmdline.h"
 #include "gfxoutput.h"
 #include "lib.h"
@@ -85,10 +86,6 @@ static zmvb_init_flags_t iflg = ZMBV_INIT_FLAG_NONE;
 static int complevel = -1;  /* compression level, -1 means default */
 static int no_zlib = 0;
 
-static uint8_t cur_pal[PALETTE_SIZE];
-
-static int16_t cur_audio[MAX_AUDIO_BUFFER_SIZE];
-
 static zmbv_avi_t zavi;
 static zmbv_codec_t zcodec;
 static zmbv_format_t fmt;
@@ -99,7 +96,8 @@ static void *video_work_buffer = NULL;
 static int video_codec;
 static int audio_codec;
 
-static uint8_t *cur_screen = NULL;
+/* frames and audio go through this to the encoder thread */
+static capture_queue_t *zqueue = NULL;
 
 /* general */
 static int file_init_done = 1;
@@ -127,6 +125,7 @@ static int audio_channels = 1;       /* initialized by zmbv_soundmovie_init */
 static unsigned int video_framerate = 50; /* initialized by zmbvdrv_init_video */
 
 static int zmbvdrv_init_file(void);
+static int zmbvdrv_encode(int type, uint8_t *data, size_t size, unsigned int repeat);
 
 /******************************************************************************/
 
@@ -321,44 +320,37 @@ static int zmbv_soundmovie_init(int speed, int channels, soundmovie_buffer_t **
 static int zmbv_soundmovie_encode(soundmovie_buffer_t *audio_in)
 {
     int ret = 0;
+    int16_t *cur_audio;
+    size_t size;
+    int i, o;
 
     LOGFRAMES(("zmbv_soundmovie_encode(size:%d used:%d channels:%d)",
                audio_in->size, audio_in->used, audio_channels));
 
-    /* FIXME: we might have an endianess problem here, we might have to swap lo/hi on BE machines */
-    if (audio_channels == 1) {
-        int i, o;
-#if 1
-        /* convert mono -> stereo */
-        for (i = o = 0; i < audio_in->used; i++, o+=2) {
-            cur_audio[o] = audio_in->buffer[i];
-            cur_audio[o+1] = audio_in->buffer[i];
-        }
-        /* write avi chunks */
-        if (zmbv_avi_write_chunk_audio(zavi, &cur_audio[0], audio_in->used * 4) < 0) {
-            LOG(("FATAL: can't write audio frame for screen #%d", frameno));
-            ret = -1;
-        }
-#else
-        /* FIXME: we should write the mono stream into the avi instead */
-#endif
-    } else if (audio_channels == 2) {
-        int i, o;
-        for (i = o = 0; i < audio_in->used; i+=2, o+=2) {
-            cur_audio[o] = audio_in->buffer[i];
-            cur_audio[o+1] = audio_in->buffer[i+1];
-        }
-        /* write avi chunks */
-        if (zmbv_avi_write_chunk_audio(zavi, &audio_in->buffer[0], audio_in->used * 2) < 0) {
-            LOG(("FATAL: can't write audio frame for screen #%d", frameno));
-            ret = -1;
+    if (audio_channels != 1 && audio_channels != 2) {
+        audio_in->used = 0;
+        return -1;
+    }
+
+    /* the avi always has a stereo stream */
+    size = (size_t)audio_in->used * sizeof(int16_t) * (audio_channels == 1 ? 2 : 1);
+    ret = capture_queue_reserve(zqueue, CAPTURE_QUEUE_AUDIO, size, (uint8_t **)&cur_audio);
+    if (ret == 0) {
+        /* FIXME: we might have an endianess problem here, we might have to swap lo/hi on BE machines */
+        if (audio_channels == 1) {
+            /* convert mono -> stereo */
+            for (i = o = 0; i < audio_in->used; i++, o += 2) {
+                cur_audio[o] = audio_in->buffer[i];
+                cur_audio[o + 1] = audio_in->buffer[i];
+            }
+        } else {
+            memcpy(cur_audio, audio_in->buffer, size);
         }
-    } else {
-        ret = -1;
+        ret = capture_queue_commit(zqueue);
     }
 
     audio_in->used = 0;
-    return ret;
+    return ret < 0 ? -1 : 0;
 }
 
 /* Soundmovie API soundmovie_funcs_t.close */
@@ -379,8 +371,11 @@ static soundmovie_funcs_t zmbvdrv_soundmovie_funcs = {
 /*-----------------------*/
 /* video stream encoding */
 /*-----------------------*/
-static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot)
+/* Copy the palette and the pixels of the screenshot into `frame'.  */
+static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot, uint8_t *frame)
 {
+    uint8_t *cur_pal = frame;
+    uint8_t *cur_screen = frame + PALETTE_SIZE;
     int x, y;
     int dx, dy;
     int bufferoffset;
@@ -415,24 +410,12 @@ static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot)
     return 0;
 }
 
-static uint8_t *zmbvdrv_alloc_picture(int width, int height)
-{
-    /* the pixel format is always 8bpp, with a 256 entries, 24bit, palette */
-    LOG(("zmbvdrv_alloc_picture width:%d height:%d", width, height));
-    return lib_malloc(width * height);
-}
-
 /* called by zmbvdrv_init_file() */
 static int zmbvdrv_open_video(int width, int height)
 {
     LOG(("zmbvdrv_open_video width:%d height:%d", width, height));
     /* MOVE? open the codec */
     video_is_open = 1;
-    /* FIXME: allocate the encoded raw picture */
-    cur_screen = zmbvdrv_alloc_picture(width, height);
-    if (cur_screen == NULL) {
-        return -1;
-    }
     return 0;
 }
 
@@ -441,10 +424,6 @@ static void zmbvdrv_close_video(void)
 {
     LOG(("zmbvdrv_close_video"));
     video_is_open = 0;
-    if (cur_screen != NULL) {
-        lib_free (cur_screen);
-        cur_screen = NULL;
-    }
 }
 /* called by zmbvdrv_save */
 static void zmbvdrv_init_video(screenshot_t *screenshot)
@@ -541,6 +520,8 @@ static int zmbvdrv_save(screenshot_t *screenshot, const char *filename)
 
     frameno = 0;
 
+    zqueue = capture_queue_open("ZMBV", zmbvdrv_encode);
+
     soundmovie_start(&zmbvdrv_soundmovie_funcs);
 
     return 0;
@@ -553,6 +534,10 @@ static int zmbvdrv_close(screenshot_t *screenshot)
 
     soundmovie_stop();
 
+    /* wait for the encoder thread */
+    capture_queue_close(zqueue);
+    zqueue = NULL;
+
     zmbvdrv_close_video();
     zmbvdrv_close_audio();
 
@@ -576,15 +561,33 @@ static int zmbvdrv_close(screenshot_t *screenshot)
 /* triggered by screenshot_record, periodically called to output video data stream */
 static int zmbvdrv_record(screenshot_t *screenshot)
 {
-    int ret = -1;
-    int32_t written;
-    int flags;
+    uint8_t *frame;
+    int ret;
 
     if (audio_init_done && video_init_done && !file_init_done) {
         zmbvdrv_init_file();
     }
 
-    zmbvdrv_fill_rgb_image(screenshot);
+    /* the pixel format is always 8bpp, with a 256 entries, 24bit, palette */
+    ret = capture_queue_reserve(zqueue, CAPTURE_QUEUE_VIDEO,
+                                PALETTE_SIZE + (size_t)video_width * video_height, &frame);
+    if (ret != 0) {
+        /* either dropped (the encoder repeats the next frame) or an error */
+        return ret < 0 ? -1 : 0;
+    }
+    zmbvdrv_fill_rgb_image(screenshot, frame);
+
+    return capture_queue_commit(zqueue);
+}
+
+/* Encode and write one frame, on the encoder thread.  */
+static int zmbvdrv_encode_frame(uint8_t *frame)
+{
+    uint8_t *cur_pal = frame;
+    uint8_t *cur_screen = frame + PALETTE_SIZE;
+    int ret = -1;
+    int32_t written;
+    int flags;
 
     flags = ((frameno % KEYFRAME_INTERVAL == 0) ? ZMBV_PREP_FLAG_KEYFRAME : ZMBV_PREP_FLAG_NONE);
 
@@ -623,6 +626,28 @@ quit:
     return 0;
 }
 
+/* capture_queue_encode_t, called on the encoder thread */
+static int zmbvdrv_encode(int type, uint8_t *data, size_t size, unsigned int repeat)
+{
+    unsigned int i;
+
+    if (type == CAPTURE_QUEUE_AUDIO) {
+        if (zmbv_avi_write_chunk_audio(zavi, data, (int)size) < 0) {
+            LOG(("FATAL: can't write audio frame for screen #%d", frameno));
+            return -1;
+        }
+        return 0;
+    }
+
+    /* dropped frames are replaced by this one, which keeps the timing */
+    for (i = 0; i <= repeat; i++) {
+        if (zmbvdrv_encode_frame(data) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /* Driver API gfxoutputdrv_t.write */
 static int zmbvdrv_write(screenshot_t *screenshot)
 {
@@ -0,0 +1,544 @@
+/*
+ * goldenframe.c - Compare frames against references at given cycles.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+ * Visual regression tests used to save a PNG at fixed cycles and compare
+ * it with a reference outside of VICE.  With -goldenframes the emulator
+ * does the comparison itself, on the palette indices of the frame (the
+ * same area a screenshot would contain), so nothing is encoded unless a
+ * frame does not match.
+ *
+ * The list file has one check per line, `#' starts a comment:
+ *
+ *   <cycle> <reference>
+ *
+ * The frame that ends first at or after <cycle> is compared with the
+ * reference, which is either a 64 bit FNV-1a hash of the frame as 16 hex
+ * digits, or the name of a PGM file (relative to the list file) holding
+ * the palette indices as grey values.  A missing PGM file is created from
+ * the frame, and without a reference (or with `-') the hash is only logged,
+ * which is how the references are made in the first place.
+ *
+ * For a frame that does not match, <list>-<line>-actual.png and, if there
+ * is a PGM reference of the same size, <list>-<line>-diff.png (changed
+ * pixels red, the rest dimmed) are written next to the list file, as BMP
+ * if VICE was built without libpng.  After
+ * the last check VICE exits with GOLDENFRAME_EXIT_OK, _MISMATCH or _ERROR.
+ */
+
+#include "vice.h"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "gfxoutput.h"
+#include "goldenframe.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "palette.h"
+#include "screenshot.h"
+#include "types.h"
+#include "util.h"
+
+typedef struct golden_check_s {
+    CLOCK clk;
+    /* hash, PGM file name, or NULL to only log the hash */
+    char *reference;
+    int is_hash;
+    uint64_t hash;
+    /* line in the list file, used to name the images */
+    int line;
+} golden_check_t;
+
+static golden_check_t *checks = NULL;
+static unsigned int num_checks = 0;
+static unsigned int next_check = 0;
+
+/* list file without the extension, the images are named after it */
+static char *image_prefix = NULL;
+static char *list_dir = NULL;
+
+static unsigned int num_matched = 0;
+static unsigned int num_mismatched = 0;
+static unsigned int num_created = 0;
+static unsigned int num_errors = 0;
+
+static log_t golden_log = LOG_DEFAULT;
+
+/* driver for the images of frames that did not match, BMP without libpng */
+static const char *image_driver = "PNG";
+static const char *image_ext = "png";
+
+/* FNV-1a */
+static uint64_t frame_hash(const uint8_t *pixels, unsigned int width, unsigned int height)
+{
+    uint64_t hash = UINT64_C(14695981039346656037);
+    size_t i, size = (size_t)width * height;
+
+    hash = (hash ^ (width & 0xffff)) * UINT64_C(1099511628211);
+    hash = (hash ^ (height & 0xffff)) * UINT64_C(1099511628211);
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ pixels[i]) * UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+/* Copy the palette indices of the visible frame, the same area
+   screenshot_save() would save.  */
+static uint8_t *grab_frame(struct video_canvas_s *canvas, unsigned int *width,
+                           unsigned int *height, palette_t **palette)
+{
+    screenshot_t screenshot;
+    uint8_t *pixels, *line;
+    unsigned int x, y;
+
+    if (machine_screenshot(&screenshot, canvas) < 0) {
+        return NULL;
+    }
+
+    *width = screenshot.max_width & ~3;
+    *height = screenshot.last_displayed_line - screenshot.first_displayed_line + 1;
+    *palette = screenshot.palette;
+
+    pixels = lib_malloc((size_t)*width * *height);
+    for (y = 0; y < *height; y++) {
+        line = screenshot.draw_buffer
+               + (size_t)(y + screenshot.first_displayed_line) * screenshot.size_height
+                 * screenshot.draw_buffer_line_size;
+        for (x = 0; x < *width; x++) {
+            pixels[(size_t)y * *width + x] = line[x * screenshot.size_width + screenshot.x_offset];
+        }
+    }
+    return pixels;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int pgm_read_number(FILE *f, unsigned int *value)
+{
+    int c;
+
+    /* skip white space and comments */
+    do {
+        c = fgetc(f);
+        if (c == '#') {
+            while (c != EOF && c != '\n') {
+                c = fgetc(f);
+            }
+        }
+    } while (c != EOF && isspace(c));
+
+    if (c == EOF || !isdigit(c)) {
+        return -1;
+    }
+    *value = 0;
+    while (c != EOF && isdigit(c)) {
+        *value = *value * 10 + (unsigned int)(c - '0');
+        c = fgetc(f);
+    }
+    /* the single white space character after the number is eaten here */
+    return 0;
+}
+
+static uint8_t *pgm_load(const char *name, unsigned int *width, unsigned int *height)
+{
+    FILE *f;
+    uint8_t *pixels = NULL;
+    unsigned int maxval;
+    size_t size;
+
+    f = fopen(name, MODE_READ);
+    if (f == NULL) {
+        return NULL;
+    }
+
+    if (fgetc(f) != 'P' || fgetc(f) != '5'
+        || pgm_read_number(f, width) < 0 || pgm_read_number(f, height) < 0
+        || pgm_read_number(f, &maxval) < 0 || maxval == 0 || maxval > 255
+        || *width == 0 || *height == 0) {
+        log_error(golden_log, "`%s' is not a binary PGM file.", name);
+        fclose(f);
+        return NULL;
+    }
+
+    size = (size_t)*width * *height;
+    pixels = lib_malloc(size);
+    if (fread(pixels, 1, size, f) != size) {
+        log_error(golden_log, "`%s' is truncated.", name);
+        lib_free(pixels);
+        pixels = NULL;
+    }
+    fclose(f);
+    return pixels;
+}
+
+static int pgm_save(const char *name, const uint8_t *pixels, unsigned int width, unsigned int height)
+{
+    FILE *f;
+    size_t size = (size_t)width * height;
+    int ret = 0;
+
+    f = fopen(name, MODE_WRITE);
+    if (f == NULL) {
+        return -1;
+    }
+    fprintf(f, "P5\n%u %u\n255\n", width, height);
+    if (fwrite(pixels, 1, size, f) != size) {
+        ret = -1;
+    }
+    if (fclose(f) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Changed pixels in red, the others in dimmed grey.  */
+static void save_diff(const char *name, const uint8_t *actual, const uint8_t *expected,
+                      unsigned int width, unsigned int height, const palette_t *palette)
+{
+    palette_t *diff_palette;
+    uint8_t *diff;
+    size_t i, size = (size_t)width * height;
+    unsigned int c;
+
+    diff_palette = palette_create(256, NULL);
+    for (c = 0; c < 255; c++) {
+        diff_palette->entries[c].red = (uint8_t)(c / 2);
+        diff_palette->entries[c].green = (uint8_t)(c / 2);
+        diff_palette->entries[c].blue = (uint8_t)(c / 2);
+    }
+    diff_palette->entries[255].red = 255;
+    diff_palette->entries[255].green = 0;
+    diff_palette->entries[255].blue = 0;
+
+    diff = lib_malloc(size);
+    for (i = 0; i < size; i++) {
+        if (actual[i] != expected[i]) {
+            diff[i] = 255;
+        } else if (actual[i] < palette->num_entries) {
+            const palette_entry_t *e = &palette->entries[actual[i]];
+
+            diff[i] = (uint8_t)((e->red * 77 + e->green * 150 + e->blue * 29) >> 9);
+        } else {
+            diff[i] = 0;
+        }
+    }
+
+    if (screenshot_save_pixels(image_driver, name, width, height, diff, diff_palette) < 0) {
+        log_error(golden_log, "Could not save `%s'.", name);
+    }
+
+    lib_free(diff);
+    palette_free(diff_palette);
+}
+
+static void save_mismatch(golden_check_t *check, struct video_canvas_s *canvas,
+                          const uint8_t *actual, const uint8_t *expected,
+                          unsigned int width, unsigned int height, const palette_t *palette)
+{
+    char *name;
+
+    if (gfxoutput_get_driver(image_driver) == NULL) {
+        image_driver = "BMP";
+        image_ext = "bmp";
+    }
+
+    name = lib_msprintf("%s-%d-actual.%s", image_prefix, check->line, image_ext);
+    if (screenshot_save(image_driver, name, canvas) < 0) {
+        log_error(golden_log, "Could not save `%s'.", name);
+    }
+    lib_free(name);
+
+    if (expected != NULL) {
+        name = lib_msprintf("%s-%d-diff.%s", image_prefix, check->line, image_ext);
+        save_diff(name, actual, expected, width, height, palette);
+        lib_free(name);
+    }
+}
+
+static void run_check(golden_check_t *check, struct video_canvas_s *canvas)
+{
+    uint8_t *actual, *expected = NULL;
+    unsigned int width, height, ref_width, ref_height;
+    palette_t *palette;
+    uint64_t hash;
+    char *path;
+    int match;
+
+    actual = grab_frame(canvas, &width, &height, &palette);
+    if (actual == NULL) {
+        log_error(golden_log, "Line %d: cannot get the frame.", check->line);
+        num_errors++;
+        return;
+    }
+    hash = frame_hash(actual, width, height);
+
+    if (check->reference == NULL) {
+        log_message(golden_log, "Line %d: cycle %"PRIu64" frame %ux%u hash %016"PRIx64".",
+                    check->line, (uint64_t)maincpu_clk, width, height, hash);
+        num_created++;
+        lib_free(actual);
+        return;
+    }
+
+    if (check->is_hash) {
+        match = (hash == check->hash);
+    } else {
+        if (archdep_path_is_relative(check->reference) && list_dir != NULL) {
+            path = util_join_paths(list_dir, check->reference, NULL);
+        } else {
+            path = lib_strdup(check->reference);
+        }
+
+        if (!util_file_exists(path)) {
+            if (pgm_save(path, actual, width, height) < 0) {
+                log_error(golden_log, "Line %d: cannot create `%s'.", check->line, path);
+                num_errors++;
+            } else {
+                log_message(golden_log, "Line %d: created `%s' (hash %016"PRIx64").",
+                            check->line, path, hash);
+                num_created++;
+            }
+            lib_free(path);
+            lib_free(actual);
+            return;
+        }
+
+        expected = pgm_load(path, &ref_width, &ref_height);
+        lib_free(path);
+        if (expected == NULL) {
+            num_errors++;
+            lib_free(actual);
+            return;
+        }
+        if (ref_width != width || ref_height != height) {
+            log_message(golden_log, "Line %d: frame is %ux%u, the reference %ux%u.",
+                        check->line, width, height, ref_width, ref_height);
+            lib_free(expected);
+            expected = NULL;
+            match = 0;
+        } else {
+            match = (memcmp(actual, expected, (size_t)width * height) == 0);
+        }
+    }
+
+    if (match) {
+        num_matched++;
+    } else {
+        log_message(golden_log, "Line %d: cycle %"PRIu64" MISMATCH, hash %016"PRIx64".",
+                    check->line, (uint64_t)maincpu_clk, hash);
+        num_mismatched++;
+        save_mismatch(check, canvas, actual, expected, width, height, palette);
+    }
+
+    lib_free(expected);
+    lib_free(actual);
+}
+
+void goldenframe_vsync(struct video_canvas_s *canvas)
+{
+    int code;
+
+    if (next_check >= num_checks || maincpu_clk < checks[next_check].clk) {
+        return;
+    }
+
+    /* several checks may fall into the same frame */
+    while (next_check < num_checks && maincpu_clk >= checks[next_check].clk) {
+        run_check(&checks[next_check], canvas);
+        next_check++;
+    }
+
+    if (next_check < num_checks) {
+        return;
+    }
+
+    log_message(golden_log, "%u frames matched, %u mismatched, %u new, %u errors.",
+                num_matched, num_mismatched, num_created, num_errors);
+
+    if (num_errors > 0) {
+        code = GOLDENFRAME_EXIT_ERROR;
+    } else if (num_mismatched > 0) {
+        code = GOLDENFRAME_EXIT_MISMATCH;
+    } else {
+        code = GOLDENFRAME_EXIT_OK;
+    }
+    archdep_vice_exit(code);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int check_compare(const void *a, const void *b)
+{
+    const golden_check_t *ca = (const golden_check_t *)a;
+    const golden_check_t *cb = (const golden_check_t *)b;
+
+    if (ca->clk != cb->clk) {
+        return ca->clk < cb->clk ? -1 : 1;
+    }
+    return ca->line - cb->line;
+}
+
+static int is_hash(const char *s)
+{
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        if (!isxdigit((unsigned char)s[i])) {
+            return 0;
+        }
+    }
+    return s[16] == 0;
+}
+
+static int goldenframe_load(const char *name, void *param)
+{
+    FILE *f;
+    char buf[1024];
+    char *p, *end, *ext;
+    unsigned int num_alloc = 0;
+    int line = 0;
+
+    goldenframe_shutdown();
+
+    f = fopen(name, MODE_READ_TEXT);
+    if (f == NULL) {
+        log_error(golden_log, "Cannot open golden frame list `%s'.", name);
+        return -1;
+    }
+
+    while (util_get_line(buf, (int)sizeof(buf), f) >= 0) {
+        golden_check_t *check;
+
+        line++;
+        p = strchr(buf, '#');
+        if (p != NULL) {
+            *p = 0;
+        }
+        p = buf;
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == 0) {
+            continue;
+        }
+
+        if (num_checks == num_alloc) {
+            num_alloc = num_alloc ? num_alloc * 2 : 64;
+            checks = lib_realloc(checks, num_alloc * sizeof(golden_check_t));
+        }
+        check = &checks[num_checks];
+        memset(check, 0, sizeof(golden_check_t));
+        check->line = line;
+
+        check->clk = (CLOCK)strtoull(p, &end, 0);
+        if (end == p || (*end != 0 && !isspace((unsigned char)*end))) {
+            log_error(golden_log, "%s:%d: expected a cycle count.", name, line);
+            fclose(f);
+            goldenframe_shutdown();
+            return -1;
+        }
+
+        p = end;
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        end = p + strlen(p);
+        while (end > p && isspace((unsigned char)end[-1])) {
+            *--end = 0;
+        }
+        if (*p != 0 && strcmp(p, "-") != 0) {
+            check->reference = lib_strdup(p);
+            check->is_hash = is_hash(p);
+            if (check->is_hash) {
+                check->hash = strtoull(p, NULL, 16);
+            }
+        }
+        num_checks++;
+    }
+    fclose(f);
+
+    if (num_checks == 0) {
+        log_error(golden_log, "Golden frame list `%s' is empty.", name);
+        return -1;
+    }
+    qsort(checks, num_checks, sizeof(golden_check_t), check_compare);
+
+    util_fname_split(name, &list_dir, NULL);
+    image_prefix = lib_strdup(name);
+    ext = strrchr(image_prefix, '.');
+    if (ext != NULL && strpbrk(ext, "/\\") == NULL) {
+        *ext = 0;
+    }
+
+    log_message(golden_log, "%u golden frames to check, the last at cycle %"PRIu64".",
+                num_checks, (uint64_t)checks[num_checks - 1].clk);
+    return 0;
+}
+
+void goldenframe_shutdown(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < num_checks; i++) {
+        lib_free(checks[i].reference);
+    }
+    lib_free(checks);
+    checks = NULL;
+    num_checks = 0;
+    next_check = 0;
+
+    lib_free(image_prefix);
+    image_prefix = NULL;
+    lib_free(list_dir);
+    list_dir = NULL;
+
+    num_matched = 0;
+    num_mismatched = 0;
+    num_created = 0;
+    num_errors = 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-goldenframes", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      goldenframe_load, NULL, NULL, NULL,
+      "<Name>", "Compare frames at the cycles listed in <Name> against hashes or PGM references and exit with the result" },
+    CMDLINE_LIST_END
+};
+
+int goldenframe_cmdline_options_init(void)
+{
+    golden_log = log_open("GoldenFrame");
+
+    return cmdline_register_options(cmdline_options);
+}
@@ -0,0 +1,40 @@
+/*
+ * goldenframe.h - Compare frames against references at given cycles.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_GOLDENFRAME_H
+#define VICE_GOLDENFRAME_H
+
+struct video_canvas_s;
+
+/* exit codes once all frames were checked */
+#define GOLDENFRAME_EXIT_OK         0
+#define GOLDENFRAME_EXIT_MISMATCH   1
+#define GOLDENFRAME_EXIT_ERROR      2
+
+int goldenframe_cmdline_options_init(void);
+void goldenframe_shutdown(void);
+
+/* called at every vsync with the canvas of the frame that just ended */
+void goldenframe_vsync(struct video_canvas_s *canvas);
+
+#endif
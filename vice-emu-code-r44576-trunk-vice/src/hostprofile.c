@@ -0,0 +1,170 @@
+/*
+ * hostprofile.c -- Host side profiler for the emulator hot paths
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <string.h>
+
+#include "archdep.h"
+#include "hostprofile.h"
+
+static const char * const section_names[HOSTPROFILE_NUM_SECTIONS] = {
+    "drive cpu",
+    "rotation",
+    "alarms",
+    "vic-ii",
+    "sound",
+    "mem read",
+    "mem write"
+};
+
+const char *hostprofile_section_name(hostprofile_section_t section)
+{
+    if ((int)section < 0 || (int)section >= HOSTPROFILE_NUM_SECTIONS) {
+        return "?";
+    }
+    return section_names[section];
+}
+
+#ifdef FEATURE_HOSTPROFILE
+
+int hostprofile_enabled = 0;
+int hostprofile_depth[HOSTPROFILE_NUM_SECTIONS];
+uint64_t hostprofile_start[HOSTPROFILE_NUM_SECTIONS];
+uint32_t hostprofile_calls[HOSTPROFILE_NUM_SECTIONS];
+uint64_t hostprofile_ticks[HOSTPROFILE_NUM_SECTIONS];
+
+static hostprofile_stats_t stats;
+static uint64_t frame_start = 0;
+
+#if !(defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))) \
+    && !((defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__)))
+/* no cycle counter available, extend the 32 bit tick timer instead */
+uint64_t hostprofile_now(void)
+{
+    static tick_t last = 0;
+    static uint64_t now = 0;
+    tick_t tick = tick_now();
+
+    now += (tick_t)(tick - last);
+    last = tick;
+
+    return now;
+}
+#endif
+
+int hostprofile_available(void)
+{
+    return 1;
+}
+
+int hostprofile_set_enabled(int enabled)
+{
+    if (enabled && !hostprofile_enabled) {
+        /* sections that are open right now are not timed */
+        memset(hostprofile_depth, 0, sizeof hostprofile_depth);
+        memset(hostprofile_calls, 0, sizeof hostprofile_calls);
+        memset(hostprofile_ticks, 0, sizeof hostprofile_ticks);
+        frame_start = hostprofile_now();
+    }
+    hostprofile_enabled = enabled ? 1 : 0;
+
+    return 0;
+}
+
+int hostprofile_get_enabled(void)
+{
+    return hostprofile_enabled;
+}
+
+void hostprofile_reset(void)
+{
+    memset(&stats, 0, sizeof stats);
+    memset(hostprofile_calls, 0, sizeof hostprofile_calls);
+    memset(hostprofile_ticks, 0, sizeof hostprofile_ticks);
+    frame_start = hostprofile_now();
+}
+
+void hostprofile_vsync(void)
+{
+    uint64_t now;
+    int i;
+
+    if (!hostprofile_enabled) {
+        return;
+    }
+
+    now = hostprofile_now();
+
+    stats.frames++;
+    stats.frame_ticks = now - frame_start;
+    stats.total_frame_ticks += stats.frame_ticks;
+
+    for (i = 0; i < HOSTPROFILE_NUM_SECTIONS; i++) {
+        stats.calls[i] = hostprofile_calls[i];
+        stats.ticks[i] = hostprofile_ticks[i];
+        stats.total_calls[i] += hostprofile_calls[i];
+        stats.total_ticks[i] += hostprofile_ticks[i];
+        hostprofile_calls[i] = 0;
+        hostprofile_ticks[i] = 0;
+    }
+
+    frame_start = now;
+}
+
+void hostprofile_get_stats(hostprofile_stats_t *dest)
+{
+    *dest = stats;
+}
+
+#else
+
+int hostprofile_available(void)
+{
+    return 0;
+}
+
+int hostprofile_set_enabled(int enabled)
+{
+    return -1;
+}
+
+int hostprofile_get_enabled(void)
+{
+    return 0;
+}
+
+void hostprofile_reset(void)
+{
+}
+
+void hostprofile_vsync(void)
+{
+}
+
+void hostprofile_get_stats(hostprofile_stats_t *dest)
+{
+    memset(dest, 0, sizeof *dest);
+}
+
+#endif /* FEATURE_HOSTPROFILE */
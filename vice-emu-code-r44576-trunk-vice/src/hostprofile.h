@@ -0,0 +1,138 @@
+/*
+ * hostprofile.h -- Host side profiler for the emulator hot paths
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_HOSTPROFILE_H
+#define VICE_HOSTPROFILE_H
+
+#include "types.h"
+
+/* Unlike profiler.c, which profiles the emulated program, this measures
+   where the *host* spends its time.  The counters are only compiled in
+   with --enable-hostprofile (FEATURE_HOSTPROFILE); without it the
+   HOSTPROFILE_ENTER/LEAVE macros expand to nothing.  When compiled in but
+   switched off, each instrumented spot costs a single branch.
+
+   Sections nest (an alarm can be dispatched while a drive CPU runs), so
+   the times are inclusive.  Recursion into the same section is only
+   timed once, at the outermost level.  */
+
+typedef enum hostprofile_section_e {
+    HOSTPROFILE_DRIVE_CPU = 0,
+    HOSTPROFILE_ROTATION,
+    HOSTPROFILE_ALARM,
+    HOSTPROFILE_VICII,
+    HOSTPROFILE_SOUND,
+    HOSTPROFILE_MEM_READ,
+    HOSTPROFILE_MEM_WRITE,
+
+    HOSTPROFILE_NUM_SECTIONS
+} hostprofile_section_t;
+
+typedef struct hostprofile_stats_s {
+    /* number of completed frames in the totals */
+    uint32_t frames;
+    /* host ticks spent in the last frame, and in all frames */
+    uint64_t frame_ticks;
+    uint64_t total_frame_ticks;
+    /* per section calls and ticks of the last frame, and of all frames */
+    uint32_t calls[HOSTPROFILE_NUM_SECTIONS];
+    uint64_t ticks[HOSTPROFILE_NUM_SECTIONS];
+    uint64_t total_calls[HOSTPROFILE_NUM_SECTIONS];
+    uint64_t total_ticks[HOSTPROFILE_NUM_SECTIONS];
+} hostprofile_stats_t;
+
+#ifdef FEATURE_HOSTPROFILE
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+# include <intrin.h>
+# define hostprofile_now() ((uint64_t)__rdtsc())
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+# include <x86intrin.h>
+# define hostprofile_now() ((uint64_t)__rdtsc())
+#else
+uint64_t hostprofile_now(void);
+#endif
+
+extern int hostprofile_enabled;
+extern int hostprofile_depth[HOSTPROFILE_NUM_SECTIONS];
+extern uint64_t hostprofile_start[HOSTPROFILE_NUM_SECTIONS];
+extern uint32_t hostprofile_calls[HOSTPROFILE_NUM_SECTIONS];
+extern uint64_t hostprofile_ticks[HOSTPROFILE_NUM_SECTIONS];
+
+inline static void hostprofile_enter(hostprofile_section_t section)
+{
+    if (hostprofile_depth[section]++ == 0) {
+        hostprofile_start[section] = hostprofile_now();
+    }
+}
+
+inline static void hostprofile_leave(hostprofile_section_t section)
+{
+    /* the depth may be zero if profiling was switched on inside a section */
+    if (hostprofile_depth[section] > 0 && --hostprofile_depth[section] == 0) {
+        hostprofile_ticks[section] += hostprofile_now() - hostprofile_start[section];
+        hostprofile_calls[section]++;
+    }
+}
+
+#define HOSTPROFILE_ENTER(section)          \
+    do {                                    \
+        if (hostprofile_enabled) {          \
+            hostprofile_enter(section);     \
+        }                                   \
+    } while (0)
+
+#define HOSTPROFILE_LEAVE(section)          \
+    do {                                    \
+        if (hostprofile_enabled) {          \
+            hostprofile_leave(section);     \
+        }                                   \
+    } while (0)
+
+#else
+
+#define HOSTPROFILE_ENTER(section)
+#define HOSTPROFILE_LEAVE(section)
+
+#endif /* FEATURE_HOSTPROFILE */
+
+/* returns non-zero if the counters have been compiled in */
+int hostprofile_available(void);
+
+/* switch sample collection on/off, returns -1 if not available */
+int hostprofile_set_enabled(int enabled);
+int hostprofile_get_enabled(void);
+
+/* clear all collected data */
+void hostprofile_reset(void);
+
+/* called at every vsync to close the current frame */
+void hostprofile_vsync(void);
+
+/* copy the current statistics */
+void hostprofile_get_stats(hostprofile_stats_t *stats);
+
+/* short name of a section, for display */
+const char *hostprofile_section_name(hostprofile_section_t section);
+
+#endif /* VICE_HOSTPROFILE_H */
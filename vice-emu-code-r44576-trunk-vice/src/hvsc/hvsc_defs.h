@@ -93,6 +93,11 @@
 #define HVSC_BUGS_FILE  "DOCUMENTS/BUGlist.txt"
 
 
+/** \brief  Path to the index of the SLDB and STIL, relative to the HVSC root
+ */
+#define HVSC_INDEX_FILE ".hvsclib-index"
+
+
 /** \brief  MD5 digest size in bytes
  */
 #define HVSC_DIGEST_SIZE    16
@@ -0,0 +1,628 @@
+/** \file   src/lib/index.c
+ * \brief   Index of the SLDB and STIL
+ *
+ * \author  Bas Wassink <b.wassink@ziggo.nl>
+ */
+
+/*
+ *  HVSClib - a library to work with High Voltage SID Collection files
+ *  Copyright (C) 2018-2022  Bas Wassink <b.wassink@ziggo.nl>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.*
+ */
+
+/*
+ * Looking up a tune used to mean reading the SLDB or STIL line by line until
+ * the entry turned up, which adds up when going through the whole HVSC.  The
+ * index maps the SLDB paths and digests and the STIL paths to the offset of
+ * their entry in the file, so a lookup is a binary search followed by a seek.
+ *
+ * The index is built the first time it's needed and stored in the HVSC root
+ * (HVSC_INDEX_FILE).  Every table in there has the size and modification
+ * time of its source file, tables of files that changed since are built
+ * again.  When the HVSC root isn't writable the index only lives as long as
+ * the library is initialized.
+ */
+
+#ifndef HVSC_STANDALONE
+# include "vice.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef HVSC_STANDALONE
+# include "log.h"
+#endif
+#include "hvsc.h"
+#include "hvsc_defs.h"
+#include "base.h"
+
+#include "index.h"
+
+
+/** \brief  Magic bytes at the start of the index file
+ *
+ * The last byte is the version of the format.
+ */
+#define INDEX_MAGIC         "HVSCIDX\x01"
+
+/** \brief  Length of INDEX_MAGIC
+ */
+#define INDEX_MAGIC_LEN     8
+
+/** \brief  Size of a table header in the index file
+ *
+ * table (4), source size (8), source mtime (8), entry count (4), key pool
+ * size (4)
+ */
+#define INDEX_TABLE_HEADER  28
+
+/** \brief  Size of an entry in the index file
+ *
+ * key (4), offset (4), line number (4)
+ */
+#define INDEX_ENTRY_SIZE    12
+
+
+/** \brief  Index entry
+ */
+typedef struct index_entry_s {
+    uint32_t key;       /**< offset of the key in the key pool */
+    uint32_t offset;    /**< offset of the entry in the source file */
+    uint32_t lineno;    /**< line number of the entry */
+} index_entry_t;
+
+
+/** \brief  Index table
+ */
+typedef struct index_table_s {
+    bool            valid;      /**< table matches its source file */
+    uint64_t        src_size;   /**< size of the source file */
+    uint64_t        src_mtime;  /**< modification time of the source file */
+    char *          pool;       /**< nul-terminated keys */
+    size_t          pool_used;  /**< bytes used in \a pool */
+    size_t          pool_max;   /**< bytes allocated for \a pool */
+    index_entry_t * entries;    /**< entries, sorted by key */
+    size_t          count;      /**< number of entries */
+    size_t          max;        /**< number of entries allocated */
+} index_table_t;
+
+
+/** \brief  Index tables
+ */
+static index_table_t tables[HVSC_INDEX_TABLE_COUNT];
+
+/** \brief  Index has been loaded or built
+ */
+static bool index_ready = false;
+
+/** \brief  Key pool used by index_entry_cmp()
+ */
+static const char *sort_pool;
+
+
+/** \brief  Get source file of \a table
+ *
+ * \param[in]   table   table ID
+ *
+ * \return  path to SLDB or STIL
+ */
+static const char *index_source(int table)
+{
+    return table == HVSC_INDEX_STIL ? hvsc_stil_path : hvsc_sldb_path;
+}
+
+
+/** \brief  Get size and modification time of \a path
+ *
+ * \param[in]   path    path to file
+ * \param[out]  size    file size
+ * \param[out]  mtime   modification time
+ *
+ * \return  bool
+ */
+static bool index_stat(const char *path, uint64_t *size, uint64_t *mtime)
+{
+    struct stat st;
+
+    if (path == NULL || stat(path, &st) != 0) {
+        return false;
+    }
+    *size = (uint64_t)st.st_size;
+    *mtime = (uint64_t)st.st_mtime;
+    return true;
+}
+
+
+/** \brief  Free memory used by \a table and reset it
+ *
+ * \param[in,out]   table   index table
+ */
+static void index_table_free(index_table_t *table)
+{
+    hvsc_free(table->pool);
+    hvsc_free(table->entries);
+    memset(table, 0, sizeof *table);
+}
+
+
+/** \brief  Add entry to \a table
+ *
+ * \param[in,out]   table   index table
+ * \param[in]       key     key
+ * \param[in]       keylen  length of \a key
+ * \param[in]       offset  offset of the entry in the source file
+ * \param[in]       lineno  line number of the entry
+ */
+static void index_table_add(index_table_t *table, const char *key, size_t keylen,
+                            long offset, long lineno)
+{
+    index_entry_t *entry;
+
+    if (table->count == table->max) {
+        table->max = table->max ? table->max * 2 : 4096;
+        table->entries = hvsc_realloc(table->entries,
+                                      table->max * sizeof *(table->entries));
+    }
+    while (table->pool_used + keylen + 1 > table->pool_max) {
+        table->pool_max = table->pool_max ? table->pool_max * 2 : 65536;
+        table->pool = hvsc_realloc(table->pool, table->pool_max);
+    }
+
+    entry = &table->entries[table->count++];
+    entry->key = (uint32_t)table->pool_used;
+    entry->offset = (uint32_t)offset;
+    entry->lineno = (uint32_t)lineno;
+
+    memcpy(table->pool + table->pool_used, key, keylen);
+    table->pool[table->pool_used + keylen] = '\0';
+    table->pool_used += keylen + 1;
+}
+
+
+/** \brief  Compare two index entries for qsort()
+ *
+ * Entries with the same key are ordered by offset, so a lookup finds the
+ * first one in the file, just like reading the file would.
+ *
+ * \param[in]   p1  index entry
+ * \param[in]   p2  index entry
+ *
+ * \return  <0, 0 or >0
+ */
+static int index_entry_cmp(const void *p1, const void *p2)
+{
+    const index_entry_t *e1 = p1;
+    const index_entry_t *e2 = p2;
+    int result = strcmp(sort_pool + e1->key, sort_pool + e2->key);
+
+    if (result != 0) {
+        return result;
+    }
+    return e1->offset < e2->offset ? -1 : e1->offset > e2->offset;
+}
+
+
+/** \brief  Sort \a table and mark it valid
+ *
+ * \param[in,out]   table   index table
+ */
+static void index_table_finish(index_table_t *table)
+{
+    sort_pool = table->pool;
+    if (table->count > 0) {
+        qsort(table->entries, table->count, sizeof *(table->entries),
+              index_entry_cmp);
+    }
+    table->valid = true;
+}
+
+
+/** \brief  Check for an SLDB entry line ('<md5>=<lengths>')
+ *
+ * \param[in]   line    line of text
+ *
+ * \return  bool
+ */
+static bool index_is_md5_line(const char *line)
+{
+    int i;
+
+    for (i = 0; i < HVSC_DIGEST_SIZE * 2; i++) {
+        if (!isxdigit((unsigned char)line[i])) {
+            return false;
+        }
+    }
+    return line[i] == '=';
+}
+
+
+/** \brief  Build both SLDB tables
+ *
+ * \return  bool
+ */
+static bool index_build_sldb(void)
+{
+    index_table_t *paths = &tables[HVSC_INDEX_SLDB_PATH];
+    index_table_t *digests = &tables[HVSC_INDEX_SLDB_MD5];
+    hvsc_text_file_t handle;
+    const char *line;
+    char *path = NULL;
+    uint64_t size;
+    uint64_t mtime;
+
+    index_table_free(paths);
+    index_table_free(digests);
+
+    if (!index_stat(hvsc_sldb_path, &size, &mtime)
+            || !hvsc_text_file_open(hvsc_sldb_path, &handle)) {
+        hvsc_errno = HVSC_ERR_IO;
+        return false;
+    }
+
+    while (true) {
+        long offset = ftell(handle.fp);
+
+        line = hvsc_text_file_read(&handle);
+        if (line == NULL) {
+            break;
+        }
+
+        /* the line after a '; /path' comment is the entry of that path */
+        if (path != NULL) {
+            index_table_add(paths, path, strlen(path), offset, handle.lineno);
+            hvsc_free(path);
+            path = NULL;
+        }
+
+        if (line[0] == ';' && line[1] == ' ') {
+            path = hvsc_strdup(line + 2);
+        } else if (index_is_md5_line(line)) {
+            index_table_add(digests, line, HVSC_DIGEST_SIZE * 2, offset,
+                            handle.lineno);
+        }
+    }
+    hvsc_free(path);
+    hvsc_text_file_close(&handle);
+
+    paths->src_size = digests->src_size = size;
+    paths->src_mtime = digests->src_mtime = mtime;
+    index_table_finish(paths);
+    index_table_finish(digests);
+    return true;
+}
+
+
+/** \brief  Build the STIL table
+ *
+ * \return  bool
+ */
+static bool index_build_stil(void)
+{
+    index_table_t *table = &tables[HVSC_INDEX_STIL];
+    hvsc_text_file_t handle;
+    const char *line;
+    uint64_t size;
+    uint64_t mtime;
+
+    index_table_free(table);
+
+    if (!index_stat(hvsc_stil_path, &size, &mtime)
+            || !hvsc_text_file_open(hvsc_stil_path, &handle)) {
+        hvsc_errno = HVSC_ERR_IO;
+        return false;
+    }
+
+    while ((line = hvsc_text_file_read(&handle)) != NULL) {
+        if (line[0] == '/') {
+            /* the entry starts right after the path */
+            index_table_add(table, line, handle.linelen, ftell(handle.fp),
+                            handle.lineno);
+        }
+    }
+    hvsc_text_file_close(&handle);
+
+    table->src_size = size;
+    table->src_mtime = mtime;
+    index_table_finish(table);
+    return true;
+}
+
+
+/** \brief  Read little endian 32-bit value
+ */
+static uint32_t index_get_u32(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8)
+        | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+
+/** \brief  Read little endian 64-bit value
+ */
+static uint64_t index_get_u64(const uint8_t *src)
+{
+    return (uint64_t)index_get_u32(src) | ((uint64_t)index_get_u32(src + 4) << 32);
+}
+
+
+/** \brief  Write little endian 32-bit value
+ */
+static void index_put_u32(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+    dest[2] = (uint8_t)(value >> 16);
+    dest[3] = (uint8_t)(value >> 24);
+}
+
+
+/** \brief  Write little endian 64-bit value
+ */
+static void index_put_u64(uint8_t *dest, uint64_t value)
+{
+    index_put_u32(dest, (uint32_t)value);
+    index_put_u32(dest + 4, (uint32_t)(value >> 32));
+}
+
+
+/** \brief  Load the tables from the index file that are still valid
+ *
+ * \param[in]   path    path to the index file
+ */
+static void index_load(const char *path)
+{
+    uint8_t *data;
+    long size;
+    long pos = INDEX_MAGIC_LEN;
+
+    size = hvsc_read_file(&data, path);
+    if (size < 0) {
+        return;
+    }
+    if (size < INDEX_MAGIC_LEN || memcmp(data, INDEX_MAGIC, INDEX_MAGIC_LEN) != 0) {
+        hvsc_free(data);
+        return;
+    }
+
+    while (pos + INDEX_TABLE_HEADER <= size) {
+        const uint8_t *p = data + pos;
+        uint32_t id = index_get_u32(p);
+        uint64_t src_size = index_get_u64(p + 4);
+        uint64_t src_mtime = index_get_u64(p + 12);
+        uint32_t count = index_get_u32(p + 20);
+        uint32_t pool_size = index_get_u32(p + 24);
+        uint64_t size_now;
+        uint64_t mtime_now;
+        index_table_t *table;
+        uint32_t i;
+
+        pos += INDEX_TABLE_HEADER;
+        if ((uint64_t)pool_size + (uint64_t)count * INDEX_ENTRY_SIZE
+                > (uint64_t)(size - pos)) {
+            /* truncated */
+            break;
+        }
+        p = data + pos;
+        pos += (long)pool_size + (long)count * INDEX_ENTRY_SIZE;
+
+        if (id >= HVSC_INDEX_TABLE_COUNT
+                || !index_stat(index_source((int)id), &size_now, &mtime_now)
+                || size_now != src_size || mtime_now != src_mtime) {
+            continue;
+        }
+        if (pool_size == 0 || p[pool_size - 1] != '\0') {
+            continue;
+        }
+
+        table = &tables[id];
+        index_table_free(table);
+        table->src_size = src_size;
+        table->src_mtime = src_mtime;
+        table->pool = hvsc_malloc(pool_size);
+        memcpy(table->pool, p, pool_size);
+        table->pool_used = table->pool_max = pool_size;
+        table->entries = hvsc_malloc((count > 0 ? count : 1) * sizeof *(table->entries));
+        table->count = table->max = count;
+
+        p += pool_size;
+        for (i = 0; i < count; i++, p += INDEX_ENTRY_SIZE) {
+            table->entries[i].key = index_get_u32(p);
+            table->entries[i].offset = index_get_u32(p + 4);
+            table->entries[i].lineno = index_get_u32(p + 8);
+            if (table->entries[i].key >= pool_size) {
+                break;
+            }
+        }
+        if (i < count) {
+            index_table_free(table);
+            continue;
+        }
+        table->valid = true;
+    }
+    hvsc_free(data);
+}
+
+
+/** \brief  Write all valid tables to the index file
+ *
+ * The file is written under a temporary name and then renamed, so other
+ * processes never see a partial index.
+ *
+ * \param[in]   path    path to the index file
+ *
+ * \return  bool
+ */
+static bool index_save(const char *path)
+{
+    FILE *fp;
+    char *tmp;
+    int i;
+    bool ok;
+
+    tmp = hvsc_malloc(strlen(path) + 5);
+    memcpy(tmp, path, strlen(path));
+    memcpy(tmp + strlen(path), ".tmp", 5);
+
+    fp = fopen(tmp, "wb");
+    if (fp == NULL) {
+        hvsc_free(tmp);
+        return false;
+    }
+
+    ok = fwrite(INDEX_MAGIC, 1, INDEX_MAGIC_LEN, fp) == INDEX_MAGIC_LEN;
+    for (i = 0; ok && i < HVSC_INDEX_TABLE_COUNT; i++) {
+        index_table_t *table = &tables[i];
+        uint8_t header[INDEX_TABLE_HEADER];
+        uint8_t entry[INDEX_ENTRY_SIZE];
+        size_t e;
+
+        if (!table->valid) {
+            continue;
+        }
+        index_put_u32(header, (uint32_t)i);
+        index_put_u64(header + 4, table->src_size);
+        index_put_u64(header + 12, table->src_mtime);
+        index_put_u32(header + 20, (uint32_t)table->count);
+        index_put_u32(header + 24, (uint32_t)table->pool_used);
+        ok = fwrite(header, 1, sizeof header, fp) == sizeof header
+            && fwrite(table->pool, 1, table->pool_used, fp) == table->pool_used;
+
+        for (e = 0; ok && e < table->count; e++) {
+            index_put_u32(entry, table->entries[e].key);
+            index_put_u32(entry + 4, table->entries[e].offset);
+            index_put_u32(entry + 8, table->entries[e].lineno);
+            ok = fwrite(entry, 1, sizeof entry, fp) == sizeof entry;
+        }
+    }
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+
+    if (ok && rename(tmp, path) != 0) {
+        /* rename() doesn't replace existing files on Windows */
+        remove(path);
+        ok = rename(tmp, path) == 0;
+    }
+    if (!ok) {
+        remove(tmp);
+    }
+    hvsc_free(tmp);
+    return ok;
+}
+
+
+/** \brief  Load or build the index
+ */
+static void index_init(void)
+{
+    char *path;
+    bool changed = false;
+
+    if (index_ready || hvsc_root_path == NULL) {
+        return;
+    }
+
+    path = hvsc_paths_join(hvsc_root_path, HVSC_INDEX_FILE);
+    index_load(path);
+
+    if (!tables[HVSC_INDEX_SLDB_PATH].valid || !tables[HVSC_INDEX_SLDB_MD5].valid) {
+#ifndef HVSC_STANDALONE
+        log_message(LOG_DEFAULT, "Vsid: Indexing '%s'.", hvsc_sldb_path);
+#endif
+        changed |= index_build_sldb();
+    }
+    if (!tables[HVSC_INDEX_STIL].valid) {
+#ifndef HVSC_STANDALONE
+        log_message(LOG_DEFAULT, "Vsid: Indexing '%s'.", hvsc_stil_path);
+#endif
+        changed |= index_build_stil();
+    }
+
+    if (changed && !index_save(path)) {
+#ifndef HVSC_STANDALONE
+        log_message(LOG_DEFAULT, "Vsid: Could not write HVSC index '%s'.", path);
+#endif
+    }
+    hvsc_free(path);
+    index_ready = true;
+}
+
+
+/** \brief  Look up \a key in index \a table
+ *
+ * \param[in]   table   table ID (see hvsc_index_table_t)
+ * \param[in]   key     SLDB path, MD5 digest in lower case hex, or STIL path
+ * \param[out]  offset  offset of the entry in the source file
+ * \param[out]  lineno  line number of the entry (can be `NULL`)
+ *
+ * \return  bool
+ */
+bool hvsc_index_lookup(int table, const char *key, long *offset, long *lineno)
+{
+    index_table_t *t;
+    size_t lo = 0;
+    size_t hi;
+
+    index_init();
+
+    t = &tables[table];
+    if (!t->valid) {
+        hvsc_errno = HVSC_ERR_IO;
+        return false;
+    }
+
+    /* find the first entry >= key */
+    hi = t->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (strcmp(t->pool + t->entries[mid].key, key) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == t->count || strcmp(t->pool + t->entries[lo].key, key) != 0) {
+        hvsc_errno = HVSC_ERR_NOT_FOUND;
+        return false;
+    }
+
+    *offset = (long)t->entries[lo].offset;
+    if (lineno != NULL) {
+        *lineno = (long)t->entries[lo].lineno;
+    }
+    return true;
+}
+
+
+/** \brief  Free memory used by the index
+ */
+void hvsc_index_free(void)
+{
+    int i;
+
+    for (i = 0; i < HVSC_INDEX_TABLE_COUNT; i++) {
+        index_table_free(&tables[i]);
+    }
+    index_ready = false;
+}
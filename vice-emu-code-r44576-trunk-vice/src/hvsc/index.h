@@ -0,0 +1,44 @@
+/** \file   src/lib/index.h
+ * \brief   Index of the SLDB and STIL - header
+ *
+ * \author  Bas Wassink <b.wassink@ziggo.nl>
+ */
+
+/*
+ *  HVSClib - a library to work with High Voltage SID Collection files
+ *  Copyright (C) 2018-2022  Bas Wassink <b.wassink@ziggo.nl>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.*
+ */
+
+#ifndef HVSC_INDEX_H
+#define HVSC_INDEX_H
+
+#include <stdbool.h>
+
+/** \brief  Index tables
+ */
+typedef enum hvsc_index_table_e {
+    HVSC_INDEX_SLDB_PATH = 0,   /**< SLDB: '; /path' comment -> entry */
+    HVSC_INDEX_SLDB_MD5,        /**< SLDB: MD5 digest -> entry */
+    HVSC_INDEX_STIL,            /**< STIL: '/path' line -> first line of entry */
+
+    HVSC_INDEX_TABLE_COUNT      /**< number of tables */
+} hvsc_index_table_t;
+
+bool    hvsc_index_lookup(int table, const char *key, long *offset, long *lineno);
+void    hvsc_index_free(void);
+
+#endif
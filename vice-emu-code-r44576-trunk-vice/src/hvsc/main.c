@@ -35,6 +35,7 @@
 
 #include "hvsc_defs.h"
 #include "base.h"
+#include "index.h"
 #include "stil.h"
 #include "sldb.h"
 
@@ -97,6 +98,7 @@ bool hvsc_init(const char *path)
  */
 void hvsc_exit(void)
 {
+    hvsc_index_free();
     hvsc_free_paths();
 }
 
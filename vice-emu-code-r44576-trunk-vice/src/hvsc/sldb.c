@@ -41,6 +41,7 @@
 #include "hvsc.h"
 #include "hvsc_defs.h"
 #include "base.h"
+#include "index.h"
 
 #include "sldb.h"
 
@@ -92,6 +93,33 @@ static bool create_md5_hash(const char *psid, unsigned char *digest)
 #endif
 
 
+/** \brief  Read the SLDB line at \a offset
+ *
+ * \param[in]   offset  offset of the line in the SLDB
+ *
+ * \return  heap-allocated line of text or `NULL` on failure
+ */
+static char *read_sldb_entry(long offset)
+{
+    hvsc_text_file_t handle;
+    const char *line;
+    char *s;
+
+    if (!hvsc_text_file_open(hvsc_sldb_path, &handle)) {
+        return NULL;
+    }
+    if (fseek(handle.fp, offset, SEEK_SET) != 0) {
+        hvsc_errno = HVSC_ERR_IO;
+        hvsc_text_file_close(&handle);
+        return NULL;
+    }
+    line = hvsc_text_file_read(&handle);
+    s = line != NULL ? hvsc_strdup(line) : NULL;
+    hvsc_text_file_close(&handle);
+    return s;
+}
+
+
 #ifdef HVSC_USE_MD5
 /** \brief  Find SLDB entry by \a digest
  *
@@ -104,33 +132,12 @@ static bool create_md5_hash(const char *psid, unsigned char *digest)
  */
 static char *find_sldb_entry_md5(const char *digest)
 {
-    hvsc_text_file_t handle;
-    const char *line;
+    long offset;
 
-    if (!hvsc_text_file_open(hvsc_sldb_path, &handle)) {
+    if (!hvsc_index_lookup(HVSC_INDEX_SLDB_MD5, digest, &offset, NULL)) {
         return NULL;
     }
-
-    while (1) {
-        line = hvsc_text_file_read(&handle);
-        if (line == NULL) {
-            hvsc_text_file_close(&handle);
-            return NULL;
-        }
-#if 0
-        printf("%s\n", line);
-#endif
-        if (memcmp(digest, line, HVSC_DIGEST_SIZE * 2) == 0) {
-            /* copy the current line before closing the file */
-            char *s = hvsc_strdup(handle.buffer);
-            hvsc_text_file_close(&handle);
-            return s;
-        }
-    }
-
-    hvsc_text_file_close(&handle);
-    hvsc_errno = HVSC_ERR_NOT_FOUND;
-    return NULL;
+    return read_sldb_entry(offset);
 }
 #endif
 
@@ -143,54 +150,20 @@ static char *find_sldb_entry_md5(const char *digest)
  */
 static char *find_sldb_entry_txt(const char *path)
 {
-    hvsc_text_file_t handle;
-    size_t plen;
-    const char *line;
-#ifndef HVSC_STANDALONE
-    log_message(LOG_DEFAULT, "Vsid: Opening '%s'.", hvsc_sldb_path);
-#endif
-    if (!hvsc_text_file_open(hvsc_sldb_path, &handle)) {
-#ifndef HVSC_STANDALONE
-        log_warning(LOG_DEFAULT, "Vsid: Failed to open the SLDB.");
-#endif
-        return NULL;
-    }
-
-    plen = strlen(path);
+    long offset;
 
-    while (true) {
-        line = hvsc_text_file_read(&handle);
-        if (line == NULL) {
-            hvsc_text_file_close(&handle);
+    if (!hvsc_index_lookup(HVSC_INDEX_SLDB_PATH, path, &offset, NULL)) {
 #ifndef HVSC_STANDALONE
+        if (hvsc_errno == HVSC_ERR_NOT_FOUND) {
             log_warning(LOG_DEFAULT,
                     "Vsid: Could not find song length data for current SID.");
-#endif
-            return NULL;
-        }
-
-
-        if (*line == ';') {
-            if (strncmp(path, line + 2, plen) == 0) {
-                /* next line contains the actual entry */
-                char *s;
-                line = hvsc_text_file_read(&handle);
-                if (line == NULL) {
-                    hvsc_text_file_close(&handle);
-                    return NULL;
-                }
-                s = hvsc_strdup(handle.buffer);
-                hvsc_text_file_close(&handle);
-                return s;
-            }
+        } else {
+            log_warning(LOG_DEFAULT, "Vsid: Failed to open the SLDB.");
         }
-    }
-
-#if 0 /* above loop never breaks - following code can never execute */
-    hvsc_text_file_close(&handle);
-    hvsc_errno = HVSC_ERR_NOT_FOUND;
-    return NULL;
 #endif
+        return NULL;
+    }
+    return read_sldb_entry(offset);
 }
 
 
@@ -40,6 +40,7 @@
 #include "hvsc.h"
 #include "hvsc_defs.h"
 #include "base.h"
+#include "index.h"
 
 #include "stil.h"
 
@@ -435,7 +436,8 @@ static void stil_handle_add_block(hvsc_stil_t *handle, hvsc_stil_block_t *block)
  */
 bool hvsc_stil_open(const char *psid, hvsc_stil_t *handle)
 {
-    const char *line;
+    long offset;
+    long lineno;
 
     stil_init_handle(handle);
 
@@ -464,29 +466,28 @@ bool hvsc_stil_open(const char *psid, hvsc_stil_t *handle)
     hvsc_dbg("stripped path is '%s'\n", handle->psid_path);
 
     /* find the entry */
-    while (true) {
-        line = hvsc_text_file_read(&(handle->stil));
-        if (line == NULL) {
-            if (feof(handle->stil.fp)) {
-                /* EOF, so simply not found */
-                hvsc_errno = HVSC_ERR_NOT_FOUND;
+    if (!hvsc_index_lookup(HVSC_INDEX_STIL, handle->psid_path, &offset, &lineno)) {
 #ifndef HVSC_STANDALONE
-                log_message(LOG_DEFAULT, "Vsid: No STIL entry found.");
-#endif
-            }
-            hvsc_stil_close(handle);
-            /* I/O error is already set */
-            return false;
+        if (hvsc_errno == HVSC_ERR_NOT_FOUND) {
+            log_message(LOG_DEFAULT, "Vsid: No STIL entry found.");
         }
+#endif
+        hvsc_stil_close(handle);
+        return false;
+    }
 
-        if (strcmp(line, handle->psid_path) == 0) {
+    /* position the handle right after the path, like reading up to it would */
+    if (fseek(handle->stil.fp, offset, SEEK_SET) != 0) {
+        hvsc_errno = HVSC_ERR_IO;
+        hvsc_stil_close(handle);
+        return false;
+    }
+    handle->stil.lineno = lineno;
 #ifndef HVSC_STANDALONE
-            log_message(LOG_DEFAULT,
-                    "Vsid: Found '%s' at line %ld.", line, handle->stil.lineno);
+    log_message(LOG_DEFAULT,
+            "Vsid: Found '%s' at line %ld.", handle->psid_path, lineno);
 #endif
-            return true;
-        }
-    }
+    return true;
 }
 
 
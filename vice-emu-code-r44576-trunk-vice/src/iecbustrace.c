@@ -0,0 +1,479 @@
+/*
+ * iecbustrace.c - Trace of the IEC bus line transitions.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Trace file layout, all values little endian:
+
+   header (20 bytes)
+     0  "IECTRACE"
+     8  version (1)
+     9  3 reserved bytes
+    12  number of events (4 bytes)
+    16  main CPU cycles per second (4 bytes)
+
+   followed by one 16 byte record per event, oldest first
+     0  main CPU clock (8 bytes)
+     8  drive CPU clock (4 bytes)
+    12  source, cpu lines, drive lines, bus lines (1 byte each)  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "drive.h"
+#include "drivetypes.h"
+#include "iecbus.h"
+#include "iecbustrace.h"
+#include "lib.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "types.h"
+#include "util.h"
+
+#define TRACE_MAGIC         "IECTRACE"
+#define TRACE_MAGIC_LEN     8
+#define TRACE_VERSION       1
+#define TRACE_HEADER_SIZE   20
+#define TRACE_EVENT_SIZE    16
+
+#define CPU_LINES   (IECBUSTRACE_ATN | IECBUSTRACE_CLK | IECBUSTRACE_DATA)
+#define DRV_LINES   (IECBUSTRACE_CLK | IECBUSTRACE_DATA)
+
+/* the first unit connected to the bus, and one past the last */
+#define FIRST_UNIT  4
+#define LAST_UNIT   (8 + NUM_DISK_UNITS)
+
+/* a talker waiting longer than this after "ready for data" signals EOI */
+#define EOI_CYCLES  200
+
+int iecbustrace_enabled = 0;
+
+static iecbustrace_event_t *buffer = NULL;
+static unsigned int buffer_size = 0;
+static unsigned int buffer_head = 0;
+static unsigned int buffer_count = 0;
+
+/* line state at the last recorded event */
+static int have_last = 0;
+static uint8_t last_cpu_lines;
+static uint8_t last_drv_lines[IECBUS_NUM];
+
+/* ------------------------------------------------------------------------- */
+
+/* Drives run behind and catch up with the main CPU when the computer
+   accesses the bus, so maincpu_clk is ahead of the moment a drive changed
+   its lines.  Project the drive clock back onto the main CPU clock.  */
+static CLOCK drive_event_main_clk(const diskunit_context_t *unit)
+{
+    CLOCK behind;
+
+    if (unit->cpu == NULL || unit->cpud == NULL
+        || unit->cpud->sync_factor <= 0
+        || *(unit->clk_ptr) >= unit->cpu->stop_clk) {
+        return maincpu_clk;
+    }
+
+    behind = ((unit->cpu->stop_clk - *(unit->clk_ptr)) << 16)
+             / (CLOCK)unit->cpud->sync_factor;
+
+    return behind < maincpu_clk ? maincpu_clk - behind : 0;
+}
+
+void iecbustrace_record(const iecbus_t *bus)
+{
+    iecbustrace_event_t *event;
+    const diskunit_context_t *unit;
+    unsigned int i, source = IECBUSTRACE_SOURCE_COMPUTER;
+    uint8_t lines, drive_lines = 0;
+    int changed = !have_last;
+
+    lines = bus->cpu_bus & CPU_LINES;
+    if (lines != last_cpu_lines) {
+        last_cpu_lines = lines;
+        changed = 1;
+    }
+
+    for (i = FIRST_UNIT; i < LAST_UNIT; i++) {
+        lines = bus->drv_bus[i] & DRV_LINES;
+        if (lines != last_drv_lines[i]) {
+            last_drv_lines[i] = lines;
+            if (!changed) {
+                source = i;
+            }
+            changed = 1;
+        }
+        if (i >= 8) {
+            if (lines & IECBUSTRACE_CLK) {
+                drive_lines |= IECBUSTRACE_DRIVE_CLK(i);
+            }
+            if (lines & IECBUSTRACE_DATA) {
+                drive_lines |= IECBUSTRACE_DRIVE_DATA(i);
+            }
+        }
+    }
+
+    if (!changed) {
+        return;
+    }
+    have_last = 1;
+
+    event = &buffer[buffer_head];
+    if (++buffer_head == buffer_size) {
+        buffer_head = 0;
+    }
+    if (buffer_count < buffer_size) {
+        buffer_count++;
+    }
+
+    unit = diskunit_context[source >= 8 ? source - 8 : 0];
+
+    event->main_clk = maincpu_clk;
+    event->drive_clk = 0;
+    if (unit != NULL) {
+        event->drive_clk = (uint32_t)*(unit->clk_ptr);
+        if (source >= 8) {
+            event->main_clk = drive_event_main_clk(unit);
+        }
+    }
+    event->source = (uint8_t)source;
+    event->cpu_lines = last_cpu_lines;
+    event->drive_lines = drive_lines;
+    /* the drives do not drive ATN, so it is left out of cpu_port */
+    event->bus_lines = (bus->cpu_port & DRV_LINES)
+                       | (bus->cpu_bus & IECBUSTRACE_ATN);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int iecbustrace_set_enabled(int enabled)
+{
+    if (enabled && buffer == NULL) {
+        buffer_size = IECBUSTRACE_DEFAULT_SIZE;
+        buffer = lib_malloc(buffer_size * sizeof(iecbustrace_event_t));
+        buffer_head = 0;
+        buffer_count = 0;
+    }
+    /* the lines may have changed while tracing was off */
+    have_last = 0;
+    iecbustrace_enabled = enabled ? 1 : 0;
+    return 0;
+}
+
+int iecbustrace_get_enabled(void)
+{
+    return iecbustrace_enabled;
+}
+
+void iecbustrace_reset(void)
+{
+    buffer_head = 0;
+    buffer_count = 0;
+    have_last = 0;
+}
+
+void iecbustrace_shutdown(void)
+{
+    iecbustrace_enabled = 0;
+    lib_free(buffer);
+    buffer = NULL;
+    buffer_size = 0;
+    iecbustrace_reset();
+}
+
+unsigned int iecbustrace_count(void)
+{
+    return buffer_count;
+}
+
+unsigned int iecbustrace_size(void)
+{
+    return buffer_size;
+}
+
+iecbustrace_event_t *iecbustrace_get_events(unsigned int *count)
+{
+    iecbustrace_event_t *events;
+    unsigned int first;
+
+    *count = buffer_count;
+    if (buffer_count == 0) {
+        return NULL;
+    }
+
+    events = lib_malloc(buffer_count * sizeof(iecbustrace_event_t));
+    first = (buffer_head + buffer_size - buffer_count) % buffer_size;
+    if (first + buffer_count <= buffer_size) {
+        memcpy(events, &buffer[first],
+               buffer_count * sizeof(iecbustrace_event_t));
+    } else {
+        unsigned int n = buffer_size - first;
+
+        memcpy(events, &buffer[first], n * sizeof(iecbustrace_event_t));
+        memcpy(&events[n], buffer,
+               (buffer_count - n) * sizeof(iecbustrace_event_t));
+    }
+    return events;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int iecbustrace_save(const char *filename)
+{
+    iecbustrace_event_t *events;
+    uint8_t rec[TRACE_HEADER_SIZE];
+    unsigned int i, count;
+    FILE *f;
+    int ret = 0;
+
+    f = fopen(filename, MODE_WRITE);
+    if (f == NULL) {
+        return -1;
+    }
+
+    events = iecbustrace_get_events(&count);
+
+    memset(rec, 0, TRACE_HEADER_SIZE);
+    memcpy(rec, TRACE_MAGIC, TRACE_MAGIC_LEN);
+    rec[8] = TRACE_VERSION;
+    util_dword_to_le_buf(&rec[12], count);
+    util_dword_to_le_buf(&rec[16], (uint32_t)machine_get_cycles_per_second());
+    if (fwrite(rec, TRACE_HEADER_SIZE, 1, f) != 1) {
+        ret = -1;
+    }
+
+    for (i = 0; i < count && ret == 0; i++) {
+        util_dword_to_le_buf(&rec[0], (uint32_t)events[i].main_clk);
+        util_dword_to_le_buf(&rec[4], (uint32_t)(events[i].main_clk >> 32));
+        util_dword_to_le_buf(&rec[8], events[i].drive_clk);
+        rec[12] = events[i].source;
+        rec[13] = events[i].cpu_lines;
+        rec[14] = events[i].drive_lines;
+        rec[15] = events[i].bus_lines;
+        if (fwrite(rec, TRACE_EVENT_SIZE, 1, f) != 1) {
+            ret = -1;
+        }
+    }
+
+    lib_free(events);
+    if (fclose(f) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+iecbustrace_event_t *iecbustrace_load(const char *filename,
+                                      unsigned int *count)
+{
+    iecbustrace_event_t *events = NULL;
+    uint8_t rec[TRACE_HEADER_SIZE];
+    unsigned int i;
+    off_t len;
+    FILE *f;
+
+    *count = 0;
+
+    f = fopen(filename, MODE_READ);
+    if (f == NULL) {
+        return NULL;
+    }
+
+    if (fread(rec, TRACE_HEADER_SIZE, 1, f) != 1
+        || memcmp(rec, TRACE_MAGIC, TRACE_MAGIC_LEN) != 0
+        || rec[8] != TRACE_VERSION) {
+        fclose(f);
+        return NULL;
+    }
+
+    *count = util_le_buf_to_dword(&rec[12]);
+
+    /* never trust the header for more events than the file holds */
+    len = archdep_file_size(f);
+    if (len < TRACE_HEADER_SIZE) {
+        *count = 0;
+    } else if (*count > (len - TRACE_HEADER_SIZE) / TRACE_EVENT_SIZE) {
+        *count = (unsigned int)((len - TRACE_HEADER_SIZE) / TRACE_EVENT_SIZE);
+    }
+
+    if (*count > 0) {
+        events = lib_malloc(*count * sizeof(iecbustrace_event_t));
+    }
+
+    for (i = 0; i < *count; i++) {
+        if (fread(rec, TRACE_EVENT_SIZE, 1, f) != 1) {
+            /* keep what could be read from a truncated file */
+            *count = i;
+            break;
+        }
+        events[i].main_clk = (CLOCK)util_le_buf_to_dword(&rec[0])
+                             | ((CLOCK)util_le_buf_to_dword(&rec[4]) << 32);
+        events[i].drive_clk = util_le_buf_to_dword(&rec[8]);
+        events[i].source = rec[12];
+        events[i].cpu_lines = rec[13];
+        events[i].drive_lines = rec[14];
+        events[i].bus_lines = rec[15];
+    }
+
+    fclose(f);
+
+    if (*count == 0) {
+        lib_free(events);
+        events = NULL;
+    }
+    return events;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The decoder follows the standard serial protocol on the resolved lines:
+   with CLK released, the listener releases DATA to signal "ready for data".
+   The talker then pulls CLK and releases it once for every bit, LSB first,
+   and DATA is valid while CLK is released.  If the talker waits too long
+   before the first bit, the listener acknowledges EOI by pulsing DATA.
+   Fast loaders do not follow this protocol; for those only the edge
+   statistics are meaningful.  */
+
+enum {
+    DECODE_IDLE,
+    DECODE_READY,
+    DECODE_BITS
+};
+
+static void update_min_max(CLOCK value, CLOCK *min, CLOCK *max, CLOCK *total,
+                           unsigned int n)
+{
+    if (n == 0 || value < *min) {
+        *min = value;
+    }
+    if (value > *max) {
+        *max = value;
+    }
+    *total += value;
+}
+
+void iecbustrace_decode(const iecbustrace_event_t *events, unsigned int count,
+                        iecbustrace_stats_t *stats,
+                        void (*byte_func)(const iecbustrace_byte_t *byte,
+                                          void *param),
+                        void *param)
+{
+    iecbustrace_byte_t byte;
+    unsigned int i, state = DECODE_IDLE, nbits = 0, edges = 0;
+    CLOCK ready_clk = 0, first_bit_clk = 0, last_bit_clk = 0, last_edge_clk = 0;
+    uint8_t prev, cur, rise, fall;
+    int eoi = 0;
+
+    memset(stats, 0, sizeof(iecbustrace_stats_t));
+    memset(&byte, 0, sizeof(iecbustrace_byte_t));
+
+    if (count == 0) {
+        return;
+    }
+
+    stats->events = count;
+    prev = events[0].bus_lines;
+
+    for (i = 1; i < count; i++) {
+        const iecbustrace_event_t *event = &events[i];
+
+        cur = event->bus_lines;
+        rise = cur & ~prev;
+        fall = prev & ~cur;
+
+        if ((rise | fall) & IECBUSTRACE_ATN) {
+            stats->atn_edges++;
+        }
+        if ((rise | fall) & IECBUSTRACE_CLK) {
+            stats->clk_edges++;
+        }
+        if ((rise | fall) & IECBUSTRACE_DATA) {
+            stats->data_edges++;
+        }
+        if ((rise | fall) & DRV_LINES) {
+            if (edges > 0) {
+                CLOCK d = event->main_clk - last_edge_clk;
+
+                if (edges == 1 || d < stats->edge_min) {
+                    stats->edge_min = d;
+                }
+            }
+            last_edge_clk = event->main_clk;
+            edges++;
+        }
+
+        if ((rise & IECBUSTRACE_DATA) && (cur & IECBUSTRACE_CLK)) {
+            /* listener ready for data; the second time after an EOI
+               acknowledgement */
+            if (state != DECODE_READY || !eoi) {
+                eoi = 0;
+            }
+            state = DECODE_READY;
+            ready_clk = event->main_clk;
+        } else if (state == DECODE_READY && (fall & IECBUSTRACE_DATA)
+                   && (cur & IECBUSTRACE_CLK)
+                   && event->main_clk - ready_clk >= EOI_CYCLES) {
+            eoi = 1;
+        } else if (state == DECODE_READY && (fall & IECBUSTRACE_CLK)) {
+            state = DECODE_BITS;
+            nbits = 0;
+            byte.value = 0;
+            byte.atn = (cur & IECBUSTRACE_ATN) ? 0 : 1;
+        } else if (state == DECODE_BITS && (rise & IECBUSTRACE_CLK)) {
+            if (cur & IECBUSTRACE_DATA) {
+                byte.value |= (uint8_t)(1 << nbits);
+            }
+            if (nbits == 0) {
+                first_bit_clk = event->main_clk;
+                byte.source = event->source;
+            } else {
+                update_min_max(event->main_clk - last_bit_clk,
+                               &stats->bit_min, &stats->bit_max,
+                               &stats->bit_total, stats->bits);
+                stats->bits++;
+            }
+            last_bit_clk = event->main_clk;
+
+            if (++nbits == 8) {
+                byte.main_clk = event->main_clk;
+                byte.eoi = (uint8_t)eoi;
+                update_min_max(event->main_clk - first_bit_clk,
+                               &stats->byte_min, &stats->byte_max,
+                               &stats->byte_total, stats->bytes);
+                stats->bytes++;
+                if (byte.atn) {
+                    stats->atn_bytes++;
+                }
+                if (eoi) {
+                    stats->eoi_bytes++;
+                }
+                if (byte_func != NULL) {
+                    byte_func(&byte, param);
+                }
+                state = DECODE_IDLE;
+                eoi = 0;
+            }
+        }
+
+        prev = cur;
+    }
+}
@@ -0,0 +1,129 @@
+/*
+ * iecbustrace.h - Trace of the IEC bus line transitions.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_IECBUSTRACE_H
+#define VICE_IECBUSTRACE_H
+
+#include "iecbus.h"
+#include "types.h"
+
+/* Every change of the ATN/CLK/DATA lines driven by the computer or one of
+   the disk units is recorded into a ring buffer that is allocated when
+   tracing is switched on.  When switched off, the only cost on the
+   emulated path is the branch in IECBUSTRACE_UPDATE().  */
+
+#define IECBUSTRACE_DEFAULT_SIZE    65536
+
+/* `source' of an event: the computer, or the unit number 4...11 */
+#define IECBUSTRACE_SOURCE_COMPUTER 0
+
+/* bits of `cpu_lines' and `bus_lines', as in iecbus_t; set = released */
+#define IECBUSTRACE_ATN     0x10
+#define IECBUSTRACE_CLK     0x40
+#define IECBUSTRACE_DATA    0x80
+
+/* bits of `drive_lines', two per unit 8...11; set = released */
+#define IECBUSTRACE_DRIVE_CLK(unit)     (0x01 << (((unit) - 8) * 2))
+#define IECBUSTRACE_DRIVE_DATA(unit)    (0x02 << (((unit) - 8) * 2))
+
+typedef struct iecbustrace_event_s {
+    /* main CPU clock; for drive events projected from the drive clock */
+    CLOCK main_clk;
+    /* low 32 bits of the clock of the source drive (unit 8 for the
+       computer) */
+    uint32_t drive_clk;
+    uint8_t source;
+    uint8_t cpu_lines;
+    uint8_t drive_lines;
+    uint8_t bus_lines;
+} iecbustrace_event_t;
+
+/* A byte reconstructed from the standard serial protocol.  */
+typedef struct iecbustrace_byte_s {
+    CLOCK main_clk;         /* clock of the last bit */
+    uint8_t value;
+    uint8_t source;         /* who released CLK for the bits */
+    uint8_t atn;            /* sent under ATN */
+    uint8_t eoi;            /* EOI was signalled before it */
+} iecbustrace_byte_t;
+
+typedef struct iecbustrace_stats_s {
+    unsigned int events;
+    /* transitions of the resolved bus lines */
+    unsigned int atn_edges;
+    unsigned int clk_edges;
+    unsigned int data_edges;
+    /* shortest distance of two CLK/DATA transitions */
+    CLOCK edge_min;
+    /* decoded bytes */
+    unsigned int bytes;
+    unsigned int atn_bytes;
+    unsigned int eoi_bytes;
+    /* distance of the bit clocks within a byte */
+    unsigned int bits;
+    CLOCK bit_min;
+    CLOCK bit_max;
+    CLOCK bit_total;
+    /* from the first bit clock to the last one of a byte */
+    CLOCK byte_min;
+    CLOCK byte_max;
+    CLOCK byte_total;
+} iecbustrace_stats_t;
+
+extern int iecbustrace_enabled;
+
+void iecbustrace_record(const iecbus_t *bus);
+
+#define IECBUSTRACE_UPDATE(bus)             \
+    do {                                    \
+        if (iecbustrace_enabled) {          \
+            iecbustrace_record(bus);        \
+        }                                   \
+    } while (0)
+
+/* switch tracing on/off; the buffer is kept until reset or shutdown */
+int iecbustrace_set_enabled(int enabled);
+int iecbustrace_get_enabled(void);
+void iecbustrace_reset(void);
+void iecbustrace_shutdown(void);
+
+/* number of events in the buffer, and its capacity */
+unsigned int iecbustrace_count(void);
+unsigned int iecbustrace_size(void);
+
+/* copy the buffered events, oldest first; free with lib_free() */
+iecbustrace_event_t *iecbustrace_get_events(unsigned int *count);
+
+/* binary trace file */
+int iecbustrace_save(const char *filename);
+iecbustrace_event_t *iecbustrace_load(const char *filename,
+                                      unsigned int *count);
+
+/* reconstruct the bytes and the bit timing; `byte_func' may be NULL */
+void iecbustrace_decode(const iecbustrace_event_t *events, unsigned int count,
+                        iecbustrace_stats_t *stats,
+                        void (*byte_func)(const iecbustrace_byte_t *byte,
+                                          void *param),
+                        void *param);
+
+#endif
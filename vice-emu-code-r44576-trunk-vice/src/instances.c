@@ -0,0 +1,392 @@
+/*
+ * instances.c - Run several instances of the emulator from one start.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+
+/*
+ * Test farms run the same emulator many times with different programs.
+ * Starting every run as its own process means loading and patching the
+ * ROMs, reading the configuration and setting up the machine again and
+ * again.  With -instances the emulator does all that once and then forks
+ * right before the CPU starts, so the instances share the ROMs and the
+ * rest of the initialized state copy-on-write.  Attaching images and
+ * autostarting happens at the first reset, i.e. in each instance, so every
+ * instance has its own file handles; the contents of images that several
+ * instances read are still shared through the page cache.
+ *
+ * -instancelist gives each instance its own command line options, one
+ * line per instance, with `%i' replaced by the index of the instance.  The
+ * parent process only waits for the instances, logs how each one exited
+ * and exits with the highest exit code.
+ *
+ * The instances are separate processes, the parent does not run any
+ * emulation and nothing is shared that one instance could change for
+ * another, so a run in an instance gives the same result as on its own.
+ */
+
+#include "vice.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef UNIX_COMPILE
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "archdep.h"
+#include "archdep_tick.h"
+#include "cmdline.h"
+#include "initcmdline.h"
+#include "instances.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "resources.h"
+#include "util.h"
+
+#define INSTANCES_MAX   4096
+
+static int instances_num = 0;
+static int instances_jobs = 0;
+
+/* per instance command lines from -instancelist */
+static char **instance_lines = NULL;
+static int instance_lines_num = 0;
+
+static log_t instances_log = LOG_DEFAULT;
+
+/* index of this instance, -1 in the parent or without instances */
+static int instance_index = -1;
+
+int instances_get_index(void)
+{
+    return instance_index;
+}
+
+int instances_get_count(void)
+{
+    return instance_index < 0 ? 0 : instances_num;
+}
+
+void instances_shutdown(void)
+{
+    int i;
+
+    for (i = 0; i < instance_lines_num; i++) {
+        lib_free(instance_lines[i]);
+    }
+    lib_free(instance_lines);
+    instance_lines = NULL;
+    instance_lines_num = 0;
+}
+
+#ifdef UNIX_COMPILE
+
+/* Split `line' into words, "..." keeps spaces in a word.  argv[0] is the
+   program name, like for the real command line.  */
+static char **instance_split_args(const char *line, int *argc)
+{
+    char **argv;
+    char *word;
+    const char *p = line;
+    int num = 1;
+
+    argv = lib_malloc(sizeof(char *) * (strlen(line) / 2 + 3));
+    argv[0] = lib_strdup(archdep_program_name());
+
+    word = lib_malloc(strlen(line) + 1);
+    for (;;) {
+        size_t len = 0;
+        int quoted = 0;
+
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == 0) {
+            break;
+        }
+        while (*p != 0 && (quoted || !isspace((unsigned char)*p))) {
+            if (*p == '"') {
+                quoted = !quoted;
+            } else {
+                word[len++] = *p;
+            }
+            p++;
+        }
+        word[len] = 0;
+        argv[num++] = lib_strdup(word);
+    }
+    lib_free(word);
+
+    argv[num] = NULL;
+    *argc = num;
+    return argv;
+}
+
+static void instance_free_args(char **argv)
+{
+    int i;
+
+    for (i = 0; argv[i] != NULL; i++) {
+        lib_free(argv[i]);
+    }
+    lib_free(argv);
+}
+
+/* Set up the instance `index' right after the fork.  */
+static int instance_init(int index)
+{
+    const char *logname = NULL;
+    char num[16];
+
+    instance_index = index;
+    sprintf(num, "%d", index);
+
+    /* every instance gets its own log file */
+    if (resources_get_string("LogFileName", &logname) == 0
+        && logname != NULL && *logname != 0 && strcmp(logname, "-") != 0) {
+        char *name = util_concat(logname, ".", num, NULL);
+
+        resources_set_string("LogFileName", name);
+        lib_free(name);
+    }
+
+    log_message(instances_log, "Instance %d of %d, pid %d.",
+                index, instances_num, (int)getpid());
+
+    if (instance_lines_num > 0) {
+        char *line = util_subst(instance_lines[index % instance_lines_num], "%i", num);
+        char **argv;
+        int argc;
+        int result;
+
+        argv = instance_split_args(line, &argc);
+        log_message(instances_log, "Instance %d options: %s", index, line);
+        lib_free(line);
+
+        result = initcmdline_check_args(argc, argv);
+        instance_free_args(argv);
+        if (result < 0) {
+            return -1;
+        }
+    }
+
+    instances_shutdown();
+    return 0;
+}
+
+int instances_run(void)
+{
+    pid_t *pids;
+    tick_t start;
+    int next = 0, running = 0, failed = 0;
+    int exit_code = 0;
+
+    if (instances_num == 0) {
+        if (instance_lines_num == 0) {
+            return 0;
+        }
+        instances_num = instance_lines_num;
+    }
+
+#ifndef USE_HEADLESSUI
+    if (!console_mode) {
+        log_error(instances_log, "Instances can only be run with -console.");
+        return -1;
+    }
+#endif
+
+    log_message(instances_log, "Starting %d instances, %d at a time.",
+                instances_num, instances_jobs > 0 ? instances_jobs : instances_num);
+
+    pids = lib_calloc((size_t)instances_num, sizeof(pid_t));
+    start = tick_now();
+
+    while (next < instances_num || running > 0) {
+        pid_t pid;
+        int status, i, code;
+
+        while (next < instances_num && (instances_jobs == 0 || running < instances_jobs)) {
+            /* don't let the instance write out what is still buffered here */
+            fflush(stdout);
+            fflush(stderr);
+
+            pid = fork();
+            if (pid == 0) {
+                lib_free(pids);
+                return instance_init(next);
+            }
+            if (pid < 0) {
+                log_error(instances_log, "Cannot start instance %d: %s.",
+                          next, strerror(errno));
+                exit_code = 1;
+                failed += instances_num - next;
+                instances_num = next;
+                break;
+            }
+            pids[next++] = pid;
+            running++;
+        }
+        if (running == 0) {
+            break;
+        }
+
+        pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_error(instances_log, "Waiting for the instances failed: %s.", strerror(errno));
+            exit_code = 1;
+            break;
+        }
+        for (i = 0; i < next && pids[i] != pid; i++) {
+        }
+        if (i == next) {
+            continue;
+        }
+        running--;
+
+        if (WIFEXITED(status)) {
+            code = WEXITSTATUS(status);
+            log_message(instances_log, "Instance %d exited with %d.", i, code);
+        } else {
+            code = 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+            log_error(instances_log, "Instance %d was killed by signal %d.", i,
+                      WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+        }
+        if (code != 0) {
+            failed++;
+        }
+        if (code > exit_code) {
+            exit_code = code;
+        }
+    }
+
+    log_message(instances_log, "%d instances done in %.2f s, %d failed.",
+                instances_num, (double)tick_now_delta(start) / tick_per_second(), failed);
+
+    lib_free(pids);
+    instances_shutdown();
+    exit(exit_code);
+}
+
+#else
+
+int instances_run(void)
+{
+    if (instances_num > 0 || instance_lines_num > 0) {
+        log_error(instances_log, "Instances are not supported on this platform.");
+        return -1;
+    }
+    return 0;
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static int set_instances(const char *value, void *param)
+{
+    int num = atoi(value);
+
+    if (num < 1 || num > INSTANCES_MAX) {
+        return -1;
+    }
+    instances_num = num;
+    return 0;
+}
+
+static int set_instance_jobs(const char *value, void *param)
+{
+    int num = atoi(value);
+
+    if (num < 0) {
+        return -1;
+    }
+    instances_jobs = num;
+    return 0;
+}
+
+static int instances_load_list(const char *name, void *param)
+{
+    FILE *f;
+    char buf[1024];
+    int num_alloc = 0;
+
+    instances_shutdown();
+
+    f = fopen(name, MODE_READ_TEXT);
+    if (f == NULL) {
+        log_error(instances_log, "Cannot open instance list `%s'.", name);
+        return -1;
+    }
+
+    while (util_get_line(buf, (int)sizeof(buf), f) >= 0) {
+        if (buf[0] == 0 || buf[0] == '#') {
+            continue;
+        }
+        if (instance_lines_num == INSTANCES_MAX) {
+            log_error(instances_log, "Instance list `%s' has more than %d lines.",
+                      name, INSTANCES_MAX);
+            break;
+        }
+        if (instance_lines_num == num_alloc) {
+            num_alloc = num_alloc ? num_alloc * 2 : 64;
+            instance_lines = lib_realloc(instance_lines, sizeof(char *) * (size_t)num_alloc);
+        }
+        instance_lines[instance_lines_num++] = lib_strdup(buf);
+    }
+    fclose(f);
+
+    if (instance_lines_num == 0) {
+        log_error(instances_log, "Instance list `%s' is empty.", name);
+        return -1;
+    }
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-instances", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      set_instances, NULL, NULL, NULL,
+      "<Number>", "Run <Number> instances of the emulator that share the ROMs and the initialized machine" },
+    { "-instancejobs", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      set_instance_jobs, NULL, NULL, NULL,
+      "<Number>", "Run at most <Number> instances at the same time (0: all)" },
+    { "-instancelist", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      instances_load_list, NULL, NULL, NULL,
+      "<Name>", "Run one instance for every line of <Name>, with the options on that line (%i is the index of the instance)" },
+    CMDLINE_LIST_END
+};
+
+int instances_cmdline_options_init(void)
+{
+    instances_log = log_open("Instances");
+
+    return cmdline_register_options(cmdline_options);
+}
@@ -0,0 +1,39 @@
+/*
+ * instances.h - Run several instances of the emulator from one start.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_INSTANCES_H
+#define VICE_INSTANCES_H
+
+int instances_cmdline_options_init(void);
+void instances_shutdown(void);
+
+/* Fork the instances once the machine is initialized.  Returns in every
+   instance, the parent process waits for them and exits.  */
+int instances_run(void);
+
+/* index of this instance and number of instances, -1 and 0 without
+   -instances; lets a job list be split over the instances */
+int instances_get_index(void);
+int instances_get_count(void);
+
+#endif
@@ -43,7 +43,10 @@
 #include "fliplist.h"
 #include "fsdevice.h"
 #include "gfxoutput.h"
+#include "goldenframe.h"
+#include "iecbustrace.h"
 #include "initcmdline.h"
+#include "instances.h"
 #include "interrupt.h"
 #include "joystick.h"
 #include "kbdbuf.h"
@@ -62,8 +65,10 @@
 #include "printer.h"
 #include "profiler.h"
 #include "resources.h"
+#include "rewind.h"
 #include "romset.h"
 #include "screenshot.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "sysfile.h"
 #include "tape.h"
@@ -373,6 +378,7 @@ void machine_shutdown(void)
 
     resources_shutdown();
 
+    iecbustrace_shutdown();
     drive_shutdown();
 
     machine_maincpu_shutdown();
@@ -463,6 +469,19 @@ static int set_exit_screenshot_name1(const char *val, void *param)
     return 0;
 }
 
+static int snapshot_compression = 0;
+
+static int set_snapshot_compression(int val, void *param)
+{
+    if (val < 0 || val > 9) {
+        return -1;
+    }
+    snapshot_compression = val;
+    snapshot_set_compression(val);
+
+    return 0;
+}
+
 static resource_string_t resources_string[] = {
     { "ExitScreenshotName", "", RES_EVENT_NO, NULL,
       &ExitScreenshotName, set_exit_screenshot_name, NULL },
@@ -475,6 +494,12 @@ static resource_string_t resources_string_c128[] = {
     RESOURCE_STRING_LIST_END
 };
 
+static const resource_int_t resources_int_snapshot[] = {
+    { "SnapshotCompression", 0, RES_EVENT_NO, NULL,
+      &snapshot_compression, set_snapshot_compression, NULL },
+    RESOURCE_INT_LIST_END
+};
+
 static const resource_int_t resources_int[] = {
     { "JAMAction", MACHINE_JAM_ACTION_CONTINUE, RES_EVENT_SAME, NULL,
       &jam_action, set_jam_action, NULL },
@@ -487,6 +512,12 @@ int machine_common_resources_init(void)
         if (resources_register_string(resources_string) < 0) {
            return -1;
         }
+        if (resources_register_int(resources_int_snapshot) < 0) {
+            return -1;
+        }
+        if (rewind_resources_init() < 0) {
+            return -1;
+        }
         if (machine_class == VICE_MACHINE_C128) {
             if (resources_register_string(resources_string_c128) < 0) {
             return -1;
@@ -500,6 +531,9 @@ void machine_common_resources_shutdown(void)
 {
     lib_free(ExitScreenshotName);
     lib_free(ExitScreenshotName1);
+    rewind_shutdown();
+    goldenframe_shutdown();
+    instances_shutdown();
 }
 
 static const cmdline_option_t cmdline_options_c128[] =
@@ -513,6 +547,9 @@ static const cmdline_option_t cmdline_options_c128[] =
     { "-exitscreenshotvicii", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "ExitScreenshotName1", NULL,
       "<Name>", "Set name of screenshot to save when emulator exits." },
+    { "-snapshotcompression", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SnapshotCompression", NULL,
+      "<Level>", "Set zlib compression level of snapshot modules (0: none, 1-9: fast-best)" },
     CMDLINE_LIST_END
 };
 
@@ -524,6 +561,9 @@ static const cmdline_option_t cmdline_options[] =
     { "-exitscreenshot", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "ExitScreenshotName", NULL,
       "<Name>", "Set name of screenshot to save when emulator exits." },
+    { "-snapshotcompression", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SnapshotCompression", NULL,
+      "<Level>", "Set zlib compression level of snapshot modules (0: none, 1-9: fast-best)" },
     CMDLINE_LIST_END
 };
 
@@ -537,10 +577,22 @@ static const cmdline_option_t cmdline_options_vsid[] =
 
 int machine_common_cmdline_options_init(void)
 {
+    if (machine_class == VICE_MACHINE_VSID) {
+        return cmdline_register_options(cmdline_options_vsid);
+    }
+
+    if (rewind_cmdline_options_init() < 0) {
+        return -1;
+    }
+    if (goldenframe_cmdline_options_init() < 0) {
+        return -1;
+    }
+    if (instances_cmdline_options_init() < 0) {
+        return -1;
+    }
+
     if (machine_class == VICE_MACHINE_C128) {
         return cmdline_register_options(cmdline_options_c128);
-    } else if (machine_class == VICE_MACHINE_VSID) {
-        return cmdline_register_options(cmdline_options_vsid);
     } else {
         return cmdline_register_options(cmdline_options);
     }
@@ -52,6 +52,7 @@
 #include "info.h"
 #include "init.h"
 #include "initcmdline.h"
+#include "instances.h"
 #include "lib.h"
 #include "log.h"
 #include "machine.h"
@@ -416,6 +417,11 @@ int main_program(int argc, char **argv)
         return -1;
     }
 
+    /* with -instances only the instances get past this */
+    if (instances_run() < 0) {
+        return -1;
+    }
+
 #ifdef USE_VICE_THREAD
 
     if (pthread_create(&vice_thread, NULL, vice_thread_main, NULL)) {
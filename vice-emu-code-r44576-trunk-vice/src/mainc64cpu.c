@@ -40,6 +40,7 @@
 #endif
 
 #include "debug.h"
+#include "hostprofile.h"
 #include "interrupt.h"
 #include "machine.h"
 #include "mainc64cpu.h"
@@ -251,7 +252,9 @@ inline static void memmap_mem_update(unsigned int addr, int write)
 static void memmap_mem_store(unsigned int addr, unsigned int value)
 {
     memmap_mem_update(addr, 1);
+    HOSTPROFILE_ENTER(HOSTPROFILE_MEM_WRITE);
     (*_mem_write_tab_ptr[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value));
+    HOSTPROFILE_LEAVE(HOSTPROFILE_MEM_WRITE);
 }
 
 static void memmap_mem_store_dummy(unsigned int addr, unsigned int value)
@@ -263,9 +266,20 @@ static void memmap_mem_store_dummy(unsigned int addr, unsigned int value)
 /* read byte, check BA and mark as read */
 static uint8_t memmap_mem_read(unsigned int addr)
 {
+#ifdef FEATURE_HOSTPROFILE
+    uint8_t value;
+
+    check_ba();
+    memmap_mem_update(addr, 0);
+    HOSTPROFILE_ENTER(HOSTPROFILE_MEM_READ);
+    value = (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr));
+    HOSTPROFILE_LEAVE(HOSTPROFILE_MEM_READ);
+    return value;
+#else
     check_ba();
     memmap_mem_update(addr, 0);
     return (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr));
+#endif
 }
 
 static uint8_t memmap_mem_read_dummy(unsigned int addr)
@@ -346,12 +360,47 @@ static uint8_t memmap_mem_read_dummy(unsigned int addr)
 
 #endif /* FEATURE_CPUMEMHISTORY */
 
+#ifdef FEATURE_HOSTPROFILE
+
+inline static uint8_t mem_read_check_ba(unsigned int addr)
+{
+    uint8_t value;
+
+    check_ba();
+    HOSTPROFILE_ENTER(HOSTPROFILE_MEM_READ);
+    value = (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr));
+    HOSTPROFILE_LEAVE(HOSTPROFILE_MEM_READ);
+    return value;
+}
+
+inline static void mem_store_profiled(unsigned int addr, unsigned int value)
+{
+    HOSTPROFILE_ENTER(HOSTPROFILE_MEM_WRITE);
+    (*_mem_write_tab_ptr[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value));
+    HOSTPROFILE_LEAVE(HOSTPROFILE_MEM_WRITE);
+}
+
+#ifndef STORE
+#define STORE(addr, value) \
+    if (reu_dma_triggered == 0) { \
+        mem_store_profiled(addr, value); \
+        if (addr == 0xff00) { \
+            reu_dma(-1); \
+        } \
+    } \
+    reu_dma_triggered = 0
+#endif
+
+#else
+
 inline static uint8_t mem_read_check_ba(unsigned int addr)
 {
     check_ba();
     return (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr));
 }
 
+#endif /* FEATURE_HOSTPROFILE */
+
 inline static uint8_t mem_read_check_ba_dummy(unsigned int addr)
 {
     check_ba();
@@ -59,6 +59,20 @@ static checkpoint_list_t *breakpoints[NUM_MEMSPACES];
 static checkpoint_list_t *watchpoints_load[NUM_MEMSPACES];
 static checkpoint_list_t *watchpoints_store[NUM_MEMSPACES];
 
+/* One bit per address for each of the lists above, set if a checkpoint in
+   the list covers the address.  Lets mon_breakpoint_check_checkpoint()
+   return early for the vast majority of accesses, the list itself is only
+   searched when the bit is set.  With 24 bit addresses the bitmap only
+   covers the low 16 bits, so a set bit is a hint rather than a hit.  NULL
+   while the corresponding list is empty.  */
+#define CHECKPOINT_MAP_SIZE (0x10000 / 8)
+static uint8_t *breakpoints_map[NUM_MEMSPACES];
+static uint8_t *watchpoints_load_map[NUM_MEMSPACES];
+static uint8_t *watchpoints_store_map[NUM_MEMSPACES];
+
+#define checkpoint_map_test(map, loc) \
+    ((map)[((loc) & 0xffff) >> 3] & (1 << ((loc) & 7)))
+
 
 void mon_breakpoint_init(void)
 {
@@ -199,8 +213,50 @@ mon_checkpoint_t *mon_breakpoint_find_checkpoint(int brknum)
     return NULL;
 }
 
+/* Rebuild the bitmap of a checkpoint list from scratch.  */
+static void update_checkpoint_map(checkpoint_list_t *head, uint8_t **map)
+{
+    checkpoint_list_t *ptr;
+    unsigned int loc, len;
+
+    if (head == NULL) {
+        lib_free(*map);
+        *map = NULL;
+        return;
+    }
+
+    if (*map == NULL) {
+        *map = lib_malloc(CHECKPOINT_MAP_SIZE);
+    }
+    memset(*map, 0, CHECKPOINT_MAP_SIZE);
+
+    for (ptr = head; ptr != NULL; ptr = ptr->next) {
+        loc = addr_location(ptr->checkpt->start_addr);
+        if (mon_is_valid_addr(ptr->checkpt->end_addr)) {
+            /* ranges with end < start wrap around, like in mon_is_in_range() */
+            len = addr_mask(addr_location(ptr->checkpt->end_addr) - loc) + 1;
+        } else {
+            len = 1;
+        }
+
+        if (len >= 0x10000) {
+            memset(*map, 0xff, CHECKPOINT_MAP_SIZE);
+            return;
+        }
+
+        while (len--) {
+            (*map)[(loc & 0xffff) >> 3] |= (uint8_t)(1 << (loc & 7));
+            loc++;
+        }
+    }
+}
+
 static void update_checkpoint_state(MEMSPACE mem)
 {
+    update_checkpoint_map(breakpoints[mem], &breakpoints_map[mem]);
+    update_checkpoint_map(watchpoints_load[mem], &watchpoints_load_map[mem]);
+    update_checkpoint_map(watchpoints_store[mem], &watchpoints_store_map[mem]);
+
     /* calls mem_toggle_watchpoints() */
     if (watchpoints_load[mem] != NULL ||
         watchpoints_store[mem] != NULL) {
@@ -499,6 +555,7 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
     checkpoint_list_t *ptr;
     mon_checkpoint_t *cp;
     checkpoint_list_t *list;
+    uint8_t *map;
     monitor_cpu_type_t *monitor_cpu, *searchcpu;
     bool must_stop = FALSE;
     MON_ADDR instpc, searchpc;
@@ -509,6 +566,33 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
     supported_cpu_type_list_t *cpulist;
     int monbank = mon_interfaces[mem]->current_bank;
 
+    switch (op) {
+        case e_load:
+            list = watchpoints_load[mem];
+            map = watchpoints_load_map[mem];
+            op_str = "load";
+            is_loadstore = 1;
+            break;
+
+        case e_store:
+            list = watchpoints_store[mem];
+            map = watchpoints_store_map[mem];
+            op_str = "store";
+            is_loadstore = 1;
+            break;
+
+        default: /* e_exec */
+            list = breakpoints[mem];
+            map = breakpoints_map[mem];
+            op_str = "exec";
+            break;
+    }
+
+    /* nothing to do if no checkpoint covers the address */
+    if (map == NULL || !checkpoint_map_test(map, addr)) {
+        return FALSE;
+    }
+
     monitor_cpu = monitor_cpu_for_memspace[mem];
     instpc = new_addr(mem, (monitor_cpu->mon_register_get_val)(mem, e_PC));
     loadstorepc = new_addr(mem, lastpc);
@@ -542,25 +626,6 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
         }
     }
 
-    switch (op) {
-        case e_load:
-            list = watchpoints_load[mem];
-            op_str = "load";
-            is_loadstore = 1;
-            break;
-
-        case e_store:
-            list = watchpoints_store[mem];
-            op_str = "store";
-            is_loadstore = 1;
-            break;
-
-        default: /* e_exec */
-            list = breakpoints[mem];
-            op_str = "exec";
-            break;
-    }
-
     ptr = search_checkpoint_list(list, addr);
 
     while (ptr && mon_is_in_range(ptr->checkpt->start_addr, ptr->checkpt->end_addr, addr)) {
@@ -768,6 +833,7 @@ void mon_breakpoint_unset(MON_ADDR address)
     if (ptr) {
         /* there's a breakpoint, so remove it */
         remove_checkpoint_from_list( &breakpoints[mem], ptr->checkpt );
+        update_checkpoint_state(mem);
     }
 }
 
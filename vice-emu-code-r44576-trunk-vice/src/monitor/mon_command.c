@@ -165,6 +165,19 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "hostprofile", "hprof",
+      "[on|off|reset]",
+      "Host profiling, shows where the emulator itself spends host time.\n"
+      "Requires a build with --enable-hostprofile. Commands:\n"
+      "\n"
+      "    hprof on                       Start collecting host timings.\n"
+      "    hprof off                      Stop collecting host timings.\n"
+      "    hprof reset                    Clear the collected timings.\n"
+      "    hprof                          Show timings of the last frame and\n"
+      "                                   the average over all frames.\n",
+      NO_FILENAME_ARG
+    },
+
     { "registers", "r",
       "[<reg_name> = <number> [, <reg_name> = <number>]*]",
       "Assign respective registers (use FL for status flags).  With no\n"
@@ -185,6 +198,14 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "rewind", "",
+      "[<frames>]",
+      "Go back in time to the state of the rewind history that is at least\n"
+      "<frames> frames old, see RewindBufferSize.  Without argument, show the\n"
+      "states in the history.",
+      NO_FILENAME_ARG
+    },
+
     { "screen", "sc",
       NULL,
       "Displays the contents of the screen.",
@@ -656,6 +677,31 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "iectrace", "iect",
+      "[on|off|reset]",
+      "Trace the IEC bus line transitions of the computer and the drives\n"
+      "into a ring buffer. Commands:\n"
+      "\n"
+      "    iect on                        Start tracing.\n"
+      "    iect off                       Stop tracing, the buffer is kept.\n"
+      "    iect reset                     Clear the buffer.\n"
+      "    iect                           Show the number of traced events.\n",
+      NO_FILENAME_ARG
+    },
+
+    { "iectracedecode", "iectd",
+      "[\"<filename>\"]",
+      "Reconstruct the bytes sent with the standard serial protocol and show\n"
+      "the bit timing, from the trace buffer or from a saved trace file.",
+      FILENAME_ARG
+    },
+
+    { "iectracesave", "iects",
+      "\"<filename>\"",
+      "Save the IEC bus trace buffer to a binary file.",
+      FILENAME_ARG
+    },
+
     { "list", "",
       "[<Directory>]",
       "List disk contents.",
@@ -28,6 +28,7 @@
 
 #include "vice.h"
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -35,6 +36,7 @@
 #include "charset.h"
 #include "diskcontents-block.h"
 #include "diskimage.h"
+#include "iecbustrace.h"
 #include "imagecontents.h"
 #include "lib.h"
 #include "machine-bus.h"
@@ -220,3 +222,136 @@ void mon_drive_list(int drive_unit)
     }
 }
 
+
+/* ------------------------------------------------------------------------- */
+
+void mon_drive_iectrace(void)
+{
+    mon_out("IEC bus trace %s, %u of %u event(s) buffered.\n",
+            iecbustrace_get_enabled() ? "running" : "stopped",
+            iecbustrace_count(), iecbustrace_size());
+}
+
+void mon_drive_iectrace_action(ACTION action)
+{
+    switch (action) {
+    case e_OFF:
+        if (iecbustrace_get_enabled()) {
+            iecbustrace_set_enabled(0);
+            mon_out("IEC bus trace stopped.\n");
+        } else {
+            mon_out("IEC bus trace not started.\n");
+        }
+        return;
+    case e_ON:
+        if (iecbustrace_get_enabled()) {
+            mon_out("IEC bus trace already running.\n");
+        } else {
+            iecbustrace_set_enabled(1);
+            mon_out("IEC bus trace started.\n");
+        }
+        return;
+    case e_TOGGLE:
+        mon_drive_iectrace_action(iecbustrace_get_enabled() ? e_OFF : e_ON);
+        return;
+    }
+}
+
+void mon_drive_iectrace_reset(void)
+{
+    iecbustrace_reset();
+    mon_out("IEC bus trace cleared.\n");
+}
+
+void mon_drive_iectrace_save(const char *filename)
+{
+    if (iecbustrace_count() == 0) {
+        mon_out("No IEC bus events traced.\n");
+        return;
+    }
+    if (iecbustrace_save(filename) < 0) {
+        mon_out("Cannot save %s.\n", filename);
+        return;
+    }
+    mon_out("Saved %u IEC bus event(s) to %s.\n", iecbustrace_count(), filename);
+}
+
+/* Show the meaning of the commands sent under ATN.  */
+static const char *iectrace_atn_command(uint8_t value)
+{
+    switch (value & 0xf0) {
+    case 0x20:
+    case 0x30:
+        return value == 0x3f ? "UNLISTEN" : "LISTEN";
+    case 0x40:
+    case 0x50:
+        return value == 0x5f ? "UNTALK" : "TALK";
+    case 0x60:
+        return "DATA";
+    case 0xe0:
+        return "CLOSE";
+    case 0xf0:
+        return "OPEN";
+    }
+    return "";
+}
+
+static void iectrace_print_byte(const iecbustrace_byte_t *byte, void *param)
+{
+    char source[8];
+
+    if (byte->source == IECBUSTRACE_SOURCE_COMPUTER) {
+        strcpy(source, "cpu");
+    } else {
+        sprintf(source, "#%u", byte->source);
+    }
+
+    if (byte->atn) {
+        mon_out("%12"PRIu64"  %-4s $%02x ATN %s %u\n", byte->main_clk, source,
+                byte->value, iectrace_atn_command(byte->value),
+                byte->value & 0x1fu);
+    } else {
+        mon_out("%12"PRIu64"  %-4s $%02x%s\n", byte->main_clk, source,
+                byte->value, byte->eoi ? " EOI" : "");
+    }
+}
+
+void mon_drive_iectrace_decode(const char *filename)
+{
+    iecbustrace_event_t *events;
+    iecbustrace_stats_t stats;
+    unsigned int count;
+
+    if (filename != NULL) {
+        events = iecbustrace_load(filename, &count);
+        if (events == NULL) {
+            mon_out("Cannot read IEC bus trace %s.\n", filename);
+            return;
+        }
+    } else {
+        events = iecbustrace_get_events(&count);
+        if (events == NULL) {
+            mon_out("No IEC bus events traced.\n");
+            return;
+        }
+    }
+
+    mon_out("       clock  from value\n");
+    iecbustrace_decode(events, count, &stats, iectrace_print_byte, NULL);
+    lib_free(events);
+
+    mon_out("%u event(s), line transitions: ATN %u, CLK %u, DATA %u, "
+            "shortest CLK/DATA distance %"PRIu64" cycles.\n",
+            stats.events, stats.atn_edges, stats.clk_edges, stats.data_edges,
+            stats.edge_min);
+    mon_out("%u byte(s), %u under ATN, %u with EOI.\n",
+            stats.bytes, stats.atn_bytes, stats.eoi_bytes);
+    if (stats.bits > 0) {
+        mon_out("Cycles per bit: min %"PRIu64" avg %"PRIu64" max %"PRIu64"\n",
+                stats.bit_min, stats.bit_total / stats.bits, stats.bit_max);
+    }
+    if (stats.bytes > 0) {
+        mon_out("Cycles per byte: min %"PRIu64" avg %"PRIu64" max %"PRIu64"\n",
+                stats.byte_min, stats.byte_total / stats.bytes, stats.byte_max);
+    }
+}
@@ -28,11 +28,18 @@
 #define VICE_MON_DRIVE_H
 
 #include "monitor.h"
+#include "montypes.h"
 
 void mon_drive_block_cmd(int op, int track, int sector, MON_ADDR addr);
 void mon_drive_execute_disk_cmd(char *cmd);
 void mon_drive_list(int drive_number);
 
+void mon_drive_iectrace(void);
+void mon_drive_iectrace_action(ACTION action); /* on|off|toggle */
+void mon_drive_iectrace_reset(void);
+void mon_drive_iectrace_save(const char *filename);
+void mon_drive_iectrace_decode(const char *filename);
+
 /* FIXME: this function should perhaps live elsewhere */
 int mon_drive_is_fsdevice(int drive_unit);
 
@@ -148,6 +148,9 @@ int yylex(void);
 %token CMD_EXPORT CMD_AUTOSTART CMD_AUTOLOAD CMD_MAINCPU_TRACE
 %token CMD_WARP
 %token CMD_PROFILE FLAT GRAPH FUNC DEPTH DISASS PROFILE_CONTEXT CLEAR
+%token CMD_HOSTPROFILE
+%token CMD_IECTRACE CMD_IECTRACESAVE CMD_IECTRACEDECODE
+%token CMD_REWIND
 %token<str> CMD_LABEL_ASGN
 %token<i> L_PAREN R_PAREN ARG_IMMEDIATE REG_A REG_X REG_Y COMMA INST_SEP
 %token<i> L_BRACKET R_BRACKET LESS_THAN REG_U REG_S REG_PC REG_PCR
@@ -257,6 +260,10 @@ machine_state_rules: CMD_BANK end_cmd
                      { mon_write_snapshot($2,0,0,0); /* FIXME */ }
                    | CMD_UNDUMP filename end_cmd
                      { mon_read_snapshot($2, 0); }
+                   | CMD_REWIND end_cmd
+                     { mon_rewind(-1); }
+                   | CMD_REWIND opt_sep d_number end_cmd
+                     { mon_rewind($3); }
                    | CMD_STEP end_cmd
                      { mon_instructions_step(-1); }
                    | CMD_STEP opt_sep expression end_cmd
@@ -607,6 +614,12 @@ monitor_misc_rules: CMD_DISK rest_of_line end_cmd
                      { mon_profile_clear($3); }
                   | CMD_PROFILE PROFILE_CONTEXT d_number end_cmd
                      { mon_profile_disass_context($3); }
+                  | CMD_HOSTPROFILE TOGGLE end_cmd
+                     { mon_hostprofile_action($2); }
+                  | CMD_HOSTPROFILE end_cmd
+                     { mon_hostprofile(); }
+                  | CMD_HOSTPROFILE RESET end_cmd
+                     { mon_hostprofile_reset(); }
                   ;
 
 disk_rules: CMD_LOAD filename device_num opt_address end_cmd
@@ -653,6 +666,18 @@ disk_rules: CMD_LOAD filename device_num opt_address end_cmd
             { mon_autostart($2,0,0); }
           | CMD_AUTOLOAD filename opt_sep number end_cmd
             { mon_autostart($2,$4,0); }
+          | CMD_IECTRACE TOGGLE end_cmd
+            { mon_drive_iectrace_action($2); }
+          | CMD_IECTRACE end_cmd
+            { mon_drive_iectrace(); }
+          | CMD_IECTRACE RESET end_cmd
+            { mon_drive_iectrace_reset(); }
+          | CMD_IECTRACESAVE filename end_cmd
+            { mon_drive_iectrace_save($2); }
+          | CMD_IECTRACEDECODE end_cmd
+            { mon_drive_iectrace_decode(NULL); }
+          | CMD_IECTRACEDECODE filename end_cmd
+            { mon_drive_iectrace_decode($2); }
           ;
 
 cmd_file_rules: CMD_RECORD filename end_cmd
@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "hostprofile.h"
 #include "lib.h"
 #include "machine.h"
 #include "maincpu.h"
@@ -1139,3 +1140,95 @@ void mon_profile_clear(MON_ADDR function)
     clear_recursively(root_context, addr);
 }
 
+
+/* ------------------------------------------------------------------------- */
+
+/* host profiler, see hostprofile.h */
+
+static bool hostprofile_check_available(void)
+{
+    if (!hostprofile_available()) {
+        mon_out("Host profiling is not available, rebuild with --enable-hostprofile.\n");
+        return false;
+    }
+    return true;
+}
+
+static double hostprofile_percent(uint64_t part, uint64_t total)
+{
+    return total ? (double)part * 100.0 / (double)total : 0.0;
+}
+
+void mon_hostprofile(void)
+{
+    hostprofile_stats_t stats;
+    int i;
+
+    if (!hostprofile_check_available()) {
+        return;
+    }
+
+    hostprofile_get_stats(&stats);
+
+    mon_out("Host profiling %s, %u frame(s) collected.\n",
+            hostprofile_get_enabled() ? "running" : "stopped", stats.frames);
+    if (stats.frames == 0) {
+        mon_out("Use \"help hprof\" for more information.\n");
+        return;
+    }
+
+    mon_out("Section         last frame: calls     ticks  frame%%   average: ticks  frame%%\n");
+    for (i = 0; i < HOSTPROFILE_NUM_SECTIONS; i++) {
+        uint64_t average = stats.total_ticks[i] / stats.frames;
+
+        mon_out("%-15s %17u %9"PRIu64" %6.2f %15"PRIu64" %6.2f\n",
+                hostprofile_section_name(i),
+                stats.calls[i],
+                stats.ticks[i],
+                hostprofile_percent(stats.ticks[i], stats.frame_ticks),
+                average,
+                hostprofile_percent(stats.total_ticks[i], stats.total_frame_ticks));
+    }
+    mon_out("%-15s %27"PRIu64"        %15"PRIu64"\n", "frame",
+            stats.frame_ticks, stats.total_frame_ticks / stats.frames);
+    mon_out("Times are inclusive, nested sections are counted in each of them.\n");
+}
+
+void mon_hostprofile_action(ACTION action)
+{
+    if (!hostprofile_check_available()) {
+        return;
+    }
+
+    switch (action) {
+    case e_OFF:
+        if (hostprofile_get_enabled()) {
+            hostprofile_set_enabled(0);
+            mon_out("Host profiling stopped.\n");
+        } else {
+            mon_out("Host profiling not started.\n");
+        }
+        return;
+    case e_ON:
+        if (hostprofile_get_enabled()) {
+            mon_out("Host profiling already running.\n");
+        } else {
+            hostprofile_set_enabled(1);
+            mon_out("Host profiling started.\n");
+        }
+        return;
+    case e_TOGGLE:
+        mon_hostprofile_action(hostprofile_get_enabled() ? e_OFF : e_ON);
+        return;
+    }
+}
+
+void mon_hostprofile_reset(void)
+{
+    if (!hostprofile_check_available()) {
+        return;
+    }
+
+    hostprofile_reset();
+    mon_out("Host profiling data cleared.\n");
+}
@@ -38,4 +38,8 @@ void mon_profile_disass(MON_ADDR function);
 void mon_profile_clear(MON_ADDR function);
 void mon_profile_disass_context(int context_id);
 
+void mon_hostprofile(void);
+void mon_hostprofile_action(ACTION action); /* on|off|toggle */
+void mon_hostprofile_reset(void);
+
 #endif /* VICE_MON_PROFILE_H */
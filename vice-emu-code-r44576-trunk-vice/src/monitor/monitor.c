@@ -81,6 +81,7 @@
 #include "joyport.h"
 
 #include "resources.h"
+#include "rewind.h"
 #include "screenshot.h"
 #include "sysfile.h"
 #include "traps.h"
@@ -394,6 +395,7 @@ void monitor_vsync_hook(void)
     /* check if someone wants to connect remotely to the monitor */
     monitor_check_remote();
     monitor_check_binary();
+    monitor_binary_vsync();
 #endif
 }
 
@@ -2742,6 +2744,34 @@ int mon_read_snapshot(const char* name, int even_mode)
     return ret;
 }
 
+void mon_rewind(int frames)
+{
+    rewind_info_t info;
+    int gone;
+
+    if (frames < 0) {
+        rewind_get_info(&info);
+        if (info.states == 0) {
+            mon_out("The rewind history is empty.\n");
+        } else {
+            mon_out("%u states (%u keyframes) from %u to %u frames ago, %" PRI_SIZE_T " bytes.\n",
+                    info.states, info.keyframes, info.oldest, info.newest, info.bytes);
+        }
+        return;
+    }
+
+    gone = rewind_frames((unsigned int)frames);
+    if (gone < 0) {
+        mon_out("Cannot rewind.\n");
+        return;
+    }
+
+    /* Reset the current address */
+    dot_addr[e_comp_space] = new_addr(e_comp_space, ((uint16_t)((monitor_cpu_for_memspace[e_comp_space]->mon_register_get_val)(e_comp_space, e_PC))));
+
+    mon_out("Went back %d frames.\n", gone);
+}
+
 
 /* *** WATCHPOINTS *** */
 
@@ -34,6 +34,7 @@
 #include "archdep_defs.h"
 #include "cmdline.h"
 #include "drive.h"
+#include "hostprofile.h"
 #include "interrupt.h"
 #include "lib.h"
 #include "log.h"
@@ -42,6 +43,7 @@
 #include "monitor_binary.h"
 #include "montypes.h"
 #include "resources.h"
+#include "rewind.h"
 #include "uiapi.h"
 #include "util.h"
 #include "vicesocket.h"
@@ -89,6 +91,7 @@ enum t_binary_command {
 
     e_MON_CMD_DUMP = 0x41,
     e_MON_CMD_UNDUMP = 0x42,
+    e_MON_CMD_REWIND = 0x43,
 
     e_MON_CMD_RESOURCE_GET = 0x51,
     e_MON_CMD_RESOURCE_SET = 0x52,
@@ -102,6 +105,9 @@ enum t_binary_command {
     e_MON_CMD_REGISTERS_AVAILABLE = 0x83,
     e_MON_CMD_DISPLAY_GET = 0x84,
     e_MON_CMD_VICE_INFO = 0x85,
+    e_MON_CMD_HOSTPROFILE_GET = 0x86,
+    e_MON_CMD_BATCH = 0x87,
+    e_MON_CMD_SUBSCRIBE = 0x88,
 
     e_MON_CMD_PALETTE_GET = 0x91,
 
@@ -133,6 +139,7 @@ enum t_binary_response {
 
     e_MON_RESPONSE_DUMP = 0x41,
     e_MON_RESPONSE_UNDUMP = 0x42,
+    e_MON_RESPONSE_REWIND = 0x43,
 
     e_MON_RESPONSE_RESOURCE_GET = 0x51,
     e_MON_RESPONSE_RESOURCE_SET = 0x52,
@@ -140,6 +147,7 @@ enum t_binary_response {
     e_MON_RESPONSE_JAM = 0x61,
     e_MON_RESPONSE_STOPPED = 0x62,
     e_MON_RESPONSE_RESUMED = 0x63,
+    e_MON_RESPONSE_SUBSCRIPTION = 0x64,
 
     e_MON_RESPONSE_ADVANCE_INSTRUCTIONS = 0x71,
     e_MON_RESPONSE_KEYBOARD_FEED = 0x72,
@@ -150,6 +158,9 @@ enum t_binary_response {
     e_MON_RESPONSE_REGISTERS_AVAILABLE = 0x83,
     e_MON_RESPONSE_DISPLAY_GET = 0x84,
     e_MON_RESPONSE_VICE_INFO = 0x85,
+    e_MON_RESPONSE_HOSTPROFILE_GET = 0x86,
+    e_MON_RESPONSE_BATCH = 0x87,
+    e_MON_RESPONSE_SUBSCRIBE = 0x88,
 
     e_MON_RESPONSE_PALETTE_GET = 0x91,
 
@@ -187,6 +198,12 @@ enum t_mon_resource_type {
 };
 typedef enum t_mon_resource_type MON_RESOURCE_TYPE;
 
+enum t_mon_subscription_trigger {
+    e_MON_SUBSCRIPTION_VSYNC = 0x01,
+    e_MON_SUBSCRIPTION_CHECKPOINT = 0x02,
+};
+typedef enum t_mon_subscription_trigger MON_SUBSCRIPTION_TRIGGER;
+
 struct binary_command_s {
     unsigned char *body;
     uint32_t length;
@@ -196,6 +213,38 @@ struct binary_command_s {
 };
 typedef struct binary_command_s binary_command_t;
 
+/* Memory range sent with every subscription event */
+struct subscription_range_s {
+    uint8_t requested_memspace;
+    MEMSPACE memspace;
+    int banknum;
+    uint16_t startaddress;
+    uint16_t endaddress;
+};
+typedef struct subscription_range_s subscription_range_t;
+
+/* What MON_CMD_SUBSCRIBE asked for, pushed to the client without being
+   polled for.  */
+static struct {
+    /* MON_SUBSCRIPTION_TRIGGER bits, 0 if there is no subscription */
+    uint8_t triggers;
+    /* requested memspace of the registers to send, 0xff for none */
+    uint8_t registers;
+    subscription_range_t *ranges;
+    unsigned int num_ranges;
+    /* a vsync event is waiting for the next instruction boundary */
+    bool pending;
+} subscription;
+
+/* While a batch is processed the responses of its commands are collected
+   here and sent together when all commands are done.  */
+static unsigned char *batch_response = NULL;
+static uint32_t batch_response_size = 0;
+static uint32_t batch_response_alloc = 0;
+static bool batch_active = false;
+
+static void subscription_clear(void);
+
 int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length)
 {
     int error = 0;
@@ -217,6 +266,7 @@ static void monitor_binary_quit(void)
 {
     vice_network_socket_close(connected_socket);
     connected_socket = NULL;
+    subscription_clear();
 }
 
 int monitor_binary_receive(unsigned char *buffer, size_t buffer_length)
@@ -296,6 +346,14 @@ static unsigned char *write_uint32(uint32_t input, unsigned char *output) {
     return output + 4;
 }
 
+/*! \internal \brief Write uint64 to buffer and return pointer to byte after */
+static unsigned char *write_uint64(uint64_t input, unsigned char *output) {
+    write_uint32((uint32_t)input, output);
+    write_uint32((uint32_t)(input >> 32), output + 4);
+
+    return output + 8;
+}
+
 /*! \internal \brief Write string to buffer and return pointer to byte after */
 static unsigned char *write_string(uint8_t length, unsigned char *input, unsigned char *output) {
     output[0] = length;
@@ -314,6 +372,26 @@ static uint16_t little_endian_to_uint16(unsigned char *input) {
     return (input[1] << 8) + input[0];
 }
 
+/*! \internal \brief Send data to the client, or add it to the batch response */
+static void monitor_binary_output(const unsigned char *buffer, uint32_t length)
+{
+    if (!batch_active) {
+        monitor_binary_transmit(buffer, length);
+        return;
+    }
+
+    if (batch_response_size + length > batch_response_alloc) {
+        batch_response_alloc = batch_response_alloc ? batch_response_alloc : 256;
+        while (batch_response_size + length > batch_response_alloc) {
+            batch_response_alloc *= 2;
+        }
+        batch_response = lib_realloc(batch_response, batch_response_alloc);
+    }
+
+    memcpy(batch_response + batch_response_size, buffer, length);
+    batch_response_size += length;
+}
+
 static void monitor_binary_response(uint32_t length, BINARY_RESPONSE response_type, BINARY_ERROR errorcode, uint32_t request_id, unsigned char *body)
 {
     unsigned char response[12];
@@ -325,10 +403,10 @@ static void monitor_binary_response(uint32_t length, BINARY_RESPONSE response_ty
     response[7] = (uint8_t)errorcode;
     write_uint32(request_id, &response[8]);
 
-    monitor_binary_transmit(response, sizeof response);
+    monitor_binary_output(response, sizeof response);
 
     if (body != NULL) {
-        monitor_binary_transmit(body, length);
+        monitor_binary_output(body, length);
     }
 }
 
@@ -406,7 +484,15 @@ static uint8_t memspace_to_uint8_t(MEMSPACE mem) {
     }
 }
 
-static void monitor_binary_response_register_info(uint32_t request_id, MEMSPACE memspace)
+/*! \internal \brief Build the body of a MON_RESPONSE_REGISTER_INFO
+
+ \param memspace The memspace of the registers
+
+ \param[out] size Size of the body
+
+ \return The body, to be freed by the caller
+*/
+static unsigned char *monitor_binary_register_info(MEMSPACE memspace, uint32_t *size)
 {
     mon_reg_list_t *regs;
     mon_reg_list_t *regs_cursor;
@@ -447,11 +533,115 @@ static void monitor_binary_response_register_info(uint32_t request_id, MEMSPACE
         response_cursor = write_uint16((uint16_t)regs_cursor->val, response_cursor);
     }
 
+    lib_free(regs);
+
+    *size = response_size;
+    return response;
+}
+
+static void monitor_binary_response_register_info(uint32_t request_id, MEMSPACE memspace)
+{
+    unsigned char *response;
+    uint32_t response_size;
+
+    response = monitor_binary_register_info(memspace, &response_size);
+
     monitor_binary_response(response_size, e_MON_RESPONSE_REGISTER_INFO, e_MON_ERR_OK, request_id, response);
 
     lib_free(response);
 }
 
+static void subscription_clear(void)
+{
+    lib_free(subscription.ranges);
+    subscription.ranges = NULL;
+    subscription.num_ranges = 0;
+    subscription.triggers = 0;
+    subscription.registers = 0xff;
+}
+
+/*! \internal \brief Send the subscribed memory ranges and registers
+
+ \param trigger What caused the event
+*/
+static void monitor_binary_response_subscription(MON_SUBSCRIPTION_TRIGGER trigger)
+{
+    unsigned char *response;
+    unsigned char *response_cursor;
+    unsigned char *regs = NULL;
+    uint32_t regs_size = 0;
+    uint32_t response_size = 2;
+    int old_sidefx = sidefx;
+    unsigned int i;
+
+    if (connected_socket == NULL) {
+        return;
+    }
+
+    for (i = 0; i < subscription.num_ranges; i++) {
+        response_size += 2 + subscription.ranges[i].endaddress
+                         - subscription.ranges[i].startaddress + 1;
+    }
+
+    if (subscription.registers != 0xff) {
+        regs = monitor_binary_register_info(get_requested_memspace(subscription.registers), &regs_size);
+        response_size += regs_size;
+    }
+
+    response = lib_malloc(response_size);
+    response_cursor = response;
+
+    *response_cursor++ = (uint8_t)trigger;
+    *response_cursor++ = (uint8_t)subscription.num_ranges;
+
+    sidefx = 0;
+    for (i = 0; i < subscription.num_ranges; i++) {
+        subscription_range_t *range = &subscription.ranges[i];
+        uint32_t length = range->endaddress - range->startaddress + 1;
+
+        response_cursor = write_uint16((uint16_t)length, response_cursor);
+        mon_get_mem_block_ex(range->memspace, range->banknum, range->startaddress,
+                             range->endaddress - range->startaddress, response_cursor);
+        response_cursor += length;
+    }
+    sidefx = old_sidefx;
+
+    if (regs != NULL) {
+        memcpy(response_cursor, regs, regs_size);
+        lib_free(regs);
+    }
+
+    monitor_binary_response(response_size, e_MON_RESPONSE_SUBSCRIPTION, e_MON_ERR_OK, MON_EVENT_ID, response);
+
+    lib_free(response);
+}
+
+/*! \internal \brief Trap handler sending the vsync subscription event.
+
+ Runs between two instructions, so the registers are up to date.
+*/
+static void monitor_binary_subscription_trap(uint16_t addr, void *data)
+{
+    subscription.pending = false;
+
+    if (subscription.triggers & e_MON_SUBSCRIPTION_VSYNC) {
+        /* Ensure drive CPU emulation is up to date with main cpu CLOCK. */
+        drive_cpu_execute_all(maincpu_clk);
+        monitor_binary_response_subscription(e_MON_SUBSCRIPTION_VSYNC);
+    }
+}
+
+/*! \internal \brief called at every vsync */
+void monitor_binary_vsync(void)
+{
+    if (connected_socket != NULL
+        && (subscription.triggers & e_MON_SUBSCRIPTION_VSYNC)
+        && !subscription.pending) {
+        subscription.pending = true;
+        interrupt_maincpu_trigger_trap(monitor_binary_subscription_trap, NULL);
+    }
+}
+
 /*! \internal \brief called when the monitor is opened */
 void monitor_binary_event_opened(void) {
     /* FIXME */
@@ -496,6 +686,10 @@ void monitor_binary_response_checkpoint_info(uint32_t request_id, mon_checkpoint
     response[22] = memspace_to_uint8_t(addr_memspace(checkpt->start_addr));
 
     monitor_binary_response(sizeof (response), e_MON_RESPONSE_CHECKPOINT_INFO, e_MON_ERR_OK, request_id, response);
+
+    if (hit && (subscription.triggers & e_MON_SUBSCRIPTION_CHECKPOINT)) {
+        monitor_binary_response_subscription(e_MON_SUBSCRIPTION_CHECKPOINT);
+    }
 }
 
 static void monitor_binary_process_ping(binary_command_t *command)
@@ -882,6 +1076,37 @@ static void monitor_binary_process_undump(binary_command_t *command)
     monitor_binary_response(sizeof response, e_MON_RESPONSE_UNDUMP, e_MON_ERR_OK, command->request_id, response);
 }
 
+static void monitor_binary_process_rewind(binary_command_t *command)
+{
+    unsigned char response[6];
+    uint32_t frames;
+    uint16_t addr;
+    int gone;
+
+    if (command->length < 4) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    frames = little_endian_to_uint32(command->body);
+
+    gone = rewind_frames(frames);
+    if (gone < 0) {
+        monitor_binary_error(e_MON_ERR_CMD_FAILURE, command->request_id);
+        return;
+    }
+
+    /* Reset the current address */
+    dot_addr[e_comp_space] = new_addr(e_comp_space, ((uint16_t)((monitor_cpu_for_memspace[e_comp_space]->mon_register_get_val)(e_comp_space, e_PC))));
+
+    addr = ((uint16_t)((monitor_cpu_for_memspace[e_comp_space]->mon_register_get_val)(e_comp_space, e_PC)));
+
+    write_uint32((uint32_t)gone, response);
+    write_uint16(addr, response + 4);
+
+    monitor_binary_response(sizeof response, e_MON_RESPONSE_REWIND, e_MON_ERR_OK, command->request_id, response);
+}
+
 static void monitor_binary_process_resource_get(binary_command_t *command)
 {
     unsigned char* response;
@@ -1403,6 +1628,81 @@ static void monitor_binary_process_vice_info(binary_command_t *command)
     monitor_binary_response(sizeof(response), e_MON_RESPONSE_VICE_INFO, e_MON_ERR_OK, command->request_id, response);
 }
 
+enum t_hostprofile_action {
+    e_HOSTPROFILE_GET = 0x00,
+    e_HOSTPROFILE_START = 0x01,
+    e_HOSTPROFILE_STOP = 0x02,
+    e_HOSTPROFILE_RESET = 0x03,
+};
+
+static void monitor_binary_process_hostprofile_get(binary_command_t *command)
+{
+    hostprofile_stats_t stats;
+    unsigned char *response;
+    unsigned char *response_cursor;
+    uint32_t response_size = 1 + 4 + 8 + 8 + 2;
+    uint8_t action;
+    int i;
+
+    if (command->length < 1) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    if (!hostprofile_available()) {
+        monitor_binary_error(e_MON_ERR_CMD_FAILURE, command->request_id);
+        return;
+    }
+
+    action = command->body[0];
+    if (action == e_HOSTPROFILE_START) {
+        hostprofile_set_enabled(1);
+    } else if (action == e_HOSTPROFILE_STOP) {
+        hostprofile_set_enabled(0);
+    } else if (action == e_HOSTPROFILE_RESET) {
+        hostprofile_reset();
+    } else if (action != e_HOSTPROFILE_GET) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        return;
+    }
+
+    hostprofile_get_stats(&stats);
+
+    for (i = 0; i < HOSTPROFILE_NUM_SECTIONS; i++) {
+        response_size += 1 + 1 + 4 + 8 + 8 + 1 + (uint32_t)strlen(hostprofile_section_name(i));
+    }
+
+    response = lib_malloc(response_size);
+    response_cursor = response;
+
+    *response_cursor = (uint8_t)hostprofile_get_enabled();
+    ++response_cursor;
+    response_cursor = write_uint32(stats.frames, response_cursor);
+    response_cursor = write_uint64(stats.frame_ticks, response_cursor);
+    response_cursor = write_uint64(stats.total_frame_ticks, response_cursor);
+    response_cursor = write_uint16(HOSTPROFILE_NUM_SECTIONS, response_cursor);
+
+    for (i = 0; i < HOSTPROFILE_NUM_SECTIONS; i++) {
+        const char *name = hostprofile_section_name(i);
+        uint8_t name_length = (uint8_t)strlen(name);
+
+        *response_cursor = 1 + 4 + 8 + 8 + 1 + name_length;
+        ++response_cursor;
+
+        *response_cursor = (uint8_t)i;
+        ++response_cursor;
+
+        response_cursor = write_uint32(stats.calls[i], response_cursor);
+        response_cursor = write_uint64(stats.ticks[i], response_cursor);
+        response_cursor = write_uint64(stats.total_ticks[i], response_cursor);
+        response_cursor = write_string(name_length, (unsigned char *)name, response_cursor);
+    }
+
+    monitor_binary_response(response_size, e_MON_RESPONSE_HOSTPROFILE_GET, e_MON_ERR_OK, command->request_id, response);
+
+    lib_free(response);
+}
+
 static void monitor_binary_process_mem_get(binary_command_t *command)
 {
     unsigned char *response;
@@ -1530,107 +1830,255 @@ static void monitor_binary_process_mem_set(binary_command_t *command)
 }
 
 
-static void monitor_binary_process_command(unsigned char * pbuffer)
+static void monitor_binary_process_subscribe(binary_command_t *command)
 {
-    BINARY_COMMAND command_type;
-    binary_command_t command;
+    const int header_size = 3;
+    const int range_size = 7;
+    unsigned char *body = command->body;
+    subscription_range_t *ranges = NULL;
+    uint8_t triggers;
+    uint8_t registers;
+    unsigned int num_ranges;
+    unsigned int i;
 
-    command.api_version = (uint8_t)pbuffer[1];
+    if (command->length < header_size) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
 
-    command.request_id = little_endian_to_uint32(&pbuffer[6]);
+    triggers = body[0];
+    registers = body[1];
+    num_ranges = body[2];
 
-    if (command.api_version < 0x01 || command.api_version > 0x02) {
-        monitor_binary_error(e_MON_ERR_CMD_INVALID_API_VERSION, command.request_id);
+    if (command->length < header_size + num_ranges * range_size) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
         return;
     }
 
-    /* Ensure drive CPU emulation is up to date with main cpu CLOCK. */
-    drive_cpu_execute_all(maincpu_clk);
+    if (registers != 0xff && get_requested_memspace(registers) == e_invalid_space) {
+        monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary subscribe: Unknown memspace %u", registers);
+        return;
+    }
 
-    command.length = little_endian_to_uint32(&pbuffer[2]);
+    if (num_ranges > 0) {
+        ranges = lib_malloc(num_ranges * sizeof(subscription_range_t));
+    }
 
-    command.type = pbuffer[10];
-    command.body = &pbuffer[11];
+    for (i = 0; i < num_ranges; i++) {
+        unsigned char *item = &body[header_size + i * range_size];
+        subscription_range_t *range = &ranges[i];
+
+        range->requested_memspace = item[0];
+        range->memspace = get_requested_memspace(item[0]);
+        range->banknum = little_endian_to_uint16(&item[1]);
+        range->startaddress = little_endian_to_uint16(&item[3]);
+        range->endaddress = little_endian_to_uint16(&item[5]);
+
+        if (range->memspace == e_invalid_space) {
+            monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary subscribe: Unknown memspace %u", item[0]);
+            lib_free(ranges);
+            return;
+        }
+
+        /* the length of a range is sent as 16 bit, so 65536 bytes won't fit */
+        if (range->startaddress > range->endaddress
+            || range->endaddress - range->startaddress >= 0xffff
+            || mon_banknum_validate(range->memspace, range->banknum) == 0) {
+            monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary subscribe: invalid range %04x - %04x, bank %d",
+                        range->startaddress, range->endaddress, range->banknum);
+            lib_free(ranges);
+            return;
+        }
+    }
+
+    subscription_clear();
+    subscription.triggers = triggers & (e_MON_SUBSCRIPTION_VSYNC | e_MON_SUBSCRIPTION_CHECKPOINT);
+    subscription.registers = registers;
+    subscription.ranges = ranges;
+    subscription.num_ranges = num_ranges;
+
+    monitor_binary_response(0, e_MON_RESPONSE_SUBSCRIBE, e_MON_ERR_OK, command->request_id, NULL);
+}
+
+static void monitor_binary_dispatch_command(binary_command_t *command);
+
+static void monitor_binary_process_batch(binary_command_t *command)
+{
+    const uint32_t header_size = 9;
+    binary_command_t sub_command;
+    uint32_t pos;
+    uint32_t sub_length;
+
+    if (batch_active) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary batch: batches cannot be nested");
+        return;
+    }
+
+    /* check the whole batch first, so nothing is done for a broken one */
+    for (pos = 0; pos < command->length; pos += header_size + sub_length) {
+        if (command->length - pos < header_size) {
+            monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+            return;
+        }
+        sub_length = little_endian_to_uint32(&command->body[pos]);
+        if (sub_length > command->length - pos - header_size) {
+            monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+            return;
+        }
+        /* these resume the emulation, leave the monitor or close the
+           connection before the batch response is sent */
+        switch (command->body[pos + 8]) {
+            case e_MON_CMD_ADVANCE_INSTRUCTIONS:
+            case e_MON_CMD_EXECUTE_UNTIL_RETURN:
+            case e_MON_CMD_EXIT:
+            case e_MON_CMD_QUIT:
+            case e_MON_CMD_RESET:
+            case e_MON_CMD_AUTOSTART:
+                monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+                log_message(LOG_DEFAULT, "monitor binary batch: command 0x%02x cannot be batched",
+                            command->body[pos + 8]);
+                return;
+            default:
+                break;
+        }
+    }
+
+    batch_active = true;
+    batch_response_size = 0;
+
+    for (pos = 0; pos < command->length; pos += header_size + sub_command.length) {
+        sub_command.api_version = command->api_version;
+        sub_command.length = little_endian_to_uint32(&command->body[pos]);
+        sub_command.request_id = little_endian_to_uint32(&command->body[pos + 4]);
+        sub_command.type = command->body[pos + 8];
+        sub_command.body = &command->body[pos + header_size];
+
+        monitor_binary_dispatch_command(&sub_command);
+    }
+
+    batch_active = false;
+
+    monitor_binary_response(batch_response_size, e_MON_RESPONSE_BATCH, e_MON_ERR_OK, command->request_id, batch_response);
+}
+
+static void monitor_binary_dispatch_command(binary_command_t *command)
+{
+    BINARY_COMMAND command_type = command->type;
 
-    command_type = command.type;
     if (command_type == e_MON_CMD_PING) {
-        monitor_binary_process_ping(&command);
+        monitor_binary_process_ping(command);
 
     } else if (command_type == e_MON_CMD_MEM_GET) {
-        monitor_binary_process_mem_get(&command);
+        monitor_binary_process_mem_get(command);
     } else if (command_type == e_MON_CMD_MEM_SET) {
-        monitor_binary_process_mem_set(&command);
+        monitor_binary_process_mem_set(command);
 
     } else if (command_type == e_MON_CMD_CHECKPOINT_GET) {
-        monitor_binary_process_checkpoint_get(&command);
+        monitor_binary_process_checkpoint_get(command);
     } else if (command_type == e_MON_CMD_CHECKPOINT_SET) {
-        monitor_binary_process_checkpoint_set(&command);
+        monitor_binary_process_checkpoint_set(command);
     } else if (command_type == e_MON_CMD_CHECKPOINT_DELETE) {
-        monitor_binary_process_checkpoint_delete(&command);
+        monitor_binary_process_checkpoint_delete(command);
     } else if (command_type == e_MON_CMD_CHECKPOINT_LIST) {
-        monitor_binary_process_checkpoint_list(&command);
+        monitor_binary_process_checkpoint_list(command);
     } else if (command_type == e_MON_CMD_CHECKPOINT_TOGGLE) {
-        monitor_binary_process_checkpoint_toggle(&command);
+        monitor_binary_process_checkpoint_toggle(command);
 
     } else if (command_type == e_MON_CMD_CONDITION_SET) {
-        monitor_binary_process_condition_set(&command);
+        monitor_binary_process_condition_set(command);
 
     } else if (command_type == e_MON_CMD_REGISTERS_GET) {
-        monitor_binary_process_registers_get(&command);
+        monitor_binary_process_registers_get(command);
     } else if (command_type == e_MON_CMD_REGISTERS_SET) {
-        monitor_binary_process_registers_set(&command);
+        monitor_binary_process_registers_set(command);
 
     } else if (command_type == e_MON_CMD_DUMP) {
-        monitor_binary_process_dump(&command);
+        monitor_binary_process_dump(command);
     } else if (command_type == e_MON_CMD_UNDUMP) {
-        monitor_binary_process_undump(&command);
+        monitor_binary_process_undump(command);
+    } else if (command_type == e_MON_CMD_REWIND) {
+        monitor_binary_process_rewind(command);
 
     } else if (command_type == e_MON_CMD_RESOURCE_GET) {
-        monitor_binary_process_resource_get(&command);
+        monitor_binary_process_resource_get(command);
     } else if (command_type == e_MON_CMD_RESOURCE_SET) {
-        monitor_binary_process_resource_set(&command);
+        monitor_binary_process_resource_set(command);
 
     } else if (command_type == e_MON_CMD_ADVANCE_INSTRUCTIONS) {
-        monitor_binary_process_advance_instructions(&command);
+        monitor_binary_process_advance_instructions(command);
     } else if (command_type == e_MON_CMD_KEYBOARD_FEED) {
-        monitor_binary_process_keyboard_feed(&command);
+        monitor_binary_process_keyboard_feed(command);
     } else if (command_type == e_MON_CMD_EXECUTE_UNTIL_RETURN) {
-        monitor_binary_process_execute_until_return(&command);
+        monitor_binary_process_execute_until_return(command);
 
     } else if (command_type == e_MON_CMD_PALETTE_GET) {
-        monitor_binary_process_palette_get(&command);
+        monitor_binary_process_palette_get(command);
 
     } else if (command_type == e_MON_CMD_JOYPORT_SET) {
-        monitor_binary_process_joyport_set(&command);
+        monitor_binary_process_joyport_set(command);
 
     } else if (command_type == e_MON_CMD_USERPORT_SET) {
-        monitor_binary_process_userport_set(&command);
+        monitor_binary_process_userport_set(command);
 
     } else if (command_type == e_MON_CMD_BANKS_AVAILABLE) {
-        monitor_binary_process_banks_available(&command);
+        monitor_binary_process_banks_available(command);
     } else if (command_type == e_MON_CMD_REGISTERS_AVAILABLE) {
-        monitor_binary_process_registers_available(&command);
+        monitor_binary_process_registers_available(command);
     } else if (command_type == e_MON_CMD_DISPLAY_GET) {
-        monitor_binary_process_display_get(&command);
+        monitor_binary_process_display_get(command);
     } else if (command_type == e_MON_CMD_VICE_INFO) {
-        monitor_binary_process_vice_info(&command);
+        monitor_binary_process_vice_info(command);
+    } else if (command_type == e_MON_CMD_HOSTPROFILE_GET) {
+        monitor_binary_process_hostprofile_get(command);
+    } else if (command_type == e_MON_CMD_BATCH) {
+        monitor_binary_process_batch(command);
+    } else if (command_type == e_MON_CMD_SUBSCRIBE) {
+        monitor_binary_process_subscribe(command);
 
     } else if (command_type == e_MON_CMD_EXIT) {
-        monitor_binary_process_exit(&command);
+        monitor_binary_process_exit(command);
     } else if (command_type == e_MON_CMD_QUIT) {
-        monitor_binary_process_quit(&command);
+        monitor_binary_process_quit(command);
     } else if (command_type == e_MON_CMD_RESET) {
-        monitor_binary_process_reset(&command);
+        monitor_binary_process_reset(command);
     } else if (command_type == e_MON_CMD_AUTOSTART) {
-        monitor_binary_process_autostart(&command);
+        monitor_binary_process_autostart(command);
 
     } else {
-        monitor_binary_error(e_MON_ERR_CMD_INVALID_TYPE, command.request_id);
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_TYPE, command->request_id);
         log_message(LOG_DEFAULT,
                 "monitor_network binary command: unknown command %u, "
                 "skipping command length of %u",
-                command.type, command.length);
+                command->type, command->length);
     }
+}
+
+static void monitor_binary_process_command(unsigned char * pbuffer)
+{
+    binary_command_t command;
+
+    command.api_version = (uint8_t)pbuffer[1];
+
+    command.request_id = little_endian_to_uint32(&pbuffer[6]);
+
+    if (command.api_version < 0x01 || command.api_version > 0x02) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_API_VERSION, command.request_id);
+        return;
+    }
+
+    /* Ensure drive CPU emulation is up to date with main cpu CLOCK. */
+    drive_cpu_execute_all(maincpu_clk);
+
+    command.length = little_endian_to_uint32(&pbuffer[2]);
+
+    command.type = pbuffer[10];
+    command.body = &pbuffer[11];
+
+    monitor_binary_dispatch_command(&command);
 
     pbuffer[0] = 0;
 }
@@ -1919,6 +2367,10 @@ void monitor_check_binary(void)
 {
 }
 
+void monitor_binary_vsync(void)
+{
+}
+
 int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length)
 {
     return 0;
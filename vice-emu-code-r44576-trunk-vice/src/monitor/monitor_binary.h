@@ -43,6 +43,7 @@ void monitor_binary_event_opened(void);
 void monitor_binary_event_closed(void);
 
 void monitor_check_binary(void);
+void monitor_binary_vsync(void);
 
 int monitor_binary_receive(unsigned char *buffer, size_t buffer_length);
 int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length);
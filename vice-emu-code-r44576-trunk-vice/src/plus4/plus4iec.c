@@ -32,6 +32,7 @@
 #include "drive.h"
 #include "maincpu.h"
 #include "iecbus.h"
+#include "iecbustrace.h"
 #include "iecdrive.h"
 #include "plus4iec.h"
 #include "types.h"
@@ -52,6 +53,8 @@ void iec_update_ports(void)
     }
 
     iecbus.drv_port = (((iecbus.cpu_port >> 4) & 0x4) | (iecbus.cpu_port >> 7) | ((iecbus.cpu_bus << 3) & 0x80));
+
+    IECBUSTRACE_UPDATE(&iecbus);
 }
 
 void iec_update_ports_embedded(void)
@@ -28,6 +28,7 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "videoarch.h"
 
@@ -105,6 +106,45 @@ inline static void refresh_canvas(raster_t *raster)
     update_area->is_null = 1;
 }
 
+/* The raster cache is not used anymore, so find the lines of the draw buffer
+   that changed since the last frame by comparing it with a copy.  */
+static void update_dirty_lines(raster_t *raster)
+{
+    draw_buffer_t *draw_buffer = raster->canvas->draw_buffer;
+    unsigned int pitch = draw_buffer->draw_buffer_pitch;
+    unsigned int height = draw_buffer->draw_buffer_height;
+    size_t size = (size_t)pitch * height;
+    uint8_t *src, *shadow;
+    unsigned int y;
+
+    if (raster->canvas->videoconfig->interlaced) {
+        /* the draw buffer alternates between two fields, start over
+           once interlace is turned off again */
+        raster->dirty_shadow_size = 0;
+        return;
+    }
+
+    if (raster->dirty_shadow_size != size) {
+        raster->dirty_shadow = lib_realloc(raster->dirty_shadow, size);
+        raster->dirty_shadow_size = size;
+        draw_buffer->dirty_lines = lib_realloc(draw_buffer->dirty_lines, height);
+        memcpy(raster->dirty_shadow, draw_buffer->draw_buffer, size);
+        memset(draw_buffer->dirty_lines, 1, height);
+        return;
+    }
+
+    src = draw_buffer->draw_buffer;
+    shadow = raster->dirty_shadow;
+    for (y = 0; y < height; y++) {
+        if (memcmp(src, shadow, pitch) != 0) {
+            memcpy(shadow, src, pitch);
+            draw_buffer->dirty_lines[y] = 1;
+        }
+        src += pitch;
+        shadow += pitch;
+    }
+}
+
 void raster_canvas_handle_end_of_frame(raster_t *raster)
 {
     if (video_disabled_mode) {
@@ -120,6 +160,9 @@ void raster_canvas_handle_end_of_frame(raster_t *raster)
     }
 
     if (raster->dont_cache) {
+        if (raster->canvas->videoconfig->partial_render) {
+            update_dirty_lines(raster);
+        }
         video_canvas_refresh_all(raster->canvas);
     } else {
         refresh_canvas(raster);
@@ -138,9 +181,15 @@ void raster_canvas_init(raster_t *raster)
     raster->update_area = lib_malloc(sizeof(raster_canvas_area_t));
 
     raster->update_area->is_null = 1;
+
+    raster->dirty_shadow = NULL;
+    raster->dirty_shadow_size = 0;
 }
 
 void raster_canvas_shutdown(raster_t *raster)
 {
     lib_free(raster->update_area);
+    lib_free(raster->dirty_shadow);
+    raster->dirty_shadow = NULL;
+    raster->dirty_shadow_size = 0;
 }
@@ -161,6 +161,12 @@ struct raster_s {
     /* Area to update.  */
     struct raster_canvas_area_s *update_area;
 
+    /* Copy of the draw buffer as of the last frame, used to find the lines
+       that changed when the canvas can render only those (see
+       `video_render_config_t.partial_render').  */
+    uint8_t *dirty_shadow;
+    size_t dirty_shadow_size;
+
     /* This is a bit mask representing each pixel on the screen (1 =
        foreground, 0 = background) and is used both for sprite-background
        collision checking and background sprite drawing.  When cache is
@@ -0,0 +1,552 @@
+/*
+ * rewind.c - In-memory ring of machine states for rewinding.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+ * Every RewindInterval frames a snapshot of the machine is written to
+ * memory (see snapshot_memory_enable()).  Most of the machine does not
+ * change between two snapshots, and as the modules are always written in
+ * the same order, most bytes stay at the same offset.  So a state is only
+ * stored completely now and then (a keyframe); the states after it are
+ * XORed against the keyframe and only the runs of changed bytes are kept.
+ *
+ * The oldest states are dropped when the ring grows beyond RewindBufferSize.
+ * Disk images are not part of the states, rewinding does not undo writes
+ * to them.
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cmdline.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "network.h"
+#include "resources.h"
+#include "rewind.h"
+#include "snapshot.h"
+#include "types.h"
+#include "vice-event.h"
+
+/* Pages of the snapshot that did not change are skipped with a single
+   memcmp().  */
+#define REWIND_PAGE_SIZE        256
+
+/* Unchanged bytes needed to end a run of changed ones.  */
+#define REWIND_MIN_SKIP         8
+
+/* A state is stored as a keyframe if its delta would be bigger than this
+   fraction of the snapshot, or if its keyframe is this many states old.  */
+#define REWIND_KEYFRAME_RATIO   4
+#define REWIND_KEYFRAME_MAX     32
+
+/* Room for the two lengths in front of a run.  */
+#define REWIND_RUN_HEADER_MAX   20
+
+typedef struct rewind_state_s {
+    /* complete snapshot for keyframes, else the delta */
+    uint8_t *data;
+    size_t size;
+
+    /* size of the complete snapshot */
+    size_t image_size;
+
+    /* frame the state was taken at */
+    unsigned int frame;
+
+    /* Flag: is this a keyframe?  The delta of the other states is against
+       the nearest keyframe before them.  */
+    int keyframe;
+} rewind_state_t;
+
+/* Oldest first, the first one is always a keyframe.  */
+static rewind_state_t *states = NULL;
+static unsigned int num_states = 0;
+static unsigned int num_states_alloc = 0;
+static size_t states_bytes = 0;
+
+static unsigned int frame_count = 0;
+static unsigned int frames_to_capture = 1;
+static int capture_pending = 0;
+static int capture_failed = 0;
+
+/* ------------------------------------------------------------------------- */
+
+static int rewind_buffer_size = 0;
+static int rewind_interval = 50;
+
+static void rewind_clear(void);
+static void rewind_trim(void);
+
+static int set_rewind_buffer_size(int val, void *param)
+{
+    if (val < 0 || val > 4096) {
+        return -1;
+    }
+
+    rewind_buffer_size = val;
+    capture_failed = 0;
+    frames_to_capture = rewind_interval;
+
+    if (val == 0) {
+        rewind_clear();
+    } else {
+        rewind_trim();
+    }
+    return 0;
+}
+
+static int set_rewind_interval(int val, void *param)
+{
+    if (val < 1 || val > 3000) {
+        return -1;
+    }
+
+    rewind_interval = val;
+    frames_to_capture = val;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "RewindBufferSize", 0, RES_EVENT_NO, NULL,
+      &rewind_buffer_size, set_rewind_buffer_size, NULL },
+    { "RewindInterval", 50, RES_EVENT_NO, NULL,
+      &rewind_interval, set_rewind_interval, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int rewind_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-rewindbuffer", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RewindBufferSize", NULL,
+      "<MiB>", "Set memory for the rewind history (0: rewinding is off)" },
+    { "-rewindinterval", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RewindInterval", NULL,
+      "<frames>", "Set number of frames between two states of the rewind history" },
+    CMDLINE_LIST_END
+};
+
+int rewind_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void rewind_shutdown(void)
+{
+    rewind_clear();
+    lib_free(states);
+    states = NULL;
+    num_states_alloc = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint8_t *rewind_put_length(uint8_t *p, size_t value)
+{
+    while (value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+static const uint8_t *rewind_get_length(const uint8_t *p, const uint8_t *end, size_t *value)
+{
+    size_t v = 0;
+    unsigned int shift = 0;
+
+    while (p < end && shift < sizeof(size_t) * 8) {
+        uint8_t b = *p++;
+
+        v |= (size_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            return p;
+        }
+        shift += 7;
+    }
+    return NULL;
+}
+
+/* Store `image' as runs of unchanged bytes (just their number) and
+   changed bytes (XORed with `key').  Returns the size of the delta, or 0
+   if it does not fit into `limit' bytes.  */
+static size_t rewind_delta_encode(const uint8_t *key, size_t key_size,
+                                  const uint8_t *image, size_t size,
+                                  uint8_t *out, size_t limit)
+{
+    size_t common = key_size < size ? key_size : size;
+    size_t pos = 0;
+    uint8_t *p = out;
+
+    while (pos < size) {
+        size_t start = pos, skip, changed, i;
+
+        while (pos < common) {
+            if ((pos % REWIND_PAGE_SIZE) == 0
+                && pos + REWIND_PAGE_SIZE <= common
+                && memcmp(image + pos, key + pos, REWIND_PAGE_SIZE) == 0) {
+                pos += REWIND_PAGE_SIZE;
+            } else if (image[pos] == key[pos]) {
+                pos++;
+            } else {
+                break;
+            }
+        }
+        skip = pos - start;
+
+        start = pos;
+        while (pos < size) {
+            size_t run = 0;
+
+            while (pos + run < common && run < REWIND_MIN_SKIP
+                   && image[pos + run] == key[pos + run]) {
+                run++;
+            }
+            if (run == REWIND_MIN_SKIP || (run > 0 && pos + run == size)) {
+                break;
+            }
+            pos += run > 0 ? run : 1;
+        }
+        changed = pos - start;
+
+        if ((size_t)(p - out) + REWIND_RUN_HEADER_MAX + changed > limit) {
+            return 0;
+        }
+
+        p = rewind_put_length(p, skip);
+        p = rewind_put_length(p, changed);
+        for (i = 0; i < changed; i++) {
+            p[i] = image[start + i] ^ (start + i < common ? key[start + i] : 0);
+        }
+        p += changed;
+    }
+
+    return (size_t)(p - out);
+}
+
+static int rewind_delta_decode(const uint8_t *key, size_t key_size,
+                               const uint8_t *delta, size_t delta_size,
+                               uint8_t *image, size_t size)
+{
+    const uint8_t *p = delta;
+    const uint8_t *end = delta + delta_size;
+    size_t pos = 0, skip, changed, i;
+
+    while (pos < size) {
+        p = rewind_get_length(p, end, &skip);
+        if (p == NULL || skip > size - pos || pos + skip > key_size) {
+            return -1;
+        }
+        memcpy(image + pos, key + pos, skip);
+        pos += skip;
+
+        p = rewind_get_length(p, end, &changed);
+        if (p == NULL || changed > size - pos || changed > (size_t)(end - p)) {
+            return -1;
+        }
+        for (i = 0; i < changed; i++) {
+            image[pos + i] = p[i] ^ (pos + i < key_size ? key[pos + i] : 0);
+        }
+        pos += changed;
+        p += changed;
+    }
+
+    return 0;
+}
+
+static unsigned int rewind_keyframe_of(unsigned int n)
+{
+    while (!states[n].keyframe) {
+        n--;
+    }
+    return n;
+}
+
+/* Returns the complete snapshot of state `n', free it with lib_free().  */
+static uint8_t *rewind_decode(unsigned int n)
+{
+    rewind_state_t *state = &states[n];
+    rewind_state_t *key;
+    uint8_t *image;
+
+    image = lib_malloc(state->image_size);
+    if (state->keyframe) {
+        memcpy(image, state->data, state->size);
+        return image;
+    }
+
+    key = &states[rewind_keyframe_of(n)];
+    if (rewind_delta_decode(key->data, key->size, state->data, state->size,
+                            image, state->image_size) < 0) {
+        lib_free(image);
+        return NULL;
+    }
+    return image;
+}
+
+static void rewind_clear(void)
+{
+    unsigned int n;
+
+    for (n = 0; n < num_states; n++) {
+        lib_free(states[n].data);
+    }
+    num_states = 0;
+    states_bytes = 0;
+}
+
+/* Drop the states after state `n'.  */
+static void rewind_drop_after(unsigned int n)
+{
+    while (num_states > n + 1) {
+        num_states--;
+        states_bytes -= states[num_states].size;
+        lib_free(states[num_states].data);
+    }
+}
+
+static void rewind_drop_oldest(void)
+{
+    if (num_states > 1 && !states[1].keyframe) {
+        /* the next state becomes the keyframe of the ones after it */
+        uint8_t *image = rewind_decode(1);
+
+        if (image == NULL) {
+            log_error(LOG_DEFAULT, "Rewind: history is corrupt, clearing it.");
+            rewind_clear();
+            return;
+        }
+        states_bytes += states[1].image_size - states[1].size;
+        lib_free(states[1].data);
+        states[1].data = image;
+        states[1].size = states[1].image_size;
+        states[1].keyframe = 1;
+    }
+
+    states_bytes -= states[0].size;
+    lib_free(states[0].data);
+    num_states--;
+    memmove(states, states + 1, num_states * sizeof(rewind_state_t));
+}
+
+static void rewind_trim(void)
+{
+    size_t budget = (size_t)rewind_buffer_size << 20;
+
+    /* the newest state is kept even if it does not fit on its own */
+    while (num_states > 1 && states_bytes > budget) {
+        rewind_drop_oldest();
+    }
+}
+
+/* Add a state, takes over `image'.  */
+static void rewind_add_state(uint8_t *image, size_t size)
+{
+    rewind_state_t *state;
+
+    if (num_states == num_states_alloc) {
+        num_states_alloc = num_states_alloc ? num_states_alloc * 2 : 64;
+        states = lib_realloc(states, num_states_alloc * sizeof(rewind_state_t));
+    }
+
+    state = &states[num_states];
+    state->data = image;
+    state->size = size;
+    state->image_size = size;
+    state->frame = frame_count;
+    state->keyframe = 1;
+
+    if (num_states > 0) {
+        unsigned int k = rewind_keyframe_of(num_states - 1);
+
+        if (num_states - k < REWIND_KEYFRAME_MAX) {
+            size_t limit = size / REWIND_KEYFRAME_RATIO;
+            uint8_t *delta = lib_malloc(limit + 1);
+            size_t delta_size;
+
+            delta_size = rewind_delta_encode(states[k].data, states[k].size,
+                                             image, size, delta, limit);
+            if (delta_size > 0) {
+                state->data = lib_realloc(delta, delta_size);
+                state->size = delta_size;
+                state->keyframe = 0;
+                lib_free(image);
+            } else {
+                lib_free(delta);
+            }
+        }
+    }
+
+    num_states++;
+    states_bytes += state->size;
+    rewind_trim();
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void rewind_capture_trap(uint16_t addr, void *data)
+{
+    uint8_t *image;
+    size_t size;
+    int err;
+
+    capture_pending = 0;
+    if (rewind_buffer_size == 0) {
+        return;
+    }
+
+    /* no disks and no ROMs, they would only take up room */
+    snapshot_memory_enable(1);
+    err = machine_write_snapshot("", 0, 0, 0);
+    snapshot_memory_enable(0);
+    image = snapshot_memory_get_image(&size);
+
+    if (err < 0 || image == NULL) {
+        log_error(LOG_DEFAULT, "Rewind: cannot take a snapshot (error %d), history is off until RewindBufferSize is set again.",
+                  snapshot_get_error());
+        snapshot_set_error(SNAPSHOT_NO_ERROR);
+        lib_free(image);
+        capture_failed = 1;
+        return;
+    }
+
+    rewind_add_state(image, size);
+}
+
+void rewind_vsync(void)
+{
+    frame_count++;
+
+    if (rewind_buffer_size == 0 || capture_failed || capture_pending) {
+        return;
+    }
+
+    if (frames_to_capture > 1) {
+        frames_to_capture--;
+        return;
+    }
+    frames_to_capture = rewind_interval;
+
+    if (network_connected() || event_playback_active()) {
+        return;
+    }
+
+    capture_pending = 1;
+    interrupt_maincpu_trigger_trap(rewind_capture_trap, NULL);
+}
+
+int rewind_frames(unsigned int frames)
+{
+    unsigned int target, n, gone;
+    uint8_t *image;
+    int err;
+
+    if (num_states == 0) {
+        return -1;
+    }
+
+    /* events and netplay cannot go back in time */
+    if (network_connected() || event_record_active() || event_playback_active()) {
+        log_error(LOG_DEFAULT, "Rewind: not possible while recording or playing back events or during netplay.");
+        return -1;
+    }
+
+    target = frames < frame_count ? frame_count - frames : 0;
+    for (n = num_states - 1; n > 0 && states[n].frame > target; n--) {
+    }
+
+    image = rewind_decode(n);
+    if (image == NULL) {
+        log_error(LOG_DEFAULT, "Rewind: history is corrupt, clearing it.");
+        rewind_clear();
+        return -1;
+    }
+
+    snapshot_memory_set_image(image, states[n].image_size);
+    snapshot_memory_enable(1);
+    err = machine_read_snapshot("", 0);
+    snapshot_memory_enable(0);
+    snapshot_memory_set_image(NULL, 0);
+    lib_free(image);
+
+    if (err < 0) {
+        log_error(LOG_DEFAULT, "Rewind: cannot restore the state of frame %u (error %d).",
+                  states[n].frame, snapshot_get_error());
+        snapshot_set_error(SNAPSHOT_NO_ERROR);
+        rewind_clear();
+        return -1;
+    }
+
+    gone = frame_count - states[n].frame;
+    frame_count = states[n].frame;
+    frames_to_capture = rewind_interval;
+
+    /* they belong to a future that will not happen anymore */
+    rewind_drop_after(n);
+
+    return (int)gone;
+}
+
+static void rewind_trap(uint16_t addr, void *data)
+{
+    rewind_frames(vice_ptr_to_uint(data));
+}
+
+void rewind_trigger(unsigned int frames)
+{
+    interrupt_maincpu_trigger_trap(rewind_trap, uint_to_void_ptr(frames));
+}
+
+unsigned int rewind_get_interval(void)
+{
+    return (unsigned int)rewind_interval;
+}
+
+void rewind_get_info(rewind_info_t *info)
+{
+    unsigned int n;
+
+    memset(info, 0, sizeof(rewind_info_t));
+    info->states = num_states;
+    info->bytes = states_bytes;
+
+    if (num_states > 0) {
+        info->oldest = frame_count - states[0].frame;
+        info->newest = frame_count - states[num_states - 1].frame;
+    }
+    for (n = 0; n < num_states; n++) {
+        if (states[n].keyframe) {
+            info->keyframes++;
+        }
+    }
+}
@@ -0,0 +1,63 @@
+/*
+ * rewind.h - In-memory ring of machine states for rewinding.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_REWIND_H
+#define VICE_REWIND_H
+
+#include "types.h"
+
+typedef struct rewind_info_s {
+    /* number of states in the ring */
+    unsigned int states;
+    /* of which are stored completely */
+    unsigned int keyframes;
+    /* age of the oldest and newest state in frames */
+    unsigned int oldest;
+    unsigned int newest;
+    /* memory used by the ring */
+    size_t bytes;
+} rewind_info_t;
+
+int rewind_resources_init(void);
+int rewind_cmdline_options_init(void);
+void rewind_shutdown(void);
+
+/* called at every vsync, takes a state every RewindInterval frames */
+void rewind_vsync(void);
+
+/* Go back to the newest state that is at least `frames' frames old (or the
+   oldest one there is).  Must be called between two instructions, like
+   machine_read_snapshot().  Returns the number of frames actually gone
+   back, -1 if there is no state to go back to.  */
+int rewind_frames(unsigned int frames);
+
+/* The same from anywhere in the emulation thread, done at the next
+   instruction boundary.  */
+void rewind_trigger(unsigned int frames);
+
+/* one RewindInterval, the step size for the UI */
+unsigned int rewind_get_interval(void);
+
+void rewind_get_info(rewind_info_t *info);
+
+#endif
@@ -38,10 +38,12 @@
 #include "lib.h"
 #include "log.h"
 #include "machine.h"
+#include "machine-video.h"
 #include "palette.h"
 #include "resources.h"
 #include "screenshot.h"
 #include "uiapi.h"
+#include "util.h"
 #include "video.h"
 
 
@@ -54,6 +56,10 @@ static char *reopen_recording_drivername;
 static struct video_canvas_s *reopen_recording_canvas;
 static char *reopen_filename;
 
+/* recording requested before there was a canvas, e.g. on the command line */
+static char *start_recording_drivername = NULL;
+static char *start_recording_filename = NULL;
+
 
 /** \brief  Initialize module
  *
@@ -82,6 +88,10 @@ void screenshot_shutdown(void)
     if (reopen_filename != NULL) {
         lib_free(reopen_filename);
     }
+    lib_free(start_recording_drivername);
+    lib_free(start_recording_filename);
+    start_recording_drivername = NULL;
+    start_recording_filename = NULL;
 }
 
 
@@ -223,6 +233,45 @@ int screenshot_save(const char *drvname, const char *filename,
     return result;
 }
 
+/** \brief  Save a buffer of palette indices like a screenshot
+ *
+ * \param[in]   drvname     name of the graphics output driver
+ * \param[in]   filename    file to save to
+ * \param[in]   width       width of the image, a multiple of 4
+ * \param[in]   height      height of the image
+ * \param[in]   pixels      one palette index per pixel, `width' per line
+ * \param[in]   palette     palette for the indices
+ *
+ * \return  0 on success, -1 on error
+ */
+int screenshot_save_pixels(const char *drvname, const char *filename,
+                           unsigned int width, unsigned int height,
+                           uint8_t *pixels, struct palette_s *palette)
+{
+    screenshot_t screenshot;
+    gfxoutputdrv_t *drv;
+
+    drv = gfxoutput_get_driver(drvname);
+    if (drv == NULL || drv->save == NULL || drv->record != NULL) {
+        return -1;
+    }
+
+    memset(&screenshot, 0, sizeof(screenshot_t));
+    screenshot.palette = palette;
+    screenshot.draw_buffer = pixels;
+    screenshot.draw_buffer_line_size = width;
+    screenshot.max_width = screenshot.debug_width = screenshot.inner_width = width;
+    screenshot.max_height = screenshot.debug_height = screenshot.inner_height = height;
+    screenshot.first_displayed_line = 0;
+    screenshot.last_displayed_line = height - 1;
+    screenshot.size_width = 1;
+    screenshot.size_height = 1;
+    screenshot.dpi_x = 100;
+    screenshot.dpi_y = 100;
+
+    return screenshot_save_core(&screenshot, drv, filename);
+}
+
 #ifdef FEATURE_CPUMEMHISTORY
 int memmap_screenshot_save(const char *drvname, const char *filename, int x_size, int y_size, uint8_t *gfx, uint8_t *palette)
 {
@@ -240,11 +289,40 @@ int memmap_screenshot_save(const char *drvname, const char *filename, int x_size
 }
 #endif
 
+/** \brief  Start recording with the first frame that is drawn
+ *
+ * Used to start recording before the video canvas exists, for example from
+ * the command line.
+ *
+ * \param[in]   drvname     name of the recording driver
+ * \param[in]   filename    file (or other target) to record to
+ *
+ * \return  0 on success, -1 if the driver does not exist
+ */
+int screenshot_start_recording(const char *drvname, const char *filename)
+{
+    if (gfxoutput_get_driver(drvname) == NULL) {
+        return -1;
+    }
+
+    util_string_set(&start_recording_drivername, drvname);
+    util_string_set(&start_recording_filename, filename);
+    return 0;
+}
+
 int screenshot_record(void)
 {
     screenshot_t screenshot;
 
     if (recording_driver == NULL) {
+        if (start_recording_drivername != NULL) {
+            screenshot_save(start_recording_drivername, start_recording_filename,
+                            machine_video_canvas_get(0));
+            lib_free(start_recording_drivername);
+            lib_free(start_recording_filename);
+            start_recording_drivername = NULL;
+            start_recording_filename = NULL;
+        }
         return 0;
     }
 
@@ -127,7 +127,11 @@ typedef struct screenshot_s {
 int screenshot_init(void);
 void screenshot_shutdown(void);
 int screenshot_save(const char *drvname, const char *filename, struct video_canvas_s *canvas);
+int screenshot_save_pixels(const char *drvname, const char *filename,
+                           unsigned int width, unsigned int height,
+                           uint8_t *pixels, struct palette_s *palette);
 int screenshot_record(void);
+int screenshot_start_recording(const char *drvname, const char *filename);
 void screenshot_stop_recording(void);
 int screenshot_is_recording(void);
 void screenshot_prepare_reopen(void);
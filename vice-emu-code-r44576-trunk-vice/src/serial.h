@@ -86,6 +86,7 @@ void serial_trap_init(uint16_t tmpin);
 int serial_trap_attention(void);
 int serial_trap_send(void);
 int serial_trap_receive(void);
+int serial_trap_load(void);
 int serial_trap_ready(void);
 void serial_traps_reset(void);
 void serial_trap_eof_callback_set(void (*func)(void));
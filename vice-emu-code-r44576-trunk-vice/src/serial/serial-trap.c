@@ -53,6 +53,8 @@ extern int traps_enabled_device[MAX_DEVICES]; /* FIXME */
 /* Warning: these are only valid for the VIC20, C64 and C128, but *not* for
    the PET.  (FIXME?)  */
 #define BSOUR 0x95 /* Buffered Character for IEEE Bus */
+#define VERCK 0x93 /* Load or Verify Flag */
+#define EAL   0xae /* End Address of the loaded data */
 
 /* FIXME: code here assumes 4 bits for device number; should be 5? */
 #define DEVNR_MASK      0x0F    /* should be 0x1F */
@@ -275,6 +277,63 @@ int serial_trap_receive(void)
 }
 
 
+/* Replace the byte loop of the Kernal LOAD routine: receive the rest of the
+   file at once and store it the same way the loop does.  The trap has to be
+   placed on the `JSR ACPTR' of the loop and resume at the `BIT STATUS' that
+   checks for EOF, so the Kernal continues the loop if the transfer stopped
+   early.  Verifying is left to the Kernal.  */
+int serial_trap_load(void)
+{
+    unsigned int count;
+    uint16_t addr;
+    uint8_t data = 0;
+
+    if (!device_uses_serial_traps(ActiveDevice) || mem_read(VERCK) != 0) {
+        DBG(("serial_trap_load aborted (dev %d)", ActiveDevice));
+        return 0;
+    }
+
+    DBG(("serial_trap_load (TrapDevice 0x%02x)", TrapDevice));
+
+    if (TrapSecondary == 0) {
+        send_listen_talk_secondary(SECONDARY + 0);
+    }
+
+    for (count = 0; count < 0x10000; count++) {
+        data = serial_iec_bus_read(TrapDevice, TrapSecondary, serial_set_st);
+
+        /* The Kernal drops the byte and tries again on timeout.  */
+        if (serial_get_st() & 0x02) {
+            break;
+        }
+
+        addr = (uint16_t)(mem_read(EAL) | (mem_read(EAL + 1) << 8));
+        mem_store(addr, data);
+        addr++;
+        mem_store(EAL, (uint8_t)(addr & 0xff));
+        mem_store(EAL + 1, (uint8_t)(addr >> 8));
+
+        if (serial_get_st() & 0x40) {
+            if (eof_callback_func != NULL) {
+                eof_callback_func();
+            }
+            break;
+        }
+    }
+
+    mem_store(tmp_in, data);
+
+    /* Set registers like the loop does.  */
+    maincpu_set_a(data);
+    maincpu_set_x(data);
+    maincpu_set_y(0);
+    maincpu_set_carry(0);
+    maincpu_set_interrupt(0);
+
+    return 1;
+}
+
+
 /* Kernal loops serial-port (0xdd00) to see when serial is ready: fake it.
    EEA9 Get serial data and clk in (TKSA subroutine).  */
 
@@ -33,6 +33,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "archdep.h"
 #include "lib.h"
 #include "log.h"
@@ -67,521 +71,407 @@ static const char snapshot_version_magic_string[] = "VICE Version\032";
 #define SNAPSHOT_MAGIC_LEN              19
 #define SNAPSHOT_VERSION_MAGIC_LEN      13
 
-struct snapshot_module_s {
-    /* File descriptor.  */
-    FILE *file;
-
-    /* Flag: are we writing it?  */
-    int write_mode;
-
-    /* Size of the module.  */
-    uint32_t size;
-
-    /* Offset of the module in the file.  */
-    long offset;
+#define SNAPSHOT_MODULE_HEADER_LEN      (SNAPSHOT_MODULE_NAME_LEN + 2 + 4)
 
-    /* Offset of the size field in the file.  */
-    long size_offset;
-};
+/* Set in the size field of a module header if the module data is
+   compressed.  The data then starts with the uncompressed size (dword),
+   followed by the zlib stream.  */
+#define SNAPSHOT_MODULE_COMPRESSED      0x80000000U
 
-struct snapshot_s {
-    /* File descriptor.  */
-    FILE *file;
+/* Set in the major version of the file header if modules may be
+   compressed.  Older versions read bit 31 of the module size as a corrupt
+   size; they reject the unknown major version of such a file instead.  */
+#define SNAPSHOT_MAJOR_COMPRESSED       0x80
 
-    /* Offset of the first module.  */
-    long first_module_offset;
+/* Best ratio deflate can achieve, bounds the size of an inflated module.  */
+#define SNAPSHOT_INFLATE_MAX_RATIO      1032
 
-    /* Flag: are we writing it?  */
-    int write_mode;
-};
+/* Modules smaller than this are never compressed.  */
+#define SNAPSHOT_COMPRESS_MIN_SIZE      256
 
-/* ------------------------------------------------------------------------- */
+/* zlib level used for new modules, 0 = no compression.  */
+static int snapshot_compression = 0;
 
-static int snapshot_write_byte(FILE *f, uint8_t data)
-{
-    current_fpos = ftell(f);
-    if (fputc(data, f) == EOF) {
-        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
-        return -1;
-    }
+/* Modules are serialised into one of these and written to the file with
+   a single fwrite() when they are closed.  When reading, the whole file is
+   loaded into one.  */
+typedef struct snapshot_buffer_s {
+    uint8_t *data;
 
-    return 0;
-}
+    /* Number of bytes used.  */
+    size_t size;
 
-static int snapshot_write_word(FILE *f, uint16_t data)
-{
-    current_fpos = ftell(f);
-    if (snapshot_write_byte(f, (uint8_t)(data & 0xff)) < 0
-        || snapshot_write_byte(f, (uint8_t)(data >> 8)) < 0) {
-        return -1;
-    }
+    /* Number of bytes allocated, 0 if `data' is not owned by the buffer.  */
+    size_t alloc;
 
-    return 0;
-}
+    /* Read position.  */
+    size_t pos;
+} snapshot_buffer_t;
 
-static int snapshot_write_dword(FILE *f, uint32_t data)
-{
-    current_fpos = ftell(f);
-    if (snapshot_write_word(f, (uint16_t)(data & 0xffff)) < 0
-        || snapshot_write_word(f, (uint16_t)(data >> 16)) < 0) {
-        return -1;
-    }
+/* Flag: do snapshot_create() and snapshot_open() work in memory?  */
+static int memory_enabled = 0;
 
-    return 0;
-}
+/* Last snapshot written to memory, or the one to read from memory.  */
+static snapshot_buffer_t memory_image;
 
-static int snapshot_write_qword(FILE *f, uint64_t data)
-{
-    current_fpos = ftell(f);
-    if (snapshot_write_dword(f, (uint32_t)(data & 0xffffffff)) < 0
-        || snapshot_write_dword(f, (uint32_t)(data >> 32)) < 0) {
-        return -1;
-    }
+/* Module header as found in the file.  */
+typedef struct snapshot_index_s {
+    char name[SNAPSHOT_MODULE_NAME_LEN];
+    uint8_t major_version;
+    uint8_t minor_version;
 
-    return 0;
-}
+    /* Offset of the module in the file.  */
+    size_t offset;
 
-static int snapshot_write_double(FILE *f, double data)
-{
-    uint8_t *byte_data = (uint8_t *)&data;
-    int i;
+    /* Size of the module in the file, including the header.  */
+    size_t size;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < sizeof(double); i++) {
-        if (snapshot_write_byte(f, byte_data[i]) < 0) {
-            return -1;
-        }
-    }
-    return 0;
-}
+    /* Flag: is the module data compressed?  */
+    int compressed;
+} snapshot_index_t;
 
-static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char,
-                                        int len)
-{
-    int i, found_zero;
-    uint8_t c;
+struct snapshot_module_s {
+    /* Snapshot the module belongs to.  */
+    snapshot_t *snapshot;
 
-    current_fpos = ftell(f);
-    for (i = found_zero = 0; i < len; i++) {
-        if (!found_zero && s[i] == 0) {
-            found_zero = 1;
-        }
-        c = found_zero ? (uint8_t)pad_char : (uint8_t) s[i];
-        if (snapshot_write_byte(f, c) < 0) {
-            return -1;
-        }
-    }
+    /* Flag: are we writing it?  */
+    int write_mode;
 
-    return 0;
-}
+    /* Header, only written when the module is closed.  */
+    uint8_t name[SNAPSHOT_MODULE_NAME_LEN];
+    uint8_t major_version;
+    uint8_t minor_version;
 
-static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int num)
-{
-    current_fpos = ftell(f);
-    if (num > 0 && fwrite(data, (size_t)num, 1, f) < 1) {
-        snapshot_error = SNAPSHOT_WRITE_BYTE_ARRAY_ERROR;
-        return -1;
-    }
+    /* Offset of the module data in the file (reading only).  */
+    size_t offset;
 
-    return 0;
-}
+    /* Module data, without the header.  */
+    snapshot_buffer_t buf;
+};
 
-static int snapshot_write_word_array(FILE *f, const uint16_t *data, unsigned int num)
-{
-    unsigned int i;
+struct snapshot_s {
+    /* File descriptor (writing only), NULL for a snapshot in memory.  */
+    FILE *file;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_write_word(f, data[i]) < 0) {
-            return -1;
-        }
-    }
+    /* Flag: are we writing it?  */
+    int write_mode;
 
-    return 0;
-}
+    /* Contents of the file (reading), or the snapshot written to memory.  */
+    snapshot_buffer_t buf;
 
-static int snapshot_write_dword_array(FILE *f, const uint32_t *data, unsigned int num)
-{
-    unsigned int i;
+    /* Offset of the first module.  */
+    size_t first_module_offset;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_write_dword(f, data[i]) < 0) {
-            return -1;
-        }
-    }
+    /* Headers of all modules in the file (reading only).  */
+    snapshot_index_t *index;
+    unsigned int num_modules;
 
-    return 0;
-}
+    /* zlib level for the modules (writing), or flag: may modules be
+       compressed (reading)?  */
+    int compression;
+};
 
+/* ------------------------------------------------------------------------- */
 
-static int snapshot_write_string(FILE *f, const char *s)
+static void snapshot_put_word(uint8_t *p, uint16_t data)
 {
-    size_t len, i;
-
-    len = s ? (strlen(s) + 1) : 0;      /* length includes nullbyte */
-
-    current_fpos = ftell(f);
-    if (snapshot_write_word(f, (uint16_t)len) < 0) {
-        return -1;
-    }
-
-    for (i = 0; i < len; i++) {
-        if (snapshot_write_byte(f, s[i]) < 0) {
-            return -1;
-        }
-    }
-
-    return (int)(len + sizeof(uint16_t));
+    p[0] = (uint8_t)(data & 0xff);
+    p[1] = (uint8_t)(data >> 8);
 }
 
-static int snapshot_read_byte(FILE *f, uint8_t *b_return)
+static void snapshot_put_dword(uint8_t *p, uint32_t data)
 {
-    int c;
-
-    current_fpos = ftell(f);
-    c = fgetc(f);
-    if (c == EOF) {
-        snapshot_error = SNAPSHOT_READ_EOF_ERROR;
-        return -1;
-    }
-    *b_return = (uint8_t)c;
-    return 0;
+    p[0] = (uint8_t)(data & 0xff);
+    p[1] = (uint8_t)((data >> 8) & 0xff);
+    p[2] = (uint8_t)((data >> 16) & 0xff);
+    p[3] = (uint8_t)(data >> 24);
 }
 
-static int snapshot_read_word(FILE *f, uint16_t *w_return)
+static uint16_t snapshot_get_word(const uint8_t *p)
 {
-    uint8_t lo, hi;
-
-    current_fpos = ftell(f);
-    if (snapshot_read_byte(f, &lo) < 0 || snapshot_read_byte(f, &hi) < 0) {
-        return -1;
-    }
-
-    *w_return = lo | (hi << 8);
-    return 0;
+    return (uint16_t)(p[0] | (p[1] << 8));
 }
 
-static int snapshot_read_dword(FILE *f, uint32_t *dw_return)
+static uint32_t snapshot_get_dword(const uint8_t *p)
 {
-    uint16_t lo, hi;
-
-    current_fpos = ftell(f);
-    if (snapshot_read_word(f, &lo) < 0 || snapshot_read_word(f, &hi) < 0) {
-        return -1;
-    }
-
-    *dw_return = lo | (hi << 16);
-    return 0;
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
 }
 
-static int snapshot_read_qword(FILE *f, uint64_t *qw_return)
+static void snapshot_pad_string(uint8_t *dest, const char *s, uint8_t pad_char, int len)
 {
-    uint32_t lo, hi;
-
-    current_fpos = ftell(f);
-    if (snapshot_read_dword(f, &lo) < 0 || snapshot_read_dword(f, &hi) < 0) {
-        return -1;
-    }
-
-    *qw_return = lo | ((uint64_t)hi << 32);
-    return 0;
-}
+    int i, found_zero;
 
-static int snapshot_read_double(FILE *f, double *d_return)
-{
-    int i;
-    int c;
-    double val;
-    uint8_t *byte_val = (uint8_t *)&val;
-
-    current_fpos = ftell(f);
-    for (i = 0; i < sizeof(double); i++) {
-        c = fgetc(f);
-        if (c == EOF) {
-            snapshot_error = SNAPSHOT_READ_EOF_ERROR;
-            return -1;
+    for (i = found_zero = 0; i < len; i++) {
+        if (!found_zero && s[i] == 0) {
+            found_zero = 1;
         }
-        byte_val[i] = (uint8_t)c;
+        dest[i] = found_zero ? pad_char : (uint8_t)s[i];
     }
-    *d_return = val;
-    return 0;
 }
 
-static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num)
+/* Append `num' bytes to `b' and return a pointer to them.  */
+static uint8_t *snapshot_buffer_append(snapshot_buffer_t *b, size_t num)
 {
-    current_fpos = ftell(f);
-    if (num > 0 && fread(b_return, (size_t)num, 1, f) < 1) {
-        snapshot_error = SNAPSHOT_READ_BYTE_ARRAY_ERROR;
-        return -1;
-    }
-
-    return 0;
-}
+    uint8_t *p;
 
-static int snapshot_read_word_array(FILE *f, uint16_t *w_return, unsigned int num)
-{
-    unsigned int i;
+    if (b->size + num > b->alloc) {
+        size_t alloc = b->alloc ? b->alloc : 256;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_read_word(f, w_return + i) < 0) {
-            return -1;
+        while (alloc < b->size + num) {
+            alloc *= 2;
         }
+        b->data = lib_realloc(b->data, alloc);
+        b->alloc = alloc;
     }
 
-    return 0;
+    p = b->data + b->size;
+    b->size += num;
+    return p;
 }
 
-static int snapshot_read_dword_array(FILE *f, uint32_t *dw_return, unsigned int num)
+/* Consume `num' bytes from `b' and return a pointer to them, or NULL if
+   there are not enough left.  `base' is the offset of the buffer in the
+   file, for error messages.  */
+static const uint8_t *snapshot_buffer_read(snapshot_buffer_t *b, size_t base, size_t num)
 {
-    unsigned int i;
+    const uint8_t *p;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < num; i++) {
-        if (snapshot_read_dword(f, dw_return + i) < 0) {
-            return -1;
-        }
+    current_fpos = base + b->pos;
+    if (num > b->size - b->pos) {
+        return NULL;
     }
 
-    return 0;
+    p = b->data + b->pos;
+    b->pos += num;
+    return p;
 }
 
-static int snapshot_read_string(FILE *f, char **s)
+static void snapshot_buffer_free(snapshot_buffer_t *b)
 {
-    int i, len;
-    uint16_t w;
-    char *p = NULL;
-
-    /* first free the previous string */
-    lib_free(*s);
-    *s = NULL;      /* don't leave a bogus pointer */
-
-    current_fpos = ftell(f);
-    if (snapshot_read_word(f, &w) < 0) {
-        return -1;
-    }
-
-    len = (int)w;
-
-    if (len) {
-        p = lib_malloc(len);
-        *s = p;
-
-        for (i = 0; i < len; i++) {
-            if (snapshot_read_byte(f, (uint8_t *)(p + i)) < 0) {
-                p[0] = 0;
-                return -1;
-            }
-        }
-        p[len - 1] = 0;   /* just to be save */
+    if (b->alloc > 0) {
+        lib_free(b->data);
     }
-    return 0;
+    memset(b, 0, sizeof(snapshot_buffer_t));
 }
 
 /* ------------------------------------------------------------------------- */
 
 int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 {
-    if (snapshot_write_byte(m->file, b) < 0) {
-        return -1;
-    }
-
-    m->size++;
+    *snapshot_buffer_append(&m->buf, sizeof(uint8_t)) = b;
     return 0;
 }
 
 int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 {
-    if (snapshot_write_word(m->file, w) < 0) {
-        return -1;
-    }
-
-    m->size += 2;
+    snapshot_put_word(snapshot_buffer_append(&m->buf, sizeof(uint16_t)), w);
     return 0;
 }
 
 int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 {
-    if (snapshot_write_dword(m->file, dw) < 0) {
-        return -1;
-    }
-
-    m->size += 4;
+    snapshot_put_dword(snapshot_buffer_append(&m->buf, sizeof(uint32_t)), dw);
     return 0;
 }
 
 int snapshot_module_write_qword(snapshot_module_t *m, uint64_t qw)
 {
-    if (snapshot_write_qword(m->file, qw) < 0) {
-        return -1;
-    }
+    uint8_t *p = snapshot_buffer_append(&m->buf, sizeof(uint64_t));
 
-    m->size += 8;
+    snapshot_put_dword(p, (uint32_t)(qw & 0xffffffff));
+    snapshot_put_dword(p + 4, (uint32_t)(qw >> 32));
     return 0;
 }
 
 int snapshot_module_write_double(snapshot_module_t *m, double db)
 {
-    if (snapshot_write_double(m->file, db) < 0) {
-        return -1;
-    }
-
-    m->size += 8;
+    memcpy(snapshot_buffer_append(&m->buf, sizeof(double)), &db, sizeof(double));
     return 0;
 }
 
 int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uint8_t pad_char, int len)
 {
-    if (snapshot_write_padded_string(m->file, s, (uint8_t)pad_char, len) < 0) {
-        return -1;
+    if (len > 0) {
+        snapshot_pad_string(snapshot_buffer_append(&m->buf, (size_t)len), s, pad_char, len);
     }
-
-    m->size += len;
     return 0;
 }
 
 int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, unsigned int num)
 {
-    if (snapshot_write_byte_array(m->file, b, num) < 0) {
-        return -1;
+    if (num > 0) {
+        memcpy(snapshot_buffer_append(&m->buf, (size_t)num), b, (size_t)num);
     }
-
-    m->size += num;
     return 0;
 }
 
 int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, unsigned int num)
 {
-    if (snapshot_write_word_array(m->file, w, num) < 0) {
-        return -1;
-    }
+    uint8_t *p = snapshot_buffer_append(&m->buf, (size_t)num * sizeof(uint16_t));
+    unsigned int i;
 
-    m->size += num * sizeof(uint16_t);
+    for (i = 0; i < num; i++) {
+        snapshot_put_word(p + i * sizeof(uint16_t), w[i]);
+    }
     return 0;
 }
 
 int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw, unsigned int num)
 {
-    if (snapshot_write_dword_array(m->file, dw, num) < 0) {
-        return -1;
-    }
+    uint8_t *p = snapshot_buffer_append(&m->buf, (size_t)num * sizeof(uint32_t));
+    unsigned int i;
 
-    m->size += num * sizeof(uint32_t);
+    for (i = 0; i < num; i++) {
+        snapshot_put_dword(p + i * sizeof(uint32_t), dw[i]);
+    }
     return 0;
 }
 
 int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 {
-    int len;
-    len = snapshot_write_string(m->file, s);
-    if (len < 0) {
+    size_t len;
+
+    len = s ? (strlen(s) + 1) : 0;      /* length includes nullbyte */
+    if (len > 0xffff) {
         snapshot_error = SNAPSHOT_ILLEGAL_STRING_LENGTH_ERROR;
         return -1;
     }
 
-    m->size += len;
-    return 0;
+    snapshot_module_write_word(m, (uint16_t)len);
+    return snapshot_module_write_byte_array(m, (const uint8_t *)s, (unsigned int)len);
 }
 
 /* ------------------------------------------------------------------------- */
 
-int snapshot_module_read_byte(snapshot_module_t *m, uint8_t *b_return)
+static const uint8_t *snapshot_module_read(snapshot_module_t *m, size_t num)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint8_t) > m->offset + m->size) {
+    const uint8_t *p = snapshot_buffer_read(&m->buf, m->offset, num);
+
+    if (p == NULL) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
-        return -1;
     }
+    return p;
+}
 
-    return snapshot_read_byte(m->file, b_return);
+int snapshot_module_read_byte(snapshot_module_t *m, uint8_t *b_return)
+{
+    const uint8_t *p = snapshot_module_read(m, sizeof(uint8_t));
+
+    if (p == NULL) {
+        return -1;
+    }
+    *b_return = p[0];
+    return 0;
 }
 
 int snapshot_module_read_word(snapshot_module_t *m, uint16_t *w_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    const uint8_t *p = snapshot_module_read(m, sizeof(uint16_t));
+
+    if (p == NULL) {
         return -1;
     }
-
-    return snapshot_read_word(m->file, w_return);
+    *w_return = snapshot_get_word(p);
+    return 0;
 }
 
 int snapshot_module_read_dword(snapshot_module_t *m, uint32_t *dw_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint32_t) > m->offset + m->size) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    const uint8_t *p = snapshot_module_read(m, sizeof(uint32_t));
+
+    if (p == NULL) {
         return -1;
     }
-
-    return snapshot_read_dword(m->file, dw_return);
+    *dw_return = snapshot_get_dword(p);
+    return 0;
 }
 
 int snapshot_module_read_qword(snapshot_module_t *m, uint64_t *qw_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint64_t) > m->offset + m->size) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    const uint8_t *p = snapshot_module_read(m, sizeof(uint64_t));
+
+    if (p == NULL) {
         return -1;
     }
-
-    return snapshot_read_qword(m->file, qw_return);
+    *qw_return = snapshot_get_dword(p) | ((uint64_t)snapshot_get_dword(p + 4) << 32);
+    return 0;
 }
 
 int snapshot_module_read_double(snapshot_module_t *m, double *db_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(double) > m->offset + m->size) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    const uint8_t *p = snapshot_module_read(m, sizeof(double));
+
+    if (p == NULL) {
         return -1;
     }
-
-    return snapshot_read_double(m->file, db_return);
+    memcpy(db_return, p, sizeof(double));
+    return 0;
 }
 
 int snapshot_module_read_byte_array(snapshot_module_t *m, uint8_t *b_return, unsigned int num)
 {
-    current_fpos = ftell(m->file);
-    if ((long)(ftell(m->file) + num) > (long)(m->offset + m->size)) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    const uint8_t *p = snapshot_module_read(m, (size_t)num);
+
+    if (p == NULL) {
         return -1;
     }
-
-    return snapshot_read_byte_array(m->file, b_return, num);
+    if (num > 0) {
+        memcpy(b_return, p, (size_t)num);
+    }
+    return 0;
 }
 
 int snapshot_module_read_word_array(snapshot_module_t *m, uint16_t *w_return, unsigned int num)
 {
-    if ((long)(ftell(m->file) + num * sizeof(uint16_t)) > (long)(m->offset + m->size)) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    const uint8_t *p = snapshot_module_read(m, (size_t)num * sizeof(uint16_t));
+    unsigned int i;
+
+    if (p == NULL) {
         return -1;
     }
-
-    return snapshot_read_word_array(m->file, w_return, num);
+    for (i = 0; i < num; i++) {
+        w_return[i] = snapshot_get_word(p + i * sizeof(uint16_t));
+    }
+    return 0;
 }
 
 int snapshot_module_read_dword_array(snapshot_module_t *m, uint32_t *dw_return, unsigned int num)
 {
-    current_fpos = ftell(m->file);
-    if ((long)(ftell(m->file) + num * sizeof(uint32_t)) > (long)(m->offset + m->size)) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    const uint8_t *p = snapshot_module_read(m, (size_t)num * sizeof(uint32_t));
+    unsigned int i;
+
+    if (p == NULL) {
         return -1;
     }
-
-    return snapshot_read_dword_array(m->file, dw_return, num);
+    for (i = 0; i < num; i++) {
+        dw_return[i] = snapshot_get_dword(p + i * sizeof(uint32_t));
+    }
+    return 0;
 }
 
 int snapshot_module_read_string(snapshot_module_t *m, char **charp_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
-        snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
+    uint16_t len;
+    const uint8_t *p;
+
+    /* first free the previous string */
+    lib_free(*charp_return);
+    *charp_return = NULL;      /* don't leave a bogus pointer */
+
+    if (snapshot_module_read_word(m, &len) < 0) {
         return -1;
     }
 
-    return snapshot_read_string(m->file, charp_return);
+    if (len) {
+        p = snapshot_module_read(m, len);
+        if (p == NULL) {
+            return -1;
+        }
+        *charp_return = lib_malloc(len);
+        memcpy(*charp_return, p, len);
+        (*charp_return)[len - 1] = 0;   /* just to be save */
+    }
+    return 0;
 }
 
 int snapshot_module_read_byte_into_int(snapshot_module_t *m, int *value_return)
@@ -680,120 +570,176 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8
 
     current_module = (char *)name;
 
-    m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
-    m->offset = ftell(s->file);
-    if (m->offset == -1) {
-        snapshot_error = SNAPSHOT_ILLEGAL_OFFSET_ERROR;
-        lib_free(m);
-        return NULL;
-    }
+    m = lib_calloc(1, sizeof(snapshot_module_t));
+    m->snapshot = s;
     m->write_mode = 1;
+    snapshot_pad_string(m->name, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN);
+    m->major_version = major_version;
+    m->minor_version = minor_version;
 
-    if (snapshot_write_padded_string(s->file, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
-        || snapshot_write_byte(s->file, major_version) < 0
-        || snapshot_write_byte(s->file, minor_version) < 0
-        || snapshot_write_dword(s->file, 0) < 0) {
-        return NULL;
-    }
+    return m;
+}
 
-    m->size = (uint32_t)(ftell(s->file) - m->offset);
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
+static int snapshot_module_inflate(snapshot_module_t *m, const uint8_t *data, size_t size)
+{
+#ifdef HAVE_ZLIB
+    uLongf len;
 
-    return m;
+    if (size >= sizeof(uint32_t)) {
+        len = snapshot_get_dword(data);
+        if (len / SNAPSHOT_INFLATE_MAX_RATIO > size - sizeof(uint32_t)) {
+            /* more than the compressed data can possibly expand to */
+            goto fail;
+        }
+        m->buf.alloc = len > 0 ? len : 1;
+        m->buf.data = lib_malloc(m->buf.alloc);
+        if (uncompress(m->buf.data, &len, data + sizeof(uint32_t),
+                       (uLong)(size - sizeof(uint32_t))) == Z_OK
+            && len == snapshot_get_dword(data)) {
+            m->buf.size = len;
+            return 0;
+        }
+        snapshot_buffer_free(&m->buf);
+    }
+fail:
+#endif
+    current_fpos = m->offset;
+    snapshot_error = SNAPSHOT_MODULE_DECOMPRESSION_ERROR;
+    return -1;
 }
 
 snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t *major_version_return, uint8_t *minor_version_return)
 {
     snapshot_module_t *m;
-    char n[SNAPSHOT_MODULE_NAME_LEN];
+    snapshot_index_t *idx = NULL;
     unsigned int name_len = (unsigned int)strlen(name);
+    unsigned int i;
+    const uint8_t *data;
+    size_t size;
 
     current_module = (char *)name;
 
-    if (fseek(s->file, s->first_module_offset, SEEK_SET) < 0) {
-        snapshot_error = SNAPSHOT_FIRST_MODULE_NOT_FOUND_ERROR;
+    DBG(("snapshot_module_open name: '%s'\n", name));
+
+    for (i = 0; i < s->num_modules && name_len <= SNAPSHOT_MODULE_NAME_LEN; i++) {
+        if (memcmp(s->index[i].name, name, name_len) == 0
+            && (name_len == SNAPSHOT_MODULE_NAME_LEN || s->index[i].name[name_len] == 0)) {
+            idx = &s->index[i];
+            break;
+        }
+    }
+
+    if (idx == NULL) {
+        /* same error as when searching the file ran into its end */
+        current_fpos = s->buf.size;
+        snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
         DBG(("snapshot_module_open error: name: '%s' NOT found\n", name));
         return NULL;
     }
 
-    m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
+    m = lib_calloc(1, sizeof(snapshot_module_t));
+    m->snapshot = s;
     m->write_mode = 0;
+    memcpy(m->name, idx->name, SNAPSHOT_MODULE_NAME_LEN);
+    m->major_version = idx->major_version;
+    m->minor_version = idx->minor_version;
+    m->offset = idx->offset + SNAPSHOT_MODULE_HEADER_LEN;
 
-    m->offset = s->first_module_offset;
+    data = s->buf.data + m->offset;
+    size = idx->size - SNAPSHOT_MODULE_HEADER_LEN;
 
-    DBG(("snapshot_module_open name: '%s'\n", name));
+    if (idx->compressed && !s->compression) {
+        /* flag not allowed by the file header, the size is corrupt */
+        lib_free(m);
+        current_fpos = idx->offset;
+        snapshot_error = SNAPSHOT_MODULE_DECOMPRESSION_ERROR;
+        return NULL;
+    } else if (!idx->compressed) {
+        /* read straight from the file contents */
+        m->buf.data = (uint8_t *)data;
+        m->buf.size = size;
+    } else if (snapshot_module_inflate(m, data, size) < 0) {
+        lib_free(m);
+        DBG(("snapshot_module_open error: name: '%s' cannot be decompressed\n", name));
+        return NULL;
+    }
 
-    /* Search for the module name.  This is quite inefficient, but I don't
-       think we care.  */
-    while (1) {
-        if (snapshot_read_byte_array(s->file, (uint8_t *)n,
-                                     SNAPSHOT_MODULE_NAME_LEN) < 0
-            || snapshot_read_byte(s->file, major_version_return) < 0
-            || snapshot_read_byte(s->file, minor_version_return) < 0
-            || snapshot_read_dword(s->file, &m->size)) {
-            snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
-            goto fail;
-        }
+    *major_version_return = m->major_version;
+    *minor_version_return = m->minor_version;
 
-        /* Found?  */
-        if (memcmp(n, name, name_len) == 0
-            && (name_len == SNAPSHOT_MODULE_NAME_LEN || n[name_len] == 0)) {
-            break;
-        }
+    DBG(("snapshot_module_open name: '%s', version %u.%u found\n", name, *major_version_return, *minor_version_return));
+    return m;
+}
 
-        m->offset += m->size;
-        if (fseek(s->file, m->offset, SEEK_SET) < 0) {
-            snapshot_error = SNAPSHOT_MODULE_NOT_FOUND_ERROR;
-            goto fail;
+static int snapshot_module_flush(snapshot_module_t *m)
+{
+    snapshot_t *s = m->snapshot;
+    FILE *f = s->file;
+    uint8_t header[SNAPSHOT_MODULE_HEADER_LEN + sizeof(uint32_t)];
+    size_t header_len = SNAPSHOT_MODULE_HEADER_LEN;
+    const uint8_t *data = m->buf.data;
+    size_t len = m->buf.size;
+    uint32_t flags = 0;
+    int retval = 0;
+#ifdef HAVE_ZLIB
+    uint8_t *packed = NULL;
+
+    if (s->compression > 0 && len >= SNAPSHOT_COMPRESS_MIN_SIZE) {
+        uLongf packed_len = compressBound((uLong)len);
+
+        packed = lib_malloc(packed_len);
+        if (compress2(packed, &packed_len, data, (uLong)len, s->compression) == Z_OK
+            && packed_len + sizeof(uint32_t) < len) {
+            snapshot_put_dword(header + header_len, (uint32_t)len);
+            header_len += sizeof(uint32_t);
+            data = packed;
+            len = packed_len;
+            flags = SNAPSHOT_MODULE_COMPRESSED;
         }
     }
+#endif
+
+    memcpy(header, m->name, SNAPSHOT_MODULE_NAME_LEN);
+    header[SNAPSHOT_MODULE_NAME_LEN] = m->major_version;
+    header[SNAPSHOT_MODULE_NAME_LEN + 1] = m->minor_version;
+    snapshot_put_dword(header + SNAPSHOT_MODULE_NAME_LEN + 2, (uint32_t)(header_len + len) | flags);
 
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
-#if 0
-    /* HACK: if any of the errors *this* function can produce is still pending
-             in snapshot_error, clear it out - else we might fail for no reason
-             eg when trying to open the C64ROM module, which isnt strictly
-             required to exist in the snapshot */
-    if ((snapshot_error == SNAPSHOT_FIRST_MODULE_NOT_FOUND_ERROR) ||
-        (snapshot_error == SNAPSHOT_MODULE_HEADER_READ_ERROR) ||
-        (snapshot_error == SNAPSHOT_MODULE_NOT_FOUND_ERROR)) {
-        snapshot_error = SNAPSHOT_NO_ERROR;
+    current_fpos = f != NULL ? ftell(f) : s->buf.size;
+    if (header_len + len >= SNAPSHOT_MODULE_COMPRESSED) {
+        snapshot_error = SNAPSHOT_MODULE_CLOSE_ERROR;
+        retval = -1;
+    } else if (f == NULL) {
+        memcpy(snapshot_buffer_append(&s->buf, header_len), header, header_len);
+        if (len > 0) {
+            memcpy(snapshot_buffer_append(&s->buf, len), data, len);
+        }
+    } else if (fwrite(header, header_len, 1, f) < 1
+               || (len > 0 && fwrite(data, len, 1, f) < 1)) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
+        retval = -1;
     }
-#endif
-    DBG(("snapshot_module_open name: '%s', version %u.%u found\n", name, *major_version_return, *minor_version_return));
-    return m;
 
-fail:
-    fseek(s->file, s->first_module_offset, SEEK_SET);
-    lib_free(m);
-    DBG(("snapshot_module_open error: name: '%s' NOT found\n", name));
-    return NULL;
+#ifdef HAVE_ZLIB
+    lib_free(packed);
+#endif
+    return retval;
 }
 
 int snapshot_module_close(snapshot_module_t *m)
 {
-    DBG(("snapshot_module_close name: '%s'\n", current_module));
-    /* Backpatch module size if writing.  */
-    if (m->write_mode
-        && (fseek(m->file, m->size_offset, SEEK_SET) < 0
-            || snapshot_write_dword(m->file, m->size) < 0)) {
-        snapshot_error = SNAPSHOT_MODULE_CLOSE_ERROR;
-        DBG(("snapshot_module_close error\n"));
-        return -1;
-    }
+    int retval = 0;
 
-    /* Skip module.  */
-    if (fseek(m->file, m->offset + m->size, SEEK_SET) < 0) {
-        snapshot_error = SNAPSHOT_MODULE_SKIP_ERROR;
+    DBG(("snapshot_module_close name: '%s'\n", current_module));
+    if (m->write_mode && snapshot_module_flush(m) < 0) {
         DBG(("snapshot_module_close error\n"));
-        return -1;
+        retval = -1;
+    } else {
+        DBG(("snapshot_module_close ok\n"));
     }
 
+    snapshot_buffer_free(&m->buf);
     lib_free(m);
-    DBG(("snapshot_module_close ok\n"));
-    return 0;
+    return retval;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -802,59 +748,77 @@ snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t
 {
     FILE *f;
     snapshot_t *s;
+    snapshot_buffer_t header;
+    uint8_t *p;
     unsigned char viceversion[4] = { VERSION_RC_NUMBER };
 
     current_filename = (char *)filename;
 
-    f = fopen(filename, MODE_WRITE);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
-        return NULL;
+    if (memory_enabled) {
+        f = NULL;
+    } else {
+        f = fopen(filename, MODE_WRITE);
+        if (f == NULL) {
+            snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
+            return NULL;
+        }
     }
 
+    memset(&header, 0, sizeof(snapshot_buffer_t));
+
     /* Magic string.  */
-    if (snapshot_write_padded_string(f, snapshot_magic_string, (uint8_t)0, SNAPSHOT_MAGIC_LEN) < 0) {
-        snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
-        goto fail;
-    }
+    p = snapshot_buffer_append(&header, SNAPSHOT_MAGIC_LEN);
+    snapshot_pad_string(p, snapshot_magic_string, (uint8_t)0, SNAPSHOT_MAGIC_LEN);
 
     /* Version number.  */
-    if (snapshot_write_byte(f, major_version) < 0
-        || snapshot_write_byte(f, minor_version) < 0) {
-        snapshot_error = SNAPSHOT_CANNOT_WRITE_VERSION_ERROR;
-        goto fail;
+    p = snapshot_buffer_append(&header, 2);
+    p[0] = major_version;
+#ifdef HAVE_ZLIB
+    /* in memory the data is left as it is, rewinding compares it
+       against older snapshots */
+    if (snapshot_compression > 0 && f != NULL) {
+        p[0] |= SNAPSHOT_MAJOR_COMPRESSED;
     }
+#endif
+    p[1] = minor_version;
 
     /* Machine.  */
-    if (snapshot_write_padded_string(f, snapshot_machine_name, (uint8_t)0, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
-        snapshot_error = SNAPSHOT_CANNOT_WRITE_MACHINE_NAME_ERROR;
-        goto fail;
-    }
+    p = snapshot_buffer_append(&header, SNAPSHOT_MACHINE_NAME_LEN);
+    snapshot_pad_string(p, snapshot_machine_name, (uint8_t)0, SNAPSHOT_MACHINE_NAME_LEN);
 
     /* VICE version and revision */
-    if (snapshot_write_padded_string(f, snapshot_version_magic_string, (uint8_t)0, SNAPSHOT_VERSION_MAGIC_LEN) < 0) {
-        snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
-        goto fail;
-    }
+    p = snapshot_buffer_append(&header, SNAPSHOT_VERSION_MAGIC_LEN);
+    snapshot_pad_string(p, snapshot_version_magic_string, (uint8_t)0, SNAPSHOT_VERSION_MAGIC_LEN);
 
-    if (snapshot_write_byte(f, viceversion[0]) < 0
-        || snapshot_write_byte(f, viceversion[1]) < 0
-        || snapshot_write_byte(f, viceversion[2]) < 0
-        || snapshot_write_byte(f, viceversion[3]) < 0
+    p = snapshot_buffer_append(&header, 4 + sizeof(uint32_t));
+    memcpy(p, viceversion, 4);
 #ifdef USE_SVN_REVISION
-        || snapshot_write_dword(f, VICE_SVN_REV_NUMBER) < 0) {
+    snapshot_put_dword(p + 4, VICE_SVN_REV_NUMBER);
 #else
-        || snapshot_write_dword(f, 0) < 0) {
+    snapshot_put_dword(p + 4, 0);
 #endif
-        snapshot_error = SNAPSHOT_CANNOT_WRITE_VERSION_ERROR;
+
+    current_fpos = 0;
+    if (f != NULL && fwrite(header.data, header.size, 1, f) < 1) {
+        snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
+        snapshot_buffer_free(&header);
         goto fail;
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
+    s = lib_calloc(1, sizeof(snapshot_t));
     s->file = f;
-    s->first_module_offset = ftell(f);
+    s->first_module_offset = header.size;
+    if (header.data[SNAPSHOT_MAGIC_LEN] & SNAPSHOT_MAJOR_COMPRESSED) {
+        s->compression = snapshot_compression;
+    }
     s->write_mode = 1;
 
+    if (f == NULL) {
+        /* the modules are appended to the header */
+        s->buf = header;
+    } else {
+        snapshot_buffer_free(&header);
+    }
     return s;
 
 fail:
@@ -867,11 +831,82 @@ fail:
 static unsigned char snapshot_viceversion[4];
 static uint32_t snapshot_vicerevision;
 
-snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
+static int snapshot_load_file(const char *filename, snapshot_buffer_t *b)
 {
     FILE *f;
-    char magic[SNAPSHOT_MAGIC_LEN];
+    long len;
+    int retval = 0;
+
+    f = zfile_fopen(filename, MODE_READ);
+    if (f == NULL) {
+        return -1;
+    }
+
+    if (fseek(f, 0, SEEK_END) < 0
+        || (len = ftell(f)) < 0
+        || fseek(f, 0, SEEK_SET) < 0) {
+        retval = -1;
+    } else {
+        b->alloc = len > 0 ? (size_t)len : 1;
+        b->data = lib_malloc(b->alloc);
+        b->size = (size_t)len;
+        if (len > 0 && fread(b->data, (size_t)len, 1, f) < 1) {
+            snapshot_buffer_free(b);
+            retval = -1;
+        }
+    }
+
+    zfile_fclose(f);
+    return retval;
+}
+
+/* Collect the module headers, so modules can be opened in any order without
+   searching the file.  */
+static void snapshot_build_index(snapshot_t *s)
+{
+    size_t offset = s->first_module_offset;
+    unsigned int num_alloc = 0;
+
+    while (offset <= s->buf.size
+           && s->buf.size - offset >= SNAPSHOT_MODULE_HEADER_LEN) {
+        const uint8_t *p = s->buf.data + offset;
+        uint32_t size = snapshot_get_dword(p + SNAPSHOT_MODULE_NAME_LEN + 2);
+        snapshot_index_t *idx;
+
+        if ((size & ~SNAPSHOT_MODULE_COMPRESSED) < SNAPSHOT_MODULE_HEADER_LEN) {
+            break;
+        }
+
+        if (s->num_modules == num_alloc) {
+            num_alloc = num_alloc ? num_alloc * 2 : 64;
+            s->index = lib_realloc(s->index, num_alloc * sizeof(snapshot_index_t));
+        }
+
+        idx = &s->index[s->num_modules++];
+        memcpy(idx->name, p, SNAPSHOT_MODULE_NAME_LEN);
+        idx->major_version = p[SNAPSHOT_MODULE_NAME_LEN];
+        idx->minor_version = p[SNAPSHOT_MODULE_NAME_LEN + 1];
+        idx->offset = offset;
+        idx->compressed = (size & SNAPSHOT_MODULE_COMPRESSED) ? 1 : 0;
+        idx->size = size & ~SNAPSHOT_MODULE_COMPRESSED;
+
+        if (idx->size > s->buf.size - offset) {
+            /* truncated, reading past the end fails like reading past the
+               end of the module */
+            idx->size = s->buf.size - offset;
+            break;
+        }
+        offset += idx->size;
+    }
+
+    DBG(("snapshot_build_index: %u modules\n", s->num_modules));
+}
+
+snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
+{
     snapshot_t *s = NULL;
+    snapshot_buffer_t *b;
+    const uint8_t *p;
     int machine_name_len;
     size_t offs;
 
@@ -879,31 +914,49 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
     current_filename = (char *)filename;
     current_module = NULL;
 
-    f = zfile_fopen(filename, MODE_READ);
-    if (f == NULL) {
+    s = lib_calloc(1, sizeof(snapshot_t));
+    s->write_mode = 0;
+    b = &s->buf;
+
+    if (memory_enabled) {
+        if (memory_image.data == NULL) {
+            snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
+            lib_free(s);
+            return NULL;
+        }
+        /* borrowed, see snapshot_memory_set_image() */
+        b->data = memory_image.data;
+        b->size = memory_image.size;
+    } else if (snapshot_load_file(filename, b) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
+        lib_free(s);
         return NULL;
     }
 
     /* Magic string.  */
-    if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_MAGIC_LEN) < 0
-        || memcmp(magic, snapshot_magic_string, SNAPSHOT_MAGIC_LEN) != 0) {
+    p = snapshot_buffer_read(b, 0, SNAPSHOT_MAGIC_LEN);
+    if (p == NULL || memcmp(p, snapshot_magic_string, SNAPSHOT_MAGIC_LEN) != 0) {
         snapshot_error = SNAPSHOT_MAGIC_STRING_MISMATCH_ERROR;
         goto fail;
     }
 
     /* Version number.  */
-    if (snapshot_read_byte(f, major_version_return) < 0
-        || snapshot_read_byte(f, minor_version_return) < 0) {
+    p = snapshot_buffer_read(b, 0, 2);
+    if (p == NULL) {
         snapshot_error = SNAPSHOT_CANNOT_READ_VERSION_ERROR;
         goto fail;
     }
+    *major_version_return = p[0] & ~SNAPSHOT_MAJOR_COMPRESSED;
+    *minor_version_return = p[1];
+    s->compression = (p[0] & SNAPSHOT_MAJOR_COMPRESSED) ? 1 : 0;
 
     /* Machine.  */
-    if (snapshot_read_byte_array(f, (uint8_t *)read_name, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
+    p = snapshot_buffer_read(b, 0, SNAPSHOT_MACHINE_NAME_LEN);
+    if (p == NULL) {
         snapshot_error = SNAPSHOT_CANNOT_READ_MACHINE_NAME_ERROR;
         goto fail;
     }
+    memcpy(read_name, p, SNAPSHOT_MACHINE_NAME_LEN);
 
     /* Check machine name.  */
     machine_name_len = (int)strlen(snapshot_machine_name);
@@ -917,62 +970,91 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
     /* VICE version and revision */
     memset(snapshot_viceversion, 0, 4);
     snapshot_vicerevision = 0;
-    offs = ftell(f);
+    offs = b->pos;
 
-    if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_VERSION_MAGIC_LEN) < 0
-        || memcmp(magic, snapshot_version_magic_string, SNAPSHOT_VERSION_MAGIC_LEN) != 0) {
+    p = snapshot_buffer_read(b, 0, SNAPSHOT_VERSION_MAGIC_LEN);
+    if (p == NULL
+        || memcmp(p, snapshot_version_magic_string, SNAPSHOT_VERSION_MAGIC_LEN) != 0) {
         /* old snapshots do not contain VICE version */
-        fseek(f, offs, SEEK_SET);
+        b->pos = offs;
         log_warning(LOG_DEFAULT, "attempting to load pre 2.4.30 snapshot");
     } else {
         /* actually read the version */
-        if (snapshot_read_byte(f, &snapshot_viceversion[0]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[1]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[2]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[3]) < 0
-            || snapshot_read_dword(f, &snapshot_vicerevision) < 0) {
+        p = snapshot_buffer_read(b, 0, 4 + sizeof(uint32_t));
+        if (p == NULL) {
             snapshot_error = SNAPSHOT_CANNOT_READ_VERSION_ERROR;
             goto fail;
         }
+        memcpy(snapshot_viceversion, p, 4);
+        snapshot_vicerevision = snapshot_get_dword(p + 4);
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
-    s->write_mode = 0;
+    s->first_module_offset = b->pos;
+    snapshot_build_index(s);
 
     vsync_suspend_speed_eval();
     return s;
 
 fail:
-    fclose(f);
+    snapshot_buffer_free(b);
+    lib_free(s);
     return NULL;
 }
 
 int snapshot_close(snapshot_t *s)
 {
-    int retval;
+    int retval = 0;
 
-    if (!s->write_mode) {
-        if (zfile_fclose(s->file) == EOF) {
-            snapshot_error = SNAPSHOT_READ_CLOSE_EOF_ERROR;
-            retval = -1;
-        } else {
-            retval = 0;
-        }
-    } else {
+    if (s->write_mode && s->file == NULL) {
+        snapshot_buffer_free(&memory_image);
+        memory_image = s->buf;
+    } else if (s->write_mode) {
         if (fclose(s->file) == EOF) {
             snapshot_error = SNAPSHOT_WRITE_CLOSE_EOF_ERROR;
             retval = -1;
-        } else {
-            retval = 0;
         }
+    } else {
+        /* the file itself has been closed after loading it */
+        snapshot_buffer_free(&s->buf);
+        lib_free(s->index);
     }
 
     lib_free(s);
     return retval;
 }
 
+void snapshot_set_compression(int level)
+{
+    snapshot_compression = level;
+}
+
+void snapshot_memory_enable(int enabled)
+{
+    memory_enabled = enabled;
+}
+
+uint8_t *snapshot_memory_get_image(size_t *size)
+{
+    uint8_t *data = NULL;
+
+    *size = 0;
+    if (memory_image.alloc > 0) {
+        data = memory_image.data;
+        *size = memory_image.size;
+    }
+    memset(&memory_image, 0, sizeof(snapshot_buffer_t));
+
+    return data;
+}
+
+void snapshot_memory_set_image(const uint8_t *data, size_t size)
+{
+    snapshot_buffer_free(&memory_image);
+    memory_image.data = (uint8_t *)data;
+    memory_image.size = size;
+}
+
+
 static void display_error_with_vice_version(char *text, char *filename)
 {
     char *vmessage = lib_malloc(0x100);
@@ -1074,6 +1156,9 @@ void snapshot_display_error(void)
         case SNAPSHOT_MODULE_SKIP_ERROR:
             ui_error("Error skipping module in snapshot %s", current_filename);
             break;
+        case SNAPSHOT_MODULE_DECOMPRESSION_ERROR:
+            ui_error("Cannot decompress module %s in snapshot %s", current_module, current_filename);
+            break;
         case SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR:
             ui_error("Cannot create snapshot %s", current_filename);
             break;
@@ -64,6 +64,7 @@
 #define SNAPSHOT_MODULE_NOT_IMPLEMENTED          28
 #define SNAPSHOT_ATA_IMAGE_FILENAME_MISMATCH     29
 #define SNAPSHOT_VICII_MODEL_MISMATCH            30
+#define SNAPSHOT_MODULE_DECOMPRESSION_ERROR      31
 
 typedef struct snapshot_module_s snapshot_module_t;
 typedef struct snapshot_s snapshot_t;
@@ -136,6 +137,20 @@ snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t
 snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name);
 int snapshot_close(snapshot_t *s);
 
+/* zlib level (1-9) used for modules written from now on, 0 to store them
+   uncompressed.  Has no effect without zlib.  */
+void snapshot_set_compression(int level);
+
+/* While enabled, snapshot_create() and snapshot_open() ignore the file
+   name and work in memory.  After a snapshot has been created and closed,
+   snapshot_memory_get_image() hands out its contents (to be freed with
+   lib_free()).  snapshot_open() reads the image last given to
+   snapshot_memory_set_image(), which is not copied and must stay valid
+   until the snapshot is closed.  */
+void snapshot_memory_enable(int enabled);
+uint8_t *snapshot_memory_get_image(size_t *size);
+void snapshot_memory_set_image(const uint8_t *data, size_t size);
+
 void snapshot_set_error(int error);
 int snapshot_get_error(void);
 
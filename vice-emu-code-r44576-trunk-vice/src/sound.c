@@ -44,6 +44,7 @@
 #include "cmdline.h"
 #include "debug.h"
 #include "fixpoint.h"
+#include "hostprofile.h"
 #include "lib.h"
 #include "log.h"
 #include "machine.h"
@@ -1360,12 +1361,14 @@ static int sound_run_sound(void)
     if (cycle_based) {
         delta_t = maincpu_clk - snddata.lastclk;
         bufferptr = snddata.buffer + snddata.bufptr * snddata.sound_output_channels;
+        HOSTPROFILE_ENTER(HOSTPROFILE_SOUND);
         nr = sound_machine_calculate_samples(snddata.psid,
                                              bufferptr,
                                              snddata.bufsize - snddata.bufptr,
                                              snddata.sound_output_channels,
                                              snddata.sound_chip_channels,
                                              &delta_t);
+        HOSTPROFILE_LEAVE(HOSTPROFILE_SOUND);
         if (delta_t && !archdep_is_exiting()) {
 #if 0
             sound_error_log_only("Sound buffer overflow (cycle based)");
@@ -1393,12 +1396,14 @@ static int sound_run_sound(void)
              nr = snddata.bufsize - snddata.bufptr;
          }
          bufferptr = snddata.buffer + snddata.bufptr * snddata.sound_output_channels;
+         HOSTPROFILE_ENTER(HOSTPROFILE_SOUND);
          sound_machine_calculate_samples(snddata.psid,
                                          bufferptr,
                                          nr,
                                          snddata.sound_output_channels,
                                          snddata.sound_chip_channels,
                                          &delta_t);
+         HOSTPROFILE_LEAVE(HOSTPROFILE_SOUND);
          snddata.fclk += nr * snddata.clkstep;
      }
 
@@ -1563,6 +1568,14 @@ bool sound_flush(void)
         mainlock_yield_and_sleep(tick_per_second() / 1000);
     }
 
+    /* In warp mode only the recording device gets the samples. */
+    if (warp_mode_enabled) {
+        if (snddata.recdev->write(snddata.buffer, nr * snddata.sound_output_channels)) {
+            sound_error("write to sound device failed.");
+            goto done;
+        }
+    }
+
     snddata.bufptr -= nr;
 
     /*
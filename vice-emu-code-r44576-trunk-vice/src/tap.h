@@ -53,6 +53,7 @@
 
 struct tape_init_s;
 struct tape_file_record_s;
+struct tap_file_s;
 
 typedef struct tap_s {
     /* File name.  */
@@ -113,6 +114,19 @@ typedef struct tap_s {
 
     /* Has the tap changed? We correct the size then.  */
     int has_changed;
+
+    /* The whole image (including the header), loaded when the files on
+       the tape are looked for.  The position is an offset into the image
+       like the one of `fd'.  */
+    uint8_t *data;
+    long data_size;
+    long data_pos;
+
+    /* Headers found so far, indexed by file number.  */
+    struct tap_file_s *files;
+    int files_num;
+    int files_max;
+    unsigned int files_generation;
 } tap_t;
 
 void tap_init(const struct tape_init_s *init);
@@ -128,6 +142,7 @@ void tap_get_header(tap_t *tap, uint8_t *name);
 struct tape_file_record_s *tap_get_current_file_record(tap_t *tap);
 
 int tap_read(tap_t *tap, uint8_t *buf, size_t size);
+void tap_discard_contents(tap_t *tap);
 
 int tap_cmdline_options_init(void);
 
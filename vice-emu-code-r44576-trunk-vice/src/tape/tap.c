@@ -81,6 +81,16 @@ static int tap_pulse_tt_short_max = 0x22;
 static int tap_pulse_tt_long_min = 0x23;
 static int tap_pulse_tt_long_max = 0x36;
 
+/* Bumped by tap_init(), the headers found before may not be found again
+   with other pulse lengths.  */
+static unsigned int tap_pulse_generation = 0;
+
+/* A header found on the tape, see tap_seek_to_file().  */
+struct tap_file_s {
+    long offset;
+    tape_file_record_t record;
+};
+
 typedef struct {
     int system;
     int video;
@@ -207,6 +217,7 @@ static tap_t *tap_new(void)
     tap->current_file_seek_position = 0;
     tap->mode = DATASETTE_CONTROL_STOP;
     tap->offset = TAP_HDR_SIZE;
+    tap->data_pos = TAP_HDR_SIZE;
     tap->has_changed = 0;
     tap->current_file_number = -1;
     tap->current_file_data = NULL;
@@ -289,6 +300,7 @@ int tap_close(tap_t *tap)
     }
 
     lib_free(tap->current_file_data);
+    tap_discard_contents(tap);
     lib_free(tap->file_name);
     lib_free(tap->tap_file_record);
     lib_free(tap);
@@ -386,63 +398,138 @@ int tap_create(const char *name)
 
 static int tap_find_pilot(tap_t *tap, int type);
 
-inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
+/* Load the image into memory.  Looking for the files on the tape walks
+   over the pulses a couple of times, which is a lot cheaper without going
+   through stdio for every single one of them.  */
+static int tap_load_data(tap_t *tap)
 {
-    uint8_t data;
-    uint32_t pulse_length = 0;
-    size_t res;
+    off_t size;
+    long pos;
+
+    if (tap->data != NULL) {
+        return 0;
+    }
+
+    size = archdep_file_size(tap->fd);
+    if (size < TAP_HDR_SIZE) {
+        return -1;
+    }
+
+    pos = ftell(tap->fd);
+    tap->data = lib_malloc((size_t)size);
+    if (fseek(tap->fd, 0, SEEK_SET) != 0
+        || fread(tap->data, 1, (size_t)size, tap->fd) != (size_t)size) {
+        log_error(tape_log, "Cannot read TAP image `%s'.", tap->file_name);
+        lib_free(tap->data);
+        tap->data = NULL;
+        fseek(tap->fd, pos, SEEK_SET);
+        return -1;
+    }
+    fseek(tap->fd, pos, SEEK_SET);
+    tap->data_size = (long)size;
+
+    return 0;
+}
+
+/* Forget everything that was loaded or found on the tape, to be called
+   when the image gets written to.  */
+void tap_discard_contents(tap_t *tap)
+{
+    lib_free(tap->data);
+    tap->data = NULL;
+    tap->data_size = 0;
+
+    lib_free(tap->files);
+    tap->files = NULL;
+    tap->files_num = 0;
+    tap->files_max = 0;
+}
+
+/* Remember where the current file is, if the file number counts from the
+   start of the tape.  */
+static void tap_add_file(tap_t *tap)
+{
+    if (tap->files_generation != tap_pulse_generation) {
+        tap->files_num = 0;
+        tap->files_generation = tap_pulse_generation;
+    }
+
+    if (tap->current_file_number != tap->files_num) {
+        return;
+    }
+
+    if (tap->files_num == tap->files_max) {
+        tap->files_max = tap->files_max ? tap->files_max * 2 : 16;
+        tap->files = lib_realloc(tap->files, sizeof(struct tap_file_s) * (size_t)tap->files_max);
+    }
+    tap->files[tap->files_num].offset = tap->current_file_seek_position;
+    tap->files[tap->files_num].record = *tap->tap_file_record;
+    tap->files_num++;
+}
 
-    *pos_advance = 0;
-    res = fread(&data, 1, 1, tap->fd);
+/* Decode one halfwave (or full wave for version 0 and 1) at `*pos'.  */
+inline static int tap_get_halfwave(const tap_t *tap, long *pos, uint32_t *pulse_length)
+{
+    const uint8_t *size;
+    uint8_t data;
 
-    if (res == 0) {
+    if (*pos >= tap->data_size) {
         return -1;
     }
 
-    *pos_advance += (int)res;
+    data = tap->data[*pos];
 
     if (data == 0) {
         if (tap->version == 0) {
-            pulse_length = 256;
+            *pulse_length = 256;
         } else if ((tap->version == 1) || (tap->version == 2)) {
-            uint8_t size[3];
-            res = fread(size, 3, 1, tap->fd);
-            if (res == 0) {
+            if (*pos + 4 > tap->data_size) {
                 return -1;
             }
-            *pos_advance += 3;
-            pulse_length = ((size[2] << 16) | (size[1] << 8) | size[0]) >> 3;
+            size = tap->data + *pos + 1;
+            *pulse_length = ((size[2] << 16) | (size[1] << 8) | size[0]) >> 3;
+            *pos += 3;
+        } else {
+            *pulse_length = 0;
         }
     } else {
-        pulse_length = data;
+        *pulse_length = data;
+    }
+    (*pos)++;
+
+    return 0;
+}
+
+/* Decode the pulse at `*pos' and move `*pos' to the next one.  */
+inline static int tap_decode_pulse(const tap_t *tap, long *pos)
+{
+    uint32_t pulse_length;
+
+    if (tap_get_halfwave(tap, pos, &pulse_length) < 0) {
+        return -1;
     }
 
     /*  Handle Halfwave format for C16 tapes */
     if (tap->version == 2) {
         uint32_t pulse_length2;
 
-        res = fread(&data, 1, 1, tap->fd);
-
-        if (res == 0) {
+        if (tap_get_halfwave(tap, pos, &pulse_length2) < 0) {
             return -1;
         }
-        *pos_advance += (int)res;
-        if (data == 0) {
-            uint8_t size[3];
-            res = fread(size, 3, 1, tap->fd);
-            if (res == 0) {
-                return -1;
-            }
-            *pos_advance += 3;
-            pulse_length2 = ((size[2] << 16) | (size[1] << 8) | size[0]) >> 3;
-        } else {
-            pulse_length2 = data;
-        }
 
         /*  This should do for the time being */
         pulse_length += pulse_length2;
     }
 
+    return (int)pulse_length;
+}
+
+inline static int tap_get_pulse(tap_t *tap)
+{
+    int data;
+
+    data = tap_decode_pulse(tap, &tap->data_pos);
+
 #if TAP_DEBUG > 2
     if (TAP_PULSE_SHORT(data)) {
         log_debug("s");
@@ -453,7 +540,7 @@ inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
     }
 #endif
 
-    return (int)pulse_length;
+    return data;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -462,13 +549,12 @@ inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
 inline static int tap_cbm_read_bit(tap_t *tap)
 {
     int pulse1, pulse2;
-    int pos_advance;
 
-    pulse1 = tap_get_pulse(tap, &pos_advance);
+    pulse1 = tap_get_pulse(tap);
     if (pulse1 < 0) {
         return -1;
     }
-    pulse2 = tap_get_pulse(tap, &pos_advance);
+    pulse2 = tap_get_pulse(tap);
     if (pulse2 < 0) {
         return -1;
     }
@@ -488,16 +574,15 @@ static int tap_cbm_read_byte(tap_t *tap)
 {
     int i, data, parity;
     uint8_t read;
-    int pos_advance;
 
     /* check for L pulse (start-of-byte) */
-    data = tap_get_pulse(tap, &pos_advance);
+    data = tap_get_pulse(tap);
     if (data < 0 || !TAP_PULSE_LONG(data)) {
         return -1;
     }
 
     /* expect either M (L-M: start-of-byte) or S (L-S: end-of-data-block) */
-    data = tap_get_pulse(tap, &pos_advance);
+    data = tap_get_pulse(tap);
     if (data < 0) {
         return -1; /* end of tape */
     } else if (TAP_PULSE_SHORT(data)) {
@@ -537,21 +622,16 @@ static int tap_cbm_skip_pilot(tap_t *tap)
     int data, errors;
     long fpos;
     long fpos2;
-    long current_filepos;
-    int pos_advance;
 
     errors = 0;
-    current_filepos = ftell(tap->fd);
     while (1) {
         /*  Save file position */
-        fpos = current_filepos;
-        data = tap_get_pulse(tap, &pos_advance);
-        current_filepos += pos_advance;
-        fpos2 = current_filepos;
+        fpos = tap->data_pos;
+        data = tap_get_pulse(tap);
+        fpos2 = tap->data_pos;
         if (TAP_PULSE_LONG(data)) {
             /* found an L pulse, try to read a byte */
-            fseek(tap->fd, fpos, SEEK_SET);
-            current_filepos = fpos;
+            tap->data_pos = fpos;
             data = tap_cbm_read_byte(tap);
             if (data == -1) {
                 /* end-of-tape */
@@ -563,12 +643,10 @@ static int tap_cbm_skip_pilot(tap_t *tap)
                 }
 
                 /* Start over after the L pulse */
-                fseek(tap->fd, fpos2, SEEK_SET);
-                current_filepos = fpos2;
+                tap->data_pos = fpos2;
             } else {
                 /* success.  Go back to start of byte and return */
-                fseek(tap->fd, fpos, SEEK_SET);
-                current_filepos = fpos;
+                tap->data_pos = fpos;
                 return 0;
             }
         } else if (data < 0) {
@@ -921,13 +999,13 @@ static int tap_cbm_skip_file(tap_t *tap)
         int ret;
 
         while (1) {
-            fpos = ftell(tap->fd);
+            fpos = tap->data_pos;
 
             /* find next pilot */
             ret = tap_find_pilot(tap, PILOT_TYPE_CBM);
             if (ret < 0) {
                 /* no more pilot found => end of data */
-                fseek(tap->fd, fpos, SEEK_SET);
+                tap->data_pos = fpos;
                 break;
             }
 
@@ -935,7 +1013,7 @@ static int tap_cbm_skip_file(tap_t *tap)
             ret = tap_cbm_read_block(tap, buffer, 193);
             if (ret < 1 || buffer[0] != 2) {
                 /* next block is not a data continuation block => end of data */
-                fseek(tap->fd, fpos, SEEK_SET);
+                tap->data_pos = fpos;
                 break;
             }
         }
@@ -974,14 +1052,13 @@ static int tap_tt_read_byte(tap_t *tap)
 {
     int pulse, i;
     uint8_t read;
-    int pos_advance;
 
     read = 0;
 
     /* turbo-tape encodes a byte as a sequence of 8 short or long pulses,
        short pulse=0,  long pulse=1.  MSB comes first */
     for (i = 0; i < 8; i++) {
-        pulse = tap_get_pulse(tap, &pos_advance);
+        pulse = tap_get_pulse(tap);
         if (pulse < 0) {
             return -1;
         }
@@ -1000,13 +1077,15 @@ static int tap_tt_read_byte(tap_t *tap)
 static int tap_tt_skip_pilot(tap_t *tap)
 {
     int data;
+    long fpos;
 
 #if TAP_DEBUG > 1
-    log_debug("\nTAP_TT_SKIP_PILOT(0x%X", ftell(tap->fd));
+    log_debug("\nTAP_TT_SKIP_PILOT(0x%lX", tap->data_pos);
 #endif
 
     /* turbo-tape pilot is just repeats of value 0x02 */
     do {
+        fpos = tap->data_pos;
         data = tap_tt_read_byte(tap);
         if (data < 0) {
             return data;
@@ -1015,12 +1094,12 @@ static int tap_tt_skip_pilot(tap_t *tap)
         if (data != 2) {
             /* value != 0x02, we found the end of the pilot.  Go back
                so byte can be read again */
-            fseek(tap->fd, -8, SEEK_CUR);
+            tap->data_pos = fpos;
         }
     } while (data == 2);
 
 #if TAP_DEBUG > 1
-    log_debug("-0x%X) ", ftell(tap->fd));
+    log_debug("-0x%lX) ", tap->data_pos);
 #endif
 
     return 0;
@@ -1242,11 +1321,9 @@ static int tap_determine_pilot_type(tap_t *tap)
 
 static int tap_find_pilot(tap_t *tap, int type)
 {
-    long i, countCBM, countTT, startCBM, startTT, minCBM;
-    int count;
-    int data[256];
-    long pos[257];
-    uint8_t buffer[256];
+    long countCBM, countTT, startCBM, startTT, minCBM;
+    long pos, next;
+    int data;
 
     /* when looking for any pilot type, require CBM pilot to be longer
        than when specifically looking for CBM pilot.  A TurboTape L pulse
@@ -1258,7 +1335,7 @@ static int tap_find_pilot(tap_t *tap, int type)
        file */
     minCBM = (type == PILOT_TYPE_ANY) ? 1000 : PILOT_MIN_LENGTH_CBM;
 
-    startCBM = ftell(tap->fd);
+    startCBM = tap->data_pos;
     startTT = startCBM;
     countCBM = 0;
     countTT = 0;
@@ -1267,131 +1344,45 @@ static int tap_find_pilot(tap_t *tap, int type)
     log_debug(" TAP_FIND_PILOT");
 #endif
 
-    while ((countCBM < minCBM) && (countTT < PILOT_MIN_LENGTH_TT * 8)) {
-/*        count = fread(&data, 1, 256, tap->fd); */
-        long startpos = ftell(tap->fd);
-        long readlen = fread(buffer, 1, 256, tap->fd);
-        uint32_t pulse_length = 0;
-        int j = 0;
-        long needed;
-        long res;
-        for (i = 0; i < readlen; ) {
-            pos[j] = startpos + i;
-            if (buffer[i] == 0) {
-                if (tap->version == 0) {
-                    pulse_length = 256;
-                    i++;
-                } else if ((tap->version == 1) || (tap->version == 2)) {
-                    long still_in_buffer = readlen - (i + 1);
-                    needed = 3 - still_in_buffer;
-                    if (needed <= 0) {
-                        pulse_length = ((buffer[i + 3] << 16) | (buffer[i + 2] << 8) | buffer[i + 1]) >> 3;
-                        i += 4;
-                    } else {
-                        /* There is not enough in the buffer
-                           Read some more */
-                        memcpy(buffer, buffer + i + 1, still_in_buffer);
-                        res = fread(buffer + still_in_buffer, 1, needed, tap->fd);
-                        i = readlen;
-                        if (res == 0) {
-                            continue;
-                        }
-                        pulse_length = ((buffer[2] << 16) | (buffer[1] << 8) | buffer[0]) >> 3;
-                    }
-                }
-            } else {
-                pulse_length = buffer[i];
-                i++;
-            }
-            data[j] = pulse_length;
-
-            if (tap->version == 2) {
-                uint32_t pulse_length2;
-                /*  Read one more byte if run out of buffer */
-                if (i == readlen) {
-                    readlen = fread(buffer, 1, 1, tap->fd);
-                    if (readlen == 0) {
-                        continue;
-                    }
-                    i = 0;
-                }
-                if (buffer[i] == 0) {
-                    long still_in_buffer = readlen - (i + 1);
-                    needed = 3 - still_in_buffer;
-                    if (needed <= 0) {
-                        pulse_length2 = ((buffer[i + 3] << 16) | (buffer[i + 2] << 8) | buffer[i + 1]) >> 3;
-                        i += 4;
-                    } else {
-                        /* There is not enough in the buffer
-                           Read some more */
-                        memcpy(buffer, buffer + i + 1, still_in_buffer);
-                        res = (int)fread(buffer + still_in_buffer, 1, needed, tap->fd);
-                        i = readlen;
-                        if (res == 0) {
-                            continue;
-                        }
-                        pulse_length2 = ((buffer[2] << 16) | (buffer[1] << 8) | buffer[0]) >> 3;
-                    }
-                } else {
-                    pulse_length2 = buffer[i];
-                    i++;
-                }
-                data[j] += pulse_length2;
-            }
-            j++;
+    for (pos = tap->data_pos; (countCBM < minCBM) && (countTT < PILOT_MIN_LENGTH_TT * 8); pos = next) {
+        next = pos;
+        data = tap_decode_pulse(tap, &next);
+        if (data < 0) {
+            tap->data_pos = pos;
+            return -1;
         }
-        count = j;
-        pos[j] = ftell(tap->fd);
 
-/*        for (i = 0, count = 0; i < 256; i++, count++) {
-            pos[i] = ftell(tap->fd);
-            data[i] = tap_get_pulse(tap);
-            if (data[i] < 0) break;
-        }
-        pos[i] = ftell(tap->fd);*/
-        if (count < 1) {
-            return -1;
+        if (type == PILOT_TYPE_ANY || type == PILOT_TYPE_CBM) {
+            /* cbm pilot is at least PILOT_MIN_LENGTH_CBM consecutive short pulses */
+            if (TAP_PULSE_SHORT(data)) {
+                countCBM++;
+            } else {
+                startCBM = next;
+                countCBM = 0;
+            }
         }
 
-        for (i = 0; (i < count) && (countCBM < minCBM) && (countTT < PILOT_MIN_LENGTH_TT * 8); i++) {
-            if (type == PILOT_TYPE_ANY || type == PILOT_TYPE_CBM) {
-                /* cbm pilot is at least PILOT_MIN_LENGTH_CBM consecutive short pulses */
-                if (TAP_PULSE_SHORT(data[i])) {
-                    countCBM++;
+        if (type == PILOT_TYPE_ANY || type == PILOT_TYPE_TT) {
+            /* TurboTape pilot is PILOT_MIN_LENGTH_TT or more repeats of the value 0x02.
+               Accept any long bit sequence of 1000000010000000100...
+               Trust that reading the header will fail if we detect a wrong
+               sequence (in that case we come back here) */
+            if ((countTT & 7) == 0) {
+                if (TAP_PULSE_TT_LONG(data)) {
+                    countTT++;
                 } else {
-                    startCBM = pos[i + 1];
-                    countCBM = 0;
+                    startTT = next;
+                    countTT = 0;
                 }
-
-/*                  { startCBM+=countCBM+1; countCBM = 0; } */
-            }
-
-            if (type == PILOT_TYPE_ANY || type == PILOT_TYPE_TT) {
-                /* TurboTape pilot is PILOT_MIN_LENGTH_TT or more repeats of the value 0x02.
-                   Accept any long bit sequence of 1000000010000000100...
-                   Trust that reading the header will fail if we detect a wrong
-                   sequence (in that case we come back here) */
-                if ((countTT & 7) == 0) {
-                    if (TAP_PULSE_TT_LONG(data[i])) {
-                        countTT++;
-                    } else {
-                        startTT = pos[i + 1];
-                        countTT = 0;
-                    }
-/*                      { startTT+=countTT+1; countTT = 0; } */
+            } else {
+                if (TAP_PULSE_TT_SHORT(data)) {
+                    countTT++;
+                } else if (TAP_PULSE_TT_LONG(data)) {
+                    startTT = pos;
+                    countTT = 1;
                 } else {
-                    if (TAP_PULSE_TT_SHORT(data[i])) {
-                        countTT++;
-                    } else if (TAP_PULSE_TT_LONG(data[i])) {
-                        startTT = pos[i];
-                        countTT = 1;
-                    }
-/*                      { startTT+=countTT; countTT = 1; } */
-                    else {
-                        startTT = pos[i + 1];
-                        countTT = 0;
-                    }
-/*                      { startTT+=countTT+1; countTT = 0; } */
+                    startTT = next;
+                    countTT = 0;
                 }
             }
         }
@@ -1399,9 +1390,9 @@ static int tap_find_pilot(tap_t *tap, int type)
 
 #if TAP_DEBUG > 0
     if (countTT >= PILOT_MIN_LENGTH_TT * 8) {
-        log_debug(" found TT pilot(0x%X)", startTT + 2);
+        log_debug(" found TT pilot(0x%lX)", startTT + 2);
     } else {
-        log_debug(" found CBM pilot(0x%X)", startCBM);
+        log_debug(" found CBM pilot(0x%lX)", startCBM);
     }
 #endif
 
@@ -1409,10 +1400,10 @@ static int tap_find_pilot(tap_t *tap, int type)
         /* startTT points to a '1' bit which we assume to be part of the
            value 00000010.  Skip over the 1 and following 0 so we start
            at the beginning of a 00000010 sequence */
-        fseek(tap->fd, startTT + 2, SEEK_SET);
+        tap->data_pos = startTT + 2;
         return 1;
     } else {
-        fseek(tap->fd, startCBM, SEEK_SET);
+        tap->data_pos = startCBM;
         return 0;
     }
 }
@@ -1432,23 +1423,22 @@ static int tap_find_header(tap_t *tap)
         }
 
         /* store current position in TAP file */
-        fpos = ftell(tap->fd);
+        fpos = tap->data_pos;
 
         /* try to read a header */
         if (type == PILOT_TYPE_CBM) {
             res = tap_cbm_read_header(tap);
             if (res < 0) {
                 int pulse;
-                fseek(tap->fd, fpos, SEEK_SET);
+                tap->data_pos = fpos;
                 do {
-                    int pos_advance;
-                    pulse = tap_get_pulse(tap, &pos_advance);
+                    pulse = tap_get_pulse(tap);
                 } while (TAP_PULSE_SHORT(pulse));
             }
         } else if (type == PILOT_TYPE_TT) {
             res = tap_tt_read_header(tap);
             if (res < 0) {
-                fseek(tap->fd, fpos, SEEK_SET);
+                tap->data_pos = fpos;
                 tap_tt_skip_pilot(tap);
             }
         } else {
@@ -1462,7 +1452,7 @@ static int tap_find_header(tap_t *tap)
             }
 
             /* success.  Rewind to start of header and return. */
-            fseek(tap->fd, fpos, SEEK_SET);
+            tap->data_pos = fpos;
             tap->current_file_seek_position = (int)fpos;
             return type;
         }
@@ -1479,8 +1469,12 @@ static int tap_read_file(tap_t *tap)
     log_debug("\nTAP_READ_FILE(START)\n");
 #endif
 
+    if (tap_load_data(tap) < 0) {
+        return -1;
+    }
+
     /* store current position in TAP file */
-    fpos = ftell(tap->fd);
+    fpos = tap->data_pos;
 
     /* clear old file data */
     tap->current_file_size = 0;
@@ -1506,7 +1500,7 @@ static int tap_read_file(tap_t *tap)
     }
 
     /* go back to previous position in TAP file */
-    fseek(tap->fd, fpos, SEEK_SET);
+    tap->data_pos = fpos;
 
 #if TAP_DEBUG > 0
     log_debug("\nTAP_READ_FILE(END%i)\n", ret);
@@ -1564,13 +1558,26 @@ int tap_seek_start(tap_t *tap)
 
     tap->current_file_number = -1;
     tap->current_file_seek_position = 0;
+    tap->data_pos = tap->offset;
     fseek(tap->fd, tap->offset, SEEK_SET);
     return 0;
 }
 
 int tap_seek_to_file(tap_t *tap, unsigned int file_number)
 {
+    int known;
+
     tap_seek_start(tap);
+
+    /* go straight to the nearest header found before */
+    if (tap->files_generation == tap_pulse_generation && tap->files_num > 0) {
+        known = ((int)file_number < tap->files_num) ? (int)file_number : tap->files_num - 1;
+        tap->data_pos = tap->files[known].offset;
+        tap->current_file_seek_position = (int)tap->files[known].offset;
+        *tap->tap_file_record = tap->files[known].record;
+        tap->current_file_number = known;
+    }
+
     while ((int) file_number > tap->current_file_number) {
         if (tap_seek_to_next_file(tap, 0) < 0) {
             return -1;
@@ -1586,6 +1593,10 @@ int tap_seek_to_next_file(tap_t *tap, unsigned int allow_rewind)
         return -1;
     }
 
+    if (tap_load_data(tap) < 0) {
+        return -1;
+    }
+
     /* clear old file content buffer */
     tap->current_file_size = 0;
     lib_free(tap->current_file_data);
@@ -1609,6 +1620,7 @@ int tap_seek_to_next_file(tap_t *tap, unsigned int allow_rewind)
     }
 
     tap->current_file_number++;
+    tap_add_file(tap);
     return 0;
 }
 
@@ -1653,6 +1665,7 @@ int tap_seek_to_offset(tap_t *tap, unsigned long offset)
 {
     if (tap && tap->fd) {
         fseek(tap->fd, offset, SEEK_SET);
+        tap->data_pos = (long)offset;
         tap->current_file_seek_position = (int)offset;
         return 0;
     }
@@ -1673,6 +1686,7 @@ void tap_init(const tape_init_t *init)
     tap_pulse_middle_max = init->pulse_middle_max / 8;
     tap_pulse_long_min = init->pulse_long_min / 8;
     tap_pulse_long_max = init->pulse_long_max / 8;
+    tap_pulse_generation++;
 
     if (tape_log == LOG_DEFAULT) {
         tape_log = log_open("TAP");
@@ -0,0 +1,332 @@
+/** \file   shmread.c
+ * \brief   Reader for the frames and audio VICE publishes in shared memory
+ *
+ * Maps a shared memory object created with the -shmexport option and
+ * follows the frame and audio rings.  For every frame it prints the
+ * sequence number, the size and a checksum of the pixel data, which is
+ * enough to compare runs in automated tests.  Frames can also be written
+ * as PPM images and the audio as raw 16 bit samples.
+ *
+ * Usage: shmread [-n frames] [-p prefix] [-a file] [-t seconds] name
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shmdrv.h"
+
+/* how long to sleep between two polls of the sequence numbers */
+#define POLL_INTERVAL_NS    (1000 * 1000)
+
+static const uint8_t *shm_base = NULL;
+static const shm_export_header_t *header = NULL;
+
+/* FNV-1a, only used to tell frames apart */
+static uint32_t checksum(const uint8_t *data, size_t size, uint32_t hash)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619U;
+    }
+    return hash;
+}
+
+static int write_ppm(const char *prefix, uint64_t seq, const shm_export_frame_t *frame)
+{
+    const uint8_t *data = (const uint8_t *)frame + sizeof(shm_export_frame_t);
+    char name[4096];
+    uint8_t *line;
+    uint32_t x, y;
+    FILE *f;
+
+    snprintf(name, sizeof(name), "%s%06lu.ppm", prefix, (unsigned long)seq);
+    f = fopen(name, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "shmread: cannot create %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+
+    line = malloc((size_t)frame->width * 3);
+    if (line == NULL) {
+        fclose(f);
+        return -1;
+    }
+
+    fprintf(f, "P6\n%u %u\n255\n", frame->width, frame->height);
+    for (y = 0; y < frame->height; y++) {
+        const uint8_t *src = data + (size_t)y * frame->line_size;
+
+        if (header->video_format == SHM_EXPORT_RGB24) {
+            memcpy(line, src, (size_t)frame->width * 3);
+        } else {
+            for (x = 0; x < frame->width; x++) {
+                memcpy(&line[x * 3], &frame->palette[src[x] * 3], 3);
+            }
+        }
+        fwrite(line, 3, frame->width, f);
+    }
+
+    free(line);
+    fclose(f);
+    return 0;
+}
+
+/* Handle frame `seq'.  Returns 0 if the frame was read, -1 if the writer
+   overwrote it while (or before) it was read.  */
+static int read_frame(uint64_t seq, const char *prefix)
+{
+    const shm_export_frame_t *frame;
+    const uint8_t *data;
+    uint32_t hash;
+    uint32_t width, height, line_size;
+    size_t bpp;
+
+    frame = (const shm_export_frame_t *)(shm_base + header->frames_offset
+                                         + ((seq - 1) % header->num_frames) * header->frame_slot_size);
+    if (frame->seq != seq) {
+        return -1;
+    }
+    SHM_EXPORT_BARRIER();
+
+    width = frame->width;
+    height = frame->height;
+    line_size = frame->line_size;
+    bpp = (header->video_format == SHM_EXPORT_RGB24) ? 3 : 1;
+    if (width > header->max_width || height > header->max_height
+        || line_size < width * bpp
+        || (size_t)line_size * height > header->frame_slot_size - sizeof(shm_export_frame_t)) {
+        return -1;
+    }
+
+    data = (const uint8_t *)frame + sizeof(shm_export_frame_t);
+    hash = checksum(data, (size_t)line_size * height, 2166136261U);
+    if (bpp == 1) {
+        hash = checksum(frame->palette, sizeof(frame->palette), hash);
+    }
+
+    if (prefix != NULL && write_ppm(prefix, seq, frame) < 0) {
+        return -1;
+    }
+
+    SHM_EXPORT_BARRIER();
+    if (frame->seq != seq) {
+        return -1;
+    }
+
+    printf("frame %lu %ux%u %08x\n", (unsigned long)seq, width, height, hash);
+    return 0;
+}
+
+static int read_block(uint64_t seq, FILE *audio)
+{
+    const shm_export_block_t *block;
+    uint32_t samples;
+
+    block = (const shm_export_block_t *)(shm_base + header->blocks_offset
+                                         + ((seq - 1) % header->num_blocks) * header->block_slot_size);
+    if (block->seq != seq) {
+        return -1;
+    }
+    SHM_EXPORT_BARRIER();
+
+    samples = block->samples;
+    if (samples > SHM_EXPORT_BLOCK_SAMPLES) {
+        return -1;
+    }
+    if (audio != NULL) {
+        fwrite((const uint8_t *)block + sizeof(shm_export_block_t), sizeof(int16_t), samples, audio);
+    }
+
+    SHM_EXPORT_BARRIER();
+    return (block->seq == seq) ? 0 : -1;
+}
+
+static void usage(const char *progname)
+{
+    fprintf(stderr,
+            "Usage: %s [-n frames] [-p prefix] [-a file] [-t seconds] name\n"
+            "\n"
+            "  -n frames   stop after this many frames (default: until VICE stops)\n"
+            "  -p prefix   write every frame to <prefix><number>.ppm\n"
+            "  -a file     write the audio as raw signed 16 bit samples\n"
+            "  -t seconds  give up if no frame arrives for this long (default 10)\n",
+            progname);
+}
+
+int main(int argc, char **argv)
+{
+    const char *prefix = NULL;
+    const char *audio_name = NULL;
+    FILE *audio = NULL;
+    char *name;
+    unsigned long max_frames = 0;
+    unsigned long frames = 0;
+    unsigned long dropped = 0;
+    unsigned long timeout = 10;
+    unsigned long idle = 0;
+    uint64_t next_frame = 1;
+    uint64_t next_block = 1;
+    struct stat st;
+    struct timespec poll_interval = { 0, POLL_INTERVAL_NS };
+    int opt;
+    int fd;
+
+    while ((opt = getopt(argc, argv, "n:p:a:t:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                max_frames = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                prefix = optarg;
+                break;
+            case 'a':
+                audio_name = optarg;
+                break;
+            case 't':
+                timeout = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    name = malloc(strlen(argv[optind]) + 2);
+    if (name == NULL) {
+        return EXIT_FAILURE;
+    }
+    sprintf(name, "%s%s", argv[optind][0] == '/' ? "" : "/", argv[optind]);
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "shmread: cannot open %s: %s\n", name, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(shm_export_header_t)) {
+        fprintf(stderr, "shmread: %s is too small\n", name);
+        return EXIT_FAILURE;
+    }
+
+    shm_base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (shm_base == MAP_FAILED) {
+        fprintf(stderr, "shmread: cannot map %s: %s\n", name, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    header = (const shm_export_header_t *)shm_base;
+    if (memcmp(header->magic, SHM_EXPORT_MAGIC, sizeof(SHM_EXPORT_MAGIC)) != 0
+        || header->version != SHM_EXPORT_VERSION
+        || header->num_frames == 0 || header->num_blocks == 0
+        || header->frames_offset + (uint64_t)header->num_frames * header->frame_slot_size > (uint64_t)st.st_size
+        || header->blocks_offset + (uint64_t)header->num_blocks * header->block_slot_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "shmread: %s is not a VICE export of version %d\n", name, SHM_EXPORT_VERSION);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %s %ux%u, %u frames, %u/%u cycles per second/frame\n",
+           name,
+           header->video_format == SHM_EXPORT_RGB24 ? "rgb24" : "indexed8",
+           header->max_width, header->max_height, header->num_frames,
+           header->cycles_per_second, header->cycles_per_frame);
+
+    if (audio_name != NULL) {
+        audio = fopen(audio_name, "wb");
+        if (audio == NULL) {
+            fprintf(stderr, "shmread: cannot create %s: %s\n", audio_name, strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* start with what is still in the rings */
+    if (header->frame_seq > header->num_frames) {
+        next_frame = header->frame_seq - header->num_frames + 1;
+    }
+    if (header->block_seq > header->num_blocks) {
+        next_block = header->block_seq - header->num_blocks + 1;
+    }
+
+    while (max_frames == 0 || frames < max_frames) {
+        uint64_t frame_seq = header->frame_seq;
+        uint64_t block_seq = header->block_seq;
+        int progress = 0;
+
+        SHM_EXPORT_BARRIER();
+
+        for (; next_block <= block_seq; next_block++) {
+            if (block_seq - next_block >= header->num_blocks || read_block(next_block, audio) < 0) {
+                next_block = block_seq - header->num_blocks + 1;
+            }
+            progress = 1;
+        }
+
+        for (; next_frame <= frame_seq && (max_frames == 0 || frames < max_frames); next_frame++) {
+            if (frame_seq - next_frame >= header->num_frames || read_frame(next_frame, prefix) < 0) {
+                dropped++;
+            } else {
+                frames++;
+            }
+            progress = 1;
+        }
+
+        if (progress) {
+            idle = 0;
+            fflush(stdout);
+            continue;
+        }
+
+        if (!header->active && header->frame_seq == frame_seq) {
+            break;
+        }
+
+        nanosleep(&poll_interval, NULL);
+        if (++idle > timeout * (1000000000UL / POLL_INTERVAL_NS)) {
+            fprintf(stderr, "shmread: no frame for %lu seconds\n", timeout);
+            break;
+        }
+    }
+
+    if (audio != NULL) {
+        fclose(audio);
+    }
+
+    printf("%lu frames read, %lu dropped\n", frames, dropped);
+    free(name);
+
+    return dropped > 0 && frames == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -121,6 +121,28 @@ int vdrive_iec_switch(vdrive_t *vdrive, bufferinfo_t *p)
     return status;
 }
 
+/* Release the pool sectors held by a channel.  */
+static void iec_put_blocks(vdrive_t *vdrive, bufferinfo_t *p)
+{
+    vdrive_put_block(vdrive, p->block);
+    vdrive_put_block(vdrive, p->block_next);
+    p->block = NULL;
+    p->block_next = NULL;
+}
+
+/* Read the next linked sector of a file ahead, so it is at hand when the
+   channel gets there, even if other channels moved the head meanwhile.  */
+static void iec_read_ahead(vdrive_t *vdrive, bufferinfo_t *p)
+{
+    int status;
+
+    p->block_next = NULL;
+    if (p->block->data[0] != 0) {
+        p->block_next = vdrive_get_block(vdrive, p->block->data[0],
+                                         p->block->data[1], &status);
+    }
+}
+
 static int iec_open_read_sequential(vdrive_t *vdrive, unsigned int secondary, unsigned int track, unsigned int sector)
 {
     int status;
@@ -128,18 +150,23 @@ static int iec_open_read_sequential(vdrive_t *vdrive, unsigned int secondary, un
 
     /* we should already be in the proper partition at this point */
     vdrive_alloc_buffer(p, BUFFER_SEQUENTIAL);
+    iec_put_blocks(vdrive, p);
     p->bufptr = 2;
     p->record = 1;
 
-    status = vdrive_read_sector(vdrive, p->buffer, track, sector);
-    p->length = p->buffer[0] ? 0 : p->buffer[1];
-
-    vdrive_set_last_read(track, sector, p->buffer);
+    /* read from the pool, shared with other channels on the same file */
+    p->block = vdrive_get_block(vdrive, track, sector, &status);
 
     if (status != 0) {
         vdrive_iec_close(vdrive, secondary);
         return SERIAL_ERROR;
     }
+
+    p->length = p->block->data[0] ? 0 : p->block->data[1];
+    vdrive_set_last_read(track, sector, p->block->data);
+
+    iec_read_ahead(vdrive, p);
+
     return SERIAL_OK;
 }
 
@@ -865,6 +892,7 @@ static int iec_close_sequential(vdrive_t *vdrive, unsigned int secondary)
         lib_free(p->slot);
     }
     /* Release buffers */
+    iec_put_blocks(vdrive, p);
     vdrive_free_buffer(p);
 
     return SERIAL_OK;
@@ -924,7 +952,11 @@ static int iec_read_sequential(vdrive_t *vdrive, uint8_t *data,
         return SERIAL_ERROR;
     }
 
-    *data = p->buffer[p->bufptr];
+    if (p->block != NULL) {
+        *data = p->block->data[p->bufptr];
+    } else {
+        *data = p->buffer[p->bufptr];
+    }
     if (p->length != 0) {
         if (p->bufptr == p->length) {
             p->bufptr = 0xff;
@@ -944,16 +976,28 @@ static int iec_read_sequential(vdrive_t *vdrive, uint8_t *data,
 
     switch (p->mode) {
         case BUFFER_SEQUENTIAL:
+            if (p->block == NULL) {
+                p->readmode = CBMDOS_FAM_EOF;
+                break;
+            }
 
-            track = (unsigned int)p->buffer[0];
-            sector = (unsigned int)p->buffer[1];
+            track = (unsigned int)p->block->data[0];
+            sector = (unsigned int)p->block->data[1];
 
-            status = vdrive_read_sector(vdrive, p->buffer, track, sector);
-            p->length = p->buffer[0] ? 0 : p->buffer[1];
-            vdrive_set_last_read(track, sector, p->buffer);
+            /* use the sector read ahead, unless it was written since */
+            status = CBMDOS_IPE_OK;
+            if (!vdrive_block_is(vdrive, p->block_next, track, sector)) {
+                vdrive_put_block(vdrive, p->block_next);
+                p->block_next = vdrive_get_block(vdrive, track, sector, &status);
+            }
 
             if (status == 0) {
+                vdrive_put_block(vdrive, p->block);
+                p->block = p->block_next;
+                p->length = p->block->data[0] ? 0 : p->block->data[1];
+                vdrive_set_last_read(track, sector, p->block->data);
                 p->bufptr = 2;
+                iec_read_ahead(vdrive, p);
             } else {
                 p->readmode = CBMDOS_FAM_EOF;
             }
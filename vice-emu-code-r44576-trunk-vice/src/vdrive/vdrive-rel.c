@@ -156,6 +156,45 @@ static void vdrive_rel_commit(vdrive_t *vdrive, bufferinfo_t *p)
     return;
 }
 
+/* Read a data sector, from the pool if it was read ahead or another
+   channel holds it.  The REL buffers are written to, so it is copied.  */
+static int vdrive_rel_read_sector(vdrive_t *vdrive, bufferinfo_t *p, uint8_t *buf, unsigned int track, unsigned int sector)
+{
+    vdrive_block_t *block;
+    int status = CBMDOS_IPE_OK;
+
+    if (vdrive_block_is(vdrive, p->block_next, track, sector)) {
+        block = p->block_next;
+        p->block_next = NULL;
+    } else {
+        block = vdrive_get_block(vdrive, track, sector, &status);
+    }
+    if (block == NULL) {
+        return status;
+    }
+
+    memcpy(buf, block->data, 256);
+    vdrive_put_block(vdrive, block);
+
+    return CBMDOS_IPE_OK;
+}
+
+/* Read the sector linked from the current one ahead into the pool, unless
+   it is already in the second buffer.  */
+static void vdrive_rel_read_ahead(vdrive_t *vdrive, bufferinfo_t *p)
+{
+    unsigned int track = p->buffer[0], sector = p->buffer[1];
+    int status;
+
+    if (track == 0 || (track == p->track_next && sector == p->sector_next)
+        || vdrive_block_is(vdrive, p->block_next, track, sector)) {
+        return;
+    }
+
+    vdrive_put_block(vdrive, p->block_next);
+    p->block_next = vdrive_get_block(vdrive, track, sector, &status);
+}
+
 static int vdrive_rel_add_sector(vdrive_t *vdrive, unsigned int secondary, unsigned int *track, unsigned int *sector)
 {
     bufferinfo_t *p = &(vdrive->buffers[secondary]);
@@ -889,16 +928,19 @@ int vdrive_rel_open(vdrive_t *vdrive, unsigned int secondary,
         return SERIAL_ERROR;
     }
 
-    /* Allocate dual buffers to improve performance */
-    p->mode = BUFFER_RELATIVE;
+    /* Allocate dual buffers to improve performance; they are kept with
+       the channel and only freed at shutdown */
+    vdrive_alloc_buffer(p, BUFFER_RELATIVE);
     p->bufptr = 0;
-    p->buffer = lib_malloc(256);
     p->record = 0;
     p->track = 0;
     p->sector = 0;
-    p->buffer_next = lib_malloc(256);
+    if (p->buffer_next == NULL) {
+        p->buffer_next = lib_malloc(256);
+    }
     p->track_next = 0;
     p->sector_next = 0;
+    p->block_next = NULL;
 
     /* Determine maximum record */
     p->record_max = vdrive_rel_record_max(vdrive, secondary);
@@ -1133,7 +1175,7 @@ static int vdrive_rel_position_internal(vdrive_t *vdrive, unsigned int secondary
         vdrive_rel_commit(vdrive, p);
 
         /* load in the sector to memory */
-        if (vdrive_read_sector(vdrive, p->buffer, track, sector) != 0) {
+        if (vdrive_rel_read_sector(vdrive, p, p->buffer, track, sector) != 0) {
             log_error(vdrive_rel_log, "Cannot read track %u sector %u.",
                     track, sector);
 #if 0
@@ -1195,7 +1237,7 @@ static int vdrive_rel_position_internal(vdrive_t *vdrive, unsigned int secondary
         if (p->buffer[0] != 0) {
             /* Read in the sector if it has not been buffered */
             if (p->buffer[0] != p->track_next || p->buffer[1] != p->sector_next) {
-                status = vdrive_read_sector(vdrive, p->buffer_next, p->buffer[0], p->buffer[1]);
+                status = vdrive_rel_read_sector(vdrive, p, p->buffer_next, p->buffer[0], p->buffer[1]);
             } else {
                 status = 0;
             }
@@ -1267,7 +1309,7 @@ int vdrive_rel_read(vdrive_t *vdrive, uint8_t *data, unsigned int secondary)
             } else if (p->track != track || p->sector != sector) {
                 /* load in the sector to memory */
                 vdrive_iec_switch(vdrive, p);
-                status = vdrive_read_sector(vdrive, p->buffer, track, sector);
+                status = vdrive_rel_read_sector(vdrive, p, p->buffer, track, sector);
             }
 
             if (status == 0) {
@@ -1276,8 +1318,9 @@ int vdrive_rel_read(vdrive_t *vdrive, uint8_t *data, unsigned int secondary)
                 p->bufptr = p->bufptr - 254;
                 p->length = p->length - 254;
                 p->record_next = p->record_next - 254;
-                /* keep buffered sector where ever it is */
-                /* we won't read in the next sector unless we have to */
+                /* keep buffered sector where ever it is, but have the
+                   following one read ahead into the pool */
+                vdrive_rel_read_ahead(vdrive, p);
             } else {
                 log_error(vdrive_rel_log, "Cannot read track %u sector %u.",
                         track, sector);
@@ -1344,7 +1387,7 @@ int vdrive_rel_read(vdrive_t *vdrive, uint8_t *data, unsigned int secondary)
                 /* Read in the sector if it has not been buffered */
                 if (p->buffer[0] != p->track_next || p->buffer[1] != p->sector_next) {
                     vdrive_iec_switch(vdrive, p);
-                    status = vdrive_read_sector(vdrive, p->buffer_next, p->buffer[0], p->buffer[1]);
+                    status = vdrive_rel_read_sector(vdrive, p, p->buffer_next, p->buffer[0], p->buffer[1]);
                 } else {
                     status = 0;
                 }
@@ -1523,13 +1566,10 @@ int vdrive_rel_close(vdrive_t *vdrive, unsigned int secondary)
     /* Commit the buffers. */
     vdrive_rel_commit(vdrive, p);
 
-    p->mode = BUFFER_NOT_IN_USE;
-
-    lib_free((char *)p->buffer);
-    p->buffer = NULL;
+    vdrive_put_block(vdrive, p->block_next);
+    p->block_next = NULL;
 
-    lib_free((char *)p->buffer_next);
-    p->buffer_next = NULL;
+    vdrive_free_buffer(p);
 
     vdrive_rel_shutdown_ss_buffers(vdrive, secondary);
 
@@ -74,6 +74,8 @@
 
 static log_t vdrive_log = LOG_ERR;
 
+static void invalidate_block(vdrive_t *vdrive, const disk_addr_t *dadr);
+
 void vdrive_init(void)
 {
     vdrive_log = log_open("VDrive");
@@ -152,6 +154,18 @@ int vdrive_device_setup(vdrive_t *vdrive, unsigned int unit)
     for (i = 0; i < 15; i++) {
         vdrive->buffers[i].mode = BUFFER_NOT_IN_USE;
         vdrive->buffers[i].buffer = NULL;
+        vdrive->buffers[i].buffer_next = NULL;
+        vdrive->buffers[i].block = NULL;
+        vdrive->buffers[i].block_next = NULL;
+    }
+
+    /* init the sector pool, allocated once for the lifetime of the drive */
+    if (vdrive->blocks == NULL) {
+        vdrive->blocks = lib_malloc(VDRIVE_NUM_BLOCKS * sizeof(vdrive_block_t));
+    }
+    for (i = 0; i < VDRIVE_NUM_BLOCKS; i++) {
+        vdrive->blocks[i].image = NULL;
+        vdrive->blocks[i].refs = 0;
     }
 
     /* init command channel */
@@ -176,7 +190,13 @@ void vdrive_device_shutdown(vdrive_t *vdrive)
             p = &(vdrive->buffers[i]);
             vdrive_free_buffer(p);
             lib_free(p->buffer);
+            lib_free(p->buffer_next);
+            p->buffer_next = NULL;
+            p->block = NULL;
+            p->block_next = NULL;
         }
+        lib_free(vdrive->blocks);
+        vdrive->blocks = NULL;
     }
 }
 
@@ -369,6 +389,7 @@ void vdrive_detach_image(disk_image_t *image, unsigned int unit,
             vdrive->selected_part = -1;
         }
     }
+    vdrive_invalidate_blocks(vdrive, image);
     vdrive->images[drive] = NULL;
 }
 
@@ -988,6 +1009,7 @@ int vdrive_write_sector(vdrive_t *vdrive, const uint8_t *buf, unsigned int track
 #if 0
     ui_display_drive_track(vdrive->unit - 8, 0, dadr.track * 2);
 #endif
+    invalidate_block(vdrive, &dadr);
     ret = disk_image_write_sector(vdrive->image, buf, &dadr);
 
 #ifdef DEBUG_DRIVE
@@ -1010,9 +1032,134 @@ int vdrive_write_sector_physical(vdrive_t *vdrive, const uint8_t *buf, unsigned
     disk_addr_t dadr;
     dadr.track = track;
     dadr.sector = sector;
+    invalidate_block(vdrive, &dadr);
     return disk_image_write_sector(vdrive->image, buf, &dadr);
 }
 
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Pool of sectors shared by the channels.  A channel reading a file holds
+ * the sector it reads from and the next linked one, which is read ahead.
+ * Channels on the same sector share a single copy.  A sector only stays in
+ * the pool while a channel holds it, so no stale data is handed out when
+ * the image is changed behind the back of the virtual drive.
+ */
+
+/* Stop handing out the pooled copy of a sector that is written.  */
+static void invalidate_block(vdrive_t *vdrive, const disk_addr_t *dadr)
+{
+    unsigned int i;
+
+    if (vdrive->blocks == NULL) {
+        return;
+    }
+
+    for (i = 0; i < VDRIVE_NUM_BLOCKS; i++) {
+        vdrive_block_t *block = &(vdrive->blocks[i]);
+
+        if (block->image == vdrive->image && block->image != NULL
+            && block->track == dadr->track && block->sector == dadr->sector) {
+            block->image = NULL;
+        }
+    }
+}
+
+/* Get the sector from the pool, or read it from the image.  Returns NULL
+   and the error in `status' if it cannot be read.  */
+vdrive_block_t *vdrive_get_block(vdrive_t *vdrive, unsigned int track, unsigned int sector, int *status)
+{
+    disk_addr_t dadr;
+    vdrive_block_t *block = NULL;
+    unsigned int i;
+    int ret;
+
+    /* update image mode if disk is attached */
+    if (vdrive->image) {
+        vdrive->image_mode = vdrive->image->read_only;
+    }
+    /* check image mode */
+    if (vdrive->image_mode < 0 || vdrive->blocks == NULL) {
+        *status = CBMDOS_IPE_NOT_READY;
+        return NULL;
+    }
+    if (vdrive_log_to_phy(vdrive, &dadr, track, sector) < 0) {
+        *status = CBMDOS_IPE_NOT_READY;
+        return NULL;
+    }
+
+    for (i = 0; i < VDRIVE_NUM_BLOCKS; i++) {
+        vdrive_block_t *b = &(vdrive->blocks[i]);
+
+        if (b->image == vdrive->image && b->image != NULL
+            && b->track == dadr.track && b->sector == dadr.sector) {
+            b->refs++;
+            *status = CBMDOS_IPE_OK;
+            return b;
+        }
+        if (block == NULL && b->refs == 0) {
+            block = b;
+        }
+    }
+
+    if (block == NULL) {
+        log_error(vdrive_log, "No free sector in the pool of unit %u.", vdrive->unit);
+        *status = CBMDOS_IPE_NO_CHANNEL;
+        return NULL;
+    }
+
+    ret = disk_image_read_sector(vdrive->image, block->data, &dadr);
+#ifdef DEBUG_DRIVE
+    log_debug("VDRIVE: get_block %u %u = %d", dadr.track, dadr.sector, ret);
+#endif
+    if (ret != 0) {
+        *status = ret;
+        return NULL;
+    }
+
+    block->image = vdrive->image;
+    block->track = dadr.track;
+    block->sector = dadr.sector;
+    block->refs = 1;
+    *status = CBMDOS_IPE_OK;
+    return block;
+}
+
+void vdrive_put_block(vdrive_t *vdrive, vdrive_block_t *block)
+{
+    if (block != NULL && block->refs > 0 && --block->refs == 0) {
+        block->image = NULL;
+    }
+}
+
+/* Check if `block' is the current content of the sector.  */
+int vdrive_block_is(vdrive_t *vdrive, const vdrive_block_t *block, unsigned int track, unsigned int sector)
+{
+    disk_addr_t dadr;
+
+    if (block == NULL || block->image == NULL || block->image != vdrive->image
+        || vdrive_log_to_phy(vdrive, &dadr, track, sector) < 0) {
+        return 0;
+    }
+    return block->track == dadr.track && block->sector == dadr.sector;
+}
+
+/* Stop handing out the sectors of `image', or of all images if NULL.  */
+void vdrive_invalidate_blocks(vdrive_t *vdrive, const struct disk_image_s *image)
+{
+    unsigned int i;
+
+    if (vdrive->blocks == NULL) {
+        return;
+    }
+
+    for (i = 0; i < VDRIVE_NUM_BLOCKS; i++) {
+        if (image == NULL || vdrive->blocks[i].image == image) {
+            vdrive->blocks[i].image = NULL;
+        }
+    }
+}
+
 /* For external access to individual drives */
 int vdrive_ext_read_sector(vdrive_t *vdrive, int drive, uint8_t *buf,
     unsigned int track, unsigned int sector)
@@ -87,6 +87,22 @@
 #define SERIAL_EOF                      (0x40)
 #define SERIAL_DEVICE_NOT_PRESENT       (0x80)
 
+/* Size of the sector pool of a drive: the current and the read ahead
+   sector of every channel.  */
+#define VDRIVE_NUM_BLOCKS       32
+
+/* A sector of the image in the pool.  Channels reading the same sector
+   share it.  When the sector is written, or the image detached, `image'
+   is cleared: the holders keep their copy, but it is not handed out
+   again.  */
+typedef struct vdrive_block_s {
+    struct disk_image_s *image;
+    unsigned int track;        /* physical address */
+    unsigned int sector;
+    unsigned int refs;
+    uint8_t data[256];
+} vdrive_block_t;
+
 typedef struct bufferinfo_s {
     unsigned int mode;     /* Mode on this buffer */
     unsigned int readmode; /* Is this channel for reading or writing */
@@ -128,6 +144,9 @@ typedef struct bufferinfo_s {
                                   written (from REL write) */
     uint8_t super_side_sector_needsupdate; /* similar to above */
 
+    vdrive_block_t *block;      /* pool sector read from (SEQ read) */
+    vdrive_block_t *block_next; /* next linked sector, read ahead */
+
 } bufferinfo_t;
 
 struct disk_image_s;
@@ -186,6 +205,7 @@ typedef struct vdrive_s {
     unsigned int bam_size;
     uint8_t *bam;              /* Disk header blk (if any) followed by BAM blocks */
     bufferinfo_t buffers[16];
+    vdrive_block_t *blocks;    /* VDRIVE_NUM_BLOCKS shared sectors */
 
     /* Memory read command buffer.  */
     uint8_t mem_buf[256];
@@ -249,6 +269,11 @@ int vdrive_write_sector(vdrive_t *vdrive, const uint8_t *buf, unsigned int track
 int vdrive_read_sector_physical(vdrive_t *vdrive, uint8_t *buf, unsigned int track, unsigned int sector);
 int vdrive_write_sector_physical(vdrive_t *vdrive, const uint8_t *buf, unsigned int track, unsigned int sector);
 
+vdrive_block_t *vdrive_get_block(vdrive_t *vdrive, unsigned int track, unsigned int sector, int *status);
+void vdrive_put_block(vdrive_t *vdrive, vdrive_block_t *block);
+int vdrive_block_is(vdrive_t *vdrive, const vdrive_block_t *block, unsigned int track, unsigned int sector);
+void vdrive_invalidate_blocks(vdrive_t *vdrive, const struct disk_image_s *image);
+
 struct disk_image_s *vdrive_get_image(vdrive_t *vdrive, unsigned int drive);
 
 void vdrive_refresh(unsigned int unit);
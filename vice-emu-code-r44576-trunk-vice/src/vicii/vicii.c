@@ -58,6 +58,7 @@
 #include "c64dtvblitter.h"
 #include "c64dtvdma.h"
 #include "dma.h"
+#include "hostprofile.h"
 #include "lib.h"
 #include "log.h"
 #include "machine.h"
@@ -1219,6 +1220,8 @@ void vicii_raster_draw_alarm_handler(CLOCK offset, void *data)
     uint8_t prev_sprite_background_collisions;
     int in_visible_area;
 
+    HOSTPROFILE_ENTER(HOSTPROFILE_VICII);
+
     prev_sprite_sprite_collisions = vicii.sprite_sprite_collisions;
     prev_sprite_background_collisions = vicii.sprite_background_collisions;
 
@@ -1401,6 +1404,8 @@ void vicii_raster_draw_alarm_handler(CLOCK offset, void *data)
     vicii.last_emulate_line_clk += vicii.cycles_per_line;
     vicii.draw_clk = vicii.last_emulate_line_clk + vicii.draw_cycle;
     alarm_set(vicii.raster_draw_alarm, vicii.draw_clk);
+
+    HOSTPROFILE_LEAVE(HOSTPROFILE_VICII);
 }
 
 void vicii_set_canvas_refresh(int enable)
@@ -114,6 +114,13 @@ struct draw_buffer_s {
     unsigned int visible_width;
     /* Height of the visible subset of draw_buffer, in pixels */
     unsigned int visible_height;
+    /* One byte per line of draw_buffer, non-zero if the line changed since it
+       was last rendered.  Kept by raster-canvas.c, NULL if not tracked. */
+    uint8_t *dirty_lines;
+    /* Lines of the render target written by the last video_canvas_render()
+       call, damage_first > damage_last if none */
+    int damage_first;
+    int damage_last;
 };
 typedef struct draw_buffer_s draw_buffer_t;
 
@@ -211,6 +218,20 @@ typedef struct video_resources_s {
     int audioleak;              /* flag: enable video->audio leak emulation */
 } video_resources_t;
 
+/* arguments of a video_canvas_render() call */
+struct video_render_target_s {
+    uint8_t *trg;
+    int width;
+    int height;
+    int xs;
+    int ys;
+    int xt;
+    int yt;
+    int pitcht;
+    int rendermode;
+};
+typedef struct video_render_target_s video_render_target_t;
+
 /* render config for a specific canvas and video chip */
 struct video_render_config_s {
     char *chip_name;               /* chip name prefix, (use to build resource names) */
@@ -244,6 +265,13 @@ struct video_render_config_s {
     int fullscreen_mode[FULLSCREEN_MAXDEV];
     int fullscreen_custom_width; /* currently used only in the SDL port */
     int fullscreen_custom_height; /* currently used only in the SDL port */
+    /* Set by the arch if its render target keeps the last rendered frame, so
+       video_canvas_render() only needs to render the lines that changed. */
+    int partial_render;
+    /* The target still holds what the last video_canvas_render() wrote; set
+       by video_canvas_render(), cleared by the arch when it draws over it. */
+    int partial_render_valid;
+    video_render_target_t last_render;
 };
 typedef struct video_render_config_s video_render_config_t;
 
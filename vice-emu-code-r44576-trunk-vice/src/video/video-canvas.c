@@ -36,8 +36,10 @@
 
 #include "videoarch.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "lib.h"
 #include "log.h"
@@ -46,6 +48,7 @@
 #include "video-canvas.h"
 #include "video-color.h"
 #include "video-render.h"
+#include "video-sound.h"
 #include "video.h"
 #include "viewport.h"
 
@@ -104,6 +107,7 @@ void video_canvas_shutdown(video_canvas_t *canvas)
         }
 
         lib_free(canvas->videoconfig);
+        lib_free(canvas->draw_buffer->dirty_lines);
         lib_free(canvas->draw_buffer);
         lib_free(canvas->viewport);
         lib_free(canvas->geometry);
@@ -111,11 +115,75 @@ void video_canvas_shutdown(video_canvas_t *canvas)
     }
 }
 
+/* Render only the lines of the draw buffer that changed since the last call,
+   which must have been made with the same arguments.  Returns -1 if that is
+   not possible and everything has to be rendered.  */
+static int video_canvas_render_partial(video_canvas_t *canvas, uint8_t *trg, int width,
+                                       int height, int xs, int ys, int xt, int yt,
+                                       int pitcht)
+{
+    video_render_config_t *config = canvas->videoconfig;
+    video_render_target_t *last = &config->last_render;
+    draw_buffer_t *draw_buffer = canvas->draw_buffer;
+    uint8_t *dirty = draw_buffer->dirty_lines;
+    int scaley = config->scaley > 0 ? config->scaley : 1;
+    int lines, y, end, first, rows;
+
+    if (!config->partial_render || !config->partial_render_valid
+        || dirty == NULL || config->interlaced
+        || last->trg != trg || last->width != width || last->height != height
+        || last->xs != xs || last->ys != ys || last->xt != xt || last->yt != yt
+        || last->pitcht != pitcht || last->rendermode != config->rendermode) {
+        return -1;
+    }
+
+    lines = (height + scaley - 1) / scaley;
+    if (ys < 0 || ys + lines > (int)draw_buffer->draw_buffer_height) {
+        return -1;
+    }
+
+    video_sound_update(config, draw_buffer->draw_buffer, width, height, xs, ys,
+                       draw_buffer->draw_buffer_width, canvas->viewport);
+
+    for (y = 0; y < lines; y = end + 1) {
+        if (!dirty[ys + y]) {
+            end = y;
+            continue;
+        }
+        for (end = y + 1; end < lines && dirty[ys + end]; end++) {
+        }
+        /* The CRT emulation and Scale2x also use the lines above and below,
+           so render one more line on either side of the changed ones.  */
+        first = (y > 0) ? y - 1 : 0;
+        if (end > lines - 1) {
+            end = lines - 1;
+        }
+        rows = (end + 1 - first) * scaley;
+        if (rows > height - first * scaley) {
+            rows = height - first * scaley;
+        }
+
+        video_render_area(config, draw_buffer->draw_buffer, trg, width, rows,
+                          xs, ys + first, xt, yt + first * scaley,
+                          draw_buffer->draw_buffer_width, pitcht, canvas->viewport);
+
+        if (draw_buffer->damage_first > yt + first * scaley) {
+            draw_buffer->damage_first = yt + first * scaley;
+        }
+        draw_buffer->damage_last = yt + first * scaley + rows - 1;
+    }
+    memset(dirty + ys, 0, (size_t)lines);
+
+    return 0;
+}
+
 void video_canvas_render(video_canvas_t *canvas, uint8_t *trg, int width,
                          int height, int xs, int ys, int xt, int yt,
                          int pitcht)
 {
     viewport_t *viewport = canvas->viewport;
+    video_render_config_t *config = canvas->videoconfig;
+    draw_buffer_t *draw_buffer = canvas->draw_buffer;
 #ifdef VIDEO_SCALE_SOURCE
     xs /= canvas->videoconfig->scalex;
     ys /= canvas->videoconfig->scaley;
@@ -129,11 +197,44 @@ void video_canvas_render(video_canvas_t *canvas, uint8_t *trg, int width,
 
     if (!canvas->videoconfig->color_tables.updated) { /* update colors as necessary */
         video_color_update_palette(canvas);
+        config->partial_render_valid = 0;
+    }
+
+    draw_buffer->damage_first = INT_MAX;
+    draw_buffer->damage_last = INT_MIN;
+
+    if (video_canvas_render_partial(canvas, trg, width, height, xs, ys, xt, yt, pitcht) < 0) {
+        video_render_main(canvas->videoconfig, canvas->draw_buffer->draw_buffer,
+                          trg, width, height, xs, ys, xt, yt,
+                          canvas->draw_buffer->draw_buffer_width, pitcht,
+                          viewport);
+
+        draw_buffer->damage_first = yt;
+        draw_buffer->damage_last = yt + height - 1;
+
+        if (draw_buffer->dirty_lines != NULL && config->scaley > 0 && ys >= 0) {
+            int lines = (height + config->scaley - 1) / config->scaley;
+
+            if (lines > (int)draw_buffer->draw_buffer_height - ys) {
+                lines = (int)draw_buffer->draw_buffer_height - ys;
+            }
+
+            if (lines > 0) {
+                memset(draw_buffer->dirty_lines + ys, 0, (size_t)lines);
+            }
+        }
     }
-    video_render_main(canvas->videoconfig, canvas->draw_buffer->draw_buffer,
-                      trg, width, height, xs, ys, xt, yt,
-                      canvas->draw_buffer->draw_buffer_width, pitcht,
-                      viewport);
+
+    config->last_render.trg = trg;
+    config->last_render.width = width;
+    config->last_render.height = height;
+    config->last_render.xs = xs;
+    config->last_render.ys = ys;
+    config->last_render.xt = xt;
+    config->last_render.yt = yt;
+    config->last_render.pitcht = pitcht;
+    config->last_render.rendermode = config->rendermode;
+    config->partial_render_valid = 1;
 }
 
 /** \brief Force refresh all tracked canvases.
@@ -56,6 +56,11 @@ void video_render_main(struct video_render_config_s *config, uint8_t *src,
                        int xs, int ys, int xt, int yt,
                        int pitchs, int pitcht,
                        viewport_t *viewport);
+void video_render_area(struct video_render_config_s *config, uint8_t *src,
+                       uint8_t *trg, int width, int height,
+                       int xs, int ys, int xt, int yt,
+                       int pitchs, int pitcht,
+                       viewport_t *viewport);
 void video_render_update_palette(struct video_canvas_s *canvas);
 
 void video_render_palntscfunc_set(render_pal_ntsc_func_t func);
@@ -52,6 +52,8 @@
 #include "archdep.h"
 #include "cmdline.h"
 #include "debug.h"
+#include "goldenframe.h"
+#include "hostprofile.h"
 #include "joystick.h"
 #include "kbdbuf.h"
 #include "lib.h"
@@ -64,6 +66,7 @@
 #endif
 #include "network.h"
 #include "resources.h"
+#include "rewind.h"
 #include "sound.h"
 #include "types.h"
 #include "videoarch.h"
@@ -664,6 +667,12 @@ void vsync_do_vsync(struct video_canvas_s *c)
     tick_t now;
     tick_t network_hook_time = 0;
 
+    hostprofile_vsync();
+
+    rewind_vsync();
+
+    goldenframe_vsync(c);
+
     monitor_vsync_hook();
 
     /*
@@ -0,0 +1,1036 @@
+/*
+ * zarchive.c - Indexed, block compressed container for disk and tape images.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The container holds any number of images ("members").  Every member is
+   split into blocks of the same uncompressed size which are compressed on
+   their own, so any byte of a member can be reached by decompressing one
+   block.  The index is stored at the end of the file:
+
+   header (40 bytes)
+     $00  "VICE-VCA"
+     $08  version (4 bytes)
+     $0c  uncompressed block size (4 bytes)
+     $10  offset of the index (8 bytes)
+     $18  number of blocks (4 bytes)
+     $1c  number of members (4 bytes)
+     $20  size of the name pool (4 bytes)
+     $24  reserved (4 bytes)
+
+   block table, 16 bytes per block
+     $00  offset of the block data (8 bytes)
+     $08  size of the block data (4 bytes)
+     $0c  method: 0 = stored, 1 = deflate
+     $0d  reserved (3 bytes)
+
+   member table, sorted by name, 24 bytes per member
+     $00  uncompressed size (8 bytes)
+     $08  first block (4 bytes)
+     $0c  offset of the name in the name pool (4 bytes)
+     $10  length of the name (4 bytes)
+     $14  reserved (4 bytes)
+
+   name pool, NUL terminated names
+
+   All values are little endian.  */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* fopencookie() */
+#endif
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "archdep.h"
+#include "lib.h"
+#include "log.h"
+#include "types.h"
+#include "util.h"
+#include "zarchive.h"
+
+#define ZARCHIVE_MAGIC          "VICE-VCA"
+#define ZARCHIVE_MAGIC_LEN      8
+#define ZARCHIVE_VERSION        1
+
+#define ZARCHIVE_HEADER_SIZE    40
+#define ZARCHIVE_BLOCK_ENTRY    16
+#define ZARCHIVE_MEMBER_ENTRY   24
+
+#define ZARCHIVE_BLOCK_MIN      0x100
+#define ZARCHIVE_BLOCK_MAX      0x1000000
+
+#define ZARCHIVE_METHOD_STORED  0
+#define ZARCHIVE_METHOD_DEFLATE 1
+
+struct zarchive_block_s {
+    off_t offset;
+    uint32_t csize;
+    uint8_t method;
+};
+typedef struct zarchive_block_s zarchive_block_t;
+
+struct zarchive_member_s {
+    off_t size;
+    unsigned int first_block;
+    const char *name;
+};
+typedef struct zarchive_member_s zarchive_member_t;
+
+struct zarchive_s {
+    FILE *fd;
+    unsigned int block_size;
+    unsigned int num_blocks;
+    unsigned int num_members;
+    zarchive_block_t *blocks;
+    zarchive_member_t *members;
+    char *names;
+
+    /* Buffer for the compressed data.  */
+    uint8_t *cbuf;
+    size_t cbuf_size;
+
+    /* The last block that was decompressed.  */
+    uint8_t *cache;
+    unsigned int cache_block;
+    size_t cache_len;
+};
+
+struct zarchive_writer_member_s {
+    char *name;
+    off_t size;
+    unsigned int first_block;
+};
+typedef struct zarchive_writer_member_s zarchive_writer_member_t;
+
+struct zarchive_writer_s {
+    FILE *fd;
+    char *name;
+    unsigned int block_size;
+    off_t pos;
+
+    uint8_t *ubuf;
+    uint8_t *cbuf;
+    size_t cbuf_size;
+
+    zarchive_block_t *blocks;
+    unsigned int num_blocks;
+    unsigned int blocks_alloc;
+
+    zarchive_writer_member_t *members;
+    unsigned int num_members;
+    unsigned int members_alloc;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static void u64_to_le_buf(uint8_t *buf, uint64_t data)
+{
+    util_dword_to_le_buf(buf, (uint32_t)data);
+    util_dword_to_le_buf(buf + 4, (uint32_t)(data >> 32));
+}
+
+static uint64_t le_buf_to_u64(uint8_t *buf)
+{
+    return (uint64_t)util_le_buf_to_dword(buf)
+           | ((uint64_t)util_le_buf_to_dword(buf + 4) << 32);
+}
+
+/* Number of blocks used by a member of `size' bytes.  */
+static unsigned int blocks_for_size(off_t size, unsigned int block_size)
+{
+    return (unsigned int)((size + block_size - 1) / block_size);
+}
+
+static int read_at(FILE *fd, off_t offset, void *buf, size_t len)
+{
+    if (archdep_fseeko(fd, offset, SEEK_SET) != 0) {
+        return -1;
+    }
+    if (len > 0 && fread(buf, 1, len, fd) != len) {
+        return -1;
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Reading.  */
+
+static int read_index(zarchive_t *arc, const char *name)
+{
+    uint8_t header[ZARCHIVE_HEADER_SIZE];
+    uint8_t *index, *p;
+    off_t file_size, index_offset;
+    size_t index_size;
+    uint32_t names_size;
+    unsigned int i;
+
+    if (read_at(arc->fd, 0, header, ZARCHIVE_HEADER_SIZE) < 0
+        || memcmp(header, ZARCHIVE_MAGIC, ZARCHIVE_MAGIC_LEN) != 0) {
+        return -1;
+    }
+
+    if (util_le_buf_to_dword(header + 8) != ZARCHIVE_VERSION) {
+        log_error(LOG_DEFAULT, "Unsupported version of archive `%s'.", name);
+        return -1;
+    }
+
+    arc->block_size = util_le_buf_to_dword(header + 12);
+    index_offset = (off_t)le_buf_to_u64(header + 16);
+    arc->num_blocks = util_le_buf_to_dword(header + 24);
+    arc->num_members = util_le_buf_to_dword(header + 28);
+    names_size = util_le_buf_to_dword(header + 32);
+
+    file_size = archdep_file_size(arc->fd);
+    if (arc->block_size < ZARCHIVE_BLOCK_MIN
+        || arc->block_size > ZARCHIVE_BLOCK_MAX
+        || arc->num_blocks > 0x1000000
+        || arc->num_members > 0x1000000
+        || names_size > 0x1000000
+        || index_offset < ZARCHIVE_HEADER_SIZE
+        || index_offset > file_size) {
+        log_error(LOG_DEFAULT, "Corrupt header in archive `%s'.", name);
+        return -1;
+    }
+
+    index_size = (size_t)arc->num_blocks * ZARCHIVE_BLOCK_ENTRY
+                 + (size_t)arc->num_members * ZARCHIVE_MEMBER_ENTRY;
+    if ((off_t)(index_size + names_size) != file_size - index_offset) {
+        log_error(LOG_DEFAULT, "Corrupt index in archive `%s'.", name);
+        return -1;
+    }
+
+    index = lib_malloc(index_size + 1);
+    arc->names = lib_malloc((size_t)names_size + 1);
+    if (read_at(arc->fd, index_offset, index, index_size) < 0
+        || (names_size > 0 && fread(arc->names, 1, names_size, arc->fd)
+                              != names_size)) {
+        lib_free(index);
+        log_error(LOG_DEFAULT, "Cannot read index of archive `%s'.", name);
+        return -1;
+    }
+    arc->names[names_size] = 0;
+
+    arc->blocks = lib_calloc(arc->num_blocks + 1, sizeof(zarchive_block_t));
+    arc->members = lib_calloc(arc->num_members + 1, sizeof(zarchive_member_t));
+
+    p = index;
+    for (i = 0; i < arc->num_blocks; i++, p += ZARCHIVE_BLOCK_ENTRY) {
+        zarchive_block_t *block = &arc->blocks[i];
+
+        block->offset = (off_t)le_buf_to_u64(p);
+        block->csize = util_le_buf_to_dword(p + 8);
+        block->method = p[12];
+
+        if (block->offset < ZARCHIVE_HEADER_SIZE
+            || block->offset + (off_t)block->csize > index_offset
+            || block->method > ZARCHIVE_METHOD_DEFLATE
+            || (block->method == ZARCHIVE_METHOD_STORED
+                && block->csize > arc->block_size)) {
+            break;
+        }
+    }
+
+    if (i == arc->num_blocks) {
+        for (i = 0; i < arc->num_members; i++, p += ZARCHIVE_MEMBER_ENTRY) {
+            zarchive_member_t *member = &arc->members[i];
+            uint32_t name_offset, name_len;
+
+            member->size = (off_t)le_buf_to_u64(p);
+            member->first_block = util_le_buf_to_dword(p + 8);
+            name_offset = util_le_buf_to_dword(p + 12);
+            name_len = util_le_buf_to_dword(p + 16);
+
+            if (member->size < 0
+                || member->first_block > arc->num_blocks
+                || blocks_for_size(member->size, arc->block_size)
+                   > arc->num_blocks - member->first_block
+                || name_len == 0
+                || name_offset >= names_size
+                || name_len > names_size - name_offset
+                || arc->names[name_offset + name_len] != 0
+                || strlen(arc->names + name_offset) != name_len) {
+                break;
+            }
+            member->name = arc->names + name_offset;
+
+            /* The members must be sorted for zarchive_find().  */
+            if (i > 0 && strcmp(arc->members[i - 1].name, member->name) >= 0) {
+                break;
+            }
+        }
+    }
+
+    lib_free(index);
+
+    if (i != arc->num_members) {
+        log_error(LOG_DEFAULT, "Corrupt index in archive `%s'.", name);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Open the archive `name' for reading.  */
+zarchive_t *zarchive_open(const char *name)
+{
+    zarchive_t *arc;
+
+    arc = lib_calloc(1, sizeof(zarchive_t));
+    arc->cache_block = (unsigned int)-1;
+
+    arc->fd = fopen(name, MODE_READ);
+    if (arc->fd == NULL || read_index(arc, name) < 0) {
+        zarchive_close(arc);
+        return NULL;
+    }
+
+    arc->cache = lib_malloc(arc->block_size);
+
+    return arc;
+}
+
+void zarchive_close(zarchive_t *arc)
+{
+    if (arc == NULL) {
+        return;
+    }
+
+    if (arc->fd != NULL) {
+        fclose(arc->fd);
+    }
+    lib_free(arc->blocks);
+    lib_free(arc->members);
+    lib_free(arc->names);
+    lib_free(arc->cbuf);
+    lib_free(arc->cache);
+    lib_free(arc);
+}
+
+unsigned int zarchive_num_members(const zarchive_t *arc)
+{
+    return arc->num_members;
+}
+
+const char *zarchive_member_name(const zarchive_t *arc, unsigned int index)
+{
+    if (index >= arc->num_members) {
+        return NULL;
+    }
+    return arc->members[index].name;
+}
+
+off_t zarchive_member_size(const zarchive_t *arc, unsigned int index)
+{
+    if (index >= arc->num_members) {
+        return -1;
+    }
+    return arc->members[index].size;
+}
+
+/* Return the index of `member', or -1 if there is no such member.  */
+int zarchive_find(const zarchive_t *arc, const char *member)
+{
+    unsigned int lo = 0, hi = arc->num_members;
+
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(member, arc->members[mid].name);
+
+        if (cmp == 0) {
+            return (int)mid;
+        }
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return -1;
+}
+
+/* Make block `block' of member `member' the cached block.  */
+static int load_block(zarchive_t *arc, const zarchive_member_t *member,
+                      unsigned int block)
+{
+    const zarchive_block_t *b;
+    unsigned int num = member->first_block + block;
+    size_t ulen;
+
+    if (arc->cache_block == num) {
+        return 0;
+    }
+
+    b = &arc->blocks[num];
+    ulen = (size_t)(member->size - (off_t)block * arc->block_size);
+    if (ulen > arc->block_size) {
+        ulen = arc->block_size;
+    }
+
+    /* Forget the old contents in case the block cannot be read.  */
+    arc->cache_block = (unsigned int)-1;
+
+    if (b->method == ZARCHIVE_METHOD_STORED) {
+        if (b->csize != ulen || read_at(arc->fd, b->offset, arc->cache,
+                                        ulen) < 0) {
+            return -1;
+        }
+    } else {
+#ifdef HAVE_ZLIB
+        uLongf destlen = (uLongf)ulen;
+
+        if (arc->cbuf_size < b->csize) {
+            arc->cbuf = lib_realloc(arc->cbuf, b->csize);
+            arc->cbuf_size = b->csize;
+        }
+        if (read_at(arc->fd, b->offset, arc->cbuf, b->csize) < 0
+            || uncompress(arc->cache, &destlen, arc->cbuf, b->csize) != Z_OK
+            || destlen != ulen) {
+            return -1;
+        }
+#else
+        log_error(LOG_DEFAULT,
+                  "Cannot decompress archive block: no zlib support.");
+        return -1;
+#endif
+    }
+
+    arc->cache_block = num;
+    arc->cache_len = ulen;
+    return 0;
+}
+
+/* Copy up to `len' bytes at `offset' of member `index' to `buf'.  Only the
+   blocks covering the requested range are decompressed.  Return the number
+   of bytes copied, or -1 on error.  */
+int zarchive_read(zarchive_t *arc, unsigned int index, off_t offset,
+                  uint8_t *buf, size_t len)
+{
+    const zarchive_member_t *member;
+    size_t done = 0;
+
+    if (index >= arc->num_members || offset < 0) {
+        return -1;
+    }
+
+    member = &arc->members[index];
+    if (offset >= member->size) {
+        return 0;
+    }
+    if ((off_t)len > member->size - offset) {
+        len = (size_t)(member->size - offset);
+    }
+
+    while (done < len) {
+        unsigned int block = (unsigned int)(offset / arc->block_size);
+        size_t pos = (size_t)(offset % arc->block_size);
+        size_t chunk;
+
+        if (load_block(arc, member, block) < 0) {
+            return -1;
+        }
+
+        chunk = arc->cache_len - pos;
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+        memcpy(buf + done, arc->cache + pos, chunk);
+        done += chunk;
+        offset += (off_t)chunk;
+    }
+
+    return (int)done;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Access to single members through a stdio stream.  */
+
+static int has_archive_extension(const char *name, size_t len)
+{
+    size_t ext_len = strlen(ZARCHIVE_EXTENSION);
+
+    return len > ext_len
+           && util_strncasecmp(name + len - ext_len, ZARCHIVE_EXTENSION,
+                               ext_len) == 0;
+}
+
+static int is_archive_file(const char *name)
+{
+    FILE *fd;
+    char magic[ZARCHIVE_MAGIC_LEN];
+    size_t len;
+    unsigned int isdir;
+    int result;
+
+    if (!has_archive_extension(name, strlen(name))
+        || archdep_stat(name, &len, &isdir) != 0 || isdir) {
+        return 0;
+    }
+
+    fd = fopen(name, MODE_READ);
+    if (fd == NULL) {
+        return 0;
+    }
+    result = fread(magic, 1, ZARCHIVE_MAGIC_LEN, fd) == ZARCHIVE_MAGIC_LEN
+             && memcmp(magic, ZARCHIVE_MAGIC, ZARCHIVE_MAGIC_LEN) == 0;
+    fclose(fd);
+
+    return result;
+}
+
+/* Split `name' into the archive and the member.  `name' is either the name
+   of an archive, which refers to its first member, or the name of an
+   archive followed by a directory separator and the name of a member.  */
+static int split_name(const char *name, char **archive, char **member)
+{
+    const char *sep;
+
+    if (is_archive_file(name)) {
+        *archive = lib_strdup(name);
+        *member = NULL;
+        return 0;
+    }
+
+    sep = strrchr(name, '/');
+    if (ARCHDEP_DIR_SEP_CHR != '/') {
+        const char *p = strrchr(name, ARCHDEP_DIR_SEP_CHR);
+
+        if (sep == NULL || (p != NULL && p > sep)) {
+            sep = p;
+        }
+    }
+
+    if (sep == NULL || sep[1] == 0
+        || !has_archive_extension(name, (size_t)(sep - name))) {
+        return -1;
+    }
+
+    *archive = lib_malloc((size_t)(sep - name) + 1);
+    memcpy(*archive, name, (size_t)(sep - name));
+    (*archive)[sep - name] = 0;
+
+    if (!is_archive_file(*archive)) {
+        lib_free(*archive);
+        return -1;
+    }
+
+    *member = lib_strdup(sep + 1);
+    return 0;
+}
+
+/* Return non-zero if `name' refers to an archive or a member of one.  */
+int zarchive_is_member_name(const char *name)
+{
+    char *archive, *member;
+
+    if (split_name(name, &archive, &member) < 0) {
+        return 0;
+    }
+    lib_free(archive);
+    lib_free(member);
+    return 1;
+}
+
+static zarchive_t *open_member(const char *name, unsigned int *index)
+{
+    zarchive_t *arc;
+    char *archive, *member;
+    int i;
+
+    if (split_name(name, &archive, &member) < 0) {
+        return NULL;
+    }
+
+    arc = zarchive_open(archive);
+    if (arc != NULL) {
+        i = (member != NULL) ? zarchive_find(arc, member)
+                             : (arc->num_members > 0 ? 0 : -1);
+        if (i < 0) {
+            log_error(LOG_DEFAULT, "Cannot find `%s' in archive `%s'.",
+                      member != NULL ? member : "", archive);
+            zarchive_close(arc);
+            arc = NULL;
+        } else {
+            *index = (unsigned int)i;
+        }
+    }
+
+    lib_free(archive);
+    lib_free(member);
+    return arc;
+}
+
+#if defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN)
+
+struct zarchive_cookie_s {
+    zarchive_t *arc;
+    unsigned int index;
+    off_t pos;
+};
+typedef struct zarchive_cookie_s zarchive_cookie_t;
+
+static int cookie_read(zarchive_cookie_t *cookie, char *buf, size_t size)
+{
+    int len;
+
+    len = zarchive_read(cookie->arc, cookie->index, cookie->pos,
+                        (uint8_t *)buf, size);
+    if (len < 0) {
+        errno = EIO;
+        return -1;
+    }
+    cookie->pos += len;
+    return len;
+}
+
+static int cookie_seek(zarchive_cookie_t *cookie, off_t *offset, int whence)
+{
+    off_t pos;
+
+    switch (whence) {
+        case SEEK_SET:
+            pos = *offset;
+            break;
+        case SEEK_CUR:
+            pos = cookie->pos + *offset;
+            break;
+        case SEEK_END:
+            pos = zarchive_member_size(cookie->arc, cookie->index) + *offset;
+            break;
+        default:
+            pos = -1;
+            break;
+    }
+
+    if (pos < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    cookie->pos = pos;
+    *offset = pos;
+    return 0;
+}
+
+static int cookie_close(zarchive_cookie_t *cookie)
+{
+    zarchive_close(cookie->arc);
+    lib_free(cookie);
+    return 0;
+}
+
+#ifdef HAVE_FOPENCOOKIE
+
+static ssize_t zarchive_cookie_read(void *cookie, char *buf, size_t size)
+{
+    return cookie_read(cookie, buf, size);
+}
+
+static int zarchive_cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+    off_t pos = (off_t)*offset;
+
+    if (cookie_seek(cookie, &pos, whence) < 0) {
+        return -1;
+    }
+    *offset = (off64_t)pos;
+    return 0;
+}
+
+static int zarchive_cookie_close(void *cookie)
+{
+    return cookie_close(cookie);
+}
+
+static FILE *open_cookie(zarchive_cookie_t *cookie)
+{
+    cookie_io_functions_t io = {
+        zarchive_cookie_read,
+        NULL,
+        zarchive_cookie_seek,
+        zarchive_cookie_close
+    };
+
+    return fopencookie(cookie, MODE_READ, io);
+}
+
+#else /* HAVE_FUNOPEN */
+
+static int zarchive_cookie_read(void *cookie, char *buf, int size)
+{
+    return cookie_read(cookie, buf, (size_t)size);
+}
+
+static fpos_t zarchive_cookie_seek(void *cookie, fpos_t offset, int whence)
+{
+    off_t pos = (off_t)offset;
+
+    if (cookie_seek(cookie, &pos, whence) < 0) {
+        return -1;
+    }
+    return (fpos_t)pos;
+}
+
+static int zarchive_cookie_close(void *cookie)
+{
+    return cookie_close(cookie);
+}
+
+static FILE *open_cookie(zarchive_cookie_t *cookie)
+{
+    return funopen(cookie, zarchive_cookie_read, NULL, zarchive_cookie_seek,
+                   zarchive_cookie_close);
+}
+
+#endif
+
+/* Open the member `name' as a read-only stream.  The stream decompresses
+   the blocks on demand, so only the parts of the image that are actually
+   accessed are decompressed.  `tmp_name' is always set to NULL.  */
+FILE *zarchive_fopen(const char *name, char **tmp_name)
+{
+    zarchive_cookie_t *cookie;
+    zarchive_t *arc;
+    unsigned int index;
+    FILE *stream;
+
+    *tmp_name = NULL;
+
+    arc = open_member(name, &index);
+    if (arc == NULL) {
+        return NULL;
+    }
+
+    cookie = lib_malloc(sizeof(zarchive_cookie_t));
+    cookie->arc = arc;
+    cookie->index = index;
+    cookie->pos = 0;
+
+    stream = open_cookie(cookie);
+    if (stream == NULL) {
+        cookie_close(cookie);
+    }
+    return stream;
+}
+
+#else
+
+/* Without custom streams, extract the member `name' into a temporary file
+   and open that one read-only.  The name of the temporary file is returned
+   in `tmp_name' and must be removed by the caller.  */
+FILE *zarchive_fopen(const char *name, char **tmp_name)
+{
+    zarchive_t *arc;
+    unsigned int index;
+    off_t pos, size;
+    FILE *fd;
+    int len = 0;
+
+    *tmp_name = NULL;
+
+    arc = open_member(name, &index);
+    if (arc == NULL) {
+        return NULL;
+    }
+
+    fd = archdep_mkstemp_fd(tmp_name, MODE_WRITE);
+    if (fd == NULL) {
+        zarchive_close(arc);
+        return NULL;
+    }
+
+    size = zarchive_member_size(arc, index);
+    for (pos = 0; pos < size; pos += len) {
+        len = zarchive_read(arc, index, pos, arc->cache, arc->block_size);
+        if (len <= 0 || fwrite(arc->cache, 1, (size_t)len, fd) != (size_t)len) {
+            break;
+        }
+    }
+
+    fclose(fd);
+    zarchive_close(arc);
+
+    if (pos < size || (fd = fopen(*tmp_name, MODE_READ)) == NULL) {
+        archdep_remove(*tmp_name);
+        lib_free(*tmp_name);
+        *tmp_name = NULL;
+        return NULL;
+    }
+
+    return fd;
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+/* Writing.  */
+
+/* Create the archive `name'.  The members are added with
+   zarchive_add_file() and the index is written by zarchive_finish().  */
+zarchive_writer_t *zarchive_create(const char *name, unsigned int block_size)
+{
+    zarchive_writer_t *w;
+    uint8_t header[ZARCHIVE_HEADER_SIZE];
+
+    if (block_size < ZARCHIVE_BLOCK_MIN || block_size > ZARCHIVE_BLOCK_MAX) {
+        return NULL;
+    }
+
+    w = lib_calloc(1, sizeof(zarchive_writer_t));
+    w->fd = fopen(name, MODE_WRITE);
+    if (w->fd == NULL) {
+        log_error(LOG_DEFAULT, "Cannot create archive `%s'.", name);
+        lib_free(w);
+        return NULL;
+    }
+
+    w->name = lib_strdup(name);
+    w->block_size = block_size;
+    w->ubuf = lib_malloc(block_size);
+#ifdef HAVE_ZLIB
+    w->cbuf_size = compressBound(block_size);
+    w->cbuf = lib_malloc(w->cbuf_size);
+#endif
+
+    /* The header is written again once the index is known.  */
+    memset(header, 0, ZARCHIVE_HEADER_SIZE);
+    if (fwrite(header, 1, ZARCHIVE_HEADER_SIZE, w->fd)
+        != ZARCHIVE_HEADER_SIZE) {
+        zarchive_abort(w);
+        return NULL;
+    }
+    w->pos = ZARCHIVE_HEADER_SIZE;
+
+    return w;
+}
+
+static int write_block(zarchive_writer_t *w, size_t len)
+{
+    zarchive_block_t *block;
+    const uint8_t *data = w->ubuf;
+    size_t csize = len;
+    uint8_t method = ZARCHIVE_METHOD_STORED;
+
+#ifdef HAVE_ZLIB
+    uLongf destlen = (uLongf)w->cbuf_size;
+
+    /* Keep the block uncompressed if it does not get any smaller.  */
+    if (compress2(w->cbuf, &destlen, w->ubuf, (uLong)len,
+                  Z_BEST_COMPRESSION) == Z_OK && destlen < len) {
+        data = w->cbuf;
+        csize = destlen;
+        method = ZARCHIVE_METHOD_DEFLATE;
+    }
+#endif
+
+    if (fwrite(data, 1, csize, w->fd) != csize) {
+        return -1;
+    }
+
+    if (w->num_blocks == w->blocks_alloc) {
+        w->blocks_alloc = w->blocks_alloc ? w->blocks_alloc * 2 : 64;
+        w->blocks = lib_realloc(w->blocks,
+                                w->blocks_alloc * sizeof(zarchive_block_t));
+    }
+
+    block = &w->blocks[w->num_blocks++];
+    block->offset = w->pos;
+    block->csize = (uint32_t)csize;
+    block->method = method;
+
+    w->pos += (off_t)csize;
+    return 0;
+}
+
+/* Add the host file `path' as member `member'.  */
+int zarchive_add_file(zarchive_writer_t *w, const char *member,
+                      const char *path)
+{
+    zarchive_writer_member_t *m;
+    FILE *fd;
+    size_t len;
+    unsigned int i;
+
+    if (member[0] == 0 || strchr(member, '/') != NULL
+        || strchr(member, ARCHDEP_DIR_SEP_CHR) != NULL) {
+        log_error(LOG_DEFAULT, "Invalid member name `%s'.", member);
+        return -1;
+    }
+
+    for (i = 0; i < w->num_members; i++) {
+        if (strcmp(w->members[i].name, member) == 0) {
+            log_error(LOG_DEFAULT, "Duplicate member name `%s'.", member);
+            return -1;
+        }
+    }
+
+    fd = fopen(path, MODE_READ);
+    if (fd == NULL) {
+        log_error(LOG_DEFAULT, "Cannot open `%s' for reading.", path);
+        return -1;
+    }
+
+    if (w->num_members == w->members_alloc) {
+        w->members_alloc = w->members_alloc ? w->members_alloc * 2 : 16;
+        w->members = lib_realloc(w->members, w->members_alloc
+                                 * sizeof(zarchive_writer_member_t));
+    }
+
+    m = &w->members[w->num_members];
+    m->first_block = w->num_blocks;
+    m->size = 0;
+
+    while ((len = fread(w->ubuf, 1, w->block_size, fd)) > 0) {
+        if (write_block(w, len) < 0) {
+            log_error(LOG_DEFAULT, "Cannot write archive `%s'.", w->name);
+            fclose(fd);
+            return -1;
+        }
+        m->size += (off_t)len;
+    }
+
+    if (ferror(fd)) {
+        log_error(LOG_DEFAULT, "Cannot read `%s'.", path);
+        fclose(fd);
+        return -1;
+    }
+    fclose(fd);
+
+    m->name = lib_strdup(member);
+    w->num_members++;
+    return 0;
+}
+
+static int member_compare(const void *a, const void *b)
+{
+    return strcmp(((const zarchive_writer_member_t *)a)->name,
+                  ((const zarchive_writer_member_t *)b)->name);
+}
+
+static void free_writer(zarchive_writer_t *w)
+{
+    unsigned int i;
+
+    for (i = 0; i < w->num_members; i++) {
+        lib_free(w->members[i].name);
+    }
+    lib_free(w->members);
+    lib_free(w->blocks);
+    lib_free(w->ubuf);
+    lib_free(w->cbuf);
+    lib_free(w->name);
+    lib_free(w);
+}
+
+/* Write the index and close the archive.  */
+int zarchive_finish(zarchive_writer_t *w)
+{
+    uint8_t header[ZARCHIVE_HEADER_SIZE];
+    uint8_t *index, *p;
+    size_t index_size, names_size = 0;
+    unsigned int i;
+    int failed;
+
+    qsort(w->members, w->num_members, sizeof(zarchive_writer_member_t),
+          member_compare);
+
+    for (i = 0; i < w->num_members; i++) {
+        names_size += strlen(w->members[i].name) + 1;
+    }
+
+    index_size = (size_t)w->num_blocks * ZARCHIVE_BLOCK_ENTRY
+                 + (size_t)w->num_members * ZARCHIVE_MEMBER_ENTRY;
+    index = lib_calloc(1, index_size + names_size + 1);
+
+    p = index;
+    for (i = 0; i < w->num_blocks; i++, p += ZARCHIVE_BLOCK_ENTRY) {
+        u64_to_le_buf(p, (uint64_t)w->blocks[i].offset);
+        util_dword_to_le_buf(p + 8, w->blocks[i].csize);
+        p[12] = w->blocks[i].method;
+    }
+
+    names_size = 0;
+    for (i = 0; i < w->num_members; i++, p += ZARCHIVE_MEMBER_ENTRY) {
+        size_t len = strlen(w->members[i].name);
+
+        u64_to_le_buf(p, (uint64_t)w->members[i].size);
+        util_dword_to_le_buf(p + 8, w->members[i].first_block);
+        util_dword_to_le_buf(p + 12, (uint32_t)names_size);
+        util_dword_to_le_buf(p + 16, (uint32_t)len);
+        memcpy(index + index_size + names_size, w->members[i].name, len + 1);
+        names_size += len + 1;
+    }
+
+    memset(header, 0, ZARCHIVE_HEADER_SIZE);
+    memcpy(header, ZARCHIVE_MAGIC, ZARCHIVE_MAGIC_LEN);
+    util_dword_to_le_buf(header + 8, ZARCHIVE_VERSION);
+    util_dword_to_le_buf(header + 12, w->block_size);
+    u64_to_le_buf(header + 16, (uint64_t)w->pos);
+    util_dword_to_le_buf(header + 24, w->num_blocks);
+    util_dword_to_le_buf(header + 28, w->num_members);
+    util_dword_to_le_buf(header + 32, (uint32_t)names_size);
+
+    failed = fwrite(index, 1, index_size + names_size, w->fd)
+             != index_size + names_size
+             || archdep_fseeko(w->fd, 0, SEEK_SET) != 0
+             || fwrite(header, 1, ZARCHIVE_HEADER_SIZE, w->fd)
+                != ZARCHIVE_HEADER_SIZE;
+
+    lib_free(index);
+
+    if (fclose(w->fd) != 0) {
+        failed = 1;
+    }
+    w->fd = NULL;
+
+    if (failed) {
+        log_error(LOG_DEFAULT, "Cannot write archive `%s'.", w->name);
+        archdep_remove(w->name);
+        free_writer(w);
+        return -1;
+    }
+
+    free_writer(w);
+    return 0;
+}
+
+/* Close and remove an unfinished archive.  */
+void zarchive_abort(zarchive_writer_t *w)
+{
+    if (w->fd != NULL) {
+        fclose(w->fd);
+        archdep_remove(w->name);
+    }
+    free_writer(w);
+}
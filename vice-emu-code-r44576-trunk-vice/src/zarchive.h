@@ -0,0 +1,61 @@
+/*
+ * zarchive.h - Indexed, block compressed container for disk and tape images.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_ZARCHIVE_H
+#define VICE_ZARCHIVE_H
+
+#include <stdio.h>
+
+#include "types.h"
+
+#define ZARCHIVE_EXTENSION          ".vca"
+
+/* Default size of the uncompressed blocks.  */
+#define ZARCHIVE_BLOCK_SIZE         0x10000
+
+typedef struct zarchive_s zarchive_t;
+typedef struct zarchive_writer_s zarchive_writer_t;
+
+/* Reading.  */
+zarchive_t *zarchive_open(const char *name);
+void zarchive_close(zarchive_t *arc);
+
+unsigned int zarchive_num_members(const zarchive_t *arc);
+const char *zarchive_member_name(const zarchive_t *arc, unsigned int index);
+off_t zarchive_member_size(const zarchive_t *arc, unsigned int index);
+int zarchive_find(const zarchive_t *arc, const char *member);
+int zarchive_read(zarchive_t *arc, unsigned int index, off_t offset,
+                  uint8_t *buf, size_t len);
+
+/* Access to single members through a stdio stream.  */
+int zarchive_is_member_name(const char *name);
+FILE *zarchive_fopen(const char *name, char **tmp_name);
+
+/* Writing.  */
+zarchive_writer_t *zarchive_create(const char *name, unsigned int block_size);
+int zarchive_add_file(zarchive_writer_t *w, const char *member,
+                      const char *path);
+int zarchive_finish(zarchive_writer_t *w);
+void zarchive_abort(zarchive_writer_t *w);
+
+#endif
@@ -55,6 +55,7 @@
 #include "lib.h"
 #include "log.h"
 #include "util.h"
+#include "zarchive.h"
 #include "zipcode.h"
 
 #include "zfile.h"
@@ -78,7 +79,8 @@ enum compression_type {
     COMPR_ARCHIVE,
     COMPR_ZIPCODE,
     COMPR_LYNX,
-    COMPR_TZX
+    COMPR_TZX,
+    COMPR_ZARCHIVE
 };
 
 /* This defines a linked list of all the compressed files that have been
@@ -955,6 +957,12 @@ static int zfile_compress(const char *src, const char *dest,
         return -1;
     }
 
+    /* This shouldn't happen */
+    if (type == COMPR_ZARCHIVE) {
+        log_error(zlog, "compress: trying to compress indexed archive.");
+        return -1;
+    }
+
     /* Check whether `compression_type' is a known one.  */
     if (type != COMPR_GZIP && type != COMPR_BZIP) {
         log_error(zlog, "compress: unknown compression type");
@@ -1052,6 +1060,24 @@ FILE *zfile_fopen(const char *name, const char *mode)
         write_mode = 1;
     }
 
+    /* Members of indexed archives are read directly from the archive and
+       cannot be written.  */
+    if (zarchive_is_member_name(name)) {
+        if (write_mode) {
+            errno = EACCES;
+            return NULL;
+        }
+        stream = zarchive_fopen(name, &tmp_name);
+        if (stream == NULL) {
+            return NULL;
+        }
+        zfile_list_add(tmp_name, name, COMPR_ZARCHIVE, 0, stream, NULL);
+        if (tmp_name != NULL) {
+            lib_free(tmp_name);
+        }
+        return stream;
+    }
+
     /* Check for write permissions.  */
     if (write_mode && archdep_access(name, ARCHDEP_ACCESS_W_OK) < 0) {
         return NULL;